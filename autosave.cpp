@@ -0,0 +1,228 @@
+#include "autosave.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QtConcurrent/QtConcurrent>
+
+// Pause of editing after which the changed sessions are written.
+const static int idleDelayMilliseconds = 3000;
+
+// Key of the recovery file holding the patient data file the changes belong to.
+const static QString recoveryOfKey = "recoveryOf";
+
+Autosave::Autosave(QObject *parent)
+    : QObject(parent)
+{
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(idleDelayMilliseconds);
+    connect(&m_idleTimer, &QTimer::timeout, this, &Autosave::save);
+
+    // Started by the first change after a write, so that continuous editing is written at the
+    // latest after the interval.
+    m_intervalTimer.setSingleShot(true);
+    m_intervalTimer.setInterval(60 * 1000);
+    connect(&m_intervalTimer, &QTimer::timeout, this, &Autosave::save);
+
+    m_writeThreadPool.setMaxThreadCount(1);
+}
+
+Autosave::~Autosave()
+{
+    m_writeThreadPool.waitForDone();
+}
+
+void Autosave::setInterval(int seconds)
+{
+    m_intervalTimer.setInterval(seconds * 1000);
+}
+
+void Autosave::addPatientSession(PatientSession *patientSession)
+{
+    m_recoveries.insert(patientSession, recovery_t());
+
+    connect(patientSession, &PatientSession::edited, this, &Autosave::patientSessionChanged);
+    connect(patientSession, &PatientSession::changedSinceLastSaveChanged, this, &Autosave::patientSessionChangedSinceLastSaveChanged);
+}
+
+// Removes the recovery file of the passed session, e.g. when it is closed. Unsaved changes
+// are discarded by the user then.
+void Autosave::removePatientSession(PatientSession *patientSession)
+{
+    if(!m_recoveries.contains(patientSession))
+    {
+        return;
+    }
+
+    auto recovery = m_recoveries.take(patientSession);
+
+    m_changedPatientSessions.remove(patientSession);
+    disconnect(patientSession, nullptr, this, nullptr);
+
+    if(!recovery.fileName.isEmpty())
+    {
+        (void)QtConcurrent::run(&m_writeThreadPool, removeRecoveryFile, recovery.fileName, recovery.lockFile);
+    }
+}
+
+// Lets the passed session continue the recovery file it has been restored from.
+void Autosave::setRecoveryFileName(PatientSession *patientSession, const QString& recoveryFileName)
+{
+    if(!m_recoveries.contains(patientSession))
+    {
+        return;
+    }
+
+    auto& recovery = m_recoveries[patientSession];
+
+    recovery.fileName = recoveryFileName;
+    recovery.lockFile = QSharedPointer<QLockFile>::create(recoveryFileName + ".lock");
+    recovery.lockFile->tryLock(0);
+}
+
+// Returns the recovery files left behind by programs which are not running anymore, the
+// latest first.
+QVector<Autosave::recovery_file_t> Autosave::recoveryFiles() const
+{
+    QVector<recovery_file_t> recoveryFiles;
+    QDir directory(recoveryDirectory());
+
+    for(const auto& fileInfo : directory.entryInfoList({"*.json"}, QDir::Files, QDir::Time))
+    {
+        // A lock which cannot be taken is held by a running program, a lock of a program which
+        // has been terminated is taken over as stale lock.
+        QLockFile lockFile(fileInfo.absoluteFilePath() + ".lock");
+
+        if(!lockFile.tryLock(0))
+        {
+            continue;
+        }
+
+        QFile recoveryFile(fileInfo.absoluteFilePath());
+
+        if(!recoveryFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            continue;
+        }
+
+        QJsonObject recoveryJsonObject = QJsonDocument::fromJson(recoveryFile.readAll()).object();
+
+        recovery_file_t recovery;
+
+        recovery.fileName = fileInfo.absoluteFilePath();
+        recovery.patientDataFileName = recoveryJsonObject[recoveryOfKey].toString();
+        recovery.patientName = recoveryJsonObject["name"].toString();
+        recovery.lastModified = fileInfo.lastModified();
+
+        recoveryFiles.append(recovery);
+    }
+
+    return recoveryFiles;
+}
+
+void Autosave::discardRecoveryFile(const QString& recoveryFileName)
+{
+    QFile::remove(recoveryFileName);
+}
+
+QString Autosave::recoveryDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/recovery";
+}
+
+void Autosave::patientSessionChanged()
+{
+    auto patientSession = qobject_cast<PatientSession*>(sender());
+
+    if(!m_recoveries.contains(patientSession))
+    {
+        return;
+    }
+
+    m_changedPatientSessions.insert(patientSession);
+
+    m_idleTimer.start();
+
+    if(!m_intervalTimer.isActive())
+    {
+        m_intervalTimer.start();
+    }
+}
+
+// A session saved (or undone back to the saved state) does not need its recovery file anymore.
+void Autosave::patientSessionChangedSinceLastSaveChanged(bool changedSinceLastSave)
+{
+    auto patientSession = qobject_cast<PatientSession*>(sender());
+
+    if(changedSinceLastSave || !m_recoveries.contains(patientSession))
+    {
+        return;
+    }
+
+    const auto& recovery = m_recoveries[patientSession];
+
+    m_changedPatientSessions.remove(patientSession);
+
+    if(!recovery.fileName.isEmpty())
+    {
+        (void)QtConcurrent::run(&m_writeThreadPool, removeRecoveryFile, recovery.fileName, QSharedPointer<QLockFile>());
+    }
+}
+
+// Takes a snapshot of each changed session and writes it in the background. The snapshot
+// shares the table columns with the models, which copy a column only when it is modified
+// afterwards, so taking it does not depend on the size of the tables.
+void Autosave::save()
+{
+    m_idleTimer.stop();
+    m_intervalTimer.stop();
+
+    for(auto patientSession : std::as_const(m_changedPatientSessions))
+    {
+        if(!patientSession->changedSinceLastSave() || patientSession->isLoading())
+        {
+            continue;
+        }
+
+        auto& recovery = m_recoveries[patientSession];
+
+        if(recovery.fileName.isEmpty())
+        {
+            QDir().mkpath(recoveryDirectory());
+
+            setRecoveryFileName(patientSession, recoveryDirectory() + "/" + QUuid::createUuid().toString(QUuid::WithoutBraces) + ".json");
+        }
+
+        (void)QtConcurrent::run(&m_writeThreadPool, writeRecoveryFile, recovery.fileName, patientSession->fileName(), patientSession->patientData());
+    }
+
+    m_changedPatientSessions.clear();
+}
+
+// Runs on the write thread: writes the patient data like a patient data file along with the
+// file it belongs to.
+void Autosave::writeRecoveryFile(const QString& recoveryFileName, const QString& patientDataFileName,
+                                 const PatientDataFile::patient_data_t& patientData)
+{
+    QJsonObject recoveryJsonObject = PatientDataFile::toJson(patientData);
+
+    recoveryJsonObject[recoveryOfKey] = patientDataFileName;
+
+    QSaveFile recoveryFile(recoveryFileName);
+
+    if(recoveryFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        recoveryFile.write(QJsonDocument(recoveryJsonObject).toJson(QJsonDocument::Compact));
+        recoveryFile.commit();
+    }
+}
+
+// Runs on the write thread, after the writes queued before. If passed, the lock file is
+// released after the recovery file has been removed.
+void Autosave::removeRecoveryFile(const QString& recoveryFileName, QSharedPointer<QLockFile> lockFile)
+{
+    QFile::remove(recoveryFileName);
+}
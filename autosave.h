@@ -0,0 +1,80 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QLockFile>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QTimer>
+#include "patientsession.h"
+
+// Writes the unsaved changes of the open patient sessions to recovery files, so that they
+// survive the program not being closed properly (e.g. a reboot overnight). A session is
+// written when editing pauses and at the latest after the autosave interval. The patient
+// data is taken as snapshot on the main thread, which only copies the shared table columns,
+// and serialized on a background thread, so editing does not wait for the write. Recovery
+// files are locked while their session is open, recovery files left behind by a program
+// which is not running anymore can be restored on the next start.
+class Autosave : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        QString fileName;
+
+        // File the session was opened from or saved to, empty for a new patient.
+        QString patientDataFileName;
+
+        QString patientName;
+        QDateTime lastModified;
+    } recovery_file_t;
+
+    explicit Autosave(QObject *parent = nullptr);
+    ~Autosave();
+
+    void setInterval(int seconds);
+
+    void addPatientSession(PatientSession *patientSession);
+    void removePatientSession(PatientSession *patientSession);
+    void setRecoveryFileName(PatientSession *patientSession, const QString& recoveryFileName);
+
+    QVector<recovery_file_t> recoveryFiles() const;
+    void discardRecoveryFile(const QString& recoveryFileName);
+
+    static QString recoveryDirectory();
+
+private slots:
+    void patientSessionChanged();
+    void patientSessionChangedSinceLastSaveChanged(bool changedSinceLastSave);
+    void save();
+
+private:
+    typedef struct
+    {
+        // Chosen when the session is written first.
+        QString fileName;
+        QSharedPointer<QLockFile> lockFile;
+    } recovery_t;
+
+    QHash<PatientSession*, recovery_t> m_recoveries;
+
+    // Sessions changed since they have been written last.
+    QSet<PatientSession*> m_changedPatientSessions;
+
+    QTimer m_idleTimer;
+    QTimer m_intervalTimer;
+
+    // A single thread keeps the writes and removals of a recovery file in order.
+    QThreadPool m_writeThreadPool;
+
+    static void writeRecoveryFile(const QString& recoveryFileName, const QString& patientDataFileName,
+                                  const PatientDataFile::patient_data_t& patientData);
+    static void removeRecoveryFile(const QString& recoveryFileName, QSharedPointer<QLockFile> lockFile);
+};
+
+#endif // AUTOSAVE_H
@@ -0,0 +1,426 @@
+#include "mainwindow.h"
+#include <QApplication>
+#include <QCheckBox>
+#include <QCommandLineParser>
+#include <QDate>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTabWidget>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+
+// Performance regression gate run by CTest. Measures the wall time and the number of heap
+// allocations of the scenarios below on the main window (median of some repetitions) and
+// fails if one of them exceeds the committed baseline by more than its tolerance, or if the
+// baseline has not been recorded. Exits with 0 if all scenarios are within the baseline and
+// 1 otherwise.
+//
+// Allocations are counted by replacing malloc(), calloc() and realloc() of the C library, so
+// the data of Qt containers is counted as well as operator new, which calls malloc(). This
+// needs glibc, elsewhere the allocations are neither measured nor compared.
+
+const static int bloodSampleRowCount = 10000;
+const static int chemoAndMedRowCount = 500;
+const static int repetitionCount = 5;
+const static int loadTimeoutMilliseconds = 60000;
+
+const static int exitCodeRegression = 1;
+
+const static QString scenarioLoad = "load10kRows";
+const static QString scenarioToggleCheckBoxes = "toggleCheckBoxes";
+const static QString scenarioSave = "save10kRows";
+
+static std::atomic<qint64> allocationCount(0);
+
+#if defined(__GLIBC__)
+const static bool allocationsCounted = true;
+
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void *pointer, size_t size);
+
+// Defined by the executable, these take the place of the ones of the C library for all
+// libraries of the process. free() is left as it is.
+void* malloc(size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void *pointer, size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    return __libc_realloc(pointer, size);
+}
+}
+#else
+const static bool allocationsCounted = false;
+#endif
+
+typedef struct
+{
+    qint64 milliseconds;
+    qint64 allocations;
+} measurement_t;
+
+// Measures the passed step, which returns false if it has failed.
+static bool measure(const std::function<bool()>& step, QVector<measurement_t>& measurements)
+{
+    QElapsedTimer timer;
+    auto allocationsBefore = allocationCount.load();
+
+    timer.start();
+
+    if(!step())
+    {
+        return false;
+    }
+
+    measurements.append({timer.elapsed(), allocationCount.load() - allocationsBefore});
+
+    return true;
+}
+
+static measurement_t median(QVector<measurement_t> measurements)
+{
+    measurement_t result;
+    auto middle = measurements.size() / 2;
+
+    std::nth_element(measurements.begin(), measurements.begin() + middle, measurements.end(),
+                     [](const measurement_t& a, const measurement_t& b) { return a.milliseconds < b.milliseconds; });
+    result.milliseconds = measurements[middle].milliseconds;
+
+    std::nth_element(measurements.begin(), measurements.begin() + middle, measurements.end(),
+                     [](const measurement_t& a, const measurement_t& b) { return a.allocations < b.allocations; });
+    result.allocations = measurements[middle].allocations;
+
+    return result;
+}
+
+// Patient with a blood sample per day and a chemo therapy every 20 days, values vary so that
+// the visualization has something to scale. Written as JSON with the keys of the patient data
+// file, so that the measurements stay comparable while the program changes.
+static bool writePatientDataFile(const QString& fileName)
+{
+    const QDate firstDay(1990, 1, 1);
+    const QVector<QString> bloodValueKeys {"leukocytes", "erythrocytes", "hemoglobin", "thrombocytes"};
+    const QVector<QString> medicationNames {"Cytarabine", "Daunorubicin", "Etoposide"};
+
+    QJsonObject patientDataJsonObject;
+    QJsonArray bloodSamplesArray;
+    QJsonArray chemoAndMedsArray;
+
+    patientDataJsonObject["patientId"] = "benchmark";
+    patientDataJsonObject["name"] = "Benchmark, Patient";
+
+    for(auto row = 0; row < bloodSampleRowCount; row++)
+    {
+        QJsonObject bloodSampleJsonObject;
+
+        bloodSampleJsonObject["date"] = firstDay.addDays(row).toString("dd.MM.yyyy");
+
+        for(auto i = 0; i < bloodValueKeys.size(); i++)
+        {
+            bloodSampleJsonObject[bloodValueKeys[i]] = ((row * (7 + i)) % 100) / 10.0 + i;
+        }
+
+        bloodSamplesArray.append(bloodSampleJsonObject);
+    }
+
+    for(auto row = 0; row < chemoAndMedRowCount; row++)
+    {
+        QJsonObject chemoAndMedJsonObject;
+
+        chemoAndMedJsonObject["date"] = firstDay.addDays(row * 20).toString("dd.MM.yyyy");
+        chemoAndMedJsonObject["days"] = "5";
+        chemoAndMedJsonObject["name"] = medicationNames[row % medicationNames.size()];
+        chemoAndMedJsonObject["dose"] = "100 mg";
+
+        chemoAndMedsArray.append(chemoAndMedJsonObject);
+    }
+
+    patientDataJsonObject["bloodSamples"] = bloodSamplesArray;
+    patientDataJsonObject["chemoTherapyAndMedicamentation"] = chemoAndMedsArray;
+
+    QSaveFile file(fileName);
+
+    return file.open(QIODevice::WriteOnly) && file.write(QJsonDocument(patientDataJsonObject).toJson()) >= 0 && file.commit();
+}
+
+// Shows the visualization tab, so that loading plots the visualization as for the user.
+// Returns the tab, nullptr if the main window has none.
+static QWidget* showVisualization(MainWindow& mainWindow)
+{
+    auto tabWidget = mainWindow.findChild<QTabWidget*>("tabWidget");
+
+    for(auto i = 0; tabWidget && i < tabWidget->count(); i++)
+    {
+        if(tabWidget->tabText(i) == "Visualization")
+        {
+            tabWidget->setCurrentIndex(i);
+            return tabWidget->widget(i);
+        }
+    }
+
+    std::cerr << "The main window has no visualization tab." << std::endl;
+
+    return nullptr;
+}
+
+// Opens the passed file and waits until it has been loaded and plotted.
+static bool openPatientDataFile(MainWindow& mainWindow, const QString& fileName)
+{
+    QSignalSpy loadedSpy(&mainWindow, &MainWindow::patientDataFileLoaded);
+
+    mainWindow.openPatientDataFile(fileName);
+
+    if(loadedSpy.isEmpty() && !loadedSpy.wait(loadTimeoutMilliseconds))
+    {
+        std::cerr << "Loading " << qPrintable(fileName) << " has not finished." << std::endl;
+        return false;
+    }
+
+    if(!loadedSpy.first().first().toBool())
+    {
+        std::cerr << "Cannot load " << qPrintable(fileName) << "." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool runLoad(const QString& fileName, QVector<measurement_t>& measurements)
+{
+    for(auto repetition = 0; repetition < repetitionCount; repetition++)
+    {
+        MainWindow mainWindow;
+        mainWindow.show();
+
+        if(!showVisualization(mainWindow) ||
+           !measure([&]() { return openPatientDataFile(mainWindow, fileName); }, measurements))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Each repetition hides and shows everything on the visualization tab once, each click
+// plots the visualization.
+static bool runToggleCheckBoxes(const QString& fileName, QVector<measurement_t>& measurements)
+{
+    MainWindow mainWindow;
+    mainWindow.show();
+
+    auto visualization = showVisualization(mainWindow);
+
+    if(!visualization || !openPatientDataFile(mainWindow, fileName))
+    {
+        return false;
+    }
+
+    auto checkBoxes = visualization->findChildren<QCheckBox*>();
+
+    if(checkBoxes.isEmpty())
+    {
+        std::cerr << "The visualization tab has no check boxes." << std::endl;
+        return false;
+    }
+
+    for(auto repetition = 0; repetition < repetitionCount; repetition++)
+    {
+        auto toggle = [&]()
+        {
+            for(auto checkBox : std::as_const(checkBoxes))
+            {
+                checkBox->click();
+                checkBox->click();
+            }
+
+            return true;
+        };
+
+        if(!measure(toggle, measurements))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Saves the patient to a new file each time, i.e. completely.
+static bool runSave(const QString& fileName, const QString& directory, QVector<measurement_t>& measurements)
+{
+    MainWindow mainWindow;
+    mainWindow.show();
+
+    if(!openPatientDataFile(mainWindow, fileName))
+    {
+        return false;
+    }
+
+    for(auto repetition = 0; repetition < repetitionCount; repetition++)
+    {
+        auto savedFileName = directory + "/saved" + QString::number(repetition) + ".json";
+        auto save = [&]()
+        {
+            mainWindow.savePatientDataFileAs(savedFileName);
+
+            if(!QFileInfo::exists(savedFileName))
+            {
+                std::cerr << "Cannot save " << qPrintable(savedFileName) << "." << std::endl;
+                return false;
+            }
+
+            return true;
+        };
+
+        if(!measure(save, measurements))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns false if the measurement exceeds the baseline value by more than the tolerance or
+// if there is no baseline value.
+static bool withinBaseline(const QString& scenario, const QString& metric, qint64 measured, const QJsonObject& baselineJsonObject)
+{
+    auto baselineValue = baselineJsonObject["scenarios"].toObject()[scenario].toObject()[metric];
+    auto tolerance = baselineJsonObject["tolerance"].toObject();
+
+    if(!baselineValue.isDouble())
+    {
+        std::cout << qPrintable(scenario) << " " << qPrintable(metric) << ": " << measured
+                  << " NO BASELINE, record it with --update-baseline" << std::endl;
+        return false;
+    }
+
+    auto limit = baselineValue.toDouble() * (1.0 + tolerance[metric].toDouble());
+
+    if(metric == "milliseconds")
+    {
+        limit += tolerance["slackMilliseconds"].toDouble();
+    }
+
+    auto successful = measured <= limit;
+
+    std::cout << qPrintable(scenario) << " " << qPrintable(metric) << ": " << measured << " (baseline "
+              << baselineValue.toDouble() << ", limit " << static_cast<qint64>(limit) << ")"
+              << (successful ? "" : " REGRESSION") << std::endl;
+
+    return successful;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication application(argc, argv);
+    QCoreApplication::setApplicationName("leukibenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the performance of Leuki with the baseline.");
+    parser.addHelpOption();
+
+    QCommandLineOption baselineOption("baseline", "Baseline file.", "file");
+    QCommandLineOption updateBaselineOption("update-baseline", "Write the measurements to the baseline file.");
+
+    parser.addOptions({baselineOption, updateBaselineOption});
+    parser.process(application);
+
+    QFile baselineFile(QFileInfo(parser.value(baselineOption)).absoluteFilePath());
+    QJsonObject baselineJsonObject;
+
+    if(baselineFile.open(QIODevice::ReadOnly))
+    {
+        baselineJsonObject = QJsonDocument::fromJson(baselineFile.readAll()).object();
+        baselineFile.close();
+    }
+
+    QTemporaryDir directory;
+    auto fileName = directory.path() + "/patient.json";
+
+    // Settings etc. of the user are left alone, files the main window writes for itself go to
+    // the test locations or to the temporary working directory.
+    QStandardPaths::setTestModeEnabled(true);
+
+    if(!directory.isValid() || !QDir::setCurrent(directory.path()) || !writePatientDataFile(fileName))
+    {
+        std::cerr << "Cannot write the patient data file." << std::endl;
+        return exitCodeRegression;
+    }
+
+    QVector<QPair<QString, QVector<measurement_t>>> scenarios {{scenarioLoad, {}}, {scenarioToggleCheckBoxes, {}}, {scenarioSave, {}}};
+
+    if(!runLoad(fileName, scenarios[0].second) ||
+       !runToggleCheckBoxes(fileName, scenarios[1].second) ||
+       !runSave(fileName, directory.path(), scenarios[2].second))
+    {
+        return exitCodeRegression;
+    }
+
+    auto scenariosJsonObject = baselineJsonObject["scenarios"].toObject();
+    auto successful = true;
+
+    for(const auto& scenario : std::as_const(scenarios))
+    {
+        auto result = median(scenario.second);
+        auto scenarioJsonObject = scenariosJsonObject[scenario.first].toObject();
+
+        successful = withinBaseline(scenario.first, "milliseconds", result.milliseconds, baselineJsonObject) && successful;
+        scenarioJsonObject["milliseconds"] = result.milliseconds;
+
+        if(allocationsCounted)
+        {
+            successful = withinBaseline(scenario.first, "allocations", result.allocations, baselineJsonObject) && successful;
+            scenarioJsonObject["allocations"] = result.allocations;
+        }
+
+        scenariosJsonObject[scenario.first] = scenarioJsonObject;
+    }
+
+    if(parser.isSet(updateBaselineOption))
+    {
+        baselineJsonObject["scenarios"] = scenariosJsonObject;
+
+        QSaveFile updatedBaselineFile(baselineFile.fileName());
+
+        if(!updatedBaselineFile.open(QIODevice::WriteOnly) ||
+           updatedBaselineFile.write(QJsonDocument(baselineJsonObject).toJson(QJsonDocument::Indented)) < 0 ||
+           !updatedBaselineFile.commit())
+        {
+            std::cerr << "Cannot write " << qPrintable(baselineFile.fileName()) << "." << std::endl;
+            return exitCodeRegression;
+        }
+
+        return 0;
+    }
+
+    return successful ? 0 : exitCodeRegression;
+}
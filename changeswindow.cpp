@@ -0,0 +1,177 @@
+#include "changeswindow.h"
+#include "ui_changeswindow.h"
+#include <QFile>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTextStream>
+
+const static QVector<QString> tableWidgetChangesColumns {"Table", "Change", "Date", "Field", "Saved", "Current"};
+
+// Quotes a cell of the exported file if it contains the separator, a quote or a line break.
+static QString csvCell(QString text)
+{
+    if(text.contains(';') || text.contains('"') || text.contains('\n'))
+    {
+        text = "\"" + text.replace("\"", "\"\"") + "\"";
+    }
+
+    return text;
+}
+
+ChangesWindow::ChangesWindow(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::ChangesWindow)
+{
+    ui->setupUi(this);
+
+    ui->tableWidgetChanges->setColumnCount(static_cast<int>(tableWidgetChangesColumns.size()));
+
+    for(auto i = 0; i < tableWidgetChangesColumns.size(); i++)
+    {
+        ui->tableWidgetChanges->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetChangesColumns[i]));
+    }
+}
+
+ChangesWindow::~ChangesWindow()
+{
+    delete ui;
+}
+
+// Fills the table with the changed general information fields, the edited cells, the added
+// and the deleted rows of the passed session.
+void ChangesWindow::showChanges(const PatientSession *patientSession)
+{
+    ui->tableWidgetChanges->setRowCount(0);
+
+    const static QVector<QPair<QString, QString PatientSession::general_information_t::*>> generalInformationFields
+    {
+        {"Patient ID", &PatientSession::general_information_t::patientId},
+        {"Name", &PatientSession::general_information_t::name},
+        {"Date of Birth", &PatientSession::general_information_t::dateOfBirth},
+        {"Size", &PatientSession::general_information_t::size},
+        {"Weight", &PatientSession::general_information_t::weight},
+        {"Body Surface", &PatientSession::general_information_t::bodySurface},
+        {"Date of Diagnosis", &PatientSession::general_information_t::dateOfDiagnosis}
+    };
+
+    const auto& savedGeneralInformation = patientSession->savedGeneralInformation();
+    const auto& generalInformation = patientSession->generalInformation();
+
+    for(const auto& field : generalInformationFields)
+    {
+        if(savedGeneralInformation.*field.second != generalInformation.*field.second)
+        {
+            appendChange("General Information", "Changed", QString(), field.first,
+                         savedGeneralInformation.*field.second, generalInformation.*field.second);
+        }
+    }
+
+    appendTableChanges("Blood Samples", patientSession->bloodSamplesModel());
+    appendTableChanges("Chemo Therapy / Medicamentation", patientSession->chemoAndMedsModel());
+
+    ui->tableWidgetChanges->resizeColumnsToContents();
+
+    ui->labelStatus->setText(ui->tableWidgetChanges->rowCount() ? QString::number(ui->tableWidgetChanges->rowCount()) + " changes since last save" :
+                                                                  QString("No changes since last save"));
+}
+
+void ChangesWindow::appendChange(const QString& table, const QString& change, const QString& date, const QString& field,
+                                 const QString& savedText, const QString& currentText)
+{
+    auto row = ui->tableWidgetChanges->rowCount();
+
+    ui->tableWidgetChanges->insertRow(row);
+
+    QVector<QString> texts {table, change, date, field, savedText, currentText};
+
+    for(auto column = 0; column < texts.size(); column++)
+    {
+        auto item = new QTableWidgetItem(texts[column]);
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+
+        ui->tableWidgetChanges->setItem(row, column, item);
+    }
+}
+
+// Lists a row per dirty cell of the rows kept since the last save, and a row per non-empty
+// cell of the added and the deleted rows.
+void ChangesWindow::appendTableChanges(const QString& table, const PatientTableModel *model)
+{
+    auto dateColumn = model->dateColumn();
+
+    for(auto row = 0; row < model->rowCount(); row++)
+    {
+        const auto& rowState = model->rowState(row);
+
+        for(auto column = 0; column < model->columnCount(); column++)
+        {
+            auto field = model->headerData(column, Qt::Horizontal).toString();
+
+            if(rowState.savedRow < 0)
+            {
+                if(!model->text(row, column).isEmpty())
+                {
+                    appendChange(table, "Added", model->text(row, dateColumn), field, QString(), model->text(row, column));
+                }
+            }
+            else if(rowState.dirtyColumns & (1u << column))
+            {
+                appendChange(table, "Changed", model->text(row, dateColumn), field,
+                             model->savedText(rowState.savedRow, column), model->text(row, column));
+            }
+        }
+    }
+
+    for(auto savedRow : model->deletedSavedRows())
+    {
+        for(auto column = 0; column < model->columnCount(); column++)
+        {
+            if(!model->savedText(savedRow, column).isEmpty())
+            {
+                appendChange(table, "Deleted", model->savedText(savedRow, dateColumn), model->headerData(column, Qt::Horizontal).toString(),
+                             model->savedText(savedRow, column), QString());
+            }
+        }
+    }
+}
+
+// Writes the listed changes as semicolon separated file, e.g. for the patient record.
+void ChangesWindow::on_pushButtonExport_clicked()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Changes"), QString(), tr("CSV (*.csv)"));
+
+    if(fileName.isEmpty())
+    {
+        return;
+    }
+
+    QFile file(fileName);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QMessageBox::warning(this, "Leuki - Export Changes", "File " + fileName + " cannot be written!");
+        return;
+    }
+
+    QTextStream stream(&file);
+    QStringList cells;
+
+    for(const auto& column : tableWidgetChangesColumns)
+    {
+        cells.append(csvCell(column));
+    }
+
+    stream << cells.join(';') << "\n";
+
+    for(auto row = 0; row < ui->tableWidgetChanges->rowCount(); row++)
+    {
+        cells.clear();
+
+        for(auto column = 0; column < ui->tableWidgetChanges->columnCount(); column++)
+        {
+            cells.append(csvCell(ui->tableWidgetChanges->item(row, column)->text()));
+        }
+
+        stream << cells.join(';') << "\n";
+    }
+}
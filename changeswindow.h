@@ -0,0 +1,34 @@
+#ifndef CHANGESWINDOW_H
+#define CHANGESWINDOW_H
+
+#include <QDialog>
+#include "patientsession.h"
+
+namespace Ui {
+class ChangesWindow;
+}
+
+// Lists the changes of a patient since the last save, taken from the change state the table
+// models keep for saving, and exports them.
+class ChangesWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ChangesWindow(QWidget *parent = nullptr);
+    ~ChangesWindow();
+
+    void showChanges(const PatientSession *patientSession);
+
+private slots:
+    void on_pushButtonExport_clicked();
+
+private:
+    Ui::ChangesWindow *ui;
+
+    void appendChange(const QString& table, const QString& change, const QString& date, const QString& field,
+                      const QString& savedText, const QString& currentText);
+    void appendTableChanges(const QString& table, const PatientTableModel *model);
+};
+
+#endif // CHANGESWINDOW_H
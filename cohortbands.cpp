@@ -0,0 +1,406 @@
+#include "cohortbands.h"
+#include "cycleanalysis.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QDataStream>
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <limits>
+
+const static QString bandsFileName = ".leukiCohortBands";
+const static quint32 bandsFileMagic = 0x4c4b4342;
+const static quint32 bandsFileVersion = 1;
+
+// Sketches per patient and of the cohort, one per lab parameter and cycle day.
+const static int sketchCount = static_cast<int>(PatientDataSchema::labParameterCount) * CycleAnalysis::maximumCycleDays;
+
+// Writes the passed data to the passed file atomically.
+static void writeBandsFile(const QString& fileName, const QByteArray& data)
+{
+    QSaveFile file(fileName);
+
+    if(file.open(QIODevice::WriteOnly))
+    {
+        file.write(data);
+        file.commit();
+    }
+}
+
+// Most sketches of a patient are empty, only the others are written with their index.
+static QDataStream& operator<<(QDataStream& stream, const CohortBands::patient_sketches_t& patient)
+{
+    QVector<qint32> indices;
+
+    for(auto i = 0; i < patient.sketches.size(); i++)
+    {
+        if(!patient.sketches[i].isEmpty())
+        {
+            indices.append(i);
+        }
+    }
+
+    stream << patient.fileName << patient.size << patient.lastModified << static_cast<qint32>(patient.sketches.size()) << indices;
+
+    for(auto index : indices)
+    {
+        stream << patient.sketches[index];
+    }
+
+    return stream;
+}
+
+static QDataStream& operator>>(QDataStream& stream, CohortBands::patient_sketches_t& patient)
+{
+    qint32 patientSketchCount = 0;
+    QVector<qint32> indices;
+
+    stream >> patient.fileName >> patient.size >> patient.lastModified >> patientSketchCount >> indices;
+
+    patient.sketches = QVector<QuantileSketch>(std::max(patientSketchCount, 0));
+
+    for(auto index : indices)
+    {
+        if(index < 0 || index >= patient.sketches.size())
+        {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+
+        stream >> patient.sketches[index];
+    }
+
+    return stream;
+}
+
+CohortBands::CohortBands(QObject *parent)
+    : QObject(parent)
+    , m_buildPending(false)
+{
+    connect(&m_buildWatcher, &QFutureWatcher<build_result_t>::finished, this, &CohortBands::handleBuildResult);
+
+    // A single thread keeps builds and writes of the bands file in order, the files of a build
+    // are read in parallel.
+    m_threadPool.setMaxThreadCount(1);
+}
+
+CohortBands::~CohortBands()
+{
+    m_threadPool.waitForDone();
+}
+
+// Loads the bands of the passed directory, build() brings them up to date.
+void CohortBands::setDirectory(const QString& directory)
+{
+    if(directory == m_directory)
+    {
+        return;
+    }
+
+    m_directory = directory;
+
+    load();
+}
+
+QString CohortBands::directory() const
+{
+    return m_directory;
+}
+
+// Checks size and modification time of all patient data files of the directory in the
+// background, only new and changed files are read.
+void CohortBands::build()
+{
+    if(m_directory.isEmpty())
+    {
+        return;
+    }
+
+    if(m_buildWatcher.isRunning())
+    {
+        m_buildPending = true;
+        return;
+    }
+
+    m_buildDirectory = m_directory;
+    m_buildWatcher.setFuture(QtConcurrent::run(&m_threadPool, buildSketches, m_directory, m_patientSketches, m_cohortSketches));
+}
+
+bool CohortBands::isBuilding() const
+{
+    return m_buildWatcher.isRunning();
+}
+
+int CohortBands::patientCount() const
+{
+    return static_cast<int>(m_patientSketches.size());
+}
+
+// Returns the passed quantile (0..1) of a blood value (in the column order of the blood
+// sample table) of all patients for each cycle day, starting with day 1. NaN on days without
+// values.
+QVector<double> CohortBands::band(int parameterColumn, double fraction) const
+{
+    QVector<double> values(CycleAnalysis::maximumCycleDays, std::numeric_limits<double>::quiet_NaN());
+
+    if(PatientDataSchema::labParameterIndex(parameterColumn) < 0 || m_cohortSketches.isEmpty())
+    {
+        return values;
+    }
+
+    for(auto cycleDay = 1; cycleDay <= CycleAnalysis::maximumCycleDays; cycleDay++)
+    {
+        values[cycleDay - 1] = m_cohortSketches[sketchIndex(parameterColumn, cycleDay)].quantile(fraction);
+    }
+
+    return values;
+}
+
+void CohortBands::handleBuildResult()
+{
+    build_result_t result = m_buildWatcher.result();
+
+    // Results of a previous directory are dropped.
+    if(m_buildDirectory == m_directory && result.changed)
+    {
+        m_patientSketches = result.patientSketches;
+        m_cohortSketches = result.cohortSketches;
+
+        save();
+    }
+
+    if(m_buildPending)
+    {
+        m_buildPending = false;
+        build();
+    }
+    else
+    {
+        emit built();
+    }
+}
+
+// Loads the bands file of the directory. A missing or unreadable bands file results in empty
+// bands which are filled by the next build.
+void CohortBands::load()
+{
+    m_patientSketches.clear();
+    m_cohortSketches.clear();
+
+    QFile file(m_directory + "/" + bandsFileName);
+
+    if(!m_directory.isEmpty() && file.open(QIODevice::ReadOnly))
+    {
+        QDataStream stream(&file);
+        quint32 magic = 0;
+        quint32 version = 0;
+        QVector<patient_sketches_t> patients;
+
+        stream >> magic >> version;
+
+        if(magic == bandsFileMagic && version == bandsFileVersion)
+        {
+            stream >> patients >> m_cohortSketches;
+
+            if(stream.status() != QDataStream::Ok ||
+               m_cohortSketches.size() != sketchCount)
+            {
+                patients.clear();
+                m_cohortSketches.clear();
+            }
+        }
+
+        // Patients of a different blood sample table layout are read again by the next build.
+        for(const auto& patient : std::as_const(patients))
+        {
+            if(patient.sketches.size() == m_cohortSketches.size())
+            {
+                m_patientSketches.insert(patient.fileName, patient);
+            }
+        }
+    }
+}
+
+void CohortBands::save()
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+
+    QVector<patient_sketches_t> patients;
+
+    for(const auto& patient : std::as_const(m_patientSketches))
+    {
+        patients.append(patient);
+    }
+
+    stream << bandsFileMagic << bandsFileVersion << patients << m_cohortSketches;
+
+    (void)QtConcurrent::run(&m_threadPool, writeBandsFile, m_directory + "/" + bandsFileName, data);
+}
+
+// Index of the sketch of a blood value column (in the column order of the blood sample table)
+// and cycle day (starting with day 1).
+int CohortBands::sketchIndex(int parameterColumn, int cycleDay)
+{
+    return PatientDataSchema::labParameterIndex(parameterColumn) * CycleAnalysis::maximumCycleDays + cycleDay - 1;
+}
+
+// Runs on the worker thread: takes over the sketches of unchanged files and reads new and
+// changed files in parallel. If anything has changed, the sketches of all patients are merged
+// into the cohort sketches, one blood value column per task.
+CohortBands::build_result_t CohortBands::buildSketches(const QString& directory, QHash<QString, patient_sketches_t> patientSketches, QVector<QuantileSketch> cohortSketches)
+{
+    build_result_t result;
+
+    const auto fileInfos = QDir(directory).entryInfoList({"*.json"}, QDir::Files, QDir::Name);
+
+    QVector<QFuture<patient_sketches_t>> patientFutures;
+
+    for(const auto& fileInfo : fileInfos)
+    {
+        auto size = fileInfo.size();
+        auto lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        auto it = patientSketches.constFind(fileInfo.fileName());
+
+        if(it != patientSketches.constEnd() && it->size == size && it->lastModified == lastModified)
+        {
+            result.patientSketches.insert(it.key(), *it);
+        }
+        else
+        {
+            patientFutures.append(QtConcurrent::run(readPatientSketches, directory, fileInfo.fileName(), size, lastModified));
+        }
+    }
+
+    for(auto& patientFuture : patientFutures)
+    {
+        auto patient = patientFuture.result();
+
+        result.patientSketches.insert(patient.fileName, patient);
+    }
+
+    result.changed = !patientFutures.isEmpty() || result.patientSketches.size() != patientSketches.size();
+
+    if(!result.changed)
+    {
+        result.cohortSketches = cohortSketches;
+
+        return result;
+    }
+
+    QVector<int> parameterColumns(PatientDataSchema::labParameterColumns.begin(), PatientDataSchema::labParameterColumns.end());
+
+    const auto& patients = result.patientSketches;
+
+    auto mergeFunction = [&patients](int parameterColumn)
+    {
+        QVector<QuantileSketch> columnSketches(CycleAnalysis::maximumCycleDays);
+
+        for(const auto& patient : patients)
+        {
+            for(auto cycleDay = 1; cycleDay <= CycleAnalysis::maximumCycleDays; cycleDay++)
+            {
+                columnSketches[cycleDay - 1].merge(patient.sketches[sketchIndex(parameterColumn, cycleDay)]);
+            }
+        }
+
+        for(auto& sketch : columnSketches)
+        {
+            sketch.compress();
+        }
+
+        return columnSketches;
+    };
+
+    const auto columnSketches = QtConcurrent::blockingMapped<QVector<QVector<QuantileSketch>>>(parameterColumns, mergeFunction);
+
+    for(const auto& sketches : columnSketches)
+    {
+        result.cohortSketches += sketches;
+    }
+
+    return result;
+}
+
+// Reads the blood values of the passed patient data file into one sketch per blood value and
+// cycle day. Samples before the first cycle or after the end of a cycle are left out.
+CohortBands::patient_sketches_t CohortBands::readPatientSketches(const QString& directory, const QString& fileName, qint64 size, qint64 lastModified)
+{
+    patient_sketches_t patient;
+
+    patient.fileName = fileName;
+    patient.size = size;
+    patient.lastModified = lastModified;
+    patient.sketches = QVector<QuantileSketch>(sketchCount);
+
+    PatientDataFile::patient_data_t patientData;
+
+    if(!PatientDataFile::load(directory + "/" + fileName, patientData))
+    {
+        return patient;
+    }
+
+    QVector<qint64> cycleStartDays;
+
+    for(const auto& startDate : std::as_const(patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsDateColumn]))
+    {
+        QDate firstDay = QDate::fromString(startDate, "dd.MM.yyyy");
+
+        if(firstDay.isValid())
+        {
+            cycleStartDays.append(firstDay.toJulianDay());
+        }
+    }
+
+    std::sort(cycleStartDays.begin(), cycleStartDays.end());
+
+    const auto& bloodSampleDates = patientData.bloodSamples[PatientDataSchema::bloodSamplesDateColumn];
+
+    for(auto row = 0; row < bloodSampleDates.size(); row++)
+    {
+        QDate sampleDate = QDate::fromString(bloodSampleDates[row], "dd.MM.yyyy");
+
+        if(!sampleDate.isValid())
+        {
+            continue;
+        }
+
+        // Latest cycle started on or before the day of the sample.
+        auto sampleDay = sampleDate.toJulianDay();
+        auto it = std::upper_bound(cycleStartDays.constBegin(), cycleStartDays.constEnd(), sampleDay);
+
+        if(it == cycleStartDays.constBegin())
+        {
+            continue;
+        }
+
+        auto cycleDay = static_cast<int>(sampleDay - *(it - 1)) + 1;
+
+        if(cycleDay > CycleAnalysis::maximumCycleDays)
+        {
+            continue;
+        }
+
+        for(auto column : PatientDataSchema::labParameterColumns)
+        {
+            bool conversionSuccessful = false;
+            double value = patientData.bloodSamples[column][row].toDouble(&conversionSuccessful);
+
+            if(conversionSuccessful)
+            {
+                patient.sketches[sketchIndex(column, cycleDay)].add(value);
+            }
+        }
+    }
+
+    for(auto& sketch : patient.sketches)
+    {
+        sketch.compress();
+    }
+
+    return patient;
+}
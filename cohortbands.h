@@ -0,0 +1,77 @@
+#ifndef COHORTBANDS_H
+#define COHORTBANDS_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include "quantilesketch.h"
+
+// Percentile bands of the blood values of all patient data files of a directory per chemo
+// therapy cycle day (cycles as in CycleAnalysis). Instead of keeping and sorting all values,
+// each day and blood value is summarized by a quantile sketch. The sketches of each file are
+// built in parallel and merged into the sketches of the cohort. Both are persisted in the
+// directory next to the patient catalog, so that the bands are available at once and only
+// new and changed files are read again.
+class CohortBands : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Sketches of a single patient data file, one per blood value column (without the date
+    // column) and cycle day, column by column.
+    typedef struct
+    {
+        QString fileName;
+        qint64 size;
+        qint64 lastModified;
+        QVector<QuantileSketch> sketches;
+    } patient_sketches_t;
+
+    explicit CohortBands(QObject *parent = nullptr);
+    ~CohortBands();
+
+    void setDirectory(const QString& directory);
+    QString directory() const;
+    void build();
+    bool isBuilding() const;
+
+    int patientCount() const;
+
+    QVector<double> band(int parameterColumn, double fraction) const;
+
+signals:
+    // Emitted when a build has finished.
+    void built();
+
+private slots:
+    void handleBuildResult();
+
+private:
+    typedef struct
+    {
+        QHash<QString, patient_sketches_t> patientSketches;
+        QVector<QuantileSketch> cohortSketches;
+        bool changed;
+    } build_result_t;
+
+    QString m_directory;
+    QHash<QString, patient_sketches_t> m_patientSketches;
+    QVector<QuantileSketch> m_cohortSketches;
+
+    QThreadPool m_threadPool;
+    QFutureWatcher<build_result_t> m_buildWatcher;
+    QString m_buildDirectory;
+    bool m_buildPending;
+
+    void load();
+    void save();
+
+    static int sketchIndex(int parameterColumn, int cycleDay);
+    static build_result_t buildSketches(const QString& directory, QHash<QString, patient_sketches_t> patientSketches, QVector<QuantileSketch> cohortSketches);
+    static patient_sketches_t readPatientSketches(const QString& directory, const QString& fileName, qint64 size, qint64 lastModified);
+};
+
+#endif // COHORTBANDS_H
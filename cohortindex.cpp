@@ -0,0 +1,427 @@
+#include "cohortindex.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "patienttablemodel.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+// Number of samples a single task evaluates the predicate of a query for.
+const static int predicateChunkSize = 65536;
+
+// Values of the predicate array (0 if the value does not match).
+const static quint8 predicateMatch = 1;
+const static quint8 predicateEmpty = 2;
+
+CohortIndex::CohortIndex(QObject *parent)
+    : QObject(parent)
+    , m_buildPending(false)
+{
+    connect(&m_buildWatcher, &QFutureWatcher<build_result_t>::finished, this, &CohortIndex::handleBuildResult);
+
+    // Builds run one after the other, the files of a build are read in parallel.
+    m_threadPool.setMaxThreadCount(1);
+}
+
+CohortIndex::~CohortIndex()
+{
+    m_threadPool.waitForDone();
+}
+
+void CohortIndex::setDirectory(const QString& directory)
+{
+    if(directory == m_directory)
+    {
+        return;
+    }
+
+    m_directory = directory;
+    m_index = index_t();
+    m_patientColumns.clear();
+}
+
+QString CohortIndex::directory() const
+{
+    return m_directory;
+}
+
+// Brings the index up to date with the patient data files of the directory in the background.
+void CohortIndex::build()
+{
+    if(m_directory.isEmpty())
+    {
+        return;
+    }
+
+    if(m_buildWatcher.isRunning())
+    {
+        m_buildPending = true;
+        return;
+    }
+
+    m_buildDirectory = m_directory;
+    m_buildWatcher.setFuture(QtConcurrent::run(&m_threadPool, buildIndex, m_directory, m_patientColumns));
+}
+
+bool CohortIndex::isBuilding() const
+{
+    return m_buildWatcher.isRunning();
+}
+
+int CohortIndex::patientCount() const
+{
+    return static_cast<int>(m_index.fileNames.size());
+}
+
+int CohortIndex::sampleCount() const
+{
+    return static_cast<int>(m_index.sampleDays.size());
+}
+
+// Runs the passed query over all patients of the index. The predicate is evaluated over the
+// whole value array of the queried blood value first, the periods are searched per patient
+// afterwards, both in parallel.
+QVector<CohortIndex::match_t> CohortIndex::query(const query_t& query) const
+{
+    QVector<match_t> matches;
+
+    auto parameterIndex = PatientDataSchema::labParameterIndex(query.parameterColumn);
+
+    if(parameterIndex < 0 || parameterIndex >= m_index.values.size())
+    {
+        return matches;
+    }
+
+    auto predicate = evaluatePredicate(m_index.values[parameterIndex], query);
+
+    QVector<int> patients(patientCount());
+    std::iota(patients.begin(), patients.end(), 0);
+
+    const auto& index = m_index;
+
+    std::function<match_t(int)> matchPatientFunction = [&index, &predicate, &query](int patient)
+    {
+        // Patients without a matching period are left out by their zero days.
+        match_t match;
+
+        match.days = 0;
+        matchPatient(index, patient, predicate, query, match);
+
+        return match;
+    };
+
+    const auto patientMatches = QtConcurrent::blockingMapped<QVector<match_t>>(patients, matchPatientFunction);
+
+    for(const auto& match : patientMatches)
+    {
+        if(match.days > 0)
+        {
+            matches.append(match);
+        }
+    }
+
+    return matches;
+}
+
+void CohortIndex::handleBuildResult()
+{
+    build_result_t result = m_buildWatcher.result();
+
+    // Results of a previous directory are dropped.
+    if(m_buildDirectory == m_directory)
+    {
+        m_index = result.index;
+        m_patientColumns = result.patientColumns;
+    }
+
+    if(m_buildPending)
+    {
+        m_buildPending = false;
+        build();
+    }
+    else
+    {
+        emit built();
+    }
+}
+
+// Runs on the worker thread: reads new and changed files in parallel and lays out the columns
+// of all patients back to back.
+CohortIndex::build_result_t CohortIndex::buildIndex(const QString& directory, QHash<QString, patient_columns_t> patientColumns)
+{
+    build_result_t result;
+
+    const auto fileInfos = QDir(directory).entryInfoList({"*.json"}, QDir::Files, QDir::Name);
+
+    QVector<patient_columns_t> patients(fileInfos.size());
+    QVector<QPair<int, QFuture<patient_columns_t>>> patientFutures;
+
+    for(auto i = 0; i < fileInfos.size(); i++)
+    {
+        auto size = fileInfos[i].size();
+        auto lastModified = fileInfos[i].lastModified().toMSecsSinceEpoch();
+        auto it = patientColumns.constFind(fileInfos[i].fileName());
+
+        if(it != patientColumns.constEnd() && it->size == size && it->lastModified == lastModified)
+        {
+            patients[i] = *it;
+        }
+        else
+        {
+            patientFutures.append(qMakePair(i, QtConcurrent::run(readPatientColumns, directory, fileInfos[i].fileName(), size, lastModified)));
+        }
+    }
+
+    for(auto& patientFuture : patientFutures)
+    {
+        patients[patientFuture.first] = patientFuture.second.result();
+    }
+
+    auto& index = result.index;
+    int sampleCount = 0;
+    int medicationCount = 0;
+
+    for(const auto& patient : patients)
+    {
+        sampleCount += static_cast<int>(patient.sampleDays.size());
+        medicationCount += static_cast<int>(patient.medicationNames.size());
+    }
+
+    index.sampleDays.reserve(sampleCount);
+    index.values.resize(PatientDataSchema::labParameterCount);
+
+    for(auto& values : index.values)
+    {
+        values.reserve(sampleCount);
+    }
+
+    index.medicationNames.reserve(medicationCount);
+    index.medicationFirstDays.reserve(medicationCount);
+
+    for(const auto& patient : patients)
+    {
+        index.fileNames.append(patient.fileName);
+        index.patientIds.append(patient.patientId);
+        index.names.append(patient.name);
+
+        index.sampleOffsets.append(static_cast<int>(index.sampleDays.size()));
+        index.sampleDays += patient.sampleDays;
+
+        for(auto column = 0; column < index.values.size(); column++)
+        {
+            index.values[column] += patient.values[column];
+        }
+
+        index.medicationOffsets.append(static_cast<int>(index.medicationNames.size()));
+        index.medicationNames += patient.medicationNames;
+        index.medicationFirstDays += patient.medicationFirstDays;
+
+        result.patientColumns.insert(patient.fileName, patient);
+    }
+
+    index.sampleOffsets.append(static_cast<int>(index.sampleDays.size()));
+    index.medicationOffsets.append(static_cast<int>(index.medicationNames.size()));
+
+    return result;
+}
+
+// Reads the samples and medications of the passed patient data file. Rows with an invalid
+// date are left out, the rest is ordered by date.
+CohortIndex::patient_columns_t CohortIndex::readPatientColumns(const QString& directory, const QString& fileName, qint64 size, qint64 lastModified)
+{
+    patient_columns_t patient;
+
+    patient.fileName = fileName;
+    patient.size = size;
+    patient.lastModified = lastModified;
+    patient.values.resize(PatientDataSchema::labParameterCount);
+
+    PatientDataFile::patient_data_t patientData;
+
+    if(!PatientDataFile::load(directory + "/" + fileName, patientData))
+    {
+        return patient;
+    }
+
+    patient.patientId = patientData.patientId;
+    patient.name = patientData.name;
+
+    const auto& bloodSampleDates = patientData.bloodSamples[PatientDataSchema::bloodSamplesDateColumn];
+    QVector<QPair<qint64, int>> sampleRows;
+
+    for(auto row = 0; row < bloodSampleDates.size(); row++)
+    {
+        auto dateKey = PatientTableModel::parseDate(bloodSampleDates[row]);
+
+        if(dateKey != PatientTableModel::invalidDateKey)
+        {
+            sampleRows.append(qMakePair(dateKey, row));
+        }
+    }
+
+    std::stable_sort(sampleRows.begin(), sampleRows.end(), [](const QPair<qint64, int>& a, const QPair<qint64, int>& b)
+    {
+        return a.first < b.first;
+    });
+
+    for(const auto& sampleRow : sampleRows)
+    {
+        patient.sampleDays.append(static_cast<qint32>(QDate::fromString(bloodSampleDates[sampleRow.second], "dd.MM.yyyy").toJulianDay()));
+
+        for(auto i = 0; i < patient.values.size(); i++)
+        {
+            const auto& text = patientData.bloodSamples[PatientDataSchema::labParameterColumns[i]][sampleRow.second];
+            bool conversionSuccessful = false;
+            float value = text.toFloat(&conversionSuccessful);
+
+            patient.values[i].append(conversionSuccessful ? value : std::numeric_limits<float>::quiet_NaN());
+        }
+    }
+
+    const auto& medicationStartDates = patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsDateColumn];
+
+    for(auto row = 0; row < medicationStartDates.size(); row++)
+    {
+        QDate firstDay = QDate::fromString(medicationStartDates[row], "dd.MM.yyyy");
+
+        if(firstDay.isValid())
+        {
+            patient.medicationNames.append(patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsNameColumn][row]);
+            patient.medicationFirstDays.append(static_cast<qint32>(firstDay.toJulianDay()));
+        }
+    }
+
+    return patient;
+}
+
+// Evaluates the comparison of the query for each value, in chunks on all cores. The loops do
+// not branch per value, so that the compiler can vectorize them. Empty cells (NaN) never
+// compare true and are marked as empty.
+QVector<quint8> CohortIndex::evaluatePredicate(const QVector<float>& values, const query_t& query)
+{
+    QVector<quint8> predicate(values.size());
+
+    const float* valueData = values.constData();
+    quint8* predicateData = predicate.data();
+    const float threshold = static_cast<float>(query.threshold);
+    const bool below = (query.comparison == COMPARISON_BELOW);
+
+    QVector<int> chunkStarts;
+
+    for(auto chunkStart = 0; chunkStart < values.size(); chunkStart += predicateChunkSize)
+    {
+        chunkStarts.append(chunkStart);
+    }
+
+    std::function<void(int&)> evaluateChunk = [valueData, predicateData, threshold, below, &values](int& chunkStart)
+    {
+        auto chunkEnd = std::min(chunkStart + predicateChunkSize, static_cast<int>(values.size()));
+
+        if(below)
+        {
+            for(auto i = chunkStart; i < chunkEnd; i++)
+            {
+                predicateData[i] = static_cast<quint8>(valueData[i] < threshold) | static_cast<quint8>((valueData[i] != valueData[i]) << 1);
+            }
+        }
+        else
+        {
+            for(auto i = chunkStart; i < chunkEnd; i++)
+            {
+                predicateData[i] = static_cast<quint8>(valueData[i] > threshold) | static_cast<quint8>((valueData[i] != valueData[i]) << 1);
+            }
+        }
+    };
+
+    QtConcurrent::blockingMap(chunkStarts, evaluateChunk);
+
+    return predicate;
+}
+
+// Searches the first period of consecutive samples of the passed patient for which the
+// predicate holds for at least the minimum number of days. Samples without a value of the
+// queried blood value neither extend nor interrupt a period.
+bool CohortIndex::matchPatient(const index_t& index, int patient, const QVector<quint8>& predicate, const query_t& query, match_t& match)
+{
+    qint32 startDay = std::numeric_limits<qint32>::min();
+
+    if(!query.medication.isEmpty())
+    {
+        auto medication = -1;
+
+        for(auto i = index.medicationOffsets[patient]; i < index.medicationOffsets[patient + 1]; i++)
+        {
+            if(index.medicationNames[i].contains(query.medication, Qt::CaseInsensitive) &&
+               (medication < 0 || index.medicationFirstDays[i] < index.medicationFirstDays[medication]))
+            {
+                medication = i;
+            }
+        }
+
+        if(medication < 0)
+        {
+            return false;
+        }
+
+        startDay = index.medicationFirstDays[medication];
+
+        match.medication = index.medicationNames[medication];
+        match.medicationStart = QDate::fromJulianDay(startDay);
+    }
+
+    const auto& values = index.values[PatientDataSchema::labParameterIndex(query.parameterColumn)];
+    auto periodStart = -1;
+    auto periodEnd = -1;
+    double extremeValue = 0.0;
+
+    for(auto sample = index.sampleOffsets[patient]; sample <= index.sampleOffsets[patient + 1]; sample++)
+    {
+        auto endOfSamples = (sample == index.sampleOffsets[patient + 1]);
+
+        if(!endOfSamples && (index.sampleDays[sample] < startDay || predicate[sample] == predicateEmpty))
+        {
+            continue;
+        }
+
+        if(!endOfSamples && predicate[sample] == predicateMatch)
+        {
+            if(periodStart < 0)
+            {
+                periodStart = sample;
+                extremeValue = values[sample];
+            }
+
+            periodEnd = sample;
+            extremeValue = (query.comparison == COMPARISON_BELOW) ? std::min(extremeValue, static_cast<double>(values[sample])) :
+                                                                    std::max(extremeValue, static_cast<double>(values[sample]));
+
+            continue;
+        }
+
+        // The period ends with a sample not matching the predicate or with the last sample.
+        if(periodStart >= 0)
+        {
+            auto days = index.sampleDays[periodEnd] - index.sampleDays[periodStart] + 1;
+
+            if(days >= query.minimumDays)
+            {
+                match.fileName = index.fileNames[patient];
+                match.patientId = index.patientIds[patient];
+                match.name = index.names[patient];
+                match.firstDate = QDate::fromJulianDay(index.sampleDays[periodStart]);
+                match.lastDate = QDate::fromJulianDay(index.sampleDays[periodEnd]);
+                match.days = days;
+                match.extremeValue = extremeValue;
+
+                return true;
+            }
+
+            periodStart = -1;
+        }
+    }
+
+    return false;
+}
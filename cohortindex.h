@@ -0,0 +1,137 @@
+#ifndef COHORTINDEX_H
+#define COHORTINDEX_H
+
+#include <QObject>
+#include <QDate>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+// Columnar in-memory index of all patient data files of a directory for queries across
+// patients. The samples of all patients are stored back to back, one array per blood value,
+// so that a query evaluates its predicate over contiguous arrays instead of walking the
+// patient data of each file. Files are only read again if their size or modification time
+// have changed since the last build.
+class CohortIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef enum
+    {
+        COMPARISON_BELOW,
+        COMPARISON_ABOVE
+    } comparison_t;
+
+    // E.g. leukocytes below 1.0 Giga/l for at least 7 days after the start of a medication.
+    typedef struct
+    {
+        // Blood value column (in the column order of the blood sample table).
+        int parameterColumn;
+        comparison_t comparison;
+        double threshold;
+        int minimumDays;
+
+        // Case insensitive part of the chemo therapy / medication name, only samples taken
+        // from the first day of the first matching medication on are considered. Empty to
+        // consider all samples.
+        QString medication;
+    } query_t;
+
+    typedef struct
+    {
+        QString fileName;
+        QString patientId;
+        QString name;
+        QString medication;
+        QDate medicationStart;
+
+        // First and last sample of the first matching period.
+        QDate firstDate;
+        QDate lastDate;
+        int days;
+
+        // Lowest (below) or highest (above) value of the period.
+        double extremeValue;
+    } match_t;
+
+    explicit CohortIndex(QObject *parent = nullptr);
+    ~CohortIndex();
+
+    void setDirectory(const QString& directory);
+    QString directory() const;
+    void build();
+    bool isBuilding() const;
+
+    int patientCount() const;
+    int sampleCount() const;
+
+    QVector<match_t> query(const query_t& query) const;
+
+signals:
+    // Emitted when a build has finished.
+    void built();
+
+private slots:
+    void handleBuildResult();
+
+private:
+    // Samples and medications of a single patient data file, ordered by date.
+    typedef struct
+    {
+        QString fileName;
+        qint64 size;
+        qint64 lastModified;
+        QString patientId;
+        QString name;
+        QVector<qint32> sampleDays;
+        QVector<QVector<float>> values;
+        QVector<QString> medicationNames;
+        QVector<qint32> medicationFirstDays;
+    } patient_columns_t;
+
+    typedef struct
+    {
+        QVector<QString> fileNames;
+        QVector<QString> patientIds;
+        QVector<QString> names;
+
+        // Samples of patient i are [sampleOffsets[i], sampleOffsets[i + 1]).
+        QVector<int> sampleOffsets;
+        QVector<qint32> sampleDays;
+
+        // One array per blood value column (without the date column), NaN for empty cells.
+        QVector<QVector<float>> values;
+
+        // Medications of patient i are [medicationOffsets[i], medicationOffsets[i + 1]).
+        QVector<int> medicationOffsets;
+        QVector<QString> medicationNames;
+        QVector<qint32> medicationFirstDays;
+    } index_t;
+
+    typedef struct
+    {
+        index_t index;
+        QHash<QString, patient_columns_t> patientColumns;
+    } build_result_t;
+
+    QString m_directory;
+    index_t m_index;
+
+    // Columns of each file of the last build, reused for unchanged files.
+    QHash<QString, patient_columns_t> m_patientColumns;
+
+    QThreadPool m_threadPool;
+    QFutureWatcher<build_result_t> m_buildWatcher;
+    QString m_buildDirectory;
+    bool m_buildPending;
+
+    static build_result_t buildIndex(const QString& directory, QHash<QString, patient_columns_t> patientColumns);
+    static patient_columns_t readPatientColumns(const QString& directory, const QString& fileName, qint64 size, qint64 lastModified);
+    static QVector<quint8> evaluatePredicate(const QVector<float>& values, const query_t& query);
+    static bool matchPatient(const index_t& index, int patient, const QVector<quint8>& predicate, const query_t& query, match_t& match);
+};
+
+#endif // COHORTINDEX_H
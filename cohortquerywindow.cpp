@@ -0,0 +1,183 @@
+#include "cohortquerywindow.h"
+#include "ui_cohortquerywindow.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QElapsedTimer>
+
+const static QVector<QString> tableWidgetResultsColumns
+{
+    "Name",
+    "Patient ID",
+    "Medication",
+    "Medication Start",
+    "From",
+    "To",
+    "Days",
+    "Extreme Value"
+};
+
+CohortQueryWindow::CohortQueryWindow(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::CohortQueryWindow)
+{
+    ui->setupUi(this);
+
+    // All blood values can be queried, i.e. all columns except the date.
+    for(auto column : PatientDataSchema::labParameterColumns)
+    {
+        ui->comboBoxParameter->addItem(PatientDataFile::bloodSamplesColumns[column], column);
+    }
+
+    ui->comboBoxComparison->addItem("below", CohortIndex::COMPARISON_BELOW);
+    ui->comboBoxComparison->addItem("above", CohortIndex::COMPARISON_ABOVE);
+
+    ui->tableWidgetResults->setColumnCount(static_cast<int>(tableWidgetResultsColumns.size()));
+
+    for(auto i = 0; i < tableWidgetResultsColumns.size(); i++)
+    {
+        ui->tableWidgetResults->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetResultsColumns[i]));
+    }
+
+    connect(&m_cohortIndex, &CohortIndex::built, this, &CohortQueryWindow::showStatus);
+}
+
+CohortQueryWindow::~CohortQueryWindow()
+{
+    delete ui;
+}
+
+void CohortQueryWindow::setDirectory(const QString& directory)
+{
+    m_cohortIndex.setDirectory(directory);
+}
+
+// The index is brought up to date in the background whenever the window is shown.
+void CohortQueryWindow::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+
+    m_cohortIndex.build();
+
+    showStatus();
+}
+
+void CohortQueryWindow::on_pushButtonRunQuery_clicked()
+{
+    CohortIndex::query_t query;
+
+    query.parameterColumn = ui->comboBoxParameter->currentData().toInt();
+    query.comparison = static_cast<CohortIndex::comparison_t>(ui->comboBoxComparison->currentData().toInt());
+    query.threshold = ui->doubleSpinBoxThreshold->value();
+    query.minimumDays = ui->spinBoxMinimumDays->value();
+    query.medication = ui->lineEditMedication->text().trimmed();
+
+    QElapsedTimer queryTimer;
+    queryTimer.start();
+
+    auto matches = m_cohortIndex.query(query);
+
+    m_queryStatus = QString::number(matches.size()) + " matching patients (" + QString::number(queryTimer.elapsed()) + " ms)";
+
+    ui->tableWidgetResults->setRowCount(0);
+    ui->tableWidgetResults->setRowCount(static_cast<int>(matches.size()));
+
+    for(auto row = 0; row < matches.size(); row++)
+    {
+        const auto& match = matches[row];
+        QVector<QString> texts {match.name,
+                                match.patientId,
+                                match.medication,
+                                match.medicationStart.toString("dd.MM.yyyy"),
+                                match.firstDate.toString("dd.MM.yyyy"),
+                                match.lastDate.toString("dd.MM.yyyy"),
+                                QString::number(match.days),
+                                QString::number(match.extremeValue)};
+
+        for(auto column = 0; column < texts.size(); column++)
+        {
+            auto item = new QTableWidgetItem(texts[column]);
+            item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+
+            ui->tableWidgetResults->setItem(row, column, item);
+        }
+
+        ui->tableWidgetResults->item(row, 0)->setData(Qt::UserRole, m_cohortIndex.directory() + "/" + match.fileName);
+    }
+
+    showStatus();
+}
+
+void CohortQueryWindow::on_tableWidgetResults_cellDoubleClicked(int row, int column)
+{
+    openSelectedPatients();
+    accept();
+}
+
+// Compares the selected patients or all results if none are selected.
+void CohortQueryWindow::on_pushButtonCompare_clicked()
+{
+    auto patientDataFileNames = selectedPatientDataFileNames();
+
+    if(patientDataFileNames.isEmpty())
+    {
+        for(auto row = 0; row < ui->tableWidgetResults->rowCount(); row++)
+        {
+            patientDataFileNames.append(ui->tableWidgetResults->item(row, 0)->data(Qt::UserRole).toString());
+        }
+    }
+
+    if(!patientDataFileNames.isEmpty())
+    {
+        emit patientDataFilesCompared(patientDataFileNames);
+    }
+}
+
+void CohortQueryWindow::on_buttonBox_accepted()
+{
+    openSelectedPatients();
+}
+
+void CohortQueryWindow::showStatus()
+{
+    QString status = QString::number(m_cohortIndex.patientCount()) + " patients, " +
+                     QString::number(m_cohortIndex.sampleCount()) + " samples indexed";
+
+    if(m_cohortIndex.isBuilding())
+    {
+        status += ", updating...";
+    }
+
+    if(!m_queryStatus.isEmpty())
+    {
+        status += " - " + m_queryStatus;
+    }
+
+    ui->labelStatus->setText(status);
+}
+
+QStringList CohortQueryWindow::selectedPatientDataFileNames() const
+{
+    QStringList patientDataFileNames;
+    const auto selectedRows = ui->tableWidgetResults->selectionModel()->selectedRows();
+
+    for(const auto& selectedRow : selectedRows)
+    {
+        if(ui->tableWidgetResults->item(selectedRow.row(), 0))
+        {
+            patientDataFileNames.append(ui->tableWidgetResults->item(selectedRow.row(), 0)->data(Qt::UserRole).toString());
+        }
+    }
+
+    return patientDataFileNames;
+}
+
+// Opens the selected patients, each in its own tab.
+void CohortQueryWindow::openSelectedPatients()
+{
+    auto patientDataFileNames = selectedPatientDataFileNames();
+
+    if(!patientDataFileNames.isEmpty())
+    {
+        emit patientDataFilesSelected(patientDataFileNames);
+    }
+}
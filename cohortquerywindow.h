@@ -0,0 +1,51 @@
+#ifndef COHORTQUERYWINDOW_H
+#define COHORTQUERYWINDOW_H
+
+#include <QDialog>
+#include "cohortindex.h"
+
+namespace Ui {
+class CohortQueryWindow;
+}
+
+class CohortQueryWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit CohortQueryWindow(QWidget *parent = nullptr);
+    ~CohortQueryWindow();
+
+    void setDirectory(const QString& directory);
+
+signals:
+    // Emitted when the user opens patients of the query results.
+    void patientDataFilesSelected(const QStringList& patientDataFileNames);
+
+    // Emitted when the user compares patients of the query results.
+    void patientDataFilesCompared(const QStringList& patientDataFileNames);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void on_pushButtonRunQuery_clicked();
+
+    void on_tableWidgetResults_cellDoubleClicked(int row, int column);
+
+    void on_pushButtonCompare_clicked();
+
+    void on_buttonBox_accepted();
+
+    void showStatus();
+
+private:
+    Ui::CohortQueryWindow *ui;
+    CohortIndex m_cohortIndex;
+    QString m_queryStatus;
+
+    QStringList selectedPatientDataFileNames() const;
+    void openSelectedPatients();
+};
+
+#endif // COHORTQUERYWINDOW_H
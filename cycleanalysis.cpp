@@ -0,0 +1,326 @@
+#include "cycleanalysis.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QDateTime>
+#include <QMap>
+#include <QStringList>
+#include <algorithm>
+
+const QVector<int> CycleAnalysis::parameterColumns
+{
+    PatientDataSchema::leukocytesColumn,
+    PatientDataSchema::thrombocytesColumn
+};
+
+CycleAnalysis::CycleAnalysis(PatientTableModel *bloodSamplesModel, PatientTableModel *chemoAndMedsModel, QObject *parent)
+    : QObject(parent)
+    , m_bloodSamplesModel(bloodSamplesModel)
+    , m_chemoAndMedsModel(chemoAndMedsModel)
+    , m_recoveryThresholds(parameterColumns.size(), 0.0)
+    , m_cyclesValid(false)
+    , m_allSamplesChanged(true)
+{
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &CycleAnalysis::handleSamplesAboutToBeRemoved);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsRemoved, this, &CycleAnalysis::handleSamplesRemoved);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsInserted, this, &CycleAnalysis::handleSamplesInserted);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsMoved, this, &CycleAnalysis::handleSamplesMoved);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::dataChanged, this, &CycleAnalysis::handleSamplesChanged);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::modelReset, this, &CycleAnalysis::handleSamplesReset);
+
+    // The chemo therapy / medication table only gives the cycle boundaries, which are cheap
+    // to collect again. Cycles with unchanged boundaries keep their results.
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::dataChanged, this, &CycleAnalysis::invalidateCycles);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::rowsInserted, this, &CycleAnalysis::invalidateCycles);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::rowsRemoved, this, &CycleAnalysis::invalidateCycles);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::modelReset, this, &CycleAnalysis::invalidateCycles);
+
+    handleSamplesReset();
+}
+
+void CycleAnalysis::setRecoveryThresholds(const QVector<double>& recoveryThresholds)
+{
+    if(recoveryThresholds != m_recoveryThresholds)
+    {
+        m_recoveryThresholds = recoveryThresholds;
+        m_allSamplesChanged = true;
+    }
+}
+
+// Returns the cycles sorted by start date, computing the ones affected by changes since
+// the last call.
+const QVector<CycleAnalysis::cycle_t>& CycleAnalysis::cycles()
+{
+    if(!m_cyclesValid)
+    {
+        updateCycleBoundaries();
+    }
+
+    if(m_allSamplesChanged)
+    {
+        m_cycleComputed.fill(false);
+        m_allSamplesChanged = false;
+    }
+    else
+    {
+        for(auto dateKey : std::as_const(m_changedSampleDateKeys))
+        {
+            if(dateKey == PatientTableModel::invalidDateKey)
+            {
+                continue;
+            }
+
+            // The cycle is the last one starting at or before the date of the sample.
+            auto it = std::upper_bound(m_cycles.constBegin(), m_cycles.constEnd(), dateKey, [](qint64 value, const cycle_t& cycle)
+            {
+                return value < cycle.startDateKey;
+            });
+
+            if(it != m_cycles.constBegin() && dateKey < (it - 1)->endDateKey)
+            {
+                m_cycleComputed[static_cast<int>(it - m_cycles.constBegin()) - 1] = false;
+            }
+        }
+    }
+
+    m_changedSampleDateKeys.clear();
+
+    for(auto i = 0; i < m_cycles.size(); i++)
+    {
+        if(!m_cycleComputed[i])
+        {
+            computeCycle(m_cycles[i]);
+            m_cycleComputed[i] = true;
+        }
+    }
+
+    return m_cycles;
+}
+
+void CycleAnalysis::handleSamplesAboutToBeRemoved(const QModelIndex &, int first, int last)
+{
+    for(auto row = first; row <= last; row++)
+    {
+        m_changedSampleDateKeys.append(m_sampleDateKeys[row]);
+    }
+}
+
+void CycleAnalysis::handleSamplesRemoved(const QModelIndex &, int first, int last)
+{
+    m_sampleDateKeys.remove(first, last - first + 1);
+}
+
+void CycleAnalysis::handleSamplesInserted(const QModelIndex &, int first, int last)
+{
+    for(auto row = first; row <= last; row++)
+    {
+        m_sampleDateKeys.insert(row, m_bloodSamplesModel->dateKey(row));
+        m_changedSampleDateKeys.append(m_sampleDateKeys[row]);
+    }
+}
+
+// Moving rows (i.e. sorting an edited date) does not change any sample.
+void CycleAnalysis::handleSamplesMoved(const QModelIndex &, int sourceStart, int sourceEnd,
+                                       const QModelIndex &, int destinationRow)
+{
+    auto count = sourceEnd - sourceStart + 1;
+    auto movedDateKeys = m_sampleDateKeys.mid(sourceStart, count);
+
+    m_sampleDateKeys.remove(sourceStart, count);
+
+    auto insertRow = destinationRow > sourceStart ? destinationRow - count : destinationRow;
+
+    for(auto i = 0; i < count; i++)
+    {
+        m_sampleDateKeys.insert(insertRow + i, movedDateKeys[i]);
+    }
+}
+
+// An edited sample affects the cycle of its previous date and the cycle of its new date.
+void CycleAnalysis::handleSamplesChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(!topLeft.isValid() || !bottomRight.isValid())
+    {
+        return;
+    }
+
+    for(auto row = topLeft.row(); row <= bottomRight.row(); row++)
+    {
+        m_changedSampleDateKeys.append(m_sampleDateKeys[row]);
+
+        m_sampleDateKeys[row] = m_bloodSamplesModel->dateKey(row);
+        m_changedSampleDateKeys.append(m_sampleDateKeys[row]);
+    }
+}
+
+// The table has been replaced as a whole (loaded or merged), so all cycles are computed again.
+void CycleAnalysis::handleSamplesReset()
+{
+    auto rowCount = m_bloodSamplesModel->rowCount();
+
+    m_sampleDateKeys.resize(rowCount);
+
+    for(auto row = 0; row < rowCount; row++)
+    {
+        m_sampleDateKeys[row] = m_bloodSamplesModel->dateKey(row);
+    }
+
+    m_changedSampleDateKeys.clear();
+    m_allSamplesChanged = true;
+}
+
+void CycleAnalysis::invalidateCycles()
+{
+    m_cyclesValid = false;
+}
+
+// Collects the cycles from the start dates of the chemo therapy / medication table. Rows
+// starting at the same date form one cycle. Results of cycles with unchanged boundaries are
+// taken over.
+void CycleAnalysis::updateCycleBoundaries()
+{
+    QMap<qint64, QStringList> medications;
+
+    for(auto row = 0; row < m_chemoAndMedsModel->rowCount(); row++)
+    {
+        if(m_chemoAndMedsModel->isDateValid(row))
+        {
+            auto& names = medications[m_chemoAndMedsModel->dateKey(row)];
+            const auto& name = m_chemoAndMedsModel->text(row, PatientDataSchema::chemoAndMedsNameColumn);
+
+            if(!name.isEmpty() && !names.contains(name))
+            {
+                names.append(name);
+            }
+        }
+    }
+
+    QVector<cycle_t> cycles;
+    QVector<bool> cycleComputed;
+
+    for(auto it = medications.constBegin(); it != medications.constEnd(); it++)
+    {
+        cycle_t cycle;
+
+        cycle.startDateKey = it.key();
+        cycle.endDateKey = QDateTime::fromSecsSinceEpoch(it.key()).addDays(maximumCycleDays).toSecsSinceEpoch();
+        cycle.medications = it.value().join(", ");
+
+        if(it + 1 != medications.constEnd())
+        {
+            cycle.endDateKey = std::min(cycle.endDateKey, (it + 1).key());
+        }
+
+        auto previous = std::lower_bound(m_cycles.constBegin(), m_cycles.constEnd(), cycle.startDateKey, [](const cycle_t& previousCycle, qint64 value)
+        {
+            return previousCycle.startDateKey < value;
+        });
+
+        auto previousIndex = static_cast<int>(previous - m_cycles.constBegin());
+
+        if(previous != m_cycles.constEnd() && previous->startDateKey == cycle.startDateKey &&
+           previous->endDateKey == cycle.endDateKey && m_cycleComputed[previousIndex])
+        {
+            cycle.parameters = previous->parameters;
+            cycleComputed.append(true);
+        }
+        else
+        {
+            cycleComputed.append(false);
+        }
+
+        cycles.append(cycle);
+    }
+
+    m_cycles = cycles;
+    m_cycleComputed = cycleComputed;
+    m_cyclesValid = true;
+}
+
+// Finds the nadir of each parameter within the cycle and the first sample after the nadir
+// reaching the recovery threshold again.
+void CycleAnalysis::computeCycle(cycle_t& cycle) const
+{
+    auto startDate = QDateTime::fromSecsSinceEpoch(cycle.startDateKey).date();
+
+    cycle.parameters = QVector<parameter_result_t>(parameterColumns.size());
+
+    for(auto& parameter : cycle.parameters)
+    {
+        parameter.hasNadir = false;
+        parameter.recovered = false;
+    }
+
+    for(auto row = sampleLowerBound(cycle.startDateKey); row < m_bloodSamplesModel->rowCount(); row++)
+    {
+        if(!m_bloodSamplesModel->isDateValid(row))
+        {
+            continue;
+        }
+
+        auto dateKey = m_bloodSamplesModel->dateKey(row);
+
+        if(dateKey >= cycle.endDateKey)
+        {
+            break;
+        }
+
+        for(auto i = 0; i < parameterColumns.size(); i++)
+        {
+            auto& parameter = cycle.parameters[i];
+            bool conversionSuccessful = false;
+            double value = m_bloodSamplesModel->text(row, parameterColumns[i]).toDouble(&conversionSuccessful);
+
+            if(!conversionSuccessful)
+            {
+                continue;
+            }
+
+            // A lower value is a new nadir, the recovery has to follow it.
+            if(!parameter.hasNadir || value < parameter.nadir)
+            {
+                parameter.hasNadir = true;
+                parameter.nadir = value;
+                parameter.nadirDateKey = dateKey;
+                parameter.nadirDay = static_cast<int>(startDate.daysTo(QDateTime::fromSecsSinceEpoch(dateKey).date())) + 1;
+                parameter.recovered = false;
+            }
+            else if(!parameter.recovered && value >= m_recoveryThresholds[i] && parameter.nadir < m_recoveryThresholds[i])
+            {
+                parameter.recovered = true;
+                parameter.recoveryValue = value;
+                parameter.recoveryDateKey = dateKey;
+                parameter.recoveryDay = static_cast<int>(startDate.daysTo(QDateTime::fromSecsSinceEpoch(dateKey).date())) + 1;
+            }
+        }
+    }
+}
+
+// Returns the first row with a valid date not before the passed date by binary search. Rows
+// with a valid date are sorted, rows with an invalid date in between are skipped.
+int CycleAnalysis::sampleLowerBound(qint64 dateKey) const
+{
+    int first = 0;
+    int last = m_bloodSamplesModel->rowCount();
+
+    while(first < last)
+    {
+        auto middle = first + (last - first) / 2;
+        auto row = middle;
+
+        while(row < last && !m_bloodSamplesModel->isDateValid(row))
+        {
+            row++;
+        }
+
+        if(row < last && m_bloodSamplesModel->dateKey(row) < dateKey)
+        {
+            first = row + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    return first;
+}
@@ -0,0 +1,89 @@
+#ifndef CYCLEANALYSIS_H
+#define CYCLEANALYSIS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include "patienttablemodel.h"
+
+// Nadir and recovery of the leukocytes and thrombocytes per chemo therapy cycle. A cycle
+// starts at each start date of the chemo therapy / medication table and lasts until the
+// next start date (at most maximumCycleDays). The results of each cycle are kept and only
+// cycles affected by a change are computed again: changed samples are assigned to their
+// cycle by binary search over the cycle start dates, changed start dates only affect the
+// cycles whose boundaries have changed.
+class CycleAnalysis : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        bool hasNadir;
+        double nadir;
+        qint64 nadirDateKey;
+
+        // Days counted from the cycle start (day 1).
+        int nadirDay;
+
+        bool recovered;
+        double recoveryValue;
+        qint64 recoveryDateKey;
+        int recoveryDay;
+    } parameter_result_t;
+
+    typedef struct
+    {
+        qint64 startDateKey;
+        qint64 endDateKey;
+        QString medications;
+
+        // Results in the order of parameterColumns.
+        QVector<parameter_result_t> parameters;
+    } cycle_t;
+
+    // Blood sample table columns analyzed.
+    static const QVector<int> parameterColumns;
+
+    // Cycles without a following start date end after this number of days.
+    static const int maximumCycleDays = 42;
+
+    CycleAnalysis(PatientTableModel *bloodSamplesModel, PatientTableModel *chemoAndMedsModel, QObject *parent = nullptr);
+
+    void setRecoveryThresholds(const QVector<double>& recoveryThresholds);
+    const QVector<cycle_t>& cycles();
+
+private slots:
+    void handleSamplesAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void handleSamplesRemoved(const QModelIndex &parent, int first, int last);
+    void handleSamplesInserted(const QModelIndex &parent, int first, int last);
+    void handleSamplesMoved(const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+                            const QModelIndex &destinationParent, int destinationRow);
+    void handleSamplesChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void handleSamplesReset();
+    void invalidateCycles();
+
+private:
+    QPointer<PatientTableModel> m_bloodSamplesModel;
+    QPointer<PatientTableModel> m_chemoAndMedsModel;
+    QVector<double> m_recoveryThresholds;
+
+    QVector<cycle_t> m_cycles;
+    QVector<bool> m_cycleComputed;
+    bool m_cyclesValid;
+
+    // Date keys of the blood sample rows as last seen, so that the dates of removed and
+    // edited rows are known after the model has been changed.
+    QVector<qint64> m_sampleDateKeys;
+
+    // Dates of changed samples not yet assigned to their cycles.
+    QVector<qint64> m_changedSampleDateKeys;
+    bool m_allSamplesChanged;
+
+    void updateCycleBoundaries();
+    void computeCycle(cycle_t& cycle) const;
+    int sampleLowerBound(qint64 dateKey) const;
+};
+
+#endif // CYCLEANALYSIS_H
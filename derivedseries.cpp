@@ -0,0 +1,223 @@
+#include "derivedseries.h"
+#include <algorithm>
+#include <limits>
+
+const static double secondsPerDay = 24.0 * 3600.0;
+
+DerivedSeries::DerivedSeries(PatientTableModel *bloodSamplesModel, QObject *parent)
+    : QObject(parent)
+    , m_bloodSamplesModel(bloodSamplesModel)
+    , m_movingAverageDays(7)
+    , m_smoothingFactor(0.3)
+{
+    column_series_t columnSeries;
+
+    columnSeries.valid = false;
+    columnSeries.derived.resize(DERIVED_COUNT);
+
+    m_columnSeries = QVector<column_series_t>(m_bloodSamplesModel->columnCount(), columnSeries);
+
+    connect(m_bloodSamplesModel, &QAbstractItemModel::dataChanged, this, &DerivedSeries::handleDataChanged);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsInserted, this, &DerivedSeries::invalidate);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsRemoved, this, &DerivedSeries::invalidate);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::rowsMoved, this, &DerivedSeries::invalidate);
+    connect(m_bloodSamplesModel, &QAbstractItemModel::modelReset, this, &DerivedSeries::invalidate);
+}
+
+void DerivedSeries::setParameters(int movingAverageDays, double smoothingFactor)
+{
+    if(movingAverageDays != m_movingAverageDays || smoothingFactor != m_smoothingFactor)
+    {
+        m_movingAverageDays = movingAverageDays;
+        m_smoothingFactor = smoothingFactor;
+
+        invalidate();
+    }
+}
+
+// Returns the derived series of the passed blood sample table column, sorted by date.
+const QVector<QCPGraphData>& DerivedSeries::series(int column, derived_t derived)
+{
+    if(!m_columnSeries[column].valid)
+    {
+        rebuild(column);
+    }
+
+    return m_columnSeries[column].derived[derived];
+}
+
+// Updates the edited samples and continues the pass from the first of them. Edited dates are
+// followed by moving the row, so the columns are computed again then.
+void DerivedSeries::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(!topLeft.isValid() || !bottomRight.isValid())
+    {
+        return;
+    }
+
+    auto dateColumn = m_bloodSamplesModel->dateColumn();
+
+    if(topLeft.column() <= dateColumn && dateColumn <= bottomRight.column())
+    {
+        invalidate();
+        return;
+    }
+
+    for(auto column = topLeft.column(); column <= bottomRight.column(); column++)
+    {
+        auto& columnSeries = m_columnSeries[column];
+
+        if(!columnSeries.valid)
+        {
+            continue;
+        }
+
+        auto first = static_cast<int>(columnSeries.values.size());
+
+        for(auto row = topLeft.row(); row <= bottomRight.row(); row++)
+        {
+            first = std::min(first, updateSample(column, row));
+        }
+
+        computeFrom(columnSeries, first);
+    }
+}
+
+void DerivedSeries::invalidate()
+{
+    for(auto& columnSeries : m_columnSeries)
+    {
+        columnSeries.valid = false;
+    }
+}
+
+// Collects the numeric samples of the passed column and computes its derived series.
+void DerivedSeries::rebuild(int column)
+{
+    auto& columnSeries = m_columnSeries[column];
+
+    columnSeries.rows.clear();
+    columnSeries.dateKeys.clear();
+    columnSeries.values.clear();
+
+    for(auto row = 0; row < m_bloodSamplesModel->rowCount(); row++)
+    {
+        bool conversionSuccessful = false;
+        double value = m_bloodSamplesModel->text(row, column).toDouble(&conversionSuccessful);
+
+        if(m_bloodSamplesModel->isDateValid(row) && conversionSuccessful)
+        {
+            columnSeries.rows.append(row);
+            columnSeries.dateKeys.append(m_bloodSamplesModel->dateKey(row));
+            columnSeries.values.append(value);
+        }
+    }
+
+    for(auto& derived : columnSeries.derived)
+    {
+        derived.resize(columnSeries.values.size());
+    }
+
+    computeFrom(columnSeries, 0);
+
+    columnSeries.valid = true;
+}
+
+// Takes over the edited cell of the passed row. A cell becoming (or no longer being) a number
+// inserts (or removes) the sample. Returns the index of the sample.
+int DerivedSeries::updateSample(int column, int row)
+{
+    auto& columnSeries = m_columnSeries[column];
+    auto index = static_cast<int>(std::lower_bound(columnSeries.rows.constBegin(), columnSeries.rows.constEnd(), row) -
+                                  columnSeries.rows.constBegin());
+    bool contained = index < columnSeries.rows.size() && columnSeries.rows[index] == row;
+
+    bool conversionSuccessful = false;
+    double value = m_bloodSamplesModel->text(row, column).toDouble(&conversionSuccessful);
+
+    conversionSuccessful = conversionSuccessful && m_bloodSamplesModel->isDateValid(row);
+
+    if(contained && conversionSuccessful)
+    {
+        columnSeries.values[index] = value;
+    }
+    else if(contained)
+    {
+        columnSeries.rows.remove(index);
+        columnSeries.dateKeys.remove(index);
+        columnSeries.values.remove(index);
+
+        for(auto& derived : columnSeries.derived)
+        {
+            derived.remove(index);
+        }
+    }
+    else if(conversionSuccessful)
+    {
+        columnSeries.rows.insert(index, row);
+        columnSeries.dateKeys.insert(index, m_bloodSamplesModel->dateKey(row));
+        columnSeries.values.insert(index, value);
+
+        for(auto& derived : columnSeries.derived)
+        {
+            derived.insert(index, QCPGraphData());
+        }
+    }
+
+    return index;
+}
+
+// Computes the derived series from the passed sample on in a single pass. The moving average
+// covers the samples of the last m_movingAverageDays calendar days, the window is found by
+// binary search when starting in the middle of the samples.
+void DerivedSeries::computeFrom(column_series_t& columnSeries, int first) const
+{
+    const auto& dateKeys = columnSeries.dateKeys;
+    const auto& values = columnSeries.values;
+    auto& movingAverage = columnSeries.derived[DERIVED_MOVING_AVERAGE];
+    auto& smoothed = columnSeries.derived[DERIVED_SMOOTHED];
+    auto& slope = columnSeries.derived[DERIVED_SLOPE];
+
+    if(first >= values.size())
+    {
+        return;
+    }
+
+    // Half a day below the window length keeps whole days in the window despite daylight
+    // saving time changes of the date keys.
+    const auto windowSeconds = (m_movingAverageDays - 0.5) * secondsPerDay;
+
+    auto windowStart = static_cast<int>(std::upper_bound(dateKeys.constBegin(), dateKeys.constBegin() + first, dateKeys[first] - windowSeconds) -
+                                        dateKeys.constBegin());
+    double windowSum = 0.0;
+
+    for(auto i = windowStart; i < first; i++)
+    {
+        windowSum += values[i];
+    }
+
+    for(auto i = first; i < values.size(); i++)
+    {
+        const double key = dateKeys[i];
+
+        windowSum += values[i];
+
+        while(dateKeys[i] - dateKeys[windowStart] >= windowSeconds)
+        {
+            windowSum -= values[windowStart];
+            windowStart++;
+        }
+
+        movingAverage[i].key = key;
+        movingAverage[i].value = windowSum / (i - windowStart + 1);
+
+        smoothed[i].key = key;
+        smoothed[i].value = i ? m_smoothingFactor * values[i] + (1.0 - m_smoothingFactor) * smoothed[i - 1].value : values[i];
+
+        // Samples of the same day have no slope, NaN leaves a gap in the graph.
+        auto days = i ? qRound((dateKeys[i] - dateKeys[i - 1]) / secondsPerDay) : 0;
+
+        slope[i].key = key;
+        slope[i].value = days ? (values[i] - values[i - 1]) / days : std::numeric_limits<double>::quiet_NaN();
+    }
+}
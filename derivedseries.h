@@ -0,0 +1,61 @@
+#ifndef DERIVEDSERIES_H
+#define DERIVEDSERIES_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include "qcustomplot.h"
+#include "patienttablemodel.h"
+
+// Series derived from the blood value columns for the visualization: the moving average over
+// a number of days, the exponentially smoothed values and the slope per day between
+// consecutive samples. All of them are computed in one pass over the numeric samples of a
+// column. An edited cell only updates the samples of its column from the edited sample on,
+// inserted, removed and moved rows require the column to be computed again.
+class DerivedSeries : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef enum
+    {
+        DERIVED_MOVING_AVERAGE,
+        DERIVED_SMOOTHED,
+        DERIVED_SLOPE,
+        DERIVED_COUNT
+    } derived_t;
+
+    explicit DerivedSeries(PatientTableModel *bloodSamplesModel, QObject *parent = nullptr);
+
+    void setParameters(int movingAverageDays, double smoothingFactor);
+    const QVector<QCPGraphData>& series(int column, derived_t derived);
+
+private slots:
+    void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void invalidate();
+
+private:
+    // Numeric samples of a column (rows with a valid date and a number only) and the
+    // derived series, one point per sample.
+    typedef struct
+    {
+        bool valid;
+        QVector<int> rows;
+        QVector<qint64> dateKeys;
+        QVector<double> values;
+        QVector<QVector<QCPGraphData>> derived;
+    } column_series_t;
+
+    QPointer<PatientTableModel> m_bloodSamplesModel;
+    int m_movingAverageDays;
+    double m_smoothingFactor;
+
+    // Indexed by the blood sample table column.
+    QVector<column_series_t> m_columnSeries;
+
+    void rebuild(int column);
+    int updateSample(int column, int row);
+    void computeFrom(column_series_t& columnSeries, int first) const;
+};
+
+#endif // DERIVEDSERIES_H
@@ -0,0 +1,355 @@
+#include "doseaccounting.h"
+#include "patientdataschema.h"
+#include "medicationindex.h"
+#include <QRegularExpression>
+#include <limits>
+
+const static qint64 secondsPerDay = 24 * 3600;
+
+// Cumulative lifetime limits per m² body surface area (in mg/m²).
+typedef struct
+{
+    QString drug;
+    double limit;
+} lifetime_limit_t;
+
+const static QVector<lifetime_limit_t> lifetimeLimits
+{
+    {"doxorubicin", 450.0},
+    {"daunorubicin", 550.0},
+    {"epirubicin", 900.0},
+    {"idarubicin", 150.0},
+    {"mitoxantrone", 140.0}
+};
+
+// Amount, unit and the optional "per m²" of a dose, e.g. "60 mg/m²", "1,5 g" or "75mg pro qm".
+const static QRegularExpression doseRegularExpression(R"(^\s*(\d+(?:[.,]\d+)?)\s*(µg|μg|ug|mcg|mg|g|[a-z]+)?\s*((?:/|pro\s|per\s)\s*(?:m²|m\^2|m2|qm))?)",
+                                                      QRegularExpression::CaseInsensitiveOption);
+
+const static QRegularExpression numberRegularExpression(R"((\d+(?:[.,]\d+)?))");
+
+DoseAccounting::DoseAccounting(PatientTableModel *chemoAndMedsModel, QObject *parent)
+    : QObject(parent)
+    , m_chemoAndMedsModel(chemoAndMedsModel)
+    , m_bodySurface(0.0)
+{
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &DoseAccounting::handleRowsAboutToBeRemoved);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::rowsRemoved, this, &DoseAccounting::handleRowsRemoved);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::rowsInserted, this, &DoseAccounting::handleRowsInserted);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::rowsMoved, this, &DoseAccounting::handleRowsMoved);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::dataChanged, this, &DoseAccounting::handleDataChanged);
+    connect(m_chemoAndMedsModel, &QAbstractItemModel::modelReset, this, &DoseAccounting::handleModelReset);
+
+    handleModelReset();
+}
+
+// Sets the body surface area in m², 0 if unknown.
+void DoseAccounting::setBodySurface(double bodySurface)
+{
+    if(bodySurface != m_bodySurface)
+    {
+        m_bodySurface = bodySurface;
+
+        emit totalsChanged();
+    }
+}
+
+// Returns the cumulative doses per drug and unit, sorted by name.
+QVector<DoseAccounting::drug_total_t> DoseAccounting::totals() const
+{
+    QVector<drug_total_t> totals;
+    const auto bodySurfaceKnown = m_bodySurface > 0.0;
+
+    for(const auto& drugSum : m_drugSums)
+    {
+        drug_total_t drugTotal;
+
+        drugTotal.name = drugSum.name;
+        drugTotal.unit = drugSum.unit;
+        drugTotal.total = drugSum.absoluteTotal;
+        drugTotal.totalPerBodySurface = drugSum.perBodySurfaceTotal;
+        drugTotal.lifetimeLimit = lifetimeLimit(drugSum.name, drugSum.unit);
+
+        if(drugSum.perBodySurfaceTotal != 0.0)
+        {
+            drugTotal.total = bodySurfaceKnown ? drugSum.absoluteTotal + drugSum.perBodySurfaceTotal * m_bodySurface :
+                                                 std::numeric_limits<double>::quiet_NaN();
+        }
+
+        if(drugSum.absoluteTotal != 0.0)
+        {
+            drugTotal.totalPerBodySurface = bodySurfaceKnown ? drugSum.perBodySurfaceTotal + drugSum.absoluteTotal / m_bodySurface :
+                                                               std::numeric_limits<double>::quiet_NaN();
+        }
+
+        totals.append(drugTotal);
+    }
+
+    return totals;
+}
+
+// Returns the cumulative dose per m² in percent of the lifetime limit for each drug having a
+// limit, one point per day of treatment. Absolute doses are left out while the body surface
+// area is unknown.
+QVector<DoseAccounting::lifetime_curve_t> DoseAccounting::lifetimeCurves() const
+{
+    QVector<lifetime_curve_t> curves;
+    QMap<QString, int> curveIndices;
+    QVector<double> cumulativeDoses;
+
+    // Rows with a valid date are sorted by date.
+    for(const auto& rowDose : m_rowDoses)
+    {
+        if(!rowDose.valid || rowDose.dateKey == PatientTableModel::invalidDateKey)
+        {
+            continue;
+        }
+
+        auto limit = lifetimeLimit(rowDose.name, rowDose.dose.unit);
+
+        if(limit <= 0.0 || (!rowDose.dose.perBodySurface && m_bodySurface <= 0.0))
+        {
+            continue;
+        }
+
+        if(!curveIndices.contains(rowDose.drugKey))
+        {
+            lifetime_curve_t curve;
+
+            curve.name = rowDose.name;
+
+            curveIndices[rowDose.drugKey] = static_cast<int>(curves.size());
+            curves.append(curve);
+            cumulativeDoses.append(0.0);
+        }
+
+        auto index = curveIndices[rowDose.drugKey];
+        auto dosePerBodySurface = rowDose.dose.perBodySurface ? rowDose.dose.amount : rowDose.dose.amount / m_bodySurface;
+
+        for(auto day = 0; day < rowDose.days; day++)
+        {
+            cumulativeDoses[index] += dosePerBodySurface;
+
+            QCPGraphData point;
+
+            point.key = rowDose.dateKey + day * secondsPerDay;
+            point.value = 100.0 * cumulativeDoses[index] / limit;
+
+            curves[index].percentages.append(point);
+        }
+    }
+
+    return curves;
+}
+
+// Parses a free text dose. Mass units are converted to mg.
+DoseAccounting::dose_t DoseAccounting::parseDose(const QString& text)
+{
+    dose_t dose;
+    auto match = doseRegularExpression.match(text);
+
+    dose.valid = match.hasMatch();
+    dose.amount = 0.0;
+    dose.perBodySurface = false;
+
+    if(!dose.valid)
+    {
+        return dose;
+    }
+
+    dose.amount = match.captured(1).replace(',', '.').toDouble();
+    dose.unit = match.captured(2);
+    dose.perBodySurface = !match.captured(3).isEmpty();
+
+    auto unit = dose.unit.toLower();
+
+    if(unit == "µg" || unit == "μg" || unit == "ug" || unit == "mcg")
+    {
+        dose.amount *= 0.001;
+        dose.unit = "mg";
+    }
+    else if(unit == "g")
+    {
+        dose.amount *= 1000.0;
+        dose.unit = "mg";
+    }
+    else if(unit == "mg")
+    {
+        dose.unit = "mg";
+    }
+
+    return dose;
+}
+
+// Parses the body surface area of the general information, e.g. "1.98 m^2". Returns 0 if
+// there is no number.
+double DoseAccounting::parseBodySurface(const QString& text)
+{
+    auto match = numberRegularExpression.match(text);
+
+    return match.hasMatch() ? match.captured(1).replace(',', '.').toDouble() : 0.0;
+}
+
+void DoseAccounting::handleRowsAboutToBeRemoved(const QModelIndex &, int first, int last)
+{
+    for(auto row = first; row <= last; row++)
+    {
+        addRowDose(m_rowDoses[row], -1);
+    }
+}
+
+void DoseAccounting::handleRowsRemoved(const QModelIndex &, int first, int last)
+{
+    m_rowDoses.remove(first, last - first + 1);
+
+    emit totalsChanged();
+}
+
+void DoseAccounting::handleRowsInserted(const QModelIndex &, int first, int last)
+{
+    for(auto row = first; row <= last; row++)
+    {
+        m_rowDoses.insert(row, parseRow(row));
+        addRowDose(m_rowDoses[row], 1);
+    }
+
+    emit totalsChanged();
+}
+
+// Moving rows (i.e. sorting an edited date) does not change any total.
+void DoseAccounting::handleRowsMoved(const QModelIndex &, int sourceStart, int sourceEnd,
+                                     const QModelIndex &, int destinationRow)
+{
+    auto count = sourceEnd - sourceStart + 1;
+    auto movedRowDoses = m_rowDoses.mid(sourceStart, count);
+
+    m_rowDoses.remove(sourceStart, count);
+
+    auto insertRow = destinationRow > sourceStart ? destinationRow - count : destinationRow;
+
+    for(auto i = 0; i < count; i++)
+    {
+        m_rowDoses.insert(insertRow + i, movedRowDoses[i]);
+    }
+}
+
+// Replaces the contribution of the edited rows.
+void DoseAccounting::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(!topLeft.isValid() || !bottomRight.isValid())
+    {
+        return;
+    }
+
+    for(auto row = topLeft.row(); row <= bottomRight.row(); row++)
+    {
+        addRowDose(m_rowDoses[row], -1);
+
+        m_rowDoses[row] = parseRow(row);
+        addRowDose(m_rowDoses[row], 1);
+    }
+
+    emit totalsChanged();
+}
+
+void DoseAccounting::handleModelReset()
+{
+    m_rowDoses.clear();
+    m_drugSums.clear();
+
+    for(auto row = 0; row < m_chemoAndMedsModel->rowCount(); row++)
+    {
+        m_rowDoses.append(parseRow(row));
+        addRowDose(m_rowDoses[row], 1);
+    }
+
+    emit totalsChanged();
+}
+
+DoseAccounting::row_dose_t DoseAccounting::parseRow(int row) const
+{
+    row_dose_t rowDose;
+
+    rowDose.name = m_chemoAndMedsModel->text(row, PatientDataSchema::chemoAndMedsNameColumn).trimmed();
+    rowDose.dateKey = m_chemoAndMedsModel->isDateValid(row) ? m_chemoAndMedsModel->dateKey(row) : PatientTableModel::invalidDateKey;
+    rowDose.dose = parseDose(m_chemoAndMedsModel->text(row, PatientDataSchema::chemoAndMedsDoseColumn));
+
+    // Rows without days are given on a single day, as in the visualization.
+    bool conversionSuccessful = false;
+    rowDose.days = m_chemoAndMedsModel->text(row, PatientDataSchema::chemoAndMedsDaysColumn).toInt(&conversionSuccessful);
+
+    if(!conversionSuccessful)
+    {
+        rowDose.days = 1;
+    }
+
+    rowDose.valid = rowDose.dose.valid && !rowDose.name.isEmpty() && rowDose.days > 0;
+    rowDose.drugKey = MedicationIndex::fold(rowDose.name) + "\n" + rowDose.dose.unit;
+
+    return rowDose;
+}
+
+// Adds (sign 1) or subtracts (sign -1) the dose of a row to the sum of its drug.
+void DoseAccounting::addRowDose(const row_dose_t& rowDose, int sign)
+{
+    if(!rowDose.valid)
+    {
+        return;
+    }
+
+    auto it = m_drugSums.find(rowDose.drugKey);
+
+    if(it == m_drugSums.end())
+    {
+        drug_sum_t drugSum;
+
+        drugSum.name = rowDose.name;
+        drugSum.unit = rowDose.dose.unit;
+        drugSum.absoluteTotal = 0.0;
+        drugSum.perBodySurfaceTotal = 0.0;
+        drugSum.rowCount = 0;
+
+        it = m_drugSums.insert(rowDose.drugKey, drugSum);
+    }
+
+    auto dose = sign * rowDose.dose.amount * rowDose.days;
+
+    if(rowDose.dose.perBodySurface)
+    {
+        it.value().perBodySurfaceTotal += dose;
+    }
+    else
+    {
+        it.value().absoluteTotal += dose;
+    }
+
+    it.value().rowCount += sign;
+
+    // Removing the last row of a drug removes the drug, which also drops rounding residues.
+    if(it.value().rowCount <= 0)
+    {
+        m_drugSums.erase(it);
+    }
+}
+
+// Returns the lifetime limit per m² of the passed drug if one of the words of its name is a
+// drug having a limit, 0 otherwise. Limits are given in mg.
+double DoseAccounting::lifetimeLimit(const QString& name, const QString& unit)
+{
+    if(unit != "mg")
+    {
+        return 0.0;
+    }
+
+    const auto nameTokens = MedicationIndex::tokens(name);
+
+    for(const auto& limit : lifetimeLimits)
+    {
+        if(nameTokens.contains(limit.drug))
+        {
+            return limit.limit;
+        }
+    }
+
+    return 0.0;
+}
@@ -0,0 +1,106 @@
+#ifndef DOSEACCOUNTING_H
+#define DOSEACCOUNTING_H
+
+#include <QObject>
+#include <QMap>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include "qcustomplot.h"
+#include "patienttablemodel.h"
+
+// Cumulative doses per drug of the chemo therapy / medication table. The free text doses are
+// parsed into amount, unit and whether they are given per m² body surface area, each row
+// contributes its dose per day times its days. The totals are kept up to date row by row as
+// the table changes, doses per m² and absolute doses are summed separately so that a changed
+// body surface area does not require summing again.
+class DoseAccounting : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        bool valid;
+        double amount;
+
+        // Mass units are converted to mg, other units are kept as written.
+        QString unit;
+        bool perBodySurface;
+    } dose_t;
+
+    typedef struct
+    {
+        QString name;
+        QString unit;
+
+        // Total dose and total dose per m², NaN if the body surface area is required but unknown.
+        double total;
+        double totalPerBodySurface;
+
+        // Lifetime limit per m² (e.g. of anthracyclines), 0 if there is none.
+        double lifetimeLimit;
+    } drug_total_t;
+
+    // Cumulative dose of a drug with a lifetime limit in percent of the limit over time.
+    typedef struct
+    {
+        QString name;
+        QVector<QCPGraphData> percentages;
+    } lifetime_curve_t;
+
+    explicit DoseAccounting(PatientTableModel *chemoAndMedsModel, QObject *parent = nullptr);
+
+    void setBodySurface(double bodySurface);
+    QVector<drug_total_t> totals() const;
+    QVector<lifetime_curve_t> lifetimeCurves() const;
+
+    static dose_t parseDose(const QString& text);
+    static double parseBodySurface(const QString& text);
+
+signals:
+    void totalsChanged();
+
+private slots:
+    void handleRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void handleRowsRemoved(const QModelIndex &parent, int first, int last);
+    void handleRowsInserted(const QModelIndex &parent, int first, int last);
+    void handleRowsMoved(const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+                         const QModelIndex &destinationParent, int destinationRow);
+    void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void handleModelReset();
+
+private:
+    // Parsed dose of a table row.
+    typedef struct
+    {
+        bool valid;
+        QString drugKey;
+        QString name;
+        qint64 dateKey;
+        int days;
+        dose_t dose;
+    } row_dose_t;
+
+    typedef struct
+    {
+        QString name;
+        QString unit;
+        double absoluteTotal;
+        double perBodySurfaceTotal;
+        int rowCount;
+    } drug_sum_t;
+
+    QPointer<PatientTableModel> m_chemoAndMedsModel;
+    double m_bodySurface;
+
+    // Parsed doses in the row order of the model, sums per drug and unit.
+    QVector<row_dose_t> m_rowDoses;
+    QMap<QString, drug_sum_t> m_drugSums;
+
+    row_dose_t parseRow(int row) const;
+    void addRowDose(const row_dose_t& rowDose, int sign);
+    static double lifetimeLimit(const QString& name, const QString& unit);
+};
+
+#endif // DOSEACCOUNTING_H
@@ -0,0 +1,41 @@
+#ifndef IPCPROTOCOL_H
+#define IPCPROTOCOL_H
+
+#include <QString>
+
+// Protocol of the local socket by which tools on the same workstation (e.g. a lab interface
+// bridge, scripts using leukiclient) push rows into the patients open in a running instance.
+// Each message is a JSON object on a line of its own (UTF-8, terminated by '\n'):
+//
+//   request:  {"id": 1, "command": "addBloodSamples", "patientId": "123", "rows": [{...}, ...]}
+//   response: {"id": 1, "ok": true, "addedRows": 2, "skippedRows": 0}
+//             {"id": 1, "ok": false, "error": "..."}
+//
+// The rows are JSON objects with the keys of the rows of a patient data file. Without a
+// patient ID, rows are added to the patient currently shown. Rows already contained in the
+// table are skipped. Requests arriving together are applied as one batch.
+namespace IpcProtocol
+{
+    // Answered with an empty response, to check whether an instance is running.
+    const static QString commandPing = "ping";
+
+    // Answered by "patients", one object {"patientId", "name", "fileName", "active"} per open patient.
+    const static QString commandListPatients = "listPatients";
+
+    const static QString commandAddBloodSamples = "addBloodSamples";
+    const static QString commandAddChemoAndMeds = "addChemoAndMeds";
+
+    // Requests longer than this are refused and the connection is closed.
+    const static qint64 maxRequestBytes = 16 * 1024 * 1024;
+
+    // The socket is per user, so that the instances of users sharing a workstation (e.g. a
+    // terminal server) do not receive the rows of each other.
+    inline QString serverName()
+    {
+        QString userName = qEnvironmentVariable("USERNAME", qEnvironmentVariable("USER"));
+
+        return "leuki-" + userName;
+    }
+}
+
+#endif // IPCPROTOCOL_H
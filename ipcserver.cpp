@@ -0,0 +1,190 @@
+#include "ipcserver.h"
+#include "ipcprotocol.h"
+#include <QJsonDocument>
+
+// Requests arriving within this time after the first one are applied as one batch.
+const static int batchDelayMilliseconds = 50;
+
+const static int connectTimeoutMilliseconds = 500;
+
+IpcServer::IpcServer(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_server, &QLocalServer::newConnection, this, &IpcServer::acceptConnections);
+
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(batchDelayMilliseconds);
+    connect(&m_batchTimer, &QTimer::timeout, this, &IpcServer::emitBatch);
+}
+
+IpcServer::~IpcServer()
+{
+    m_server.close();
+}
+
+// Starts listening unless another instance of the user does already. A socket left over by an
+// instance which has not been closed properly is removed.
+bool IpcServer::listen()
+{
+    auto serverName = IpcProtocol::serverName();
+
+    // Only the user may connect, rows are pushed into patient data.
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    if(m_server.listen(serverName))
+    {
+        return true;
+    }
+
+    if(m_server.serverError() != QAbstractSocket::AddressInUseError)
+    {
+        return false;
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+
+    if(socket.waitForConnected(connectTimeoutMilliseconds))
+    {
+        return false;
+    }
+
+    QLocalServer::removeServer(serverName);
+
+    return m_server.listen(serverName);
+}
+
+// Responds to a request of a batch, the response gets the ID of the request. Responses without
+// "ok" are successful.
+void IpcServer::respond(const request_t& request, QJsonObject response)
+{
+    response["id"] = request.id;
+
+    if(!response.contains("ok"))
+    {
+        response["ok"] = true;
+    }
+
+    writeResponse(request.socket, response);
+}
+
+void IpcServer::acceptConnections()
+{
+    while(m_server.hasPendingConnections())
+    {
+        auto socket = m_server.nextPendingConnection();
+
+        connect(socket, &QLocalSocket::readyRead, this, &IpcServer::readRequests);
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+// Reads the complete request lines, an incomplete line stays in the socket until the rest has
+// arrived.
+void IpcServer::readRequests()
+{
+    auto socket = qobject_cast<QLocalSocket*>(sender());
+
+    if(!socket)
+    {
+        return;
+    }
+
+    while(socket->canReadLine())
+    {
+        readRequest(socket, socket->readLine().trimmed());
+    }
+
+    if(socket->bytesAvailable() > IpcProtocol::maxRequestBytes)
+    {
+        writeError(socket, QJsonValue(), "Request exceeds " + QString::number(IpcProtocol::maxRequestBytes) + " bytes.");
+        socket->disconnectFromServer();
+    }
+}
+
+void IpcServer::emitBatch()
+{
+    QVector<request_t> requests;
+    requests.swap(m_pendingRequests);
+
+    emit batchReceived(requests);
+}
+
+// Parses a request line. Requests for the main window are queued for the next batch, invalid
+// requests are answered at once.
+void IpcServer::readRequest(QLocalSocket *socket, const QByteArray& line)
+{
+    if(line.isEmpty())
+    {
+        return;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument requestJsonDocument = QJsonDocument::fromJson(line, &parseError);
+
+    if(!requestJsonDocument.isObject())
+    {
+        writeError(socket, QJsonValue(), "Request is not a JSON object: " + parseError.errorString());
+        return;
+    }
+
+    QJsonObject requestJsonObject = requestJsonDocument.object();
+    request_t request = {socket, requestJsonObject["id"], requestJsonObject["command"].toString(),
+                         requestJsonObject["patientId"].toString(), requestJsonObject["rows"].toArray()};
+
+    if(request.command == IpcProtocol::commandPing)
+    {
+        respond(request, QJsonObject());
+        return;
+    }
+
+    if(request.command == IpcProtocol::commandAddBloodSamples || request.command == IpcProtocol::commandAddChemoAndMeds)
+    {
+        if(!requestJsonObject["rows"].isArray())
+        {
+            writeError(socket, request.id, "Rows are missing.");
+            return;
+        }
+
+        for(const auto& rowJsonValue : std::as_const(request.rows))
+        {
+            if(!rowJsonValue.isObject())
+            {
+                writeError(socket, request.id, "Rows must be JSON objects.");
+                return;
+            }
+        }
+    }
+    else if(request.command != IpcProtocol::commandListPatients)
+    {
+        writeError(socket, request.id, "Unknown command \"" + request.command + "\".");
+        return;
+    }
+
+    m_pendingRequests.append(request);
+
+    if(!m_batchTimer.isActive())
+    {
+        m_batchTimer.start();
+    }
+}
+
+void IpcServer::writeResponse(QLocalSocket *socket, const QJsonObject& response)
+{
+    if(!socket || socket->state() != QLocalSocket::ConnectedState)
+    {
+        return;
+    }
+
+    socket->write(QJsonDocument(response).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void IpcServer::writeError(QLocalSocket *socket, const QJsonValue& id, const QString& error)
+{
+    QJsonObject response;
+    response["id"] = id;
+    response["ok"] = false;
+    response["error"] = error;
+
+    writeResponse(socket, response);
+}
@@ -0,0 +1,60 @@
+#ifndef IPCSERVER_H
+#define IPCSERVER_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+// Local socket endpoint by which tools on the same workstation push rows into the open
+// patients, see ipcprotocol.h for the protocol. Requests are parsed as they arrive and handed
+// over in batches, so that a tool pushing many requests in a row gets them applied (and the
+// visualization plotted) once. Only the first instance of a user listens.
+class IpcServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        // Connection to respond on, null if the client has disconnected in the meantime.
+        QPointer<QLocalSocket> socket;
+
+        QJsonValue id;
+        QString command;
+        QString patientId;
+        QJsonArray rows;
+    } request_t;
+
+    explicit IpcServer(QObject *parent = nullptr);
+    ~IpcServer();
+
+    bool listen();
+    void respond(const request_t& request, QJsonObject response);
+
+signals:
+    // Requests arrived within the batch delay, in the order of arrival. Ping requests are
+    // answered by the server and not included.
+    void batchReceived(const QVector<IpcServer::request_t>& requests);
+
+private slots:
+    void acceptConnections();
+    void readRequests();
+    void emitBatch();
+
+private:
+    QLocalServer m_server;
+    QTimer m_batchTimer;
+    QVector<request_t> m_pendingRequests;
+
+    void readRequest(QLocalSocket *socket, const QByteArray& line);
+
+    static void writeResponse(QLocalSocket *socket, const QJsonObject& response);
+    static void writeError(QLocalSocket *socket, const QJsonValue& id, const QString& error);
+};
+
+#endif // IPCSERVER_H
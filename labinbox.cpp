@@ -0,0 +1,575 @@
+#include "labinbox.h"
+#include "labresultfile.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "patienttablemodel.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+
+const static QString ingestedListFileName = ".leukiInboxIngested";
+const static QStringList labResultFileNameFilters = {"*.csv", "*.txt", "*.json"};
+
+// Delay between a change notification and the scan, so that a burst of new files results in
+// a single scan.
+const static int scanDelayMilliseconds = 1000;
+
+// File system notifications are not reliable on all (e.g. network) file systems, so the inbox
+// is scanned periodically as well.
+const static int fallbackScanIntervalMilliseconds = 60000;
+
+// Files modified more recently are expected to be still written by the analyzer.
+const static int fileSettleMilliseconds = 2000;
+
+// Writes the passed data to the passed file atomically.
+static void writeIngestedListFile(const QString& fileName, const QByteArray& data)
+{
+    QSaveFile file(fileName);
+
+    if(file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        file.write(data);
+        file.commit();
+    }
+}
+
+LabInbox::LabInbox(QObject *parent)
+    : QObject(parent)
+    , m_rescanPending(false)
+{
+    m_scanDelayTimer.setSingleShot(true);
+    m_scanDelayTimer.setInterval(scanDelayMilliseconds);
+    connect(&m_scanDelayTimer, &QTimer::timeout, this, &LabInbox::scan);
+
+    m_fallbackScanTimer.setInterval(fallbackScanIntervalMilliseconds);
+    connect(&m_fallbackScanTimer, &QTimer::timeout, this, &LabInbox::scan);
+
+    connect(&m_fileSystemWatcher, &QFileSystemWatcher::directoryChanged, this, &LabInbox::scheduleScan);
+    connect(&m_scanWatcher, &QFutureWatcher<scan_result_t>::finished, this, &LabInbox::handleScanResult);
+
+    m_threadPool.setMaxThreadCount(1);
+}
+
+LabInbox::~LabInbox()
+{
+    m_threadPool.waitForDone();
+}
+
+// Starts watching the passed inbox directory. Watching stops if the inbox directory is empty.
+void LabInbox::setDirectories(const QString& inboxDirectory, const QString& patientDataDirectory)
+{
+    if(inboxDirectory == m_inboxDirectory && patientDataDirectory == m_patientDataDirectory)
+    {
+        return;
+    }
+
+    if(!m_fileSystemWatcher.directories().isEmpty())
+    {
+        m_fileSystemWatcher.removePaths(m_fileSystemWatcher.directories());
+    }
+
+    if(inboxDirectory != m_inboxDirectory)
+    {
+        m_inboxDirectory = inboxDirectory;
+        loadIngestedList();
+    }
+
+    if(patientDataDirectory != m_patientDataDirectory)
+    {
+        m_patientDataDirectory = patientDataDirectory;
+        m_patientDataFiles.clear();
+        retryUnmatchedFiles();
+    }
+
+    if(m_inboxDirectory.isEmpty())
+    {
+        m_scanDelayTimer.stop();
+        m_fallbackScanTimer.stop();
+        return;
+    }
+
+    m_fallbackScanTimer.start();
+    scheduleScan();
+}
+
+// Samples of these patients are handed over by bloodSamplesReceived() instead of being written
+// to their patient data files.
+void LabInbox::setOpenPatientIds(const QSet<QString>& patientIds)
+{
+    if(patientIds == m_openPatientIds)
+    {
+        return;
+    }
+
+    m_openPatientIds = patientIds;
+    retryUnmatchedFiles();
+
+    // Samples of these patients may have been waiting for a patient data file.
+    if(!m_inboxDirectory.isEmpty())
+    {
+        scheduleScan();
+    }
+}
+
+// Returns the passed rows which are contained neither in the passed columnar table nor
+// earlier in the passed rows, so that ingesting a file again does not duplicate samples.
+QVector<QVector<QString>> LabInbox::withoutExistingRows(const QVector<QVector<QString>>& columns,
+                                                        const QVector<QVector<QString>>& rows)
+{
+    const static QChar cellSeparator = QChar(0x1f);
+
+    auto columnCount = static_cast<int>(columns.size());
+    auto rowCount = columns.isEmpty() ? 0 : static_cast<int>(columns[0].size());
+
+    QSet<QString> existingRows;
+    existingRows.reserve(rowCount + rows.size());
+
+    for(auto row = 0; row < rowCount; row++)
+    {
+        QString key;
+
+        for(auto column = 0; column < columnCount; column++)
+        {
+            key += columns[column][row] + cellSeparator;
+        }
+
+        existingRows.insert(key);
+    }
+
+    QVector<QVector<QString>> newRows;
+
+    for(const auto& row : rows)
+    {
+        QString key;
+
+        for(auto column = 0; column < columnCount; column++)
+        {
+            key += row.value(column) + cellSeparator;
+        }
+
+        if(!existingRows.contains(key))
+        {
+            existingRows.insert(key);
+            newRows.append(row);
+        }
+    }
+
+    return newRows;
+}
+
+void LabInbox::scheduleScan()
+{
+    // Restarting the timer debounces bursts of changes.
+    m_scanDelayTimer.start(scanDelayMilliseconds);
+}
+
+// Collects the inbox files which are new or changed since the last scan and hands them over
+// to the worker thread. Unchanged files are skipped without reading them.
+void LabInbox::scan()
+{
+    if(m_inboxDirectory.isEmpty())
+    {
+        return;
+    }
+
+    if(m_scanWatcher.isRunning())
+    {
+        m_rescanPending = true;
+        return;
+    }
+
+    QDir inboxDirectory(m_inboxDirectory);
+
+    if(!inboxDirectory.exists())
+    {
+        return;
+    }
+
+    // The directory may have been created (again) after watching was started.
+    if(m_fileSystemWatcher.directories().isEmpty())
+    {
+        m_fileSystemWatcher.addPath(m_inboxDirectory);
+    }
+
+    // A new or saved patient data file may match the unmatched files.
+    QDateTime patientDataDirectoryLastModified = QFileInfo(m_patientDataDirectory).lastModified();
+
+    if(patientDataDirectoryLastModified != m_patientDataDirectoryLastModified)
+    {
+        m_patientDataDirectoryLastModified = patientDataDirectoryLastModified;
+        retryUnmatchedFiles();
+    }
+
+    scan_job_t job;
+    QDateTime settledTime = QDateTime::currentDateTime().addMSecs(-fileSettleMilliseconds);
+    bool unsettledFiles = false;
+
+    const auto fileInfos = inboxDirectory.entryInfoList(labResultFileNameFilters, QDir::Files);
+
+    for(const auto& fileInfo : fileInfos)
+    {
+        auto inboxFile = m_inboxFiles.constFind(fileInfo.fileName());
+
+        if(inboxFile != m_inboxFiles.constEnd() &&
+           inboxFile->size == fileInfo.size() &&
+           inboxFile->lastModified == fileInfo.lastModified() &&
+           (inboxFile->failed || inboxFile->unmatched || m_ingestedHashes.contains(inboxFile->hash)))
+        {
+            continue;
+        }
+
+        if(fileInfo.lastModified() > settledTime)
+        {
+            unsettledFiles = true;
+            continue;
+        }
+
+        job.fileNames.append(fileInfo.fileName());
+    }
+
+    if(unsettledFiles)
+    {
+        m_scanDelayTimer.start(fileSettleMilliseconds);
+    }
+
+    if(job.fileNames.isEmpty())
+    {
+        return;
+    }
+
+    job.inboxDirectory = m_inboxDirectory;
+    job.patientDataDirectory = m_patientDataDirectory;
+    job.openPatientIds = m_openPatientIds;
+    job.inboxFiles = m_inboxFiles;
+    job.ingestedHashes = m_ingestedHashes;
+    job.patientDataFiles = m_patientDataFiles;
+
+    m_scanWatcher.setFuture(QtConcurrent::run(&m_threadPool, runScan, job));
+}
+
+// Takes over the state of a finished scan and passes the samples of the open patients on.
+void LabInbox::handleScanResult()
+{
+    scan_result_t result = m_scanWatcher.result();
+
+    // Results of directories no longer in use are dropped. Samples already merged into patient
+    // data files are recognized as existing when the files are ingested again.
+    if(result.job.inboxDirectory == m_inboxDirectory && result.job.patientDataDirectory == m_patientDataDirectory)
+    {
+        m_inboxFiles = result.job.inboxFiles;
+        m_patientDataFiles = result.job.patientDataFiles;
+
+        // Patients opened during the scan may match files the scan has not matched.
+        if(result.job.openPatientIds != m_openPatientIds)
+        {
+            retryUnmatchedFiles();
+        }
+
+        for(auto it = result.openPatientRows.constBegin(); it != result.openPatientRows.constEnd(); it++)
+        {
+            if(m_openPatientIds.contains(it.key()))
+            {
+                emit bloodSamplesReceived(it.key(), it.value());
+                continue;
+            }
+
+            // The patient has been closed meanwhile, its files are ingested again by the next scan.
+            for(const auto& fileName : std::as_const(result.openPatientFileNames[it.key()]))
+            {
+                result.ingestedFileNames.removeAll(fileName);
+            }
+
+            m_rescanPending = true;
+        }
+
+        for(const auto& fileName : std::as_const(result.ingestedFileNames))
+        {
+            m_ingestedHashes.insert(m_inboxFiles[fileName].hash);
+        }
+
+        if(!result.ingestedFileNames.isEmpty())
+        {
+            saveIngestedList();
+        }
+
+        if(!result.ingestedFileNames.isEmpty() || !result.unknownPatientIds.isEmpty() || result.failedFileCount > 0)
+        {
+            emit scanFinished(result.ingestedFileNames.size(), result.updatedPatientDataFileNames,
+                              result.unknownPatientIds.values(), result.failedFileCount);
+        }
+    }
+    else
+    {
+        m_rescanPending = true;
+    }
+
+    if(m_rescanPending)
+    {
+        m_rescanPending = false;
+        scheduleScan();
+    }
+}
+
+// Loads the list of ingested files of the inbox directory. Each line contains the SHA-256
+// hash, size, modification time (milliseconds since epoch) and name of an ingested file.
+void LabInbox::loadIngestedList()
+{
+    m_inboxFiles.clear();
+    m_ingestedHashes.clear();
+
+    QFile ingestedListFile(m_inboxDirectory + "/" + ingestedListFileName);
+
+    if(m_inboxDirectory.isEmpty() || !ingestedListFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return;
+    }
+
+    while(!ingestedListFile.atEnd())
+    {
+        QString line = QString::fromUtf8(ingestedListFile.readLine()).trimmed();
+        QStringList fields = line.split(';');
+
+        if(fields.size() < 4 || fields[0].isEmpty())
+        {
+            continue;
+        }
+
+        QByteArray hash = QByteArray::fromHex(fields[0].toLatin1());
+        m_ingestedHashes.insert(hash);
+
+        // The file name is the last field as it may contain the separator itself.
+        QString fileName = fields.mid(3).join(';');
+
+        if(!fileName.isEmpty())
+        {
+            inbox_file_t inboxFile;
+
+            inboxFile.size = fields[1].toLongLong();
+            inboxFile.lastModified = QDateTime::fromMSecsSinceEpoch(fields[2].toLongLong());
+            inboxFile.hash = hash;
+            inboxFile.failed = false;
+            inboxFile.unmatched = false;
+
+            m_inboxFiles[fileName] = inboxFile;
+        }
+    }
+}
+
+// Hashes of ingested files which have been removed from the inbox are kept, so that a copy
+// of the same file dropped again is skipped as well.
+void LabInbox::saveIngestedList()
+{
+    QByteArray data;
+    QSet<QByteArray> writtenHashes;
+
+    for(auto it = m_inboxFiles.constBegin(); it != m_inboxFiles.constEnd(); it++)
+    {
+        if(!it->failed && m_ingestedHashes.contains(it->hash))
+        {
+            data += it->hash.toHex() + ";" + QByteArray::number(it->size) + ";" +
+                    QByteArray::number(it->lastModified.toMSecsSinceEpoch()) + ";" + it.key().toUtf8() + "\n";
+            writtenHashes.insert(it->hash);
+        }
+    }
+
+    for(const auto& hash : std::as_const(m_ingestedHashes))
+    {
+        if(!writtenHashes.contains(hash))
+        {
+            data += hash.toHex() + ";;;\n";
+        }
+    }
+
+    (void)QtConcurrent::run(&m_threadPool, writeIngestedListFile, m_inboxDirectory + "/" + ingestedListFileName, data);
+}
+
+// Reads the unmatched files again with the next scan.
+void LabInbox::retryUnmatchedFiles()
+{
+    for(auto& inboxFile : m_inboxFiles)
+    {
+        inboxFile.unmatched = false;
+    }
+}
+
+// Runs on the worker thread: hashes and parses the passed inbox files and merges the samples
+// into the patient data files. Files are only reported as ingested if the samples of all
+// their patients could be stored.
+LabInbox::scan_result_t LabInbox::runScan(scan_job_t job)
+{
+    scan_result_t result;
+    result.failedFileCount = 0;
+
+    LabResultFile::results_t results;
+    QHash<QString, QStringList> patientFileNames;
+
+    for(const auto& fileName : std::as_const(job.fileNames))
+    {
+        QFile labResultFile(job.inboxDirectory + "/" + fileName);
+        QFileInfo labResultFileInfo(labResultFile);
+
+        if(!labResultFile.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+
+        QByteArray data = labResultFile.readAll();
+        labResultFile.close();
+
+        inbox_file_t inboxFile;
+
+        inboxFile.size = labResultFileInfo.size();
+        inboxFile.lastModified = labResultFileInfo.lastModified();
+        inboxFile.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+        inboxFile.failed = false;
+        inboxFile.unmatched = false;
+
+        if(job.ingestedHashes.contains(inboxFile.hash))
+        {
+            job.inboxFiles[fileName] = inboxFile;
+            continue;
+        }
+
+        LabResultFile::results_t fileResults;
+
+        if(!LabResultFile::parse(fileName, data, fileResults))
+        {
+            // Not retried until the file changes.
+            inboxFile.failed = true;
+            job.inboxFiles[fileName] = inboxFile;
+            result.failedFileCount++;
+            continue;
+        }
+
+        job.inboxFiles[fileName] = inboxFile;
+        result.ingestedFileNames.append(fileName);
+
+        for(auto it = fileResults.constBegin(); it != fileResults.constEnd(); it++)
+        {
+            results[it.key()] += it.value();
+            patientFileNames[it.key()].append(fileName);
+        }
+    }
+
+    // Files of patients whose samples cannot be stored are not ingested yet. Files of patients
+    // without patient data file are only read again when there may be a patient data file.
+    QSet<QString> unmatchedFileNames;
+    QSet<QString> failedFileNames;
+
+    auto notIngested = [&result, &patientFileNames](const QString& patientId, QSet<QString>& notIngestedFileNames)
+    {
+        for(const auto& fileName : std::as_const(patientFileNames[patientId]))
+        {
+            result.ingestedFileNames.removeAll(fileName);
+            notIngestedFileNames.insert(fileName);
+        }
+    };
+
+    QHash<QString, QString> patientDataFileNames;
+    bool patientDataFilesIndexed = false;
+
+    for(auto it = results.constBegin(); it != results.constEnd(); it++)
+    {
+        if(it.value().isEmpty())
+        {
+            continue;
+        }
+
+        if(job.openPatientIds.contains(it.key()))
+        {
+            result.openPatientRows[it.key()] = it.value();
+            result.openPatientFileNames[it.key()] = patientFileNames[it.key()];
+            continue;
+        }
+
+        // The patient IDs of the patient data files are only read for new or changed files.
+        if(!patientDataFilesIndexed && !job.patientDataDirectory.isEmpty())
+        {
+            QHash<QString, patient_data_file_t> patientDataFiles;
+            const auto fileInfos = QDir(job.patientDataDirectory).entryInfoList({"*.json"}, QDir::Files);
+
+            for(const auto& fileInfo : fileInfos)
+            {
+                auto patientDataFile = job.patientDataFiles.constFind(fileInfo.absoluteFilePath());
+
+                if(patientDataFile != job.patientDataFiles.constEnd() && patientDataFile->lastModified == fileInfo.lastModified())
+                {
+                    patientDataFiles[fileInfo.absoluteFilePath()] = *patientDataFile;
+                }
+                else
+                {
+                    PatientDataFile::patient_data_t patientData;
+                    patient_data_file_t newPatientDataFile;
+
+                    newPatientDataFile.lastModified = fileInfo.lastModified();
+
+                    if(PatientDataFile::load(fileInfo.absoluteFilePath(), patientData))
+                    {
+                        newPatientDataFile.patientId = patientData.patientId;
+                    }
+
+                    patientDataFiles[fileInfo.absoluteFilePath()] = newPatientDataFile;
+                }
+
+                if(!patientDataFiles[fileInfo.absoluteFilePath()].patientId.isEmpty())
+                {
+                    patientDataFileNames[patientDataFiles[fileInfo.absoluteFilePath()].patientId] = fileInfo.absoluteFilePath();
+                }
+            }
+
+            job.patientDataFiles = patientDataFiles;
+            patientDataFilesIndexed = true;
+        }
+
+        if(!patientDataFileNames.contains(it.key()))
+        {
+            result.unknownPatientIds.insert(it.key());
+            notIngested(it.key(), unmatchedFileNames);
+            continue;
+        }
+
+        QString patientDataFileName = patientDataFileNames[it.key()];
+        PatientDataFile::patient_data_t patientData;
+
+        if(!PatientDataFile::load(patientDataFileName, patientData))
+        {
+            notIngested(it.key(), failedFileNames);
+            continue;
+        }
+
+        QVector<QVector<QString>> newRows = withoutExistingRows(patientData.bloodSamples, it.value());
+
+        if(newRows.isEmpty())
+        {
+            continue;
+        }
+
+        // Only the new samples are sorted, they are merged with the already sorted samples.
+        QVector<qint64> dateKeys = PatientTableModel::parseDates(patientData.bloodSamples, PatientDataSchema::bloodSamplesDateColumn);
+        PatientTableModel::mergeRowsSorted(patientData.bloodSamples, dateKeys, PatientDataSchema::bloodSamplesDateColumn, newRows);
+
+        if(!PatientDataFile::save(patientDataFileName, patientData))
+        {
+            notIngested(it.key(), failedFileNames);
+            continue;
+        }
+
+        job.patientDataFiles[patientDataFileName].lastModified = QFileInfo(patientDataFileName).lastModified();
+        result.updatedPatientDataFileNames.append(patientDataFileName);
+    }
+
+    for(const auto& fileName : std::as_const(unmatchedFileNames))
+    {
+        if(!failedFileNames.contains(fileName))
+        {
+            job.inboxFiles[fileName].unmatched = true;
+        }
+    }
+
+    result.job = job;
+
+    return result;
+}
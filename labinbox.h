@@ -0,0 +1,117 @@
+#ifndef LABINBOX_H
+#define LABINBOX_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+// Watches the inbox directory the lab analyzers write their result files to. New files are
+// parsed on a worker thread and their blood samples are merged into the patient data file of
+// the patient ID found in the patient data directory. Samples of the patients currently open
+// are handed over by bloodSamplesReceived() instead, so that unsaved changes are kept.
+// Files already ingested are recognized by their content hash and skipped.
+class LabInbox : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LabInbox(QObject *parent = nullptr);
+    ~LabInbox();
+
+    void setDirectories(const QString& inboxDirectory, const QString& patientDataDirectory);
+    void setOpenPatientIds(const QSet<QString>& patientIds);
+
+    static QVector<QVector<QString>> withoutExistingRows(const QVector<QVector<QString>>& columns,
+                                                         const QVector<QVector<QString>>& rows);
+
+    // State of an inbox file, the hash is only computed again if size or modification time change.
+    // Files which cannot be parsed are marked as failed and not read again until they change.
+    // Files of patients without patient data file are marked as unmatched and not read again
+    // until they change, a patient is opened or the patient data directory changes.
+    typedef struct
+    {
+        qint64 size;
+        QDateTime lastModified;
+        QByteArray hash;
+        bool failed;
+        bool unmatched;
+    } inbox_file_t;
+
+    // Patient ID of a patient data file, only read again if the modification time changes.
+    typedef struct
+    {
+        QDateTime lastModified;
+        QString patientId;
+    } patient_data_file_t;
+
+    typedef struct
+    {
+        QString inboxDirectory;
+        QString patientDataDirectory;
+        QSet<QString> openPatientIds;
+        QStringList fileNames;
+        QHash<QString, inbox_file_t> inboxFiles;
+        QSet<QByteArray> ingestedHashes;
+        QHash<QString, patient_data_file_t> patientDataFiles;
+    } scan_job_t;
+
+    typedef struct
+    {
+        scan_job_t job;
+        QStringList ingestedFileNames;
+        QHash<QString, QStringList> openPatientFileNames;
+        QHash<QString, QVector<QVector<QString>>> openPatientRows;
+        QSet<QString> unknownPatientIds;
+        QStringList updatedPatientDataFileNames;
+        int failedFileCount;
+    } scan_result_t;
+
+signals:
+    // Blood samples of an open patient (each row in the column order of the blood sample table).
+    void bloodSamplesReceived(const QString& patientId, const QVector<QVector<QString>>& rows);
+
+    // Emitted after a scan which ingested files or found files which cannot be ingested.
+    void scanFinished(int ingestedFileCount, const QStringList& updatedPatientDataFileNames,
+                      const QStringList& unknownPatientIds, int failedFileCount);
+
+private slots:
+    void scheduleScan();
+    void scan();
+    void handleScanResult();
+
+private:
+    QString m_inboxDirectory;
+    QString m_patientDataDirectory;
+    QSet<QString> m_openPatientIds;
+
+    QHash<QString, inbox_file_t> m_inboxFiles;
+    QSet<QByteArray> m_ingestedHashes;
+    QHash<QString, patient_data_file_t> m_patientDataFiles;
+
+    // Modification time of the patient data directory when unmatched files have been matched
+    // last, it changes when a patient data file is added or saved.
+    QDateTime m_patientDataDirectoryLastModified;
+
+    QFileSystemWatcher m_fileSystemWatcher;
+    QTimer m_scanDelayTimer;
+    QTimer m_fallbackScanTimer;
+    bool m_rescanPending;
+
+    // A single thread keeps scans and writes of the ingested list in order.
+    QThreadPool m_threadPool;
+    QFutureWatcher<scan_result_t> m_scanWatcher;
+
+    void loadIngestedList();
+    void saveIngestedList();
+    void retryUnmatchedFiles();
+
+    static scan_result_t runScan(scan_job_t job);
+};
+
+#endif // LABINBOX_H
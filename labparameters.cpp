@@ -0,0 +1,60 @@
+#include "labparameters.h"
+#include <cmath>
+
+// The registry is created on first use, so that it can be used to initialize other static
+// data regardless of the initialization order.
+const QVector<LabParameters::parameter_t>& LabParameters::parameters()
+{
+    static const QVector<parameter_t> registry = []()
+    {
+        QVector<parameter_t> parameters;
+
+        for(const auto& labParameter : PatientDataSchema::labParameters)
+        {
+            parameters.append({QString::fromUtf8(labParameter.name),
+                               QString::fromUtf8(labParameter.unit),
+                               QString::fromUtf8(labParameter.jsonKey),
+                               QColor(labParameter.color),
+                               labParameter.referenceLow,
+                               labParameter.referenceHigh,
+                               labParameter.axis});
+        }
+
+        return parameters;
+    }();
+
+    return registry;
+}
+
+// Returns the parameter of the passed blood sample table column (not the date column).
+const LabParameters::parameter_t& LabParameters::parameterOfColumn(int column)
+{
+    return parameters()[PatientDataSchema::labParameterIndex(column)];
+}
+
+// Returns the column name of the blood sample table, e.g. "Leukocytes [Giga/l]".
+QString LabParameters::columnName(const parameter_t& parameter)
+{
+    return parameter.name + " [" + parameter.unit + "]";
+}
+
+// Returns the reference range as text, e.g. "4 - 10 Giga/l" or "<= 5 mg/l".
+QString LabParameters::referenceRangeText(const parameter_t& parameter)
+{
+    if(std::isnan(parameter.referenceLow) && std::isnan(parameter.referenceHigh))
+    {
+        return QString();
+    }
+
+    if(std::isnan(parameter.referenceLow))
+    {
+        return "<= " + QString::number(parameter.referenceHigh) + " " + parameter.unit;
+    }
+
+    if(std::isnan(parameter.referenceHigh))
+    {
+        return ">= " + QString::number(parameter.referenceLow) + " " + parameter.unit;
+    }
+
+    return QString::number(parameter.referenceLow) + " - " + QString::number(parameter.referenceHigh) + " " + parameter.unit;
+}
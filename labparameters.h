@@ -0,0 +1,38 @@
+#ifndef LABPARAMETERS_H
+#define LABPARAMETERS_H
+
+#include <QColor>
+#include <QString>
+#include <QVector>
+#include "patientdataschema.h"
+
+// Registry of the blood values (lab parameters) of the blood sample table, created from
+// PatientDataSchema::labParameters with Qt types for the user interface. The visualization
+// check boxes and graphs are derived from it, so that a parameter is added by adding an
+// entry to the schema.
+class LabParameters
+{
+public:
+    typedef struct
+    {
+        // Also the name of the visualization setting.
+        QString name;
+        QString unit;
+        QString jsonKey;
+        QColor color;
+
+        // Reference range, NaN where there is no limit.
+        double referenceLow;
+        double referenceHigh;
+
+        PatientDataSchema::axis_t axis;
+    } parameter_t;
+
+    static const QVector<parameter_t>& parameters();
+
+    static const parameter_t& parameterOfColumn(int column);
+    static QString columnName(const parameter_t& parameter);
+    static QString referenceRangeText(const parameter_t& parameter);
+};
+
+#endif // LABPARAMETERS_H
@@ -0,0 +1,244 @@
+#include "labresultfile.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QDate>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+const static QString patientIdKey = "patientId";
+
+// Parses the passed content of a lab result file, the format is chosen by the file
+// extension. Returns false if the content is not a lab result file.
+bool LabResultFile::parse(const QString& fileName, const QByteArray& data, results_t& results)
+{
+    if(fileName.endsWith(".json", Qt::CaseInsensitive))
+    {
+        return parseJson(data, results);
+    }
+
+    if(fileName.endsWith(".csv", Qt::CaseInsensitive) || fileName.endsWith(".txt", Qt::CaseInsensitive))
+    {
+        return parseCsv(data, results);
+    }
+
+    return false;
+}
+
+// Columns are identified by the header row using the keys of the patient data files, so the
+// column order of the analyzer does not matter. Unknown columns are ignored.
+bool LabResultFile::parseCsv(const QByteArray& data, results_t& results)
+{
+    QStringList lines = QString::fromUtf8(data).split('\n');
+    int headerLine = 0;
+
+    while(headerLine < lines.size() && lines[headerLine].trimmed().isEmpty())
+    {
+        headerLine++;
+    }
+
+    csv_header_t header;
+
+    if(headerLine == lines.size() || !parseCsvHeader(lines[headerLine], header))
+    {
+        return false;
+    }
+
+    for(auto line = headerLine + 1; line < lines.size(); line++)
+    {
+        if(lines[line].trimmed().isEmpty())
+        {
+            continue;
+        }
+
+        QStringList cells = lines[line].split(header.separator);
+        QString patientId = cellText(cells.value(header.patientIdColumn));
+
+        if(patientId.isEmpty())
+        {
+            continue;
+        }
+
+        QVector<QString> row(header.columns.size());
+
+        row[PatientDataSchema::bloodSamplesDateColumn] = dateToText(cellText(cells.value(header.columns[PatientDataSchema::bloodSamplesDateColumn])));
+
+        for(auto column = 0; column < header.columns.size(); column++)
+        {
+            if(column != PatientDataSchema::bloodSamplesDateColumn && header.columns[column] >= 0)
+            {
+                row[column] = valueToText(cellText(cells.value(header.columns[column])), header.decimalComma);
+            }
+        }
+
+        results[patientId].append(row);
+    }
+
+    return true;
+}
+
+// Takes the separator from the passed header row and maps the CSV columns to the blood sample
+// table columns. With ';', tab or '|' separated files a decimal comma is expected. Returns
+// false if the patient ID or date column is missing.
+bool LabResultFile::parseCsvHeader(const QString& headerLine, csv_header_t& header)
+{
+    header.separator = ',';
+
+    for(QChar separator : {';', '\t', '|'})
+    {
+        if(headerLine.contains(separator))
+        {
+            header.separator = separator;
+            break;
+        }
+    }
+
+    header.decimalComma = header.separator != ',';
+    header.patientIdColumn = -1;
+    header.columns = QVector<int>(PatientDataFile::bloodSamplesJsonKeys.size(), -1);
+
+    QStringList headerCells = headerLine.split(header.separator);
+
+    for(auto csvColumn = 0; csvColumn < headerCells.size(); csvColumn++)
+    {
+        QString headerCell = cellText(headerCells[csvColumn]);
+
+        if(headerCell.compare(patientIdKey, Qt::CaseInsensitive) == 0)
+        {
+            header.patientIdColumn = csvColumn;
+            continue;
+        }
+
+        for(auto column = 0; column < PatientDataFile::bloodSamplesJsonKeys.size(); column++)
+        {
+            if(headerCell.compare(PatientDataFile::bloodSamplesJsonKeys[column], Qt::CaseInsensitive) == 0)
+            {
+                header.columns[column] = csvColumn;
+            }
+        }
+    }
+
+    return header.patientIdColumn >= 0 && header.columns[PatientDataSchema::bloodSamplesDateColumn] >= 0;
+}
+
+// Returns the trimmed text of a CSV cell without enclosing quotes.
+QString LabResultFile::cellText(const QString& cell)
+{
+    QString text = cell.trimmed();
+
+    if(text.size() >= 2 && text.startsWith('"') && text.endsWith('"'))
+    {
+        text = text.mid(1, text.size() - 2).trimmed();
+    }
+
+    return text;
+}
+
+bool LabResultFile::parseJson(const QByteArray& data, results_t& results)
+{
+    QJsonParseError parseError;
+    QJsonDocument labResultJsonDocument = QJsonDocument::fromJson(data, &parseError);
+
+    if(parseError.error != QJsonParseError::NoError)
+    {
+        return false;
+    }
+
+    if(labResultJsonDocument.isArray())
+    {
+        QJsonArray labResultsArray = labResultJsonDocument.array();
+
+        for(const auto& labResult : labResultsArray)
+        {
+            parseJsonObject(labResult.toObject(), results);
+        }
+    }
+    else
+    {
+        parseJsonObject(labResultJsonDocument.object(), results);
+    }
+
+    return true;
+}
+
+void LabResultFile::parseJsonObject(const QJsonObject& labResultJsonObject, results_t& results)
+{
+    QString patientId = labResultJsonObject[patientIdKey].toString().trimmed();
+
+    if(patientId.isEmpty())
+    {
+        return;
+    }
+
+    QJsonArray bloodSamplesArray = labResultJsonObject["bloodSamples"].toArray();
+    auto& rows = results[patientId];
+
+    for(const auto& bloodSample : bloodSamplesArray)
+    {
+        QJsonObject bloodSampleJsonObject = bloodSample.toObject();
+        QVector<QString> row(PatientDataFile::bloodSamplesJsonKeys.size());
+
+        for(auto column = 0; column < row.size(); column++)
+        {
+            if(column == PatientDataSchema::bloodSamplesDateColumn)
+            {
+                row[column] = dateToText(bloodSampleJsonObject[PatientDataFile::bloodSamplesJsonKeys[column]].toString());
+                continue;
+            }
+
+            QJsonValue value = bloodSampleJsonObject[PatientDataFile::bloodSamplesJsonKeys[column]];
+
+            if(value.isString())
+            {
+                row[column] = valueToText(value.toString(), false);
+            }
+            else
+            {
+                row[column] = PatientDataFile::bloodSampleValueToText(value);
+            }
+        }
+
+        rows.append(row);
+    }
+}
+
+// Analyzers usually write ISO dates (yyyy-MM-dd, optionally followed by a time), these are
+// converted to the date format of the tables. Other dates are taken over unchanged.
+QString LabResultFile::dateToText(QString dateString)
+{
+    dateString = dateString.trimmed();
+
+    if(dateString.size() >= 10 && dateString[4] == '-' && dateString[7] == '-')
+    {
+        QDate date = QDate::fromString(dateString.left(10), "yyyy-MM-dd");
+
+        if(date.isValid())
+        {
+            return date.toString("dd.MM.yyyy");
+        }
+    }
+
+    return dateString;
+}
+
+// Converts a blood value to the text shown in the table. Values which are no number (e.g.
+// "n.a.") are taken over unchanged, so that they are shown as the lab reported them. They are
+// not plotted.
+QString LabResultFile::valueToText(QString valueString, bool decimalComma)
+{
+    valueString = valueString.trimmed();
+
+    if(decimalComma)
+    {
+        valueString.replace(',', '.');
+    }
+
+    bool conversionSuccessful = false;
+    double value = valueString.toDouble(&conversionSuccessful);
+
+    if(conversionSuccessful)
+    {
+        return QString::number(value);
+    }
+
+    return valueString;
+}
@@ -0,0 +1,44 @@
+#ifndef LABRESULTFILE_H
+#define LABRESULTFILE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+
+// Parsing of result files written by the lab analyzers. Supported are CSV files with a
+// header row (e.g. "patientId;date;leukocytes;erythrocytes;hemoglobin;thrombocytes"), also
+// with '|' separated fields as written by HL7-style lab exports, and JSON files containing
+// one or an array of objects with a patient ID and blood samples in the format of the
+// patient data files.
+class LabResultFile
+{
+public:
+    // Blood sample rows per patient ID, each row a vector of cell texts in the column order
+    // of PatientDataFile::bloodSamplesColumns.
+    typedef QHash<QString, QVector<QVector<QString>>> results_t;
+
+    // Layout of a CSV file taken from its header row. columns holds the CSV column of each
+    // blood sample table column (-1 if not contained).
+    typedef struct
+    {
+        QChar separator;
+        bool decimalComma;
+        int patientIdColumn;
+        QVector<int> columns;
+    } csv_header_t;
+
+    static bool parse(const QString& fileName, const QByteArray& data, results_t& results);
+    static bool parseCsvHeader(const QString& headerLine, csv_header_t& header);
+    static QString cellText(const QString& cell);
+    static QString dateToText(QString dateString);
+    static QString valueToText(QString valueString, bool decimalComma);
+
+private:
+    static bool parseCsv(const QByteArray& data, results_t& results);
+    static bool parseJson(const QByteArray& data, results_t& results);
+    static void parseJsonObject(const QJsonObject& labResultJsonObject, results_t& results);
+};
+
+#endif // LABRESULTFILE_H
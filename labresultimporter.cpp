@@ -0,0 +1,531 @@
+#include "labresultimporter.h"
+#include "labinbox.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "patienttablemodel.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QSet>
+#include <QtConcurrent/QtConcurrent>
+#include <cstring>
+
+// Chunks are large enough to keep the per-task overhead small and small enough to keep all
+// threads busy until the end.
+const static qint64 chunkSizeBytes = 4 * 1024 * 1024;
+
+const static int maximumReportMessages = 20;
+
+// Byte range of a field within the export, no copy of the data is made.
+typedef struct
+{
+    const char *begin;
+    const char *end;
+} field_t;
+
+// Removes surrounding white space and quotes of the passed field.
+static void trimField(field_t& field)
+{
+    while(field.begin < field.end && (*field.begin == ' ' || *field.begin == '\t' || *field.begin == '\r'))
+    {
+        field.begin++;
+    }
+
+    while(field.end > field.begin && (field.end[-1] == ' ' || field.end[-1] == '\t' || field.end[-1] == '\r'))
+    {
+        field.end--;
+    }
+
+    if(field.end - field.begin >= 2 && *field.begin == '"' && field.end[-1] == '"')
+    {
+        field.begin++;
+        field.end--;
+    }
+}
+
+static QString fieldText(const field_t& field)
+{
+    return QString::fromUtf8(field.begin, static_cast<int>(field.end - field.begin));
+}
+
+// Returns the patient ID stored in the passed patient data file, empty if there is none.
+static QString readPatientId(const QString& fileName)
+{
+    PatientDataFile::patient_data_t patientData;
+
+    if(!PatientDataFile::load(fileName, patientData))
+    {
+        return QString();
+    }
+
+    return patientData.patientId;
+}
+
+// Returns a file name for a new patient data file derived from the patient ID.
+static QString newPatientDataFileName(const QString& patientDataDirectory, const QString& patientId, QSet<QString>& reservedFileNames)
+{
+    QString baseName;
+
+    for(const auto& character : patientId)
+    {
+        baseName += character.isLetterOrNumber() || character == '-' || character == '_' ? character : QChar('_');
+    }
+
+    QString fileName = patientDataDirectory + "/" + baseName + ".json";
+
+    for(auto suffix = 2; QFile::exists(fileName) || reservedFileNames.contains(fileName); suffix++)
+    {
+        fileName = patientDataDirectory + "/" + baseName + "_" + QString::number(suffix) + ".json";
+    }
+
+    reservedFileNames.insert(fileName);
+
+    return fileName;
+}
+
+// Imports the passed lab export into the patient data files of the passed directory. With
+// dryRun set, the export is validated and the report is created without writing any file.
+LabResultImporter::import_report_t LabResultImporter::import(const QString& fileName, const QString& patientDataDirectory,
+                                                             bool dryRun, const QSet<QString>& openPatientIds)
+{
+    import_report_t report;
+
+    report.successful = false;
+    report.rowCount = 0;
+    report.malformedRowCount = 0;
+    report.invalidDateCount = 0;
+    report.invalidValueCount = 0;
+    report.duplicateRowCount = 0;
+    report.patientCount = 0;
+    report.newPatientDataFileCount = 0;
+    report.updatedPatientDataFileCount = 0;
+    report.failedPatientDataFileCount = 0;
+
+    QFile labResultFile(fileName);
+
+    if(!labResultFile.open(QIODevice::ReadOnly))
+    {
+        report.error = "Lab result file " + fileName + " cannot be read.";
+        return report;
+    }
+
+    if(patientDataDirectory.isEmpty() || !QDir(patientDataDirectory).exists())
+    {
+        report.error = "Patient data directory " + patientDataDirectory + " does not exist.";
+        return report;
+    }
+
+    // The export is mapped into memory, the chunks and fields refer to it directly. If the
+    // file cannot be mapped it is read instead.
+    QByteArray fileData;
+    auto fileSize = labResultFile.size();
+    const char *data = reinterpret_cast<const char*>(fileSize > 0 ? labResultFile.map(0, fileSize) : nullptr);
+
+    if(!data)
+    {
+        fileData = labResultFile.readAll();
+        data = fileData.constData();
+        fileSize = fileData.size();
+    }
+
+    const char *dataEnd = data + fileSize;
+    const char *position = data;
+    qint64 headerLineNumber = 0;
+
+    // Skip byte order mark and empty lines before the header row.
+    if(fileSize >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    {
+        position += 3;
+    }
+
+    QString headerLine;
+
+    while(position < dataEnd && headerLine.isEmpty())
+    {
+        auto lineEnd = static_cast<const char*>(std::memchr(position, '\n', dataEnd - position));
+
+        if(!lineEnd)
+        {
+            lineEnd = dataEnd;
+        }
+
+        headerLine = QString::fromUtf8(position, static_cast<int>(lineEnd - position)).trimmed();
+        headerLineNumber++;
+        position = lineEnd < dataEnd ? lineEnd + 1 : dataEnd;
+    }
+
+    LabResultFile::csv_header_t header;
+
+    if(!LabResultFile::parseCsvHeader(headerLine, header))
+    {
+        report.error = "The header row of the lab result file does not contain a patientId and a date column.";
+        return report;
+    }
+
+    // Split the rows into chunks ending at line ends and parse them in parallel.
+    QVector<QFuture<chunk_result_t>> chunkFutures;
+
+    while(position < dataEnd)
+    {
+        chunk_t chunk;
+
+        chunk.begin = position;
+        chunk.end = dataEnd;
+
+        if(dataEnd - position > chunkSizeBytes)
+        {
+            auto lineEnd = static_cast<const char*>(std::memchr(position + chunkSizeBytes, '\n', dataEnd - position - chunkSizeBytes));
+
+            if(lineEnd)
+            {
+                chunk.end = lineEnd + 1;
+            }
+        }
+
+        chunkFutures.append(QtConcurrent::run(parseChunk, chunk, header));
+        position = chunk.end;
+    }
+
+    // Group the rows by patient keeping the order of the export.
+    LabResultFile::results_t results;
+    qint64 lineOffset = headerLineNumber;
+
+    for(auto& chunkFuture : chunkFutures)
+    {
+        chunk_result_t chunkResult = chunkFuture.result();
+
+        report.rowCount += chunkResult.rowCount;
+        report.malformedRowCount += chunkResult.malformedRowCount;
+        report.invalidDateCount += chunkResult.invalidDateCount;
+        report.invalidValueCount += chunkResult.invalidValueCount;
+
+        for(const auto& message : std::as_const(chunkResult.messages))
+        {
+            if(report.messages.size() < maximumReportMessages)
+            {
+                report.messages.append("Line " + QString::number(lineOffset + message.first) + ": " + message.second);
+            }
+        }
+
+        lineOffset += chunkResult.lineCount;
+
+        for(auto it = chunkResult.results.begin(); it != chunkResult.results.end(); it++)
+        {
+            results[it.key()] += it.value();
+        }
+    }
+
+    // All cell texts have been copied, the export is not needed anymore.
+    if(fileData.isEmpty())
+    {
+        labResultFile.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+    }
+
+    labResultFile.close();
+
+    report.patientCount = static_cast<int>(results.size());
+
+    for(const auto& openPatientId : openPatientIds)
+    {
+        if(results.contains(openPatientId))
+        {
+            report.openPatientRows[openPatientId] = results.take(openPatientId);
+        }
+    }
+
+    // Find the patient data files of the patients by their patient IDs.
+    const auto fileInfos = QDir(patientDataDirectory).entryInfoList({"*.json"}, QDir::Files);
+    QVector<QFuture<QString>> patientIdFutures;
+
+    for(const auto& fileInfo : fileInfos)
+    {
+        patientIdFutures.append(QtConcurrent::run(readPatientId, fileInfo.absoluteFilePath()));
+    }
+
+    QHash<QString, QString> patientDataFileNames;
+
+    for(auto i = 0; i < fileInfos.size(); i++)
+    {
+        QString patientId = patientIdFutures[i].result();
+
+        if(!patientId.isEmpty())
+        {
+            patientDataFileNames[patientId] = fileInfos[i].absoluteFilePath();
+        }
+    }
+
+    // Import the patients in parallel, each patient data file is written by one task only.
+    QStringList patientIds = results.keys();
+    std::sort(patientIds.begin(), patientIds.end());
+
+    QSet<QString> reservedFileNames;
+    QVector<patient_import_t> patientImports;
+    QVector<QFuture<patient_import_result_t>> patientImportFutures;
+
+    patientImports.reserve(patientIds.size());
+
+    for(const auto& patientId : std::as_const(patientIds))
+    {
+        patient_import_t patientImport;
+
+        patientImport.patientId = patientId;
+        patientImport.newFile = !patientDataFileNames.contains(patientId);
+        patientImport.fileName = patientImport.newFile ? newPatientDataFileName(patientDataDirectory, patientId, reservedFileNames)
+                                                       : patientDataFileNames[patientId];
+        patientImport.rows = results.take(patientId);
+
+        patientImports.append(patientImport);
+    }
+
+    for(const auto& patientImport : std::as_const(patientImports))
+    {
+        patientImportFutures.append(QtConcurrent::run(importPatient, patientImport, dryRun));
+    }
+
+    for(auto i = 0; i < patientImports.size(); i++)
+    {
+        patient_import_result_t patientImportResult = patientImportFutures[i].result();
+
+        report.duplicateRowCount += patientImportResult.duplicateRowCount;
+
+        if(!patientImportResult.successful)
+        {
+            report.failedPatientDataFileCount++;
+
+            if(report.messages.size() < maximumReportMessages)
+            {
+                report.messages.append("Patient data file " + patientImports[i].fileName + " cannot be " +
+                                       (patientImports[i].newFile ? "written." : "read or written."));
+            }
+        }
+        else if(patientImports[i].newFile)
+        {
+            report.newPatientDataFileCount++;
+        }
+        else if(patientImportResult.duplicateRowCount < patientImports[i].rows.size())
+        {
+            report.updatedPatientDataFileCount++;
+        }
+    }
+
+    report.successful = true;
+
+    return report;
+}
+
+// Runs on a worker thread: tokenizes the rows of the passed chunk without copying the fields
+// and converts only the cells taken over to the blood sample table.
+LabResultImporter::chunk_result_t LabResultImporter::parseChunk(chunk_t chunk, LabResultFile::csv_header_t header)
+{
+    chunk_result_t chunkResult;
+
+    chunkResult.lineCount = 0;
+    chunkResult.rowCount = 0;
+    chunkResult.malformedRowCount = 0;
+    chunkResult.invalidDateCount = 0;
+    chunkResult.invalidValueCount = 0;
+
+    auto separator = header.separator.toLatin1();
+    auto requiredFieldCount = header.patientIdColumn + 1;
+
+    for(auto csvColumn : std::as_const(header.columns))
+    {
+        requiredFieldCount = std::max(requiredFieldCount, csvColumn + 1);
+    }
+
+    auto addMessage = [&chunkResult](const QString& message)
+    {
+        if(chunkResult.messages.size() < maximumReportMessages)
+        {
+            chunkResult.messages.append(qMakePair(chunkResult.lineCount, message));
+        }
+    };
+
+    QVector<field_t> fields(requiredFieldCount);
+
+    // Rows of a patient usually follow each other, so the patient ID is converted and looked
+    // up only when it changes.
+    field_t previousPatientIdField = {nullptr, nullptr};
+    QVector<QVector<QString>> *patientRows = nullptr;
+
+    const char *position = chunk.begin;
+
+    while(position < chunk.end)
+    {
+        auto lineEnd = static_cast<const char*>(std::memchr(position, '\n', chunk.end - position));
+
+        if(!lineEnd)
+        {
+            lineEnd = chunk.end;
+        }
+
+        const char *lineBegin = position;
+        position = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+        chunkResult.lineCount++;
+
+        field_t line = {lineBegin, lineEnd};
+        trimField(line);
+
+        if(line.begin == line.end)
+        {
+            continue;
+        }
+
+        // Tokenize the line, fields behind the last needed one are not looked at.
+        auto fieldCount = 0;
+        const char *fieldBegin = lineBegin;
+
+        for(const char *character = lineBegin; fieldCount < requiredFieldCount; character++)
+        {
+            if(character == lineEnd || *character == separator)
+            {
+                fields[fieldCount] = {fieldBegin, character};
+                trimField(fields[fieldCount]);
+                fieldCount++;
+                fieldBegin = character + 1;
+
+                if(character == lineEnd)
+                {
+                    break;
+                }
+            }
+        }
+
+        field_t& patientIdField = fields[header.patientIdColumn];
+
+        if(fieldCount < requiredFieldCount || patientIdField.begin == patientIdField.end)
+        {
+            chunkResult.malformedRowCount++;
+            addMessage(fieldCount < requiredFieldCount ? "Too few fields." : "Patient ID missing.");
+            continue;
+        }
+
+        auto patientIdSize = patientIdField.end - patientIdField.begin;
+
+        if(!patientRows ||
+           patientIdSize != previousPatientIdField.end - previousPatientIdField.begin ||
+           std::memcmp(patientIdField.begin, previousPatientIdField.begin, patientIdSize) != 0)
+        {
+            patientRows = &chunkResult.results[fieldText(patientIdField)];
+            previousPatientIdField = patientIdField;
+        }
+
+        QVector<QString> row(header.columns.size());
+        auto& date = row[PatientDataSchema::bloodSamplesDateColumn];
+
+        date = LabResultFile::dateToText(fieldText(fields[header.columns[PatientDataSchema::bloodSamplesDateColumn]]));
+
+        if(PatientTableModel::parseDate(date) == PatientTableModel::invalidDateKey)
+        {
+            chunkResult.invalidDateCount++;
+            addMessage("Invalid date \"" + date + "\".");
+        }
+
+        for(auto column = 0; column < header.columns.size(); column++)
+        {
+            if(column == PatientDataSchema::bloodSamplesDateColumn || header.columns[column] < 0)
+            {
+                continue;
+            }
+
+            row[column] = LabResultFile::valueToText(fieldText(fields[header.columns[column]]), header.decimalComma);
+
+            bool conversionSuccessful = false;
+            row[column].toDouble(&conversionSuccessful);
+
+            if(!row[column].isEmpty() && !conversionSuccessful)
+            {
+                chunkResult.invalidValueCount++;
+                addMessage("Invalid value \"" + row[column] + "\".");
+            }
+        }
+
+        patientRows->append(row);
+        chunkResult.rowCount++;
+    }
+
+    return chunkResult;
+}
+
+// Runs on a worker thread: merges the rows of one patient into the sorted blood samples of
+// the patient's data file. Rows already contained in the file are skipped.
+LabResultImporter::patient_import_result_t LabResultImporter::importPatient(const patient_import_t& patientImport, bool dryRun)
+{
+    patient_import_result_t patientImportResult;
+
+    patientImportResult.successful = false;
+    patientImportResult.duplicateRowCount = 0;
+
+    PatientDataFile::patient_data_t patientData;
+
+    if(patientImport.newFile)
+    {
+        patientData.patientId = patientImport.patientId;
+        patientData.bloodSamples.resize(PatientDataFile::bloodSamplesColumns.size());
+        patientData.chemoAndMeds.resize(PatientDataFile::chemoAndMedsColumns.size());
+    }
+    else if(!PatientDataFile::load(patientImport.fileName, patientData))
+    {
+        return patientImportResult;
+    }
+
+    QVector<QVector<QString>> newRows = LabInbox::withoutExistingRows(patientData.bloodSamples, patientImport.rows);
+    patientImportResult.duplicateRowCount = patientImport.rows.size() - newRows.size();
+
+    if(newRows.isEmpty() && !patientImport.newFile)
+    {
+        patientImportResult.successful = true;
+        return patientImportResult;
+    }
+
+    QVector<qint64> dateKeys = PatientTableModel::parseDates(patientData.bloodSamples, PatientDataSchema::bloodSamplesDateColumn);
+    PatientTableModel::mergeRowsSorted(patientData.bloodSamples, dateKeys, PatientDataSchema::bloodSamplesDateColumn, newRows);
+
+    patientImportResult.successful = dryRun || PatientDataFile::save(patientImport.fileName, patientData);
+
+    return patientImportResult;
+}
+
+// Returns a summary of the passed report to be shown to the user.
+QString LabResultImporter::reportText(const import_report_t& report, bool dryRun)
+{
+    if(!report.successful)
+    {
+        return report.error;
+    }
+
+    QString text;
+
+    text += QString::number(report.rowCount) + " blood samples of " + QString::number(report.patientCount) + " patients found.\n";
+    text += QString::number(report.duplicateRowCount) + " blood samples are already contained in the patient data files.\n";
+    text += QString::number(report.newPatientDataFileCount) + " patient data files " + (dryRun ? "to be created" : "created") + ", ";
+    text += QString::number(report.updatedPatientDataFileCount) + " patient data files " + (dryRun ? "to be updated" : "updated") + ".\n";
+
+    if(!report.openPatientRows.isEmpty())
+    {
+        qint64 openPatientRowCount = 0;
+
+        for(const auto& rows : report.openPatientRows)
+        {
+            openPatientRowCount += rows.size();
+        }
+
+        text += QString::number(openPatientRowCount) + " blood samples of open patients are added to their tables.\n";
+    }
+
+    if(report.malformedRowCount > 0 || report.invalidDateCount > 0 || report.invalidValueCount > 0 || report.failedPatientDataFileCount > 0)
+    {
+        text += "\nProblems: " + QString::number(report.malformedRowCount) + " malformed rows, " +
+                QString::number(report.invalidDateCount) + " invalid dates, " +
+                QString::number(report.invalidValueCount) + " invalid values, " +
+                QString::number(report.failedPatientDataFileCount) + " failed patient data files.\n";
+
+        for(const auto& message : report.messages)
+        {
+            text += message + "\n";
+        }
+    }
+
+    return text;
+}
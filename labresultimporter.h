@@ -0,0 +1,82 @@
+#ifndef LABRESULTIMPORTER_H
+#define LABRESULTIMPORTER_H
+
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "labresultfile.h"
+
+// Bulk import of large lab exports (CSV with a header row, see LabResultFile) into the
+// patient data files of a directory. The export is split into chunks which are parsed in
+// parallel, the rows are grouped by patient ID and merged into the sorted blood samples of
+// each patient's file. Patients without a file get a new one.
+class LabResultImporter
+{
+public:
+    typedef struct
+    {
+        bool successful;
+        QString error;
+        qint64 rowCount;
+        qint64 malformedRowCount;
+        qint64 invalidDateCount;
+        qint64 invalidValueCount;
+        qint64 duplicateRowCount;
+        int patientCount;
+        int newPatientDataFileCount;
+        int updatedPatientDataFileCount;
+        int failedPatientDataFileCount;
+
+        // First problems found, with line numbers of the export.
+        QStringList messages;
+
+        // Samples of the passed open patients, which are not written to their files.
+        LabResultFile::results_t openPatientRows;
+    } import_report_t;
+
+    static import_report_t import(const QString& fileName, const QString& patientDataDirectory,
+                                  bool dryRun, const QSet<QString>& openPatientIds = QSet<QString>());
+
+    static QString reportText(const import_report_t& report, bool dryRun);
+
+private:
+    typedef struct
+    {
+        const char *begin;
+        const char *end;
+    } chunk_t;
+
+    typedef struct
+    {
+        LabResultFile::results_t results;
+        qint64 lineCount;
+        qint64 rowCount;
+        qint64 malformedRowCount;
+        qint64 invalidDateCount;
+        qint64 invalidValueCount;
+
+        // Problems with the line number relative to the chunk.
+        QVector<QPair<qint64, QString>> messages;
+    } chunk_result_t;
+
+    typedef struct
+    {
+        QString patientId;
+        QString fileName;
+        bool newFile;
+        QVector<QVector<QString>> rows;
+    } patient_import_t;
+
+    typedef struct
+    {
+        bool successful;
+        qint64 duplicateRowCount;
+    } patient_import_result_t;
+
+    static chunk_result_t parseChunk(chunk_t chunk, LabResultFile::csv_header_t header);
+    static patient_import_result_t importPatient(const patient_import_t& patientImport, bool dryRun);
+};
+
+#endif // LABRESULTIMPORTER_H
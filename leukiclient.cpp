@@ -0,0 +1,203 @@
+#include "ipcprotocol.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <cstdio>
+#include <iostream>
+
+// Command line client of the local socket of a running Leuki, see ipcprotocol.h. Pushes rows
+// read from a file or the standard input into an open patient and prints the responses, one
+// JSON object per line. Exits with 0 if all requests succeeded, 1 if a request failed and 2 if
+// no running instance has been reached.
+
+const static int connectTimeoutMilliseconds = 3000;
+const static int responseTimeoutMilliseconds = 30000;
+
+const static int exitCodeRequestFailed = 1;
+const static int exitCodeNotReached = 2;
+
+static bool readInput(const QString& fileName, QByteArray& input)
+{
+    QFile file;
+
+    if(fileName.isEmpty() || fileName == "-")
+    {
+        if(!file.open(stdin, QIODevice::ReadOnly))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        file.setFileName(fileName);
+
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            return false;
+        }
+    }
+
+    input = file.readAll();
+
+    return true;
+}
+
+// Rows are given as JSON array or as one JSON object per line.
+static bool rowsFromInput(const QByteArray& input, QJsonArray& rows)
+{
+    QJsonDocument inputJsonDocument = QJsonDocument::fromJson(input);
+
+    if(inputJsonDocument.isArray())
+    {
+        rows = inputJsonDocument.array();
+        return true;
+    }
+
+    for(const auto& line : input.split('\n'))
+    {
+        if(line.trimmed().isEmpty())
+        {
+            continue;
+        }
+
+        QJsonDocument rowJsonDocument = QJsonDocument::fromJson(line);
+
+        if(!rowJsonDocument.isObject())
+        {
+            return false;
+        }
+
+        rows.append(rowJsonDocument.object());
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("leukiclient");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pushes rows into the patients open in a running Leuki.");
+    parser.addHelpOption();
+
+    QCommandLineOption pingOption("ping", "Check whether Leuki is running.");
+    QCommandLineOption listPatientsOption("list-patients", "List the open patients.");
+    QCommandLineOption bloodSamplesOption("blood-samples", "Add the rows to the blood samples.");
+    QCommandLineOption chemoAndMedsOption("chemo-and-meds", "Add the rows to the chemo therapy and medicamentation.");
+    QCommandLineOption rawOption("raw", "Send the input lines as requests.");
+    QCommandLineOption patientIdOption("patient-id", "Patient to add the rows to, the patient shown if omitted.", "id");
+
+    parser.addOptions({pingOption, listPatientsOption, bloodSamplesOption, chemoAndMedsOption, rawOption, patientIdOption});
+    parser.addPositionalArgument("file", "Rows as JSON array or one JSON object per line (keys like in a patient data file), "
+                                         "requests with --raw. Standard input if omitted or \"-\".", "[file]");
+    parser.process(application);
+
+    QList<QByteArray> requestLines;
+    QJsonObject request;
+    request["id"] = 1;
+
+    if(parser.isSet(pingOption))
+    {
+        request["command"] = IpcProtocol::commandPing;
+    }
+    else if(parser.isSet(listPatientsOption))
+    {
+        request["command"] = IpcProtocol::commandListPatients;
+    }
+    else if(parser.isSet(bloodSamplesOption) || parser.isSet(chemoAndMedsOption) || parser.isSet(rawOption))
+    {
+        QByteArray input;
+        auto fileName = parser.positionalArguments().value(0);
+
+        if(!readInput(fileName, input))
+        {
+            std::cerr << "Cannot read " << qPrintable(fileName.isEmpty() ? QString("standard input") : fileName) << "." << std::endl;
+            return exitCodeRequestFailed;
+        }
+
+        if(parser.isSet(rawOption))
+        {
+            for(const auto& line : input.split('\n'))
+            {
+                if(!line.trimmed().isEmpty())
+                {
+                    requestLines.append(line.trimmed());
+                }
+            }
+        }
+        else
+        {
+            QJsonArray rows;
+
+            if(!rowsFromInput(input, rows))
+            {
+                std::cerr << "Rows must be a JSON array or one JSON object per line." << std::endl;
+                return exitCodeRequestFailed;
+            }
+
+            request["command"] = parser.isSet(bloodSamplesOption) ? IpcProtocol::commandAddBloodSamples :
+                                                                    IpcProtocol::commandAddChemoAndMeds;
+            request["patientId"] = parser.value(patientIdOption);
+            request["rows"] = rows;
+        }
+    }
+    else
+    {
+        parser.showHelp(exitCodeRequestFailed);
+    }
+
+    if(request.contains("command"))
+    {
+        requestLines.append(QJsonDocument(request).toJson(QJsonDocument::Compact));
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(IpcProtocol::serverName());
+
+    if(!socket.waitForConnected(connectTimeoutMilliseconds))
+    {
+        std::cerr << "No running Leuki reached: " << qPrintable(socket.errorString()) << std::endl;
+        return exitCodeNotReached;
+    }
+
+    for(const auto& requestLine : std::as_const(requestLines))
+    {
+        socket.write(requestLine + '\n');
+    }
+
+    while(socket.bytesToWrite() > 0 && socket.waitForBytesWritten(responseTimeoutMilliseconds))
+    {
+    }
+
+    auto successful = true;
+    auto responseCount = 0;
+
+    while(responseCount < requestLines.size())
+    {
+        if(!socket.canReadLine() && !socket.waitForReadyRead(responseTimeoutMilliseconds))
+        {
+            std::cerr << "No response from Leuki: " << qPrintable(socket.errorString()) << std::endl;
+            return exitCodeNotReached;
+        }
+
+        while(socket.canReadLine())
+        {
+            QByteArray responseLine = socket.readLine().trimmed();
+
+            std::cout << responseLine.constData() << std::endl;
+
+            successful = successful && QJsonDocument::fromJson(responseLine).object()["ok"].toBool();
+            responseCount++;
+        }
+    }
+
+    socket.disconnectFromServer();
+
+    return successful ? 0 : exitCodeRequestFailed;
+}
@@ -1,37 +1,58 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
+#include "tablecolumnsizer.h"
+#include "validationitemdelegate.h"
+#include "labparameters.h"
+#include "patientdataschema.h"
+#include "ipcprotocol.h"
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QProgressDialog>
+#include <QScrollBar>
+#include <QShortcut>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrent>
 #include <iostream>
-#include <regex>
-
-const char* leukiSettingsDefault =
-#include "leukiSettingsDefault.txt"
-;
+#include <algorithm>
+#include <cmath>
 
 const static QVector<QString> tabWidgetTabs
 {
     "General Information",
     "Blood Samples",
     "Chemo Therapy / Medicamentation",
-    "Visualization"
+    "Visualization",
+    "Cycles"
 };
 
-const static QVector<QString> tableWidgetBloodSamplesColumns
+const static QVector<QString> tableWidgetCumulativeDosesColumns
 {
-    "Date",
-    "Leukocytes [Giga/l]",
-    "Erythrocytes [Tera/l]",
-    "Hemoglobin [g/dl]",
-    "Thrombocytes [Giga/l]"
+    "Name",
+    "Unit",
+    "Total",
+    "Total per m²",
+    "Lifetime Limit per m²",
+    "Lifetime Limit [%]"
 };
 
-const static QVector<QString> tableWidgetChemoAndMedsColumns
+const static QVector<QString> tableWidgetCyclesColumns
 {
-    "Date (Start)",
-    "Days",
-    "Name",
-    "Dose per Day"
+    "Start",
+    "Medications",
+    "Leukocyte Nadir",
+    "Nadir Day",
+    "Recovery Day",
+    "Thrombocyte Nadir",
+    "Nadir Day",
+    "Recovery Day"
 };
 
+// Duration of temporary status bar messages.
+const static int statusMessageTimeoutMilliseconds = 5000;
+
+// Maximum number of rows measured when sizing table columns to their contents.
+const static int tableColumnSizingSampleRows = 200;
+
 const static unsigned int heightVisualizationTextLabelPixels = 45;
 const static unsigned int lengthVisualizationArrowPixels = 15;
 
@@ -39,130 +60,133 @@ const static unsigned int hoursPerDay = 24;
 const static unsigned int secondsPerHour = 3600;
 const static unsigned int secondsPerDay = hoursPerDay * secondsPerHour;
 
+const static double sizeVisualizationNadirAndRecoveryMarkerPixels = 9.0;
+
+const static qsizetype bytesPerMegabyte = 1024 * 1024;
+
+// Returns the recovery thresholds of the settings in the order of CycleAnalysis::parameterColumns.
+static QVector<double> recoveryThresholds(const SettingsWindow::settings_t& settings)
+{
+    QVector<double> thresholds;
+
+    for(auto column : CycleAnalysis::parameterColumns)
+    {
+        thresholds.append(column == PatientDataSchema::leukocytesColumn ?
+                          settings.leukocytesRecoveryThreshold : settings.thrombocytesRecoveryThreshold);
+    }
+
+    return thresholds;
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_tableDataChangedSinceLastVisualizationPlot(false)
-    , m_patientDataChangedSinceLastSave(false)
-    , m_internalTableModificationsInProgress(false)
+    , m_activePatientSession(nullptr)
+    , m_bloodSamplesModel(nullptr)
+    , m_chemoAndMedsModel(nullptr)
+    , m_derivedSeriesGraphs(DerivedSeries::DERIVED_COUNT)
+    , m_chemistryAxis(nullptr)
+    , m_cumulativeDoseAxis(nullptr)
 {
     ui->setupUi(this);
 
-    // Load settings file first.
+    // Load settings first.
 
-    QFile settingsFile;
-    settingsFile.setFileName(QDir::currentPath() + "/" + "leukiSettings.json");
+    m_settingsStore.load();
 
-    // If settings file does not exist, create a new file with default settings.
-    if(!settingsFile.exists())
-    {
-        settingsFile.open(QIODevice::WriteOnly | QIODevice::Text);
-        settingsFile.write(leukiSettingsDefault);
-        settingsFile.close();
-    }
+    ui->tabWidget->setCurrentIndex(m_settingsStore.activeTabIndex());
 
-    settingsFile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QString settingsString = settingsFile.readAll();
-    settingsFile.close();
-    QJsonDocument settingsJsonDocument = QJsonDocument::fromJson(settingsString.toUtf8());
-    QJsonObject settingsJsonObject = settingsJsonDocument.object();
+    auto settings = m_settingsStore.settings();
+    m_settingsWindow.setSettings(settings);
 
-    if(settingsJsonObject["previousPatientDataFileName"].isString())
-    {
-        m_previousPatientDataFileName = settingsJsonObject["previousPatientDataFileName"].toString();
-    }
+    connect(&m_settingsWindow, &SettingsWindow::settingsAccepted, &m_settingsStore, &SettingsStore::setSettings);
+    connect(&m_settingsStore, &SettingsStore::settingsChanged, this, &MainWindow::applySettings);
 
-    if(settingsJsonObject["activeTabIndex"].isDouble())
-    {
-        ui->tabWidget->setCurrentIndex(settingsJsonObject["activeTabIndex"].toInt());
-    }
+    // One check box per blood value of the registry, in the colour of its graph, four per row.
+    const auto& parameters = LabParameters::parameters();
 
-    if(settingsJsonObject["autoLoadPatientDataFileOnStartup"].isBool())
+    for(auto i = 0; i < parameters.size(); i++)
     {
-        SettingsWindow::settings_t settings;
-        settings.autoLoadPatientDataFileOnStartup = settingsJsonObject["autoLoadPatientDataFileOnStartup"].toBool();
-        m_settingsWindow.setSettings(settings);
-    }
+        auto checkBox = new QCheckBox(parameters[i].name, ui->widgetVisualizationParameters);
+        auto palette = checkBox->palette();
 
-    if(settingsJsonObject["visualizationShowLeukocytes"].isBool())
-    {
-        if(settingsJsonObject["visualizationShowLeukocytes"].toBool())
-        {
-            ui->checkBoxVisualizationShowLeukocytes->setCheckState(Qt::CheckState::Checked);
-        }
-        else
-        {
-            ui->checkBoxVisualizationShowLeukocytes->setCheckState(Qt::CheckState::Unchecked);
-        }
-    }
+        palette.setColor(QPalette::WindowText, parameters[i].color);
+        checkBox->setPalette(palette);
+        checkBox->setToolTip(LabParameters::columnName(parameters[i]) + ", reference range " + LabParameters::referenceRangeText(parameters[i]));
+        checkBox->setChecked(m_settingsStore.visualizationShow(parameters[i].name));
 
-    if(settingsJsonObject["visualizationShowErythrocytes"].isBool())
-    {
-        if(settingsJsonObject["visualizationShowErythrocytes"].toBool())
-        {
-            ui->checkBoxVisualizationShowErythrocytes->setCheckState(Qt::CheckState::Checked);
-        }
-        else
-        {
-            ui->checkBoxVisualizationShowErythrocytes->setCheckState(Qt::CheckState::Unchecked);
-        }
-    }
+        connect(checkBox, &QCheckBox::stateChanged, this, &MainWindow::parameterCheckBoxStateChanged);
 
-    if(settingsJsonObject["visualizationShowHemoglobin"].isBool())
-    {
-        if(settingsJsonObject["visualizationShowHemoglobin"].toBool())
-        {
-            ui->checkBoxVisualizationShowHemoglobin->setCheckState(Qt::CheckState::Checked);
-        }
-        else
-        {
-            ui->checkBoxVisualizationShowHemoglobin->setCheckState(Qt::CheckState::Unchecked);
-        }
+        ui->gridLayoutVisualizationParameters->addWidget(checkBox, i / 4, i % 4);
+        m_parameterCheckBoxes.append(checkBox);
     }
 
-    if(settingsJsonObject["visualizationShowThrombocytes"].isBool())
-    {
-        if(settingsJsonObject["visualizationShowThrombocytes"].toBool())
-        {
-            ui->checkBoxVisualizationShowThrombocytes->setCheckState(Qt::CheckState::Checked);
-        }
-        else
-        {
-            ui->checkBoxVisualizationShowThrombocytes->setCheckState(Qt::CheckState::Unchecked);
-        }
-    }
+    ui->checkBoxVisualizationShowMedicamentationAndChemoTherapy->setChecked(m_settingsStore.visualizationShow("MedicamentationAndChemoTherapy"));
+    ui->checkBoxVisualizationShowNadirAndRecovery->setChecked(m_settingsStore.visualizationShow("NadirAndRecovery"));
+    ui->checkBoxVisualizationShowMovingAverage->setChecked(m_settingsStore.visualizationShow("MovingAverage"));
+    ui->checkBoxVisualizationShowSmoothed->setChecked(m_settingsStore.visualizationShow("Smoothed"));
+    ui->checkBoxVisualizationShowSlope->setChecked(m_settingsStore.visualizationShow("Slope"));
+    ui->checkBoxVisualizationShowCumulativeDose->setChecked(m_settingsStore.visualizationShow("CumulativeDose"));
 
-    if(settingsJsonObject["visualizationShowMedicamentationAndChemoTherapy"].isBool())
+    // Prepare tables.
+
+    // Use uniform row heights and size columns from a bounded sample of rows instead of
+    // letting the views measure every cell on each layout. Invalid entries are marked by
+    // the item delegate.
+    for(auto tableView : {ui->tableViewBloodSamples, ui->tableViewChemoAndMeds})
     {
-        if(settingsJsonObject["visualizationShowMedicamentationAndChemoTherapy"].toBool())
-        {
-            ui->checkBoxVisualizationShowMedicamentationAndChemoTherapy->setCheckState(Qt::CheckState::Checked);
-        }
-        else
-        {
-            ui->checkBoxVisualizationShowMedicamentationAndChemoTherapy->setCheckState(Qt::CheckState::Unchecked);
-        }
+        tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+        tableView->setItemDelegate(new ValidationItemDelegate(tableView));
     }
 
-    // Prepare tables.
+    // The models are set when a patient session is activated.
+    m_bloodSamplesColumnSizer = new TableColumnSizer(ui->tableViewBloodSamples, tableColumnSizingSampleRows);
+    m_chemoAndMedsColumnSizer = new TableColumnSizer(ui->tableViewChemoAndMeds, tableColumnSizingSampleRows);
 
-    ui->tableWidgetBloodSamples->setColumnCount(static_cast<int>(tableWidgetBloodSamplesColumns.size()));
+    // Pasting rows is available through the standard shortcut as well.
+    auto bloodSamplesPasteShortcut = new QShortcut(QKeySequence::Paste, ui->tableViewBloodSamples);
+    bloodSamplesPasteShortcut->setContext(Qt::WidgetShortcut);
+    connect(bloodSamplesPasteShortcut, &QShortcut::activated, this, &MainWindow::on_pushButtonPasteBloodSamples_clicked);
 
-    for(auto i = 0; i < tableWidgetBloodSamplesColumns.size(); i++)
+    auto chemoAndMedsPasteShortcut = new QShortcut(QKeySequence::Paste, ui->tableViewChemoAndMeds);
+    chemoAndMedsPasteShortcut->setContext(Qt::WidgetShortcut);
+    connect(chemoAndMedsPasteShortcut, &QShortcut::activated, this, &MainWindow::on_pushButtonPasteChemoAndMeds_clicked);
+
+    ui->tableWidgetCumulativeDoses->setColumnCount(static_cast<int>(tableWidgetCumulativeDosesColumns.size()));
+
+    for(auto i = 0; i < tableWidgetCumulativeDosesColumns.size(); i++)
     {
-        ui->tableWidgetBloodSamples->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetBloodSamplesColumns[i]));
+        ui->tableWidgetCumulativeDoses->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetCumulativeDosesColumns[i]));
     }
 
-    ui->tableWidgetBloodSamples->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->tableWidgetCycles->setColumnCount(static_cast<int>(tableWidgetCyclesColumns.size()));
 
-    ui->tableWidgetChemoAndMeds->setColumnCount(static_cast<int>(tableWidgetChemoAndMedsColumns.size()));
-
-    for(auto i = 0; i < tableWidgetChemoAndMedsColumns.size(); i++)
+    for(auto i = 0; i < tableWidgetCyclesColumns.size(); i++)
     {
-        ui->tableWidgetChemoAndMeds->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetChemoAndMedsColumns[i]));
+        ui->tableWidgetCycles->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetCyclesColumns[i]));
     }
 
-    ui->tableWidgetChemoAndMeds->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    // Summary of invalid entries of both tables in the status bar.
+    m_validationStatusLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(m_validationStatusLabel);
+
+    // Lab results dropped into the inbox directory are merged into the patient data.
+    connect(&m_labInbox, &LabInbox::bloodSamplesReceived, this, &MainWindow::labBloodSamplesReceived);
+    connect(&m_labInbox, &LabInbox::scanFinished, this, &MainWindow::labInboxScanFinished);
+
+    // Local tools (e.g. a lab interface bridge) push rows into the open patients.
+    connect(&m_ipcServer, &IpcServer::batchReceived, this, &MainWindow::ipcBatchReceived);
+    m_ipcServer.listen();
+
+    connect(&m_patientCatalogWindow, &PatientCatalogWindow::patientDataFileSelected, this, &MainWindow::openPatientDataFileFromCatalog);
+    connect(&m_cohortQueryWindow, &CohortQueryWindow::patientDataFilesSelected, this, &MainWindow::openPatientDataFiles);
+    connect(&m_cohortQueryWindow, &CohortQueryWindow::patientDataFilesCompared, this, &MainWindow::comparePatientDataFiles);
+
+    // Open files changed elsewhere are merged, files opened elsewhere as well are warned about.
+    connect(&m_patientFileMonitor, &PatientFileMonitor::concurrentEditingDetected, this, &MainWindow::patientFileOpenedElsewhere);
+
+    applySettings(settings);
 
     // Setup plot.
 
@@ -173,24 +197,62 @@ MainWindow::MainWindow(QWidget *parent)
     ui->customPlot->xAxis->setUpperEnding(QCPLineEnding::esSpikeArrow);
     ui->customPlot->yAxis->setUpperEnding(QCPLineEnding::esSpikeArrow);
 
-    // Configure horizontal axis to show date.
-    QSharedPointer<QCPAxisTickerDateTime> dateTicker(new QCPAxisTickerDateTime);
-    dateTicker->setDateTimeFormat("dd.MM.yyyy");
-    ui->customPlot->xAxis->setTicker(dateTicker);
+    // The slopes of the derived series use the right axis, shown along with them.
+    ui->customPlot->yAxis2->setLabel("Slope [per day]");
+    ui->customPlot->yAxis2->setVisible(ui->checkBoxVisualizationShowSlope->isChecked());
+
+    // Clinical chemistry values (e.g. CRP, LDH) are of another magnitude and use a right axis.
+    m_chemistryAxis = ui->customPlot->axisRect()->addAxis(QCPAxis::atRight);
+    m_chemistryAxis->setVisible(false);
+
+    // The cumulative doses use another right axis, a lifetime limit is reached at 100 %.
+    m_cumulativeDoseAxis = ui->customPlot->axisRect()->addAxis(QCPAxis::atRight);
+    m_cumulativeDoseAxis->setLabel("Cumulative Dose [% of Lifetime Limit]");
+    m_cumulativeDoseAxis->setVisible(ui->checkBoxVisualizationShowCumulativeDose->isChecked());
+
+    // Configure horizontal axis to show date. Days relative to an anchor can be chosen instead.
+    m_dateTicker.reset(new QCPAxisTickerDateTime);
+    m_dateTicker->setDateTimeFormat("dd.MM.yyyy");
+    ui->customPlot->xAxis->setTicker(m_dateTicker);
+
+    m_relativeDayTicker.reset(new RelativeDayAxisTicker);
 
     // Initialize with current date.
     double currentSecondsSinceEpoch = QDateTime::currentSecsSinceEpoch();
     ui->customPlot->xAxis->setRange(currentSecondsSinceEpoch, currentSecondsSinceEpoch + 1);
+
+    // Setup patient tabs. All patients share the widgets below the tab bar, switching the tab
+    // swaps the models and forms of the patient session shown.
+
+    m_patientTabBar = new QTabBar(ui->centralwidget);
+    m_patientTabBar->setGeometry(0, 0, 801, 25);
+    m_patientTabBar->setTabsClosable(true);
+    m_patientTabBar->setExpanding(false);
+    m_patientTabBar->setDocumentMode(true);
+
+    connect(m_patientTabBar, &QTabBar::currentChanged, this, &MainWindow::patientTabChanged);
+    connect(m_patientTabBar, &QTabBar::tabCloseRequested, this, &MainWindow::patientTabCloseRequested);
+
+    activatePatientSession(addPatientSession());
 }
 
 MainWindow::~MainWindow()
 {
-    if(m_patientDataChangedSinceLastSave)
+    for(auto patientSession : m_patientSessions)
     {
-        askPatientDataFileSave();
+        if(patientSession->changedSinceLastSave())
+        {
+            activatePatientSession(patientSession);
+            askPatientDataFileSave();
+        }
+
+        // Closed properly, unsaved changes have been discarded by the user.
+        m_autosave.removePatientSession(patientSession);
     }
 
-    saveSettingsFile();
+    // Settings are written in the background while the program is running, just make sure
+    // that pending changes are written.
+    m_settingsStore.flush();
     delete ui;
 }
 
@@ -198,11 +260,15 @@ MainWindow::~MainWindow()
 // in order to make plot axes scaling detection work properly.
 void MainWindow::initializeAfterShowing()
 {
+    recoverPatientSessions();
+
     // Auto-load previously opened patient data file if this setting is activated and a valid
     // previous file name exists.
-    if(m_settingsWindow.getSettings().autoLoadPatientDataFileOnStartup && QFile::exists(m_previousPatientDataFileName))
+    QString previousPatientDataFileName = m_settingsStore.previousPatientDataFileName();
+
+    if(m_settingsStore.settings().autoLoadPatientDataFileOnStartup && QFile::exists(previousPatientDataFileName))
     {
-        loadPatientDataFile(m_previousPatientDataFileName);
+        openPatientDataFiles({previousPatientDataFileName});
     }
 
     // This is a workaround. When visualization is not opened at this point (i.e. other tab is
@@ -212,562 +278,1220 @@ void MainWindow::initializeAfterShowing()
     {
         m_tableDataChangedSinceLastVisualizationPlot = true;
     }
+}
+
+// Creates a new (empty) patient session with its own tab.
+PatientSession* MainWindow::addPatientSession()
+{
+    auto patientSession = new PatientSession(this);
+
+    // Only the models of the active session are shown, so only these report user changes.
+    connect(patientSession->bloodSamplesModel(), &PatientTableModel::cellChanged, this, &MainWindow::bloodSamplesCellChanged);
+    connect(patientSession->chemoAndMedsModel(), &PatientTableModel::cellChanged, this, &MainWindow::chemoAndMedsCellChanged);
+    connect(patientSession->bloodSamplesModel(), &PatientTableModel::invalidDateCountChanged, this, &MainWindow::updateValidationStatus);
+    connect(patientSession->chemoAndMedsModel(), &PatientTableModel::invalidDateCountChanged, this, &MainWindow::updateValidationStatus);
+
+    connect(patientSession, &PatientSession::loaded, this, &MainWindow::patientSessionLoaded);
+    connect(patientSession, &PatientSession::changedSinceLastSaveChanged, this, &MainWindow::updatePatientTabs);
+    connect(patientSession, &PatientSession::generalInformationChanged, this, &MainWindow::patientGeneralInformationChanged);
+    connect(patientSession, &PatientSession::fileChangesMerged, this, &MainWindow::patientFileChangesMerged);
+    connect(patientSession->undoStack(), &QUndoStack::indexChanged, this, &MainWindow::updateUndoActions);
+    connect(patientSession->doseAccounting(), &DoseAccounting::totalsChanged, this, &MainWindow::cumulativeDosesChanged);
+
+    patientSession->cycleAnalysis()->setRecoveryThresholds(recoveryThresholds(m_settingsStore.settings()));
+    patientSession->derivedSeries()->setParameters(m_settingsStore.settings().movingAverageDays, m_settingsStore.settings().smoothingFactor);
+    patientSession->setUndoMemoryBudget(m_settingsStore.settings().undoMemoryBudgetMegabytes * bytesPerMegabyte);
+
+    m_autosave.addPatientSession(patientSession);
+    m_patientFileMonitor.addPatientSession(patientSession);
+    m_patientSessions.append(patientSession);
+
+    // Blocked, the caller decides which session to activate.
+    m_patientTabBar->blockSignals(true);
+    m_patientTabBar->addTab(patientSession->title());
+    m_patientTabBar->blockSignals(false);
+
+    return patientSession;
+}
+
+// Returns the session showing the passed patient data file, nullptr if there is none.
+PatientSession* MainWindow::patientSessionOfFile(const QString& patientDataFileName) const
+{
+    auto absoluteFilePath = QFileInfo(patientDataFileName).absoluteFilePath();
 
-    // Scroll to bottoms of tables per default. Slight workaround needed (first top, then bottom).
-    ui->tableWidgetBloodSamples->scrollTo(ui->tableWidgetBloodSamples->model()->index(0, 0));
-    ui->tableWidgetBloodSamples->scrollTo(ui->tableWidgetBloodSamples->model()->index(ui->tableWidgetBloodSamples->rowCount() - 1, 0));
+    for(auto patientSession : m_patientSessions)
+    {
+        if(!patientSession->fileName().isEmpty() && QFileInfo(patientSession->fileName()).absoluteFilePath() == absoluteFilePath)
+        {
+            return patientSession;
+        }
+    }
 
-    ui->tableWidgetChemoAndMeds->scrollTo(ui->tableWidgetChemoAndMeds->model()->index(0, 0));
-    ui->tableWidgetChemoAndMeds->scrollTo(ui->tableWidgetChemoAndMeds->model()->index(ui->tableWidgetChemoAndMeds->rowCount() - 1, 0));
+    return nullptr;
 }
 
-// Loads the patient data file, fills all forms and triggers visualization plot.
-void MainWindow::loadPatientDataFile(QString& patientDataFileName)
+// Opens each passed patient data file in its own tab and activates the tab of the first one.
+// Files which are already open are not loaded again. The files are loaded in the background,
+// the forms are filled as soon as the active patient has been loaded.
+void MainWindow::openPatientDataFiles(const QStringList& patientDataFileNames)
 {
-    m_internalTableModificationsInProgress = true;
-    m_patientDataChangedSinceLastSave = false;
+    PatientSession *firstPatientSession = nullptr;
 
-    ui->labelPatientDataFile->setText(patientDataFileName);
+    for(const auto& patientDataFileName : patientDataFileNames)
+    {
+        auto patientSession = patientSessionOfFile(patientDataFileName);
+
+        if(!patientSession)
+        {
+            // The empty session shown on startup is reused for the first file.
+            if(!firstPatientSession && m_activePatientSession->isEmpty())
+            {
+                patientSession = m_activePatientSession;
+            }
+            else
+            {
+                patientSession = addPatientSession();
+            }
 
-    // Store the file name so it can be written to the settings file on program exit
-    // and be restored at the next program execution.
-    m_previousPatientDataFileName = patientDataFileName;
+            patientSession->load(patientDataFileName);
+        }
+
+        if(!firstPatientSession)
+        {
+            firstPatientSession = patientSession;
+        }
+    }
 
-    QFile patientDataFile;
-    patientDataFile.setFileName(patientDataFileName);
-    patientDataFile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QString patientDataString = patientDataFile.readAll();
-    patientDataFile.close();
-    QJsonDocument patientDataJsonDocument = QJsonDocument::fromJson(patientDataString.toUtf8());
-    QJsonObject patientDataJsonObject = patientDataJsonDocument.object();
+    updatePatientTabs();
 
-    // Fill forms with given patient data.
+    if(firstPatientSession)
+    {
+        activatePatientSession(firstPatientSession);
 
-    ui->lineEditPatientName->setText(patientDataJsonObject["name"].toString());
-    ui->lineEditPatientDateOfBirth->setText(patientDataJsonObject["dateOfBirth"].toString());
-    ui->lineEditPatientSize->setText(patientDataJsonObject["size"].toString());
-    ui->lineEditPatientWeight->setText(patientDataJsonObject["weight"].toString());
-    ui->lineEditPatientBodySurface->setText(patientDataJsonObject["bodySurface"].toString());
+        // The forms of a reused session are filled when loading has finished.
+        showGeneralInformation();
+    }
 
-    auto bloodSamplesArraySize = patientDataJsonObject["bloodSamples"].toArray().size();
+    m_patientFileMonitor.update();
+}
 
-    ui->tableWidgetBloodSamples->setRowCount(bloodSamplesArraySize);
+void MainWindow::patientSessionLoaded(bool successful)
+{
+    auto patientSession = qobject_cast<PatientSession*>(sender());
+    auto index = m_patientSessions.indexOf(patientSession);
 
-    for(auto i = 0; i < bloodSamplesArraySize; i++)
+    if(index < 0)
     {
-        // Date
-        QString dateString = patientDataJsonObject["bloodSamples"][i]["date"].toString();
-        ui->tableWidgetBloodSamples->setItem(i,
-                                             tableWidgetBloodSamplesColumns.indexOf("Date"),
-                                             new QTableWidgetItem(dateString));
+        return;
+    }
 
-        // We expect the values to be of type double. If not, user may have entered nothing so we expect an
-        // empty string so we ignore the value for the graph.
+    if(!successful)
+    {
+        QMessageBox::warning(this,
+                             "Leuki - Patient Data File",
+                             "Patient data file " + patientSession->fileName() + " cannot be read!");
 
-        // Leukocytes
+        closePatientSession(index);
 
-        if(patientDataJsonObject["bloodSamples"][i]["leukocytes"].isDouble())
-        {
-            double leukocytes = patientDataJsonObject["bloodSamples"][i]["leukocytes"].toDouble();
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Leukocytes [Giga/l]"),
-                                                 new QTableWidgetItem(QString::number(leukocytes)));
-        }
-        else if(patientDataJsonObject["bloodSamples"][i]["leukocytes"].isString())
-        {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Leukocytes [Giga/l]"),
-                                                 new QTableWidgetItem(patientDataJsonObject["bloodSamples"][i]["leukocytes"].toString()));
-        }
+        emit patientDataFileLoaded(false);
 
-        // Erythrocytes
+        return;
+    }
 
-        if(patientDataJsonObject["bloodSamples"][i]["erythrocytes"].isDouble())
-        {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Erythrocytes [Tera/l]"),
-                                                 new QTableWidgetItem(QString::number(patientDataJsonObject["bloodSamples"][i]["erythrocytes"].toDouble())));
-        }
-        else if(patientDataJsonObject["bloodSamples"][i]["erythrocytes"].isString())
+    updatePatientTabs();
+    m_labInbox.setOpenPatientIds(openPatientIds());
+
+    if(patientSession == m_activePatientSession)
+    {
+        // Store the file name so it can be restored at the next program execution. A recovered
+        // new patient has no file yet.
+        if(!patientSession->fileName().isEmpty())
         {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Erythrocytes [Tera/l]"),
-                                                 new QTableWidgetItem(patientDataJsonObject["bloodSamples"][i]["erythrocytes"].toString()));
+            m_settingsStore.setPreviousPatientDataFileName(patientSession->fileName());
         }
 
-        // Hemoglobin
+        showGeneralInformation();
+        restoreTableScrollPositions();
 
-        if(patientDataJsonObject["bloodSamples"][i]["hemoglobin"].isDouble())
+        if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Visualization"))
         {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Hemoglobin [g/dl]"),
-                                                 new QTableWidgetItem(QString::number(patientDataJsonObject["bloodSamples"][i]["hemoglobin"].toDouble())));
+            plotVisualization();
         }
-        else if(patientDataJsonObject["bloodSamples"][i]["hemoglobin"].isString())
+        else
         {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Hemoglobin [g/dl]"),
-                                                 new QTableWidgetItem(patientDataJsonObject["bloodSamples"][i]["hemoglobin"].toString()));
+            m_tableDataChangedSinceLastVisualizationPlot = true;
         }
 
-        // Thrombocytes
-
-        if(patientDataJsonObject["bloodSamples"][i]["thrombocytes"].isDouble())
+        if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Cycles"))
         {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Thrombocytes [Giga/l]"),
-                                                 new QTableWidgetItem(QString::number(patientDataJsonObject["bloodSamples"][i]["thrombocytes"].toDouble())));
-        }
-        else if(patientDataJsonObject["bloodSamples"][i]["thrombocytes"].isString())
-        {
-            ui->tableWidgetBloodSamples->setItem(i,
-                                                 tableWidgetBloodSamplesColumns.indexOf("Thrombocytes [Giga/l]"),
-                                                 new QTableWidgetItem(patientDataJsonObject["bloodSamples"][i]["thrombocytes"].toString()));
+            showCycleSummary();
         }
     }
 
-    auto chemoAndMedsArraySize = patientDataJsonObject["chemoTherapyAndMedicamentation"].toArray().size();
+    emit patientDataFileLoaded(true);
+}
+
+// Shows the passed patient session in the shared widgets. The view state of the previously
+// shown session is kept, so that switching back restores the scroll positions and the
+// visualized range.
+void MainWindow::activatePatientSession(PatientSession *patientSession)
+{
+    if(patientSession == m_activePatientSession)
+    {
+        return;
+    }
+
+    if(m_activePatientSession)
+    {
+        PatientSession::view_state_t viewState;
+
+        viewState.visualizationRangeValid = true;
+        viewState.visualizationRange = ui->customPlot->xAxis->range();
+        viewState.bloodSamplesScrollPosition = ui->tableViewBloodSamples->verticalScrollBar()->value();
+        viewState.chemoAndMedsScrollPosition = ui->tableViewChemoAndMeds->verticalScrollBar()->value();
+
+        m_activePatientSession->setViewState(viewState);
+    }
+
+    m_activePatientSession = patientSession;
+    m_bloodSamplesModel = patientSession->bloodSamplesModel();
+    m_chemoAndMedsModel = patientSession->chemoAndMedsModel();
+
+    m_patientTabBar->setCurrentIndex(m_patientSessions.indexOf(patientSession));
+
+    setTableModel(*(ui->tableViewBloodSamples), *m_bloodSamplesColumnSizer, m_bloodSamplesModel);
+    setTableModel(*(ui->tableViewChemoAndMeds), *m_chemoAndMedsColumnSizer, m_chemoAndMedsModel);
 
-    ui->tableWidgetChemoAndMeds->setRowCount(chemoAndMedsArraySize);
+    showGeneralInformation();
+    showCumulativeDoses();
+    updateValidationStatus();
+    updateUndoActions();
 
-    for(auto i = 0; i < chemoAndMedsArraySize; i++)
+    if(!patientSession->fileName().isEmpty() && !patientSession->isLoading())
     {
-        // Date
-        QString dateString = patientDataJsonObject["chemoTherapyAndMedicamentation"][i]["date"].toString();
-        ui->tableWidgetChemoAndMeds->setItem(i, tableWidgetChemoAndMedsColumns.indexOf("Date (Start)"), new QTableWidgetItem(dateString));
+        m_settingsStore.setPreviousPatientDataFileName(patientSession->fileName());
+    }
+
+    // The views update their scroll bar ranges after the models have been laid out.
+    QTimer::singleShot(0, this, &MainWindow::restoreTableScrollPositions);
+
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Visualization"))
+    {
+        plotVisualization();
+    }
+    else
+    {
+        m_tableDataChangedSinceLastVisualizationPlot = true;
+    }
 
-        // Name
-        QString nameString = patientDataJsonObject["chemoTherapyAndMedicamentation"][i]["name"].toString();
-        ui->tableWidgetChemoAndMeds->setItem(i,
-                                             tableWidgetChemoAndMedsColumns.indexOf("Name"),
-                                             new QTableWidgetItem(nameString));
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Cycles"))
+    {
+        showCycleSummary();
+    }
+}
 
-        // Dose
-        QString doseString = patientDataJsonObject["chemoTherapyAndMedicamentation"][i]["dose"].toString();
-        ui->tableWidgetChemoAndMeds->setItem(i,
-                                             tableWidgetChemoAndMedsColumns.indexOf("Dose per Day"),
-                                             new QTableWidgetItem(doseString));
+// Closes the patient session of the passed tab without asking for saving. The last tab is
+// replaced by an empty session.
+void MainWindow::closePatientSession(int index)
+{
+    auto patientSession = m_patientSessions[index];
 
-        // Days
-        QString daysString = patientDataJsonObject["chemoTherapyAndMedicamentation"][i]["days"].toString();
-        ui->tableWidgetChemoAndMeds->setItem(i,
-                                             tableWidgetChemoAndMedsColumns.indexOf("Days"),
-                                             new QTableWidgetItem(daysString));
+    if(m_patientSessions.size() == 1)
+    {
+        activatePatientSession(addPatientSession());
+    }
+    else if(patientSession == m_activePatientSession)
+    {
+        activatePatientSession(m_patientSessions[index > 0 ? index - 1 : index + 1]);
     }
 
-    m_internalTableModificationsInProgress = false;
+    m_patientSessions.remove(index);
+    m_autosave.removePatientSession(patientSession);
+    m_patientFileMonitor.removePatientSession(patientSession);
 
-    plotVisualization();
+    m_patientTabBar->blockSignals(true);
+    m_patientTabBar->removeTab(index);
+    m_patientTabBar->blockSignals(false);
+
+    patientSession->deleteLater();
+
+    m_labInbox.setOpenPatientIds(openPatientIds());
+}
+
+void MainWindow::patientTabChanged(int index)
+{
+    if(index >= 0 && index < m_patientSessions.size())
+    {
+        activatePatientSession(m_patientSessions[index]);
+    }
 }
 
-// Saves the settings file after writing the current settings.
-void MainWindow::saveSettingsFile()
+void MainWindow::patientTabCloseRequested(int index)
 {
-    QFile settingsFile;
-    settingsFile.setFileName(QDir::currentPath() + "/" + "leukiSettings.json");
+    // Ask for saving patient data file first if there are unsaved changes.
+    if(m_patientSessions[index]->changedSinceLastSave())
+    {
+        activatePatientSession(m_patientSessions[index]);
+        askPatientDataFileSave();
+    }
+
+    closePatientSession(index);
+}
+
+void MainWindow::updatePatientTabs()
+{
+    for(auto i = 0; i < m_patientSessions.size(); i++)
+    {
+        m_patientTabBar->setTabText(i, m_patientSessions[i]->title());
+        m_patientTabBar->setTabToolTip(i, m_patientSessions[i]->fileName());
+    }
+}
+
+// Scrolls the tables to the positions stored in the view state of the active session. A
+// negative position scrolls to the bottom (i.e. the latest entries).
+void MainWindow::restoreTableScrollPositions()
+{
+    const auto& viewState = m_activePatientSession->viewState();
+
+    for(auto tableView : {ui->tableViewBloodSamples, ui->tableViewChemoAndMeds})
+    {
+        auto scrollPosition = (tableView == ui->tableViewBloodSamples) ? viewState.bloodSamplesScrollPosition :
+                                                                         viewState.chemoAndMedsScrollPosition;
+
+        if(scrollPosition < 0)
+        {
+            // Slight workaround needed (first top, then bottom).
+            tableView->scrollToTop();
+            tableView->scrollToBottom();
+        }
+        else
+        {
+            tableView->verticalScrollBar()->setValue(scrollPosition);
+        }
+    }
+}
+
+// Replaces the model shown by the passed table view.
+void MainWindow::setTableModel(QTableView& tableView, TableColumnSizer& columnSizer, PatientTableModel *model)
+{
+    // The view does not delete the selection model of the previous model.
+    auto selectionModel = tableView.selectionModel();
+
+    tableView.setModel(model);
+    columnSizer.setModel(model);
+
+    delete selectionModel;
+}
 
-    settingsFile.open(QIODevice::ReadOnly | QIODevice::Text);
-    QString settingsString = settingsFile.readAll();
-    settingsFile.close();
-    QJsonDocument settingsJsonDocument = QJsonDocument::fromJson(settingsString.toUtf8());
-    QJsonObject settingsJsonObject = settingsJsonDocument.object();
+// Sets the text of a form unless it is shown already, so that the cursor position of the form
+// being edited is kept.
+static void setLineEditText(QLineEdit *lineEdit, const QString& text)
+{
+    if(lineEdit->text() != text)
+    {
+        lineEdit->setText(text);
+    }
+}
 
-    settingsFile.open(QIODevice::WriteOnly | QIODevice::Text);
+// Fills the forms with the general information of the active session.
+void MainWindow::showGeneralInformation()
+{
+    const auto& generalInformation = m_activePatientSession->generalInformation();
 
-    settingsJsonObject["previousPatientDataFileName"] = m_previousPatientDataFileName;
-    settingsJsonObject["activeTabIndex"] = static_cast<double>(ui->tabWidget->currentIndex());
+    ui->labelPatientDataFile->setText(m_activePatientSession->fileName());
 
-    auto settings = m_settingsWindow.getSettings();
-    settingsJsonObject["autoLoadPatientDataFileOnStartup"] = settings.autoLoadPatientDataFileOnStartup;
+    setLineEditText(ui->lineEditPatientId, generalInformation.patientId);
+    setLineEditText(ui->lineEditPatientName, generalInformation.name);
+    setLineEditText(ui->lineEditPatientDateOfBirth, generalInformation.dateOfBirth);
+    setLineEditText(ui->lineEditPatientSize, generalInformation.size);
+    setLineEditText(ui->lineEditPatientWeight, generalInformation.weight);
+    setLineEditText(ui->lineEditPatientBodySurface, generalInformation.bodySurface);
+    setLineEditText(ui->lineEditPatientDateOfDiagnosis, generalInformation.dateOfDiagnosis);
+}
 
-    settingsJsonObject["visualizationShowLeukocytes"] = (ui->checkBoxVisualizationShowLeukocytes->checkState() == Qt::CheckState::Checked);
-    settingsJsonObject["visualizationShowErythrocytes"] = (ui->checkBoxVisualizationShowErythrocytes->checkState() == Qt::CheckState::Checked);
-    settingsJsonObject["visualizationShowHemoglobin"] = (ui->checkBoxVisualizationShowHemoglobin->checkState() == Qt::CheckState::Checked);
-    settingsJsonObject["visualizationShowThrombocytes"] = (ui->checkBoxVisualizationShowThrombocytes->checkState() == Qt::CheckState::Checked);
-    settingsJsonObject["visualizationShowMedicamentationAndChemoTherapy"] = (ui->checkBoxVisualizationShowMedicamentationAndChemoTherapy->checkState() == Qt::CheckState::Checked);
+// Takes over a general information field edited in the forms into the active session.
+void MainWindow::storeGeneralInformationField(QString PatientSession::general_information_t::*field, const QString& text)
+{
+    m_activePatientSession->setGeneralInformationField(field, text);
+}
 
-    settingsJsonDocument.setObject(settingsJsonObject);
+// Handles a general information field edited in the forms or changed by undo / redo.
+void MainWindow::patientGeneralInformationChanged()
+{
+    if(sender() == m_activePatientSession)
+    {
+        showGeneralInformation();
 
-    settingsFile.write(settingsJsonDocument.toJson());
+        // The date of diagnosis is offered as x-axis anchor.
+        m_tableDataChangedSinceLastVisualizationPlot = true;
+    }
 
-    settingsFile.close();
+    updatePatientTabs();
+    m_labInbox.setOpenPatientIds(openPatientIds());
 }
 
-// Replaces all empty (null) cell contents of the passed table with an empty string.
-void MainWindow::ensureTableWidgetCellsAreNotNull(QTableWidget& tableWidget)
+// Returns the patient IDs of all open patients. Lab results of these patients are merged
+// into the open sessions instead of being written to their patient data files.
+QSet<QString> MainWindow::openPatientIds() const
 {
-    for(auto row = 0; row < tableWidget.rowCount(); row++)
+    QSet<QString> patientIds;
+
+    for(auto patientSession : m_patientSessions)
     {
-        for(auto column = 0; column < tableWidget.columnCount(); column++)
+        if(!patientSession->generalInformation().patientId.isEmpty())
         {
-            if(!tableWidget.item(row, column))
-            {
-                tableWidget.setItem(row, column, new QTableWidgetItem(""));
-            }
+            patientIds.insert(patientSession->generalInformation().patientId);
         }
     }
+
+    return patientIds;
 }
 
-// Deletes the selected rows of the passed table.
+// Deletes the selected rows of the passed table, undone at once.
 // Returns the number of deleted rows.
-qsizetype MainWindow::deleteSelectedTableRows(QTableWidget& qTableWidget)
+qsizetype MainWindow::deleteSelectedTableRows(QTableView& tableView)
 {
     // Check if one or more items are selected.
-    if(qTableWidget.selectionModel()->hasSelection())
+    if(tableView.selectionModel()->hasSelection())
     {
-       auto selectedRows = qTableWidget.selectionModel()->selectedRows();
+       auto selectedRows = tableView.selectionModel()->selectedRows();
 
-       // Selected rows are stored in selection order, so find the first selected row's index
-       // first by iterating through all selected rows.
-       int firstRowToDeleteIndex = INT_MAX;
+       // Selected rows are stored in selection order, so sort them first.
+       QVector<int> rows;
+       rows.reserve(selectedRows.count());
 
-       for(auto i = 0; i < selectedRows.count(); i++)
+       for(const auto& selectedRow : selectedRows)
        {
-           if(selectedRows[i].row() < firstRowToDeleteIndex)
-           {
-               firstRowToDeleteIndex = selectedRows[i].row();
-           }
+           rows.append(selectedRow.row());
        }
 
-       for(auto i = 0; i < selectedRows.count(); i++)
+       std::sort(rows.begin(), rows.end());
+
+       // Remove each contiguous range of rows at once, starting at the bottom so that the
+       // indices of the remaining ranges stay valid.
+       auto last = rows.size() - 1;
+
+       m_activePatientSession->undoStack()->beginMacro("Delete Rows");
+
+       while(last >= 0)
        {
-           // The item below the previously gets it's index, so use the same index for all
-           // items to delete.
-           qTableWidget.removeRow(firstRowToDeleteIndex);
+           auto first = last;
+
+           while(first > 0 && rows[first - 1] == rows[first] - 1)
+           {
+               first--;
+           }
+
+           tableView.model()->removeRows(rows[first], static_cast<int>(last - first + 1));
+
+           last = first - 1;
        }
 
+       m_activePatientSession->undoStack()->endMacro();
+
        return selectedRows.count();
     }
 
     return 0;
 }
 
-// Sorts the passed row of the passed table in the table so that table is sorted date ascending.
-void MainWindow::sortEditedTableRow(QTableWidget& table, int row, int dateColumn)
+// Parses a block of table rows as copied from a spreadsheet or lab portal in a single pass.
+// Rows are separated by line breaks, cells by tabs or, if the first line does not contain a
+// tab, by semicolons. Empty lines are skipped, each row is padded or cut to the passed column
+// count.
+static QVector<QVector<QString>> parseTableRows(const QString& text, int columnCount)
 {
-    // Re-Sort if required.
-    auto dateOfEditedRow = QDateTime::fromString(table.item(row, dateColumn)->text(), "dd.MM.yyyy").toSecsSinceEpoch();
+    QVector<QVector<QString>> rows;
+
+    auto firstLineEnd = text.indexOf('\n');
+    QChar separator = text.left(firstLineEnd).contains('\t') ? QChar('\t') : QChar(';');
 
-    int rowToMoveNewItemTo = 0;
+    QVector<QString> row;
+    qsizetype fieldStart = 0;
 
-    for(int i = 0; i < table.rowCount() - 1; i++)
+    for(qsizetype i = 0; i <= text.size(); i++)
     {
-        auto dateOfCurrentRow = QDateTime::fromString(table.item(i, dateColumn)->text(), "dd.MM.yyyy").toSecsSinceEpoch();
-        long long dateOfNextRow = LLONG_MAX;
+        auto endOfText = (i == text.size());
+        auto c = endOfText ? QChar('\n') : text[i];
 
-        if(i < table.rowCount() - 2)
+        if(c != separator && c != '\n')
         {
-           dateOfNextRow = QDateTime::fromString(table.item(i + 1, dateColumn)->text(), "dd.MM.yyyy").toSecsSinceEpoch();
+            continue;
         }
 
-        // Edited item must be placed before first item.
-        if(i == 0 && dateOfEditedRow < dateOfCurrentRow)
+        if(row.size() < columnCount)
         {
-            rowToMoveNewItemTo = i;
+            row.append(text.mid(fieldStart, i - fieldStart).trimmed());
         }
-        // Edited item must be placed between two items.
-        else if(dateOfEditedRow >= dateOfCurrentRow && dateOfEditedRow < dateOfNextRow)
+
+        fieldStart = i + 1;
+
+        if(c == '\n')
         {
-            rowToMoveNewItemTo = i + 1;
+            // Skip empty lines (e.g. the trailing line break of a copied block).
+            if(row.size() > 1 || !row[0].isEmpty())
+            {
+                row.resize(columnCount);
+                rows.append(row);
+            }
+
+            row.clear();
         }
     }
 
-    if(row != rowToMoveNewItemTo)
+    return rows;
+}
+
+// Pastes a block of rows from the clipboard into the passed table. All rows are validated
+// and merged into the date sorted table at once, so the table is updated once and the
+// visualization is replotted once.
+void MainWindow::pasteTableRows(PatientTableModel& model, QTableView& tableView, bool numericValueColumns)
+{
+    auto rows = parseTableRows(QGuiApplication::clipboard()->text(), model.columnCount());
+    auto dateColumn = model.dateColumn();
+
+    // Skip a header row copied along with the data.
+    if(!rows.isEmpty() &&
+       rows[0][dateColumn].compare(model.headerData(dateColumn, Qt::Horizontal).toString(), Qt::CaseInsensitive) == 0)
     {
-        m_internalTableModificationsInProgress = true;
+        rows.removeFirst();
+    }
 
-        // Insert a new row at the destination row position.
-        table.insertRow(rowToMoveNewItemTo);
+    if(rows.isEmpty())
+    {
+        ui->statusbar->showMessage("Clipboard does not contain any table rows to paste.", statusMessageTimeoutMilliseconds);
+        return;
+    }
 
-        // Copy new user-added row's contents to the inserted new row.
-        for(auto i = 0; i < table.columnCount(); i++)
+    // Lab portals and spreadsheets frequently use a decimal comma.
+    if(numericValueColumns)
+    {
+        for(auto& row : rows)
         {
-            // At this point, increase row by one for accessing the new added row
-            // since it's index has been increased by inserting a new row above.
-            if(table.item(row + 1, i))
+            for(auto column = 0; column < row.size(); column++)
             {
-                table.setItem(rowToMoveNewItemTo,
-                              i,
-                              new QTableWidgetItem(table.item(row + 1, i)->text()));
+                if(column != dateColumn)
+                {
+                    row[column].replace(',', '.');
+                }
             }
         }
+    }
+
+    auto firstInsertedRow = model.insertRowsSorted(rows);
 
-        // Delete new user-added row after copying.
-        table.removeRow(row + 1);
+    m_tableDataChangedSinceLastVisualizationPlot = true;
 
-        // Scroll to new added row.
-        table.scrollTo(table.model()->index(rowToMoveNewItemTo, 0));
+    // Scroll to the first pasted row.
+    tableView.scrollTo(model.index(firstInsertedRow, 0));
+
+    ui->statusbar->showMessage(QString::number(rows.size()) + " rows pasted.", statusMessageTimeoutMilliseconds);
+}
 
-        m_internalTableModificationsInProgress = false;
+// Handles a user-initiated change in a date table cell. Invalid dates (format must be
+// dd.MM.yyyy) are validated by the model and marked in the table, rows with a valid date
+// have been sorted into the table by the model, so scroll to the row.
+void MainWindow::handleDateCellChange(PatientTableModel& model, QTableView& tableView, int row)
+{
+    if(model.isDateValid(row))
+    {
+        tableView.scrollTo(model.index(row, model.dateColumn()));
     }
 }
 
-bool MainWindow::checkDateFormat(QString dateString)
+void MainWindow::applySettings(const SettingsWindow::settings_t& settings)
 {
-    auto dateStdString = dateString.toStdString();
-    std::regex regex("\\b\\d{2}[.]\\d{2}[.]\\d{4}\\b");
-    std::smatch match;
+    m_labInbox.setDirectories(settings.labInboxDirectory, settings.patientDataDirectory);
+    m_patientCatalogWindow.setDirectory(settings.patientDataDirectory);
+    m_cohortQueryWindow.setDirectory(settings.patientDataDirectory);
+    m_overlayComparisonWindow.setDirectory(settings.patientDataDirectory);
 
-    auto ret = std::regex_match(dateStdString, match, regex);
+    for(auto patientSession : std::as_const(m_patientSessions))
+    {
+        patientSession->cycleAnalysis()->setRecoveryThresholds(recoveryThresholds(settings));
+        patientSession->derivedSeries()->setParameters(settings.movingAverageDays, settings.smoothingFactor);
+        patientSession->setUndoMemoryBudget(settings.undoMemoryBudgetMegabytes * bytesPerMegabyte);
+    }
 
-    return ret;
-}
+    m_autosave.setInterval(settings.autosaveIntervalSeconds);
 
-// Handles a user-initiated change in a date table cell. Triggers date validation
-// and sorting of the table.
-void MainWindow::handleDateCellChange(QTableWidget& table, int row, int column)
-{
-    QString dateString = table.item(row, column)->text();
+    updateUndoActions();
 
-    if(!checkDateFormat(dateString))
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Visualization"))
     {
-        QMessageBox::information(this,
-                                 "Leuki - Invalid Date Entry",
-                                 "Warning: Table Row " + QString::number(row + 1) +
-                                 " contains an invalid date entry (" +
-                                 dateString +
-                                 ")! Format must be dd.MM.yyyy .");
+        plotVisualization();
     }
-    else if (!m_internalTableModificationsInProgress)
+    else if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Cycles"))
     {
-        sortEditedTableRow(table,
-                           row,
-                           column);
+        showCycleSummary();
     }
 }
 
-void MainWindow::askPatientDataFileSave()
+void MainWindow::labBloodSamplesReceived(const QString& patientId, const QVector<QVector<QString>>& rows)
 {
-    auto ret = QMessageBox::question(this,
-                                     "Leuki - Patient Data Changed",
-                                     "Patient data has been changed since last save! Save first? Otherwise, unsaved data will be lost!",
-                                     QMessageBox::Yes|QMessageBox::No);
+    auto newRowCount = 0;
 
-    if (ret == QMessageBox::Yes)
+    for(auto patientSession : m_patientSessions)
     {
-        on_actionSettingsSaveAs_triggered();
+        if(patientSession->generalInformation().patientId == patientId && !patientSession->isLoading())
+        {
+            newRowCount += mergeLabBloodSamples(patientSession, rows);
+        }
+    }
+
+    if(newRowCount > 0)
+    {
+        ui->statusbar->showMessage(QString::number(newRowCount) + " blood samples received from the lab.", statusMessageTimeoutMilliseconds);
     }
 }
 
-// (Re-)Plots the visualization.
-void MainWindow::plotVisualization()
+// Merges lab results of an open patient into its blood sample table. Samples which are
+// already contained in the table are skipped. Returns the number of merged samples.
+int MainWindow::mergeLabBloodSamples(PatientSession *patientSession, const QVector<QVector<QString>>& rows)
 {
-    // Clear everything before (re)plotting.
-    ui->customPlot->clearGraphs();
-    ui->customPlot->clearItems();
-    ui->customPlot->clearPlottables();
-    ui->customPlot->clearFocus();
-    ui->customPlot->clearMask();
+    QVector<QVector<QString>> newRows = LabInbox::withoutExistingRows(patientSession->bloodSamplesModel()->columns(), rows);
 
-    QString yAxisLabel;
+    if(newRows.isEmpty())
+    {
+        return 0;
+    }
+
+    patientSession->bloodSamplesModel()->insertRowsSorted(newRows);
+
+    // Inactive sessions are plotted when they are activated.
+    if(patientSession != m_activePatientSession)
+    {
+        return static_cast<int>(newRows.size());
+    }
+
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Visualization"))
+    {
+        plotVisualization();
+    }
+    else
+    {
+        m_tableDataChangedSinceLastVisualizationPlot = true;
+    }
 
-    if(ui->checkBoxVisualizationShowLeukocytes->isChecked())
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Cycles"))
     {
-        yAxisLabel = yAxisLabel + ", Leukocytes [Giga/l]";
+        showCycleSummary();
     }
 
-    if(ui->checkBoxVisualizationShowErythrocytes->isChecked())
+    return static_cast<int>(newRows.size());
+}
+
+void MainWindow::labInboxScanFinished(int ingestedFileCount, const QStringList& updatedPatientDataFileNames,
+                                      const QStringList& unknownPatientIds, int failedFileCount)
+{
+    QStringList messages;
+
+    if(ingestedFileCount > 0)
     {
-        yAxisLabel = yAxisLabel + ", Erythrocytes [Tera / l]";
+        messages.append(QString::number(ingestedFileCount) + " lab result files ingested, " +
+                        QString::number(updatedPatientDataFileNames.size()) + " patient data files updated.");
     }
 
-    if(ui->checkBoxVisualizationShowHemoglobin->isChecked())
+    if(!unknownPatientIds.isEmpty())
     {
-        yAxisLabel = yAxisLabel + ", Hemoglobin [g/dl]";
+        messages.append("No patient data file for patient IDs " + unknownPatientIds.join(", ") + ".");
     }
 
-    if(ui->checkBoxVisualizationShowThrombocytes->isChecked())
+    if(failedFileCount > 0)
     {
-        yAxisLabel = yAxisLabel + ", Thrombocytes [Giga/l]";
+        messages.append(QString::number(failedFileCount) + " lab result files cannot be read.");
     }
 
-    // Remove leading ", "
-    yAxisLabel.remove(0, std::string(", ").length());
+    ui->statusbar->showMessage(messages.join(" "), statusMessageTimeoutMilliseconds);
+}
 
-    ui->customPlot->yAxis->setLabel(yAxisLabel);
+// Applies a batch of requests of local tools. The rows pushed into a table by the requests of
+// the batch are merged at once and the batch is a single undo step per patient, so that the
+// visualization is plotted once per batch instead of once per request.
+void MainWindow::ipcBatchReceived(const QVector<IpcServer::request_t>& requests)
+{
+    QVector<QJsonObject> responses(requests.size());
+    QVector<PatientSession*> pushedPatientSessions;
 
-    auto bloodSamplesCount = ui->tableWidgetBloodSamples->rowCount();
-    double yAxisMax = 0.0;
+    // Rows pushed per table with the request each row stems from.
+    QHash<PatientTableModel*, QVector<QVector<QString>>> pushedRows;
+    QHash<PatientTableModel*, QVector<int>> pushedRowRequests;
 
-    // At this point, assume that the first column (index 0) is the date column.
-    for(auto column = tableWidgetBloodSamplesColumns.indexOf("Date") + 1; column < tableWidgetBloodSamplesColumns.size(); column++)
+    for(auto i = 0; i < requests.size(); i++)
     {
-        ui->customPlot->addGraph();
-        ui->customPlot->graph(column - 1)->setLineStyle(QCPGraph::lsLine);
-        ui->customPlot->graph(column - 1)->setScatterStyle(QCPScatterStyle::ssStar);
+        const auto& request = requests[i];
 
-        if(column == tableWidgetBloodSamplesColumns.indexOf("Leukocytes [Giga/l]"))
+        if(request.command == IpcProtocol::commandListPatients)
         {
-            if(!ui->checkBoxVisualizationShowLeukocytes->isChecked())
-            {
-                continue;
-            }
-
-            ui->customPlot->graph(column - 1)->setPen(QPen(Qt::blue));
+            responses[i]["patients"] = ipcPatientList();
+            continue;
         }
-        else if(column == tableWidgetBloodSamplesColumns.indexOf("Erythrocytes [Tera/l]"))
+
+        auto patientSession = ipcPatientSession(request.patientId);
+
+        if(!patientSession)
         {
-            if(!ui->checkBoxVisualizationShowErythrocytes->isChecked())
-            {
-                continue;
-            }
+            responses[i]["ok"] = false;
+            responses[i]["error"] = request.patientId.isEmpty() ? QString("No patient is open.") :
+                                                                  "Patient " + request.patientId + " is not open.";
+            continue;
+        }
+
+        auto bloodSamples = (request.command == IpcProtocol::commandAddBloodSamples);
+        auto model = bloodSamples ? patientSession->bloodSamplesModel() : patientSession->chemoAndMedsModel();
+        auto rows = bloodSamples ? PatientDataFile::bloodSampleRowsFromJson(request.rows) :
+                                   PatientDataFile::chemoAndMedRowsFromJson(request.rows);
+
+        pushedRows[model].append(rows);
+        pushedRowRequests[model].append(QVector<int>(rows.size(), i));
 
-            ui->customPlot->graph(column - 1)->setPen(QPen(Qt::red));
+        if(!pushedPatientSessions.contains(patientSession))
+        {
+            pushedPatientSessions.append(patientSession);
         }
-        else if(column == tableWidgetBloodSamplesColumns.indexOf("Hemoglobin [g/dl]"))
+    }
+
+    // Rows contained in the table or pushed before in the batch are skipped. The new rows keep
+    // the order of the pushed rows and the first of equal rows, so matching them in order tells
+    // the request each stems from.
+    QHash<PatientTableModel*, QVector<QVector<QString>>> newTableRows;
+    QVector<int> addedRowCounts(requests.size(), 0);
+    auto addedRowCount = 0;
+
+    for(auto model : pushedRows.keys())
+    {
+        const auto& rows = pushedRows[model];
+        const auto& rowRequests = pushedRowRequests[model];
+        QVector<QVector<QString>> newRows = LabInbox::withoutExistingRows(model->columns(), rows);
+        auto newRow = 0;
+
+        for(auto row = 0; row < rows.size() && newRow < newRows.size(); row++)
         {
-            if(!ui->checkBoxVisualizationShowHemoglobin->isChecked())
+            if(rows[row] == newRows[newRow])
             {
-                continue;
+                addedRowCounts[rowRequests[row]]++;
+                newRow++;
             }
+        }
 
-            ui->customPlot->graph(column - 1)->setPen(QPen(Qt::magenta));
+        if(!newRows.isEmpty())
+        {
+            newTableRows.insert(model, newRows);
+            addedRowCount += static_cast<int>(newRows.size());
         }
-        else if(column == tableWidgetBloodSamplesColumns.indexOf("Thrombocytes [Giga/l]"))
+    }
+
+    QVector<PatientSession*> changedPatientSessions;
+
+    for(auto patientSession : std::as_const(pushedPatientSessions))
+    {
+        auto bloodSamplesModel = patientSession->bloodSamplesModel();
+        auto chemoAndMedsModel = patientSession->chemoAndMedsModel();
+
+        if(!newTableRows.contains(bloodSamplesModel) && !newTableRows.contains(chemoAndMedsModel))
         {
-            if(!ui->checkBoxVisualizationShowThrombocytes->isChecked())
-            {
-                continue;
-            }
+            continue;
+        }
+
+        patientSession->undoStack()->beginMacro("Receive Rows");
 
-            ui->customPlot->graph(column - 1)->setPen(QPen(Qt::darkYellow));
+        if(newTableRows.contains(bloodSamplesModel))
+        {
+            bloodSamplesModel->insertRowsSorted(newTableRows[bloodSamplesModel]);
         }
-        else
+
+        if(newTableRows.contains(chemoAndMedsModel))
         {
-            ui->customPlot->graph(column - 1)->setPen(QPen(Qt::black));
+            chemoAndMedsModel->insertRowsSorted(newTableRows[chemoAndMedsModel]);
         }
 
-        QVector<QCPGraphData> graphData;
+        patientSession->undoStack()->endMacro();
+
+        changedPatientSessions.append(patientSession);
+    }
 
-        for(auto bloodSampleIndex = 0; bloodSampleIndex < bloodSamplesCount; bloodSampleIndex++)
+    for(auto i = 0; i < requests.size(); i++)
+    {
+        if(requests[i].command == IpcProtocol::commandAddBloodSamples || requests[i].command == IpcProtocol::commandAddChemoAndMeds)
         {
-            if(// Ignore cells of rows with an invalid date.
-               ui->tableWidgetBloodSamples->item(bloodSampleIndex, tableWidgetBloodSamplesColumns.indexOf("Date")) &&
-               checkDateFormat(ui->tableWidgetBloodSamples->item(bloodSampleIndex, tableWidgetBloodSamplesColumns.indexOf("Date"))->text()) &&
-               // Ignore empty cells.
-               ui->tableWidgetBloodSamples->item(bloodSampleIndex, column) &&
-               ui->tableWidgetBloodSamples->item(bloodSampleIndex, column)->text() != "")
+            if(!responses[i].contains("ok"))
             {
-                QCPGraphData graphPoint;
+                responses[i]["addedRows"] = addedRowCounts[i];
+                responses[i]["skippedRows"] = static_cast<int>(requests[i].rows.size()) - addedRowCounts[i];
+            }
+        }
 
-                graphPoint.key = QDateTime::fromString(ui->tableWidgetBloodSamples->item(bloodSampleIndex, tableWidgetBloodSamplesColumns.indexOf("Date"))->text(), "dd.MM.yyyy").toSecsSinceEpoch();
-                graphPoint.value = ui->tableWidgetBloodSamples->item(bloodSampleIndex, column)->text().toDouble();
+        m_ipcServer.respond(requests[i], responses[i]);
+    }
 
-                graphData.append(graphPoint);
+    if(addedRowCount == 0)
+    {
+        return;
+    }
 
-                if(graphPoint.value > yAxisMax)
-                {
-                    yAxisMax = graphPoint.value;
-                }
-            }
+    // Inactive sessions are plotted when they are activated.
+    if(changedPatientSessions.contains(m_activePatientSession))
+    {
+        showActiveSessionChanges();
+    }
+
+    ui->statusbar->showMessage(QString::number(addedRowCount) + " rows received from local tools.", statusMessageTimeoutMilliseconds);
+}
+
+// Returns the open session of the patient ID of a request of a local tool, the active session
+// if the request names no patient.
+PatientSession* MainWindow::ipcPatientSession(const QString& patientId) const
+{
+    if(patientId.isEmpty())
+    {
+        return m_activePatientSession->isLoading() ? nullptr : m_activePatientSession;
+    }
+
+    for(auto patientSession : m_patientSessions)
+    {
+        if(patientSession->generalInformation().patientId == patientId && !patientSession->isLoading())
+        {
+            return patientSession;
+        }
+    }
+
+    return nullptr;
+}
+
+QJsonArray MainWindow::ipcPatientList() const
+{
+    QJsonArray patientsArray;
+
+    for(auto patientSession : m_patientSessions)
+    {
+        if(patientSession->isLoading())
+        {
+            continue;
         }
 
-        ui->customPlot->graph(column - 1)->data()->set(graphData);
+        QJsonObject patientJsonObject;
+        patientJsonObject["patientId"] = patientSession->generalInformation().patientId;
+        patientJsonObject["name"] = patientSession->generalInformation().name;
+        patientJsonObject["fileName"] = patientSession->fileName();
+        patientJsonObject["active"] = (patientSession == m_activePatientSession);
+
+        patientsArray.append(patientJsonObject);
     }
 
-    // Plot (date axis range)
-    if(bloodSamplesCount)
+    return patientsArray;
+}
+
+// Shows the number of invalid table entries in the status bar.
+void MainWindow::updateValidationStatus()
+{
+    auto bloodSamplesInvalidDateCount = m_bloodSamplesModel->invalidDateCount();
+    auto chemoAndMedsInvalidDateCount = m_chemoAndMedsModel->invalidDateCount();
+
+    if(!bloodSamplesInvalidDateCount && !chemoAndMedsInvalidDateCount)
     {
-        double firstBloodSampleDateSecsSinceEpoch = 0.0;
-        bool entryFound = false;
+        m_validationStatusLabel->clear();
+        return;
+    }
 
-        for(auto i = 0; i < ui->tableWidgetBloodSamples->rowCount(); i++)
+    m_validationStatusLabel->setText("Invalid date entries (format must be dd.MM.yyyy): " +
+                                     QString::number(bloodSamplesInvalidDateCount) + " in Blood Samples, " +
+                                     QString::number(chemoAndMedsInvalidDateCount) + " in Chemo Therapy / Medicamentation");
+}
+
+void MainWindow::askPatientDataFileSave()
+{
+    auto ret = QMessageBox::question(this,
+                                     "Leuki - Patient Data Changed",
+                                     "Patient data has been changed since last save! Save first? Otherwise, unsaved data will be lost!",
+                                     QMessageBox::Yes|QMessageBox::No);
+
+    if (ret == QMessageBox::Yes)
+    {
+        on_actionSave_triggered();
+    }
+}
+
+// Offers to restore the unsaved changes left behind by a previous program execution which has
+// not been closed properly, each in its own tab.
+void MainWindow::recoverPatientSessions()
+{
+    for(const auto& recoveryFile : m_autosave.recoveryFiles())
+    {
+        QString patient = recoveryFile.patientName.isEmpty() ? QString("a new patient") : recoveryFile.patientName;
+
+        if(!recoveryFile.patientDataFileName.isEmpty())
         {
-            if(ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Date")) &&
-               checkDateFormat(ui->tableWidgetBloodSamples->item(i, 0)->text()))
-            {
-                firstBloodSampleDateSecsSinceEpoch = QDateTime::fromString(ui->tableWidgetBloodSamples->item(0, tableWidgetBloodSamplesColumns.indexOf("Date"))->text(), "dd.MM.yyyy").toSecsSinceEpoch();
-                entryFound = true;
-                break;
-            }
+            patient += " (" + recoveryFile.patientDataFileName + ")";
         }
 
-        double lastBloodSampleDateSecsSinceEpoch = 0.0;
+        auto ret = QMessageBox::question(this,
+                                         "Leuki - Recover Unsaved Changes",
+                                         "Leuki has not been closed properly! Unsaved changes of " + patient + " from " +
+                                         recoveryFile.lastModified.toString("dd.MM.yyyy hh:mm") + " have been found. Restore them? Otherwise, they will be discarded!",
+                                         QMessageBox::Yes|QMessageBox::No);
 
-        if(entryFound)
+        if(ret != QMessageBox::Yes)
         {
-            entryFound = false;
+            m_autosave.discardRecoveryFile(recoveryFile.fileName);
+            continue;
+        }
 
-            for(auto i = ui->tableWidgetBloodSamples->rowCount() - 1; i >= 0; i--)
-            {
-                if(ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Date")) &&
-                   checkDateFormat(ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Date"))->text()))
-                {
-                    lastBloodSampleDateSecsSinceEpoch = QDateTime::fromString(ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Date"))->text(), "dd.MM.yyyy").toSecsSinceEpoch();
-                    entryFound = true;
-                    break;
-                }
-            }
+        auto patientSession = m_activePatientSession->isEmpty() ? m_activePatientSession : addPatientSession();
+
+        m_autosave.setRecoveryFileName(patientSession, recoveryFile.fileName);
+        patientSession->recover(recoveryFile.fileName, recoveryFile.patientDataFileName);
+
+        activatePatientSession(patientSession);
+    }
+
+    updatePatientTabs();
+    m_patientFileMonitor.update();
+}
+
+// Fills the cycles table with the nadir and recovery of each chemo therapy cycle of the
+// active session. Only cycles affected by changes since the last call are computed again.
+void MainWindow::showCycleSummary()
+{
+    if(!m_activePatientSession)
+    {
+        return;
+    }
+
+    const auto& cycles = m_activePatientSession->cycleAnalysis()->cycles();
+
+    ui->tableWidgetCycles->setRowCount(0);
+    ui->tableWidgetCycles->setRowCount(static_cast<int>(cycles.size()));
+
+    for(auto row = 0; row < cycles.size(); row++)
+    {
+        const auto& cycle = cycles[row];
+        QVector<QString> texts {QDateTime::fromSecsSinceEpoch(cycle.startDateKey).toString("dd.MM.yyyy"),
+                                cycle.medications};
+
+        for(const auto& parameter : cycle.parameters)
+        {
+            texts.append(parameter.hasNadir ? QString::number(parameter.nadir) : QString());
+            texts.append(parameter.hasNadir ? QString::number(parameter.nadirDay) : QString());
+            texts.append(parameter.recovered ? QString::number(parameter.recoveryDay) : QString());
         }
 
-        if(!entryFound)
+        for(auto column = 0; column < texts.size(); column++)
         {
-            QMessageBox::information(this,
-                                     "Leuki - No Valid Date Entries",
-                                     "Warning: No valid date entries for plot x-axes scaling found!");
+            ui->tableWidgetCycles->setItem(row, column, new QTableWidgetItem(texts[column]));
+        }
+    }
+}
 
-            return;
+// Fills the cumulative doses table with the totals per drug of the active session. Totals
+// requiring the unknown body surface area are shown as "?".
+void MainWindow::showCumulativeDoses()
+{
+    const auto totals = m_activePatientSession->doseAccounting()->totals();
+
+    auto doseText = [](double dose)
+    {
+        return std::isnan(dose) ? QString("?") : QString::number(dose, 'g', 6);
+    };
+
+    ui->tableWidgetCumulativeDoses->setRowCount(0);
+    ui->tableWidgetCumulativeDoses->setRowCount(static_cast<int>(totals.size()));
+
+    for(auto row = 0; row < totals.size(); row++)
+    {
+        const auto& total = totals[row];
+        QVector<QString> texts {total.name,
+                                total.unit,
+                                doseText(total.total),
+                                doseText(total.totalPerBodySurface),
+                                total.lifetimeLimit > 0.0 ? QString::number(total.lifetimeLimit) : QString(),
+                                total.lifetimeLimit > 0.0 ? doseText(100.0 * total.totalPerBodySurface / total.lifetimeLimit) : QString()};
+
+        for(auto column = 0; column < texts.size(); column++)
+        {
+            ui->tableWidgetCumulativeDoses->setItem(row, column, new QTableWidgetItem(texts[column]));
         }
+    }
+}
+
+// Fills the x-axis choices with the anchors of the active session: the date of diagnosis and
+// the start of each chemo therapy cycle. The chosen anchor is kept if it still exists.
+void MainWindow::updateTimelineAnchors()
+{
+    auto anchorKey = ui->comboBoxVisualizationTimeline->currentData();
+    const auto& generalInformation = m_activePatientSession->generalInformation();
+    auto diagnosisKey = PatientTableModel::parseDate(generalInformation.dateOfDiagnosis);
+    const auto& cycles = m_activePatientSession->cycleAnalysis()->cycles();
+
+    ui->comboBoxVisualizationTimeline->clear();
+    ui->comboBoxVisualizationTimeline->addItem("Dates");
 
-        ui->customPlot->xAxis->setRange(firstBloodSampleDateSecsSinceEpoch - secondsPerDay, lastBloodSampleDateSecsSinceEpoch + secondsPerDay);
+    if(diagnosisKey != PatientTableModel::invalidDateKey)
+    {
+        ui->comboBoxVisualizationTimeline->addItem("Days since Diagnosis (" + generalInformation.dateOfDiagnosis + ")", diagnosisKey);
     }
 
-    ui->customPlot->yAxis->setRange(0, yAxisMax);
+    for(auto i = 0; i < cycles.size(); i++)
+    {
+        ui->comboBoxVisualizationTimeline->addItem("Days since Cycle " + QString::number(i + 1) + " (" +
+                                                   QDateTime::fromSecsSinceEpoch(cycles[i].startDateKey).toString("dd.MM.yyyy") + ", " +
+                                                   cycles[i].medications + ")",
+                                                   cycles[i].startDateKey);
+    }
 
-    unsigned int maxTextLabelsStacked = 0;
+    auto index = anchorKey.isValid() ? ui->comboBoxVisualizationTimeline->findData(anchorKey) : 0;
 
-    if(ui->checkBoxVisualizationShowMedicamentationAndChemoTherapy->isChecked())
+    ui->comboBoxVisualizationTimeline->setCurrentIndex(std::max(index, 0));
+
+    applyTimelineAnchor(false);
+}
+
+// Sets the x-axis ticker of the chosen anchor. Optionally, the visualized range is moved to
+// start the day before the anchor, keeping its width.
+void MainWindow::applyTimelineAnchor(bool moveToAnchor)
+{
+    auto anchorKey = ui->comboBoxVisualizationTimeline->currentData();
+
+    if(!anchorKey.isValid())
     {
-        m_textLabelStatistics.clear();
+        ui->customPlot->xAxis->setTicker(m_dateTicker);
+        ui->customPlot->xAxis->setLabel("Date");
 
-        auto chemoAndMedsCount = ui->tableWidgetChemoAndMeds->rowCount();
+        return;
+    }
+
+    m_relativeDayTicker->setAnchorKey(anchorKey.toLongLong());
+
+    ui->customPlot->xAxis->setTicker(m_relativeDayTicker);
+    ui->customPlot->xAxis->setLabel(ui->comboBoxVisualizationTimeline->currentText());
+
+    if(moveToAnchor)
+    {
+        auto rangeSize = ui->customPlot->xAxis->range().size();
+        auto lower = static_cast<double>(anchorKey.toLongLong()) - secondsPerDay;
+
+        ui->customPlot->xAxis->setRange(lower, lower + rangeSize);
+    }
+}
+
+// Shows or hides the plotted graphs of the passed derived series.
+void MainWindow::showDerivedSeries(DerivedSeries::derived_t derived, bool show)
+{
+    for(auto derivedGraph : std::as_const(m_derivedSeriesGraphs[derived]))
+    {
+        derivedGraph->setVisible(show);
+    }
+
+    ui->customPlot->replot();
+}
+
+// (Re-)Plots the visualization from the prepared visualization data of the active session.
+void MainWindow::plotVisualization()
+{
+    // The visualization check boxes are restored from the settings before the first session
+    // has been created.
+    if(!m_activePatientSession)
+    {
+        return;
+    }
 
-        for(auto i = 0; i < chemoAndMedsCount; i++)
+    // Clear everything before (re)plotting.
+    ui->customPlot->clearGraphs();
+    ui->customPlot->clearItems();
+    ui->customPlot->clearPlottables();
+    ui->customPlot->clearFocus();
+    ui->customPlot->clearMask();
+
+    updateTimelineAnchors();
+
+    // The visualization data is prepared again only if the tables have been changed.
+    const auto& plotData = m_activePatientSession->plotData();
+    double yAxisMax = 0.0;
+    double chemistryAxisMax = 0.0;
+    QStringList yAxisLabels;
+    QStringList chemistryAxisLabels;
+    QVector<int> shownColumns;
+
+    // One graph per blood value of the registry, on the axis and in the colour of its
+    // parameter. Check boxes and graph data are in the order of the registry.
+    const auto& parameters = LabParameters::parameters();
+
+    for(auto i = 0; i < parameters.size(); i++)
+    {
+        const auto& parameter = parameters[i];
+        const auto column = PatientDataSchema::labParameterColumns[i];
+        const auto chemistry = parameter.axis == PatientDataSchema::AXIS_CHEMISTRY;
+
+        if(!m_parameterCheckBoxes[i]->isChecked())
         {
-            auto secondsSinceEpoch = QDateTime::fromString(ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Date (Start)"))->text(), "dd.MM.yyyy").toSecsSinceEpoch();
-            int days = 1;
+            continue;
+        }
 
-            if(ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Days")))
-            {
-                bool conversionSuccessful = false;
-                int ret = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Days"))->text().toInt(&conversionSuccessful);
+        auto graph = ui->customPlot->addGraph(ui->customPlot->xAxis, chemistry ? m_chemistryAxis : ui->customPlot->yAxis);
+        graph->setLineStyle(QCPGraph::lsLine);
+        graph->setScatterStyle(QCPScatterStyle::ssStar);
+        graph->setPen(QPen(parameter.color));
+        graph->data()->set(plotData.graphs[i]);
 
-                if(conversionSuccessful)
-                {
-                    days = ret;
-                }
-            }
+        shownColumns.append(column);
+        (chemistry ? chemistryAxisLabels : yAxisLabels).append(LabParameters::columnName(parameter));
 
-            // Text Label
+        auto& axisMax = chemistry ? chemistryAxisMax : yAxisMax;
+        axisMax = std::max(axisMax, plotData.graphMaximums[i]);
+    }
+
+    ui->customPlot->yAxis->setLabel(yAxisLabels.join(", "));
+    m_chemistryAxis->setLabel(chemistryAxisLabels.join(", "));
+    m_chemistryAxis->setVisible(!chemistryAxisLabels.isEmpty());
+
+    // Derived series of the shown blood values in their colour. All of them are added, the
+    // hidden ones are shown by their check boxes without plotting again.
+    const QVector<Qt::PenStyle> derivedSeriesPenStyles {Qt::DashLine, Qt::DotLine, Qt::DashDotLine};
+    const QVector<QCheckBox*> derivedSeriesCheckBoxes {ui->checkBoxVisualizationShowMovingAverage,
+                                                       ui->checkBoxVisualizationShowSmoothed,
+                                                       ui->checkBoxVisualizationShowSlope};
+
+    for(auto derived = 0; derived < DerivedSeries::DERIVED_COUNT; derived++)
+    {
+        m_derivedSeriesGraphs[derived].clear();
+
+        for(auto column : shownColumns)
+        {
+            const auto& parameter = LabParameters::parameterOfColumn(column);
+            auto valueAxis = parameter.axis == PatientDataSchema::AXIS_CHEMISTRY ? m_chemistryAxis : ui->customPlot->yAxis;
+            auto derivedGraph = ui->customPlot->addGraph(ui->customPlot->xAxis,
+                                                         derived == DerivedSeries::DERIVED_SLOPE ? ui->customPlot->yAxis2 : valueAxis);
+            QPen derivedPen(parameter.color);
+
+            derivedPen.setStyle(derivedSeriesPenStyles[derived]);
+
+            derivedGraph->setPen(derivedPen);
+            derivedGraph->setLineStyle(QCPGraph::lsLine);
+            derivedGraph->data()->set(m_activePatientSession->derivedSeries()->series(column, static_cast<DerivedSeries::derived_t>(derived)), true);
+            derivedGraph->setVisible(derivedSeriesCheckBoxes[derived]->isChecked());
+
+            m_derivedSeriesGraphs[derived].append(derivedGraph);
+        }
+    }
+
+    ui->customPlot->yAxis2->rescale();
+
+    // Cumulative doses of the drugs having a lifetime limit, as running curves up to the limit
+    // line at 100 %.
+    m_cumulativeDoseAxis->setVisible(ui->checkBoxVisualizationShowCumulativeDose->isChecked());
+
+    if(ui->checkBoxVisualizationShowCumulativeDose->isChecked())
+    {
+        const auto lifetimeCurves = m_activePatientSession->doseAccounting()->lifetimeCurves();
+        double cumulativeDoseMax = 100.0;
+
+        for(const auto& lifetimeCurve : lifetimeCurves)
+        {
+            auto cumulativeDoseGraph = ui->customPlot->addGraph(ui->customPlot->xAxis, m_cumulativeDoseAxis);
+            cumulativeDoseGraph->setPen(QPen(Qt::darkRed, 2));
+            cumulativeDoseGraph->setLineStyle(QCPGraph::lsStepLeft);
+            cumulativeDoseGraph->data()->set(lifetimeCurve.percentages, true);
+
+            const auto& lastPoint = lifetimeCurve.percentages.last();
 
             QCPItemText *textLabel = new QCPItemText(ui->customPlot);
-            textLabel->setPositionAlignment(Qt::AlignTop|Qt::AlignHCenter);
-            textLabel->position->setType(QCPItemPosition::ptPlotCoords);
+            textLabel->setPositionAlignment(Qt::AlignBottom|Qt::AlignLeft);
+            textLabel->position->setAxes(ui->customPlot->xAxis, m_cumulativeDoseAxis);
+            textLabel->position->setCoords(lastPoint.key, lastPoint.value);
+            textLabel->setText(lifetimeCurve.name + " " + QString::number(lastPoint.value, 'f', 0) + " %");
+            textLabel->setColor(Qt::darkRed);
+
+            cumulativeDoseMax = std::max(cumulativeDoseMax, lastPoint.value);
+        }
 
-            // Check how many labels are already placed at the current x-axis position.
-            unsigned int textLabelsAtCurrentXAxisPosition = 0;
-            bool entryFound = false;
+        QCPItemStraightLine *limitLine = new QCPItemStraightLine(ui->customPlot);
+        limitLine->point1->setAxes(ui->customPlot->xAxis, m_cumulativeDoseAxis);
+        limitLine->point2->setAxes(ui->customPlot->xAxis, m_cumulativeDoseAxis);
+        limitLine->point1->setCoords(0, 100);
+        limitLine->point2->setCoords(1, 100);
+        limitLine->setPen(QPen(Qt::darkRed, 1, Qt::DashLine));
+
+        m_cumulativeDoseAxis->setRange(0, cumulativeDoseMax * 1.1);
+    }
+
+    // Nadir (circle) and recovery (triangle) of each chemo therapy cycle, in the colour of the
+    // blood value.
+    if(ui->checkBoxVisualizationShowNadirAndRecovery->isChecked())
+    {
+        const auto& cycles = m_activePatientSession->cycleAnalysis()->cycles();
 
-            for(auto i = 0; i < m_textLabelStatistics.size(); i++)
+        for(auto i = 0; i < CycleAnalysis::parameterColumns.size(); i++)
+        {
+            auto column = CycleAnalysis::parameterColumns[i];
+
+            if(!m_parameterCheckBoxes[PatientDataSchema::labParameterIndex(column)]->isChecked())
+            {
+                continue;
+            }
+
+            auto color = LabParameters::parameterOfColumn(column).color;
+
+            auto nadirGraph = ui->customPlot->addGraph();
+            nadirGraph->setLineStyle(QCPGraph::lsNone);
+            nadirGraph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, color, sizeVisualizationNadirAndRecoveryMarkerPixels));
+
+            auto recoveryGraph = ui->customPlot->addGraph();
+            recoveryGraph->setLineStyle(QCPGraph::lsNone);
+            recoveryGraph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssTriangle, color, sizeVisualizationNadirAndRecoveryMarkerPixels));
+
+            for(const auto& cycle : cycles)
             {
-                if(m_textLabelStatistics[i].dateSecondsSinceEpoch == secondsSinceEpoch)
+                const auto& parameter = cycle.parameters[i];
+
+                if(parameter.hasNadir)
+                {
+                    nadirGraph->addData(parameter.nadirDateKey, parameter.nadir);
+                }
+
+                if(parameter.recovered)
                 {
-                    m_textLabelStatistics[i].textLabelCount++;
-                    textLabelsAtCurrentXAxisPosition = m_textLabelStatistics[i].textLabelCount;
-                    entryFound = true;
-                    break;
+                    recoveryGraph->addData(parameter.recoveryDateKey, parameter.recoveryValue);
                 }
             }
+        }
+    }
+
+    // Plot (date axis range)
+    if(plotData.bloodSampleCount)
+    {
+        if(!plotData.hasValidDate)
+        {
+            ui->statusbar->showMessage("Warning: No valid date entries for plot x-axes scaling found!");
+
+            return;
+        }
+
+        ui->customPlot->xAxis->setRange(plotData.firstDateKey - secondsPerDay,
+                                        plotData.lastDateKey + secondsPerDay);
+    }
+
+    ui->customPlot->yAxis->setRange(0, yAxisMax);
+
+    unsigned int maxTextLabelsStacked = 0;
+
+    if(ui->checkBoxVisualizationShowMedicamentationAndChemoTherapy->isChecked())
+    {
+        m_textLabelStatistics.clear();
+        m_textLabelStatistics.reserve(plotData.medicationLabels.size());
+
+        for(const auto& medicationLabel : plotData.medicationLabels)
+        {
+            qint64 secondsSinceEpoch = medicationLabel.dateKey;
+            int days = medicationLabel.days;
 
-            if(!entryFound)
-            {
-                text_label_statistics_item_t m_textLabelStatisticsItem;
-                m_textLabelStatisticsItem.dateSecondsSinceEpoch = secondsSinceEpoch;
-                m_textLabelStatisticsItem.textLabelCount = 1;
-                textLabelsAtCurrentXAxisPosition = 1;
+            // Text Label
 
-                m_textLabelStatistics.push_back(m_textLabelStatisticsItem);
-            }
+            QCPItemText *textLabel = new QCPItemText(ui->customPlot);
+            textLabel->setPositionAlignment(Qt::AlignTop|Qt::AlignHCenter);
+            textLabel->position->setType(QCPItemPosition::ptPlotCoords);
+
+            // Count how many labels are already placed at the current x-axis position. A hash lookup
+            // keeps this constant per label instead of scanning all previously placed labels.
+            unsigned int textLabelsAtCurrentXAxisPosition = ++m_textLabelStatistics[secondsSinceEpoch];
 
             // Place the label in the middle of it's time span.
             textLabel->position->setPixelPosition(QPointF(ui->customPlot->xAxis->coordToPixel(static_cast<double>(secondsSinceEpoch) +
@@ -783,22 +1507,7 @@ void MainWindow::plotVisualization()
                 maxTextLabelsStacked = textLabelsAtCurrentXAxisPosition;
             }
 
-            QString name = "";
-            QString dose = "";
-
-            // Check cells for content before evaluating to avoid nullptr-access.
-
-            if(ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Name")))
-            {
-                name = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Name"))->text();
-            }
-
-            if(ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Dose per Day")))
-            {
-                dose = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Dose per Day"))->text();
-            }
-
-            textLabel->setText(name + "\n" + dose);
+            textLabel->setText(medicationLabel.text);
             textLabel->setPen(QPen(Qt::black));
 
             for(auto i = 0; i < days; i++)
@@ -817,20 +1526,56 @@ void MainWindow::plotVisualization()
 
     ui->customPlot->yAxis->setRange(yAxisMin, yAxisMax);
 
+    // The chemistry axis is aligned with the left axis at 0, below are the medication labels.
+    if(yAxisMax > 0.0)
+    {
+        m_chemistryAxis->setRange(yAxisMin / yAxisMax * chemistryAxisMax, chemistryAxisMax);
+    }
+    else
+    {
+        m_chemistryAxis->setRange(0, chemistryAxisMax);
+    }
+
+    // Restore the range visualized before the session has been switched (only once, later
+    // plots show the whole data again).
+    auto viewState = m_activePatientSession->viewState();
+
+    if(viewState.visualizationRangeValid)
+    {
+        ui->customPlot->xAxis->setRange(viewState.visualizationRange);
+
+        viewState.visualizationRangeValid = false;
+        m_activePatientSession->setViewState(viewState);
+    }
+
     ui->customPlot->replot();
 }
 
 void MainWindow::on_pushButtonAddBloodSample_clicked()
 {
-    ui->tableWidgetBloodSamples->setRowCount(ui->tableWidgetBloodSamples->rowCount() + 1);
+    m_bloodSamplesModel->insertRows(m_bloodSamplesModel->rowCount(), 1);
 
     // Scroll to new added row.
-    ui->tableWidgetBloodSamples->scrollTo(ui->tableWidgetBloodSamples->model()->index(ui->tableWidgetBloodSamples->rowCount() - 1, 0));
+    ui->tableViewBloodSamples->scrollTo(m_bloodSamplesModel->index(m_bloodSamplesModel->rowCount() - 1, 0));
+}
+
+// Saves the active session to its patient data file, only the changes since the last save
+// are written. Sessions without file are saved as new file.
+void MainWindow::on_actionSave_triggered()
+{
+    if(m_activePatientSession->fileName().isEmpty() || m_activePatientSession->isLoading())
+    {
+        on_actionSettingsSaveAs_triggered();
+        return;
+    }
+
+    savePatientDataFile(m_activePatientSession->fileName());
 }
 
 void MainWindow::on_actionSettingsSaveAs_triggered()
 {
-    QFileInfo patientDataFileInfo(m_previousPatientDataFileName);
+    QFileInfo patientDataFileInfo(m_activePatientSession->fileName().isEmpty() ? m_settingsStore.previousPatientDataFileName() :
+                                                                                 m_activePatientSession->fileName());
 
     QString patientDataFileName = QFileDialog::getSaveFileName(this,
                                                                tr("Save File"),
@@ -843,150 +1588,295 @@ void MainWindow::on_actionSettingsSaveAs_triggered()
         return;
     }
 
-    // Collect and write all data to the selected patient data file.
-
-    QJsonDocument patientDataJsonDocument;
-    QJsonObject patientDataJsonObject;
+    savePatientDataFile(patientDataFileName);
+}
 
-    patientDataJsonObject["name"] = ui->lineEditPatientName->text();
-    patientDataJsonObject["dateOfBirth"] = ui->lineEditPatientDateOfBirth->text();
-    patientDataJsonObject["size"] = ui->lineEditPatientSize->text();
-    patientDataJsonObject["weight"] = ui->lineEditPatientWeight->text();
-    patientDataJsonObject["bodySurface"] = ui->lineEditPatientBodySurface->text();
+// Saves the active session to the passed file like "Save As" without the file dialog, e.g. for
+// the benchmark.
+void MainWindow::savePatientDataFileAs(const QString& patientDataFileName)
+{
+    savePatientDataFile(patientDataFileName);
+}
 
-    // Make sure that each cell of the blood samples table contains some text.
-    ensureTableWidgetCellsAreNotNull(*(ui->tableWidgetBloodSamples));
+// Saving merges changes of the file made elsewhere which have not been merged yet, which clears
+// the undo history, so the user is asked first.
+void MainWindow::savePatientDataFile(const QString& patientDataFileName)
+{
+    if(patientDataFileName == m_activePatientSession->fileName() && m_activePatientSession->isFileChangedOnDisk())
+    {
+        auto ret = QMessageBox::question(this,
+                                         "Leuki - Patient Data File Changed",
+                                         "Patient data file " + patientDataFileName + " has been changed elsewhere! Merge these changes and save? The undo history will be cleared! Otherwise, nothing is saved.",
+                                         QMessageBox::Yes|QMessageBox::No);
 
-    QJsonArray bloodSamplesArray;
-    auto bloodSamplesArraySize = ui->tableWidgetBloodSamples->rowCount();
+        if(ret != QMessageBox::Yes)
+        {
+            return;
+        }
+    }
 
-    for(auto i = 0; i < bloodSamplesArraySize; i++)
+    if(!m_activePatientSession->save(patientDataFileName))
     {
-        QJsonObject bloodSamplesJsonObject;
+        QMessageBox::warning(this,
+                             "Leuki - Patient Data File",
+                             "Patient data file " + patientDataFileName + " cannot be written!");
 
-        bloodSamplesJsonObject["date"] = ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Date"))->text();
+        return;
+    }
 
-        bool conversionSuccessful = false;
+    ui->labelPatientDataFile->setText(patientDataFileName);
+    m_settingsStore.setPreviousPatientDataFileName(patientDataFileName);
 
-        bloodSamplesJsonObject["leukocytes"] = ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Leukocytes [Giga/l]"))->text().toDouble(&conversionSuccessful);
+    updatePatientTabs();
+    m_patientFileMonitor.update();
+}
 
-        if(!conversionSuccessful)
-        {
-            bloodSamplesJsonObject["leukocytes"] = "";
-        }
+void MainWindow::on_actionChangesSinceLastSave_triggered()
+{
+    m_changesWindow.showChanges(m_activePatientSession);
+    m_changesWindow.show();
+    m_changesWindow.raise();
+}
 
-        bloodSamplesJsonObject["erythrocytes"] = ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Erythrocytes [Tera/l]"))->text().toDouble(&conversionSuccessful);
+void MainWindow::on_actionOpenPatientDataFile_triggered()
+{
+    // Load patient data from patient data files, each patient is opened in its own tab.
 
-        if(!conversionSuccessful)
-        {
-            bloodSamplesJsonObject["erythrocytes"] = "";
-        }
+    QFileInfo patientDataFileInfo(m_settingsStore.previousPatientDataFileName());
 
-        bloodSamplesJsonObject["hemoglobin"] = ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Hemoglobin [g/dl]"))->text().toDouble(&conversionSuccessful);
+    QStringList patientDataFileNames = QFileDialog::getOpenFileNames(this,
+                                                                     tr("Open Files"),
+                                                                     patientDataFileInfo.absolutePath(),
+                                                                     tr("JSON (*.json)"));
 
-        if(!conversionSuccessful)
-        {
-            bloodSamplesJsonObject["hemoglobin"] = "";
-        }
+    // If the file open dialog has been cancelled by the user, the list is empty.
+    if(!patientDataFileNames.isEmpty())
+    {
+        openPatientDataFiles(patientDataFileNames);
+    }
+}
 
-        bloodSamplesJsonObject["thrombocytes"] = ui->tableWidgetBloodSamples->item(i, tableWidgetBloodSamplesColumns.indexOf("Thrombocytes [Giga/l]"))->text().toDouble(&conversionSuccessful);
+// Opens the passed patient data file like "Open" without the file dialog, e.g. for the
+// benchmark. patientDataFileLoaded() is emitted once it has been loaded.
+void MainWindow::openPatientDataFile(const QString& patientDataFileName)
+{
+    openPatientDataFiles({patientDataFileName});
+}
 
-        if(!conversionSuccessful)
-        {
-            bloodSamplesJsonObject["thrombocytes"] = "";
-        }
+void MainWindow::on_pushButtonPasteBloodSamples_clicked()
+{
+    pasteTableRows(*m_bloodSamplesModel, *(ui->tableViewBloodSamples), true);
+}
 
-        bloodSamplesArray.push_back(bloodSamplesJsonObject);
-    }
+void MainWindow::on_pushButtonPasteChemoAndMeds_clicked()
+{
+    pasteTableRows(*m_chemoAndMedsModel, *(ui->tableViewChemoAndMeds), false);
+}
 
-    patientDataJsonObject["bloodSamples"] = bloodSamplesArray;
+void MainWindow::on_pushButtonAddChemoAndMed_clicked()
+{
+    m_chemoAndMedsModel->insertRows(m_chemoAndMedsModel->rowCount(), 1);
 
-    // Make sure that each cell of the chemo and meds table contains some text.
-    ensureTableWidgetCellsAreNotNull(*(ui->tableWidgetChemoAndMeds));
+    // Scroll to new added row.
+    ui->tableViewChemoAndMeds->scrollTo(m_chemoAndMedsModel->index(m_chemoAndMedsModel->rowCount() - 1, 0));
+}
 
-    QJsonArray chemoAndMedsArray;
-    auto chemoAndMedsArraySize = ui->tableWidgetChemoAndMeds->rowCount();
+// Stores the state of the check box of a blood value under the name of the parameter.
+void MainWindow::parameterCheckBoxStateChanged(int state)
+{
+    auto index = m_parameterCheckBoxes.indexOf(qobject_cast<QCheckBox*>(sender()));
 
-    for(auto i = 0; i < chemoAndMedsArraySize; i++)
+    if(index < 0)
     {
-        QJsonObject chemoAndMedsJsonObject;
+        return;
+    }
 
-        chemoAndMedsJsonObject["date"] = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Date (Start)"))->text();
-        chemoAndMedsJsonObject["name"] = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Name"))->text();
-        chemoAndMedsJsonObject["dose"] = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Dose per Day"))->text();
-        chemoAndMedsJsonObject["days"] = ui->tableWidgetChemoAndMeds->item(i, tableWidgetChemoAndMedsColumns.indexOf("Days"))->text();
+    m_settingsStore.setVisualizationShow(LabParameters::parameters()[index].name, state == Qt::Checked);
+    plotVisualization();
+}
 
-        chemoAndMedsArray.push_back(chemoAndMedsJsonObject);
-    }
+void MainWindow::on_checkBoxVisualizationShowMedicamentationAndChemoTherapy_stateChanged(int arg1)
+{
+    m_settingsStore.setVisualizationShow("MedicamentationAndChemoTherapy", arg1 == Qt::Checked);
+    plotVisualization();
+}
 
-    patientDataJsonObject["chemoTherapyAndMedicamentation"] = chemoAndMedsArray;
+void MainWindow::on_checkBoxVisualizationShowNadirAndRecovery_stateChanged(int arg1)
+{
+    m_settingsStore.setVisualizationShow("NadirAndRecovery", arg1 == Qt::Checked);
+    plotVisualization();
+}
 
-    patientDataJsonDocument.setObject(patientDataJsonObject);
+void MainWindow::on_checkBoxVisualizationShowMovingAverage_stateChanged(int arg1)
+{
+    m_settingsStore.setVisualizationShow("MovingAverage", arg1 == Qt::Checked);
+    showDerivedSeries(DerivedSeries::DERIVED_MOVING_AVERAGE, arg1 == Qt::Checked);
+}
 
-    QFile patientDataFile;
-    patientDataFile.setFileName(patientDataFileName);
-    patientDataFile.open(QIODevice::WriteOnly | QIODevice::Text);
-    patientDataFile.write(patientDataJsonDocument.toJson());
-    patientDataFile.close();
+void MainWindow::on_checkBoxVisualizationShowSmoothed_stateChanged(int arg1)
+{
+    m_settingsStore.setVisualizationShow("Smoothed", arg1 == Qt::Checked);
+    showDerivedSeries(DerivedSeries::DERIVED_SMOOTHED, arg1 == Qt::Checked);
+}
 
-    m_patientDataChangedSinceLastSave = false;
+void MainWindow::on_checkBoxVisualizationShowCumulativeDose_stateChanged(int arg1)
+{
+    m_settingsStore.setVisualizationShow("CumulativeDose", arg1 == Qt::Checked);
+    plotVisualization();
 }
 
-void MainWindow::on_actionOpenPatientDataFile_triggered()
+// Updates the cumulative doses shown if they belong to the active session.
+void MainWindow::cumulativeDosesChanged()
 {
-    // Ask for saving patient data file first if there are unsaved changes.
-    if(m_patientDataChangedSinceLastSave)
+    if(!m_activePatientSession || sender() != m_activePatientSession->doseAccounting())
     {
-        askPatientDataFileSave();
+        return;
     }
 
-    // Load patient data from patient data file.
+    showCumulativeDoses();
+    m_tableDataChangedSinceLastVisualizationPlot = true;
+}
 
-    QFileInfo patientDataFileInfo(m_previousPatientDataFileName);
+void MainWindow::on_checkBoxVisualizationShowSlope_stateChanged(int arg1)
+{
+    m_settingsStore.setVisualizationShow("Slope", arg1 == Qt::Checked);
 
-    QString patientDataFileName = QFileDialog::getOpenFileName(this,
-                                                               tr("Open File"),
-                                                               patientDataFileInfo.absolutePath(),
-                                                               tr("JSON (*.json)"));
+    ui->customPlot->yAxis2->setVisible(arg1 == Qt::Checked);
+    showDerivedSeries(DerivedSeries::DERIVED_SLOPE, arg1 == Qt::Checked);
+}
 
-    // If the file open dialog has been cancelled by the user, file name is "", so length is 0.
-    if(patientDataFileName.length())
+void MainWindow::on_actionOpenFromPatientCatalog_triggered()
+{
+    if(m_settingsStore.settings().patientDataDirectory.isEmpty())
     {
-        loadPatientDataFile(patientDataFileName);
+        QMessageBox::information(this,
+                                 "Leuki - Patient Catalog",
+                                 "Please select the patient data directory in the settings first.");
+
+        return;
     }
+
+    m_patientCatalogWindow.show();
 }
 
-void MainWindow::on_pushButtonAddChemoAndMed_clicked()
+void MainWindow::openPatientDataFileFromCatalog(const QString& patientDataFileName)
 {
-    ui->tableWidgetChemoAndMeds->setRowCount(ui->tableWidgetChemoAndMeds->rowCount() + 1);
-
-    // Scroll to new added row.
-    ui->tableWidgetChemoAndMeds->scrollTo(ui->tableWidgetChemoAndMeds->model()->index(ui->tableWidgetChemoAndMeds->rowCount() - 1, 0));
+    openPatientDataFiles({patientDataFileName});
 }
 
-void MainWindow::on_checkBoxVisualizationShowLeukocytes_stateChanged(int arg1)
+void MainWindow::on_actionCohortQuery_triggered()
 {
-    plotVisualization();
+    if(m_settingsStore.settings().patientDataDirectory.isEmpty())
+    {
+        QMessageBox::information(this,
+                                 "Leuki - Cohort Query",
+                                 "Please select the patient data directory in the settings first.");
+
+        return;
+    }
+
+    m_cohortQueryWindow.show();
 }
 
-void MainWindow::on_checkBoxVisualizationShowErythrocytes_stateChanged(int arg1)
+// Compares the saved patients of all tabs, more patients can be added in the window.
+void MainWindow::on_actionOverlayComparison_triggered()
 {
-    plotVisualization();
+    QStringList patientDataFileNames;
+
+    for(auto patientSession : std::as_const(m_patientSessions))
+    {
+        if(!patientSession->fileName().isEmpty())
+        {
+            patientDataFileNames.append(patientSession->fileName());
+        }
+    }
+
+    comparePatientDataFiles(patientDataFileNames);
 }
 
-void MainWindow::on_checkBoxVisualizationShowHemoglobin_stateChanged(int arg1)
+void MainWindow::comparePatientDataFiles(const QStringList& patientDataFileNames)
 {
-    plotVisualization();
+    m_overlayComparisonWindow.setPatientDataFileNames(patientDataFileNames);
+    m_overlayComparisonWindow.show();
+    m_overlayComparisonWindow.raise();
 }
 
-void MainWindow::on_checkBoxVisualizationShowThrombocytes_stateChanged(int arg1)
+// Imports a lab export into the patient data directory. The export is checked by a dry run
+// first and only imported after the user has seen the report.
+void MainWindow::on_actionImportLabResults_triggered()
 {
-    plotVisualization();
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Import Lab Results"),
+                                                    "",
+                                                    tr("Lab Results (*.csv *.txt)"));
+
+    if(fileName.isEmpty())
+    {
+        return;
+    }
+
+    QString patientDataDirectory = m_settingsStore.settings().patientDataDirectory;
+
+    if(patientDataDirectory.isEmpty())
+    {
+        patientDataDirectory = QFileDialog::getExistingDirectory(this, tr("Select Patient Data Directory"));
+
+        if(patientDataDirectory.isEmpty())
+        {
+            return;
+        }
+    }
+
+    auto dryRunReport = runLabResultImport(fileName, patientDataDirectory, true);
+
+    if(!dryRunReport.successful)
+    {
+        QMessageBox::warning(this, "Leuki - Import Lab Results", LabResultImporter::reportText(dryRunReport, true));
+        return;
+    }
+
+    auto ret = QMessageBox::question(this,
+                                     "Leuki - Import Lab Results",
+                                     LabResultImporter::reportText(dryRunReport, true) + "\nImport the lab results now?",
+                                     QMessageBox::Yes|QMessageBox::No);
+
+    if(ret != QMessageBox::Yes)
+    {
+        return;
+    }
+
+    auto report = runLabResultImport(fileName, patientDataDirectory, false);
+
+    if(report.successful)
+    {
+        for(auto it = report.openPatientRows.constBegin(); it != report.openPatientRows.constEnd(); it++)
+        {
+            labBloodSamplesReceived(it.key(), it.value());
+        }
+    }
+
+    QMessageBox::information(this, "Leuki - Import Lab Results", LabResultImporter::reportText(report, false));
 }
 
-void MainWindow::on_checkBoxVisualizationShowMedicamentationAndChemoTherapy_stateChanged(int arg1)
+// Runs the import on a background thread while a progress dialog is shown.
+LabResultImporter::import_report_t MainWindow::runLabResultImport(const QString& fileName, const QString& patientDataDirectory, bool dryRun)
 {
-    plotVisualization();
+    QProgressDialog progressDialog(dryRun ? "Checking lab results..." : "Importing lab results...", QString(), 0, 0, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+
+    // The import waits for its own tasks on the global thread pool, so it runs on a separate one.
+    QThreadPool importThreadPool;
+    QFutureWatcher<LabResultImporter::import_report_t> importWatcher;
+
+    connect(&importWatcher, &QFutureWatcherBase::finished, &progressDialog, &QProgressDialog::accept);
+
+    importWatcher.setFuture(QtConcurrent::run(&importThreadPool, LabResultImporter::import,
+                                              fileName, patientDataDirectory, dryRun, openPatientIds()));
+
+    progressDialog.exec();
+    importWatcher.waitForFinished();
+
+    return importWatcher.result();
 }
 
 void MainWindow::on_actionSettings_triggered()
@@ -994,97 +1884,206 @@ void MainWindow::on_actionSettings_triggered()
     m_settingsWindow.show();
 }
 
-void MainWindow::on_tableWidgetBloodSamples_cellChanged(int row, int column)
+// Handles a cell change made by the user. Changes made by the application itself (e.g.
+// during patient data file loading) are not reported by the model.
+void MainWindow::bloodSamplesCellChanged(int row, int column)
 {
-    // Check date format, must be dd.MM.yyyy .
-    if(column == tableWidgetBloodSamplesColumns.indexOf("Date"))
-    {
-        handleDateCellChange(*(ui->tableWidgetBloodSamples), row, column);
-    }
+    m_tableDataChangedSinceLastVisualizationPlot = true;
 
-    // If the cell data is not changed by the application itself during patient data
-    // file loading, set the respective flags.
-    if(!m_internalTableModificationsInProgress)
+    if(column == m_bloodSamplesModel->dateColumn())
     {
-        m_tableDataChangedSinceLastVisualizationPlot = true;
-        m_patientDataChangedSinceLastSave = true;
+        handleDateCellChange(*m_bloodSamplesModel, *(ui->tableViewBloodSamples), row);
     }
 }
 
-void MainWindow::on_tableWidgetChemoAndMeds_cellChanged(int row, int column)
+// Handles a cell change made by the user. Changes made by the application itself (e.g.
+// during patient data file loading) are not reported by the model.
+void MainWindow::chemoAndMedsCellChanged(int row, int column)
 {
-    // Check date format, must be dd.MM.yyyy .
-    if(column == tableWidgetChemoAndMedsColumns.indexOf("Date (Start)"))
-    {
-        handleDateCellChange(*(ui->tableWidgetChemoAndMeds), row, column);
-    }
+    m_tableDataChangedSinceLastVisualizationPlot = true;
 
-    // If the cell data is not changed by the application itself during patient data
-    // file loading, set the respective flags.
-    if(!m_internalTableModificationsInProgress)
+    if(column == m_chemoAndMedsModel->dateColumn())
     {
-        m_tableDataChangedSinceLastVisualizationPlot = true;
-        m_patientDataChangedSinceLastSave = true;
+        handleDateCellChange(*m_chemoAndMedsModel, *(ui->tableViewChemoAndMeds), row);
     }
 }
 
 void MainWindow::on_tabWidget_currentChanged(int index)
 {
+    m_settingsStore.setActiveTabIndex(index);
+
     // If visualization tab is clicked, replot if table data has been changed since last plot.
     if(index == tabWidgetTabs.indexOf("Visualization") && m_tableDataChangedSinceLastVisualizationPlot)
     {
         m_tableDataChangedSinceLastVisualizationPlot = false;
         plotVisualization();
     }
+    else if(index == tabWidgetTabs.indexOf("Cycles"))
+    {
+        showCycleSummary();
+    }
+}
+
+void MainWindow::on_lineEditPatientId_textEdited(const QString &arg1)
+{
+    storeGeneralInformationField(&PatientSession::general_information_t::patientId, arg1);
 }
 
 void MainWindow::on_lineEditPatientName_textEdited(const QString &arg1)
 {
-    m_patientDataChangedSinceLastSave = true;
+    storeGeneralInformationField(&PatientSession::general_information_t::name, arg1);
 }
 
 void MainWindow::on_lineEditPatientDateOfBirth_textEdited(const QString &arg1)
 {
-    m_patientDataChangedSinceLastSave = true;
+    storeGeneralInformationField(&PatientSession::general_information_t::dateOfBirth, arg1);
 }
 
 void MainWindow::on_lineEditPatientSize_textEdited(const QString &arg1)
 {
-    m_patientDataChangedSinceLastSave = true;
+    storeGeneralInformationField(&PatientSession::general_information_t::size, arg1);
 }
 
 void MainWindow::on_lineEditPatientWeight_textEdited(const QString &arg1)
 {
-    m_patientDataChangedSinceLastSave = true;
+    storeGeneralInformationField(&PatientSession::general_information_t::weight, arg1);
 }
 
 void MainWindow::on_lineEditPatientBodySurface_textEdited(const QString &arg1)
 {
-    m_patientDataChangedSinceLastSave = true;
+    storeGeneralInformationField(&PatientSession::general_information_t::bodySurface, arg1);
+}
+
+void MainWindow::on_lineEditPatientDateOfDiagnosis_textEdited(const QString &arg1)
+{
+    storeGeneralInformationField(&PatientSession::general_information_t::dateOfDiagnosis, arg1);
+}
+
+// Switching the anchor only changes the labels of the x-axis and moves the visualized range
+// to the anchor, the plotted data is kept.
+void MainWindow::on_comboBoxVisualizationTimeline_activated(int index)
+{
+    applyTimelineAnchor(true);
+
+    ui->customPlot->replot();
 }
 
 void MainWindow::on_pushButtonDeleteSelectedBloodSample_clicked()
 {
-    auto ret = deleteSelectedTableRows(*(ui->tableWidgetBloodSamples));
+    auto ret = deleteSelectedTableRows(*(ui->tableViewBloodSamples));
 
     if(ret)
     {
         m_tableDataChangedSinceLastVisualizationPlot = true;
-        m_patientDataChangedSinceLastSave = true;
     }
 }
 
 void MainWindow::on_pushButtonDeleteSelectedChemoAndMed_clicked()
 {
-    auto ret = deleteSelectedTableRows(*(ui->tableWidgetChemoAndMeds));
+    auto ret = deleteSelectedTableRows(*(ui->tableViewChemoAndMeds));
 
     if(ret)
     {
         m_tableDataChangedSinceLastVisualizationPlot = true;
-        m_patientDataChangedSinceLastSave = true;
     }
 }
 
+void MainWindow::on_actionUndo_triggered()
+{
+    m_activePatientSession->undo();
+
+    showActiveSessionChanges();
+}
+
+void MainWindow::on_actionRedo_triggered()
+{
+    m_activePatientSession->redo();
+
+    showActiveSessionChanges();
+}
+
+// Enables the undo / redo actions for the history of the active session.
+void MainWindow::updateUndoActions()
+{
+    auto undoStack = m_activePatientSession->undoStack();
+
+    ui->actionUndo->setEnabled(m_activePatientSession->canUndo());
+    ui->actionUndo->setText(m_activePatientSession->canUndo() ? "Undo " + undoStack->undoText() : QString("Undo"));
+    ui->actionRedo->setEnabled(undoStack->canRedo());
+    ui->actionRedo->setText(undoStack->canRedo() ? "Redo " + undoStack->redoText() : QString("Redo"));
+}
+
+// Shows the tables of the active session after undo / redo, merged changes of its file or rows
+// pushed by local tools, like after lab results have been merged.
+void MainWindow::showActiveSessionChanges()
+{
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Visualization"))
+    {
+        plotVisualization();
+    }
+    else
+    {
+        m_tableDataChangedSinceLastVisualizationPlot = true;
+    }
+
+    if(ui->tabWidget->currentIndex() == tabWidgetTabs.indexOf("Cycles"))
+    {
+        showCycleSummary();
+    }
+}
+
+// Shows the changes of a patient data file made elsewhere which a session has merged. Only the
+// rows touched are updated in the tables, the visualization is plotted again only if rows have
+// been changed.
+void MainWindow::patientFileChangesMerged(int changedRowCount, int conflictCount, bool generalInformationChanged)
+{
+    auto patientSession = qobject_cast<PatientSession*>(sender());
+
+    if(!m_patientSessions.contains(patientSession))
+    {
+        return;
+    }
+
+    updatePatientTabs();
+
+    QString message = "Changes of " + QFileInfo(patientSession->fileName()).fileName() + " made elsewhere merged: " +
+                      QString::number(changedRowCount) + " rows changed, undo history cleared.";
+
+    if(conflictCount)
+    {
+        message += " " + QString::number(conflictCount) + " entries changed there and here have been kept as changed here.";
+    }
+
+    ui->statusbar->showMessage(message, statusMessageTimeoutMilliseconds);
+
+    if(patientSession != m_activePatientSession)
+    {
+        return;
+    }
+
+    if(generalInformationChanged)
+    {
+        showGeneralInformation();
+    }
+
+    if(changedRowCount)
+    {
+        showActiveSessionChanges();
+    }
+}
+
+// Warns that a patient data file just opened is opened elsewhere (e.g. on another workstation)
+// as well.
+void MainWindow::patientFileOpenedElsewhere(PatientSession *patientSession, const QString& userName, const QString& hostName,
+                                            const QDateTime& since)
+{
+    QMessageBox::warning(this,
+                         "Leuki - Patient Data File",
+                         "Patient data file " + patientSession->fileName() + " has been opened by " +
+                         (userName.isEmpty() ? QString("another user") : userName) + " on " + hostName + " since " +
+                         since.toString("dd.MM.yyyy hh:mm") + "! Changes saved there are merged here, but entries changed at both places keep the changes made here.");
+}
+
 void MainWindow::on_actionAbout_triggered()
 {
     QMessageBox::about(0,
@@ -1094,20 +2093,60 @@ void MainWindow::on_actionAbout_triggered()
 
 void MainWindow::on_pushButtonJumpTopBloodSample_clicked()
 {
-    ui->tableWidgetBloodSamples->scrollTo(ui->tableWidgetBloodSamples->model()->index(0, 0));
+    ui->tableViewBloodSamples->scrollTo(m_bloodSamplesModel->index(0, 0));
 }
 
 void MainWindow::on_pushButtonJumpBottomBloodSample_clicked()
 {
-    ui->tableWidgetBloodSamples->scrollTo(ui->tableWidgetBloodSamples->model()->index(ui->tableWidgetBloodSamples->rowCount() - 1, 0));
+    ui->tableViewBloodSamples->scrollTo(m_bloodSamplesModel->index(m_bloodSamplesModel->rowCount() - 1, 0));
 }
 
 void MainWindow::on_pushButtonJumpTopChemoAndMed_clicked()
 {
-    ui->tableWidgetChemoAndMeds->scrollTo(ui->tableWidgetChemoAndMeds->model()->index(0, 0));
+    ui->tableViewChemoAndMeds->scrollTo(m_chemoAndMedsModel->index(0, 0));
 }
 
 void MainWindow::on_pushButtonJumpBottomChemoAndMed_clicked()
 {
-    ui->tableWidgetChemoAndMeds->scrollTo(ui->tableWidgetChemoAndMeds->model()->index(ui->tableWidgetChemoAndMeds->rowCount() - 1, 0));
+    ui->tableViewChemoAndMeds->scrollTo(m_chemoAndMedsModel->index(m_chemoAndMedsModel->rowCount() - 1, 0));
+}
+
+void MainWindow::on_lineEditSearchChemoAndMeds_textEdited(const QString &arg1)
+{
+    jumpToChemoAndMedSearchMatch(-1);
+}
+
+void MainWindow::on_lineEditSearchChemoAndMeds_returnPressed()
+{
+    jumpToChemoAndMedSearchMatch(ui->tableViewChemoAndMeds->currentIndex().row());
+}
+
+void MainWindow::on_pushButtonFindNextChemoAndMed_clicked()
+{
+    jumpToChemoAndMedSearchMatch(ui->tableViewChemoAndMeds->currentIndex().row());
+}
+
+// Selects the first chemo therapy / medication row after the passed row whose name or dose
+// matches the search text, starting over at the top after the last match.
+void MainWindow::jumpToChemoAndMedSearchMatch(int afterRow)
+{
+    auto rows = m_activePatientSession->medicationIndex()->search(ui->lineEditSearchChemoAndMeds->text());
+
+    if(rows.isEmpty())
+    {
+        ui->labelSearchChemoAndMeds->setText(ui->lineEditSearchChemoAndMeds->text().isEmpty() ? "" : "No matches");
+        return;
+    }
+
+    auto match = std::upper_bound(rows.constBegin(), rows.constEnd(), afterRow);
+
+    if(match == rows.constEnd())
+    {
+        match = rows.constBegin();
+    }
+
+    ui->tableViewChemoAndMeds->selectRow(*match);
+    ui->tableViewChemoAndMeds->scrollTo(m_chemoAndMedsModel->index(*match, 0));
+
+    ui->labelSearchChemoAndMeds->setText("Match " + QString::number(match - rows.constBegin() + 1) + " of " + QString::number(rows.size()));
 }
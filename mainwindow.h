@@ -2,8 +2,27 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QtWidgets/QTableWidget>
+#include <QHash>
+#include <QtWidgets/QCheckBox>
+#include <QtWidgets/QTableView>
+#include <QtWidgets/QTabBar>
+#include <QtWidgets/QLabel>
 #include "settingswindow.h"
+#include "changeswindow.h"
+#include "patientcatalogwindow.h"
+#include "cohortquerywindow.h"
+#include "overlaycomparisonwindow.h"
+#include "settingsstore.h"
+#include "autosave.h"
+#include "patientfilemonitor.h"
+#include "patienttablemodel.h"
+#include "patientdatafile.h"
+#include "patientsession.h"
+#include "tablecolumnsizer.h"
+#include "relativedayaxisticker.h"
+#include "labinbox.h"
+#include "ipcserver.h"
+#include "labresultimporter.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -17,34 +36,88 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     void initializeAfterShowing();
+    void openPatientDataFile(const QString& patientDataFileName);
+    void savePatientDataFileAs(const QString& patientDataFileName);
+
+signals:
+    void patientDataFileLoaded(bool successful);
 
 private slots:
     void on_pushButtonAddBloodSample_clicked();
 
+    void on_actionSave_triggered();
+
     void on_actionSettingsSaveAs_triggered();
 
+    void on_actionChangesSinceLastSave_triggered();
+
     void on_actionOpenPatientDataFile_triggered();
 
-    void on_pushButtonAddChemoAndMed_clicked();
+    void on_actionOpenFromPatientCatalog_triggered();
+
+    void openPatientDataFileFromCatalog(const QString& patientDataFileName);
 
-    void on_checkBoxVisualizationShowLeukocytes_stateChanged(int arg1);
+    void on_actionCohortQuery_triggered();
 
-    void on_checkBoxVisualizationShowErythrocytes_stateChanged(int arg1);
+    void on_actionOverlayComparison_triggered();
 
-    void on_checkBoxVisualizationShowHemoglobin_stateChanged(int arg1);
+    void comparePatientDataFiles(const QStringList& patientDataFileNames);
 
-    void on_checkBoxVisualizationShowThrombocytes_stateChanged(int arg1);
+    void on_pushButtonAddChemoAndMed_clicked();
+
+    void on_pushButtonPasteBloodSamples_clicked();
+
+    void on_pushButtonPasteChemoAndMeds_clicked();
+
+    void parameterCheckBoxStateChanged(int state);
 
     void on_checkBoxVisualizationShowMedicamentationAndChemoTherapy_stateChanged(int arg1);
 
+    void on_checkBoxVisualizationShowNadirAndRecovery_stateChanged(int arg1);
+
+    void on_checkBoxVisualizationShowMovingAverage_stateChanged(int arg1);
+
+    void on_checkBoxVisualizationShowSmoothed_stateChanged(int arg1);
+
+    void on_checkBoxVisualizationShowSlope_stateChanged(int arg1);
+
+    void on_checkBoxVisualizationShowCumulativeDose_stateChanged(int arg1);
+
+    void cumulativeDosesChanged();
+
+    void on_actionImportLabResults_triggered();
+
     void on_actionSettings_triggered();
 
-    void on_tableWidgetBloodSamples_cellChanged(int row, int column);
+    void bloodSamplesCellChanged(int row, int column);
+
+    void chemoAndMedsCellChanged(int row, int column);
+
+    void updateValidationStatus();
+
+    void applySettings(const SettingsWindow::settings_t& settings);
 
-    void on_tableWidgetChemoAndMeds_cellChanged(int row, int column);
+    void labBloodSamplesReceived(const QString& patientId, const QVector<QVector<QString>>& rows);
+
+    void labInboxScanFinished(int ingestedFileCount, const QStringList& updatedPatientDataFileNames,
+                              const QStringList& unknownPatientIds, int failedFileCount);
+
+    void ipcBatchReceived(const QVector<IpcServer::request_t>& requests);
+
+    void patientSessionLoaded(bool successful);
+
+    void patientTabChanged(int index);
+
+    void patientTabCloseRequested(int index);
+
+    void updatePatientTabs();
+
+    void restoreTableScrollPositions();
 
     void on_tabWidget_currentChanged(int index);
 
+    void on_lineEditPatientId_textEdited(const QString &arg1);
+
     void on_lineEditPatientName_textEdited(const QString &arg1);
 
     void on_lineEditPatientDateOfBirth_textEdited(const QString &arg1);
@@ -55,10 +128,27 @@ private slots:
 
     void on_lineEditPatientBodySurface_textEdited(const QString &arg1);
 
+    void on_lineEditPatientDateOfDiagnosis_textEdited(const QString &arg1);
+
+    void on_comboBoxVisualizationTimeline_activated(int index);
+
     void on_pushButtonDeleteSelectedBloodSample_clicked();
 
     void on_pushButtonDeleteSelectedChemoAndMed_clicked();
 
+    void on_actionUndo_triggered();
+
+    void on_actionRedo_triggered();
+
+    void updateUndoActions();
+
+    void patientGeneralInformationChanged();
+
+    void patientFileChangesMerged(int changedRowCount, int conflictCount, bool generalInformationChanged);
+
+    void patientFileOpenedElsewhere(PatientSession *patientSession, const QString& userName, const QString& hostName,
+                                    const QDateTime& since);
+
     void on_actionAbout_triggered();
 
     void on_pushButtonJumpTopBloodSample_clicked();
@@ -69,30 +159,82 @@ private slots:
 
     void on_pushButtonJumpBottomChemoAndMed_clicked();
 
+    void on_lineEditSearchChemoAndMeds_textEdited(const QString &arg1);
+
+    void on_lineEditSearchChemoAndMeds_returnPressed();
+
+    void on_pushButtonFindNextChemoAndMed_clicked();
+
 private:
     Ui::MainWindow *ui;
-    QString m_previousPatientDataFileName;
     SettingsWindow m_settingsWindow;
+    PatientCatalogWindow m_patientCatalogWindow;
+    CohortQueryWindow m_cohortQueryWindow;
+    OverlayComparisonWindow m_overlayComparisonWindow;
+    ChangesWindow m_changesWindow;
+    SettingsStore m_settingsStore;
+    Autosave m_autosave;
+    PatientFileMonitor m_patientFileMonitor;
+    LabInbox m_labInbox;
+    IpcServer m_ipcServer;
     bool m_tableDataChangedSinceLastVisualizationPlot;
-    bool m_patientDataChangedSinceLastSave;
-    bool m_internalTableModificationsInProgress;
-
-    typedef struct
-    {
-        int dateSecondsSinceEpoch;
-        unsigned int textLabelCount;
-    } text_label_statistics_item_t;
-
-    std::vector<text_label_statistics_item_t> m_textLabelStatistics;
-
-    void loadPatientDataFile(QString&);
-    void saveSettingsFile();
-    void ensureTableWidgetCellsAreNotNull(QTableWidget&);
-    qsizetype deleteSelectedTableRows(QTableWidget&);
-    void sortEditedTableRow(QTableWidget&, int, int);
-    bool checkDateFormat(QString);
-    void handleDateCellChange(QTableWidget&, int, int);
+    QTabBar *m_patientTabBar;
+    QVector<PatientSession*> m_patientSessions;
+    PatientSession *m_activePatientSession;
+
+    // Models of the active patient session, shown by the table views.
+    PatientTableModel *m_bloodSamplesModel;
+    PatientTableModel *m_chemoAndMedsModel;
+    TableColumnSizer *m_bloodSamplesColumnSizer;
+    TableColumnSizer *m_chemoAndMedsColumnSizer;
+    QLabel *m_validationStatusLabel;
+
+    // Graphs of the derived series per DerivedSeries::derived_t, shown or hidden by the
+    // visualization check boxes without plotting again.
+    QVector<QVector<QCPGraph*>> m_derivedSeriesGraphs;
+
+    // Visualization check boxes of the blood values in the order of LabParameters::parameters().
+    QVector<QCheckBox*> m_parameterCheckBoxes;
+
+    // Right axis of the blood values of PatientDataSchema::AXIS_CHEMISTRY.
+    QCPAxis *m_chemistryAxis;
+
+    // Right axis of the cumulative doses in percent of the lifetime limits.
+    QCPAxis *m_cumulativeDoseAxis;
+
+    // Tickers of the x-axis showing dates or days relative to the chosen anchor.
+    QSharedPointer<QCPAxisTickerDateTime> m_dateTicker;
+    QSharedPointer<RelativeDayAxisTicker> m_relativeDayTicker;
+
+    // Number of text labels stacked at each x-axis position (seconds since epoch).
+    QHash<qint64, unsigned int> m_textLabelStatistics;
+
+    PatientSession* addPatientSession();
+    PatientSession* patientSessionOfFile(const QString& patientDataFileName) const;
+    void openPatientDataFiles(const QStringList& patientDataFileNames);
+    void activatePatientSession(PatientSession *patientSession);
+    void closePatientSession(int index);
+    void showGeneralInformation();
+    void storeGeneralInformationField(QString PatientSession::general_information_t::*field, const QString& text);
+    QSet<QString> openPatientIds() const;
+    void setTableModel(QTableView& tableView, TableColumnSizer& columnSizer, PatientTableModel *model);
+    qsizetype deleteSelectedTableRows(QTableView&);
+    void handleDateCellChange(PatientTableModel&, QTableView&, int);
+    void pasteTableRows(PatientTableModel&, QTableView&, bool);
+    void jumpToChemoAndMedSearchMatch(int afterRow);
+    int mergeLabBloodSamples(PatientSession *patientSession, const QVector<QVector<QString>>& rows);
+    PatientSession* ipcPatientSession(const QString& patientId) const;
+    QJsonArray ipcPatientList() const;
+    LabResultImporter::import_report_t runLabResultImport(const QString& fileName, const QString& patientDataDirectory, bool dryRun);
     void askPatientDataFileSave();
+    void recoverPatientSessions();
+    void savePatientDataFile(const QString& patientDataFileName);
+    void showCycleSummary();
+    void showCumulativeDoses();
+    void showDerivedSeries(DerivedSeries::derived_t derived, bool show);
+    void updateTimelineAnchors();
+    void applyTimelineAnchor(bool moveToAnchor);
     void plotVisualization();
+    void showActiveSessionChanges();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,262 @@
+#include "medicationindex.h"
+#include <algorithm>
+
+MedicationIndex::MedicationIndex(PatientTableModel *model, const QVector<int>& columns, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_columns(columns)
+    , m_valid(false)
+{
+    connect(m_model, &QAbstractItemModel::dataChanged, this, &MedicationIndex::handleDataChanged);
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &MedicationIndex::handleRowsInserted);
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, &MedicationIndex::handleRowsRemoved);
+    connect(m_model, &QAbstractItemModel::rowsMoved, this, &MedicationIndex::handleRowsMoved);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &MedicationIndex::invalidate);
+}
+
+// Returns the rows (ascending) containing a word starting with each word of the passed text.
+QVector<int> MedicationIndex::search(const QString& text)
+{
+    QVector<int> rows;
+    const auto searchTokens = tokens(text);
+
+    if(searchTokens.isEmpty() || !m_model)
+    {
+        return rows;
+    }
+
+    if(!m_valid)
+    {
+        rebuild();
+    }
+
+    const auto& postings = m_postings;
+    QSet<int> found;
+
+    for(auto i = 0; i < searchTokens.size(); i++)
+    {
+        QSet<int> tokenRows;
+
+        // The words are sorted, so the words with the prefix follow each other.
+        for(auto it = postings.lowerBound(searchTokens[i]); it != postings.constEnd() && it.key().startsWith(searchTokens[i]); it++)
+        {
+            tokenRows.unite(it.value());
+        }
+
+        if(i == 0)
+        {
+            found = tokenRows;
+        }
+        else
+        {
+            found.intersect(tokenRows);
+        }
+    }
+
+    rows = QVector<int>(found.begin(), found.end());
+    std::sort(rows.begin(), rows.end());
+
+    return rows;
+}
+
+// Splits the passed text into words of letters and digits, folded by fold(). Decimal
+// separators within numbers are kept, e.g. doses like "1.5" stay one word.
+QStringList MedicationIndex::tokens(const QString& text)
+{
+    QStringList tokens;
+    QString token;
+    const auto foldedText = fold(text);
+
+    for(const auto& c : foldedText)
+    {
+        if(c.isLetterOrNumber() || ((c == '.' || c == ',') && !token.isEmpty() && token.back().isDigit()))
+        {
+            token += c;
+        }
+        else if(!token.isEmpty())
+        {
+            tokens.append(token);
+            token.clear();
+        }
+    }
+
+    if(!token.isEmpty())
+    {
+        tokens.append(token);
+    }
+
+    return tokens;
+}
+
+// Case folds the passed text and removes accents, e.g. "Étoposid" becomes "etoposid".
+QString MedicationIndex::fold(const QString& text)
+{
+    QString folded;
+    const auto decomposedText = text.normalized(QString::NormalizationForm_KD);
+
+    folded.reserve(decomposedText.size());
+
+    for(const auto& c : decomposedText)
+    {
+        if(c.category() != QChar::Mark_NonSpacing)
+        {
+            folded += c;
+        }
+    }
+
+    return folded.toCaseFolded();
+}
+
+// Re-indexes the rows of edited cells.
+void MedicationIndex::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(!m_valid || !topLeft.isValid() || !bottomRight.isValid())
+    {
+        return;
+    }
+
+    for(auto row = topLeft.row(); row <= bottomRight.row(); row++)
+    {
+        unindexRow(row);
+        indexRow(row);
+    }
+}
+
+// Indexes the inserted rows, the rows behind them move down.
+void MedicationIndex::handleRowsInserted(const QModelIndex &, int first, int last)
+{
+    if(!m_valid)
+    {
+        return;
+    }
+
+    auto count = last - first + 1;
+
+    unpostRows(first, m_rowTokens.size() - 1);
+    m_rowTokens.insert(first, count, QStringList());
+    postRows(last + 1, m_rowTokens.size() - 1);
+
+    for(auto row = first; row <= last; row++)
+    {
+        indexRow(row);
+    }
+}
+
+// The words of the removed rows are still known, the rows behind them move up.
+void MedicationIndex::handleRowsRemoved(const QModelIndex &, int first, int last)
+{
+    if(!m_valid)
+    {
+        return;
+    }
+
+    unpostRows(first, m_rowTokens.size() - 1);
+    m_rowTokens.remove(first, last - first + 1);
+    postRows(first, m_rowTokens.size() - 1);
+}
+
+// Moving rows (i.e. sorting an edited date) only changes the row numbers between the old and
+// the new position.
+void MedicationIndex::handleRowsMoved(const QModelIndex &, int sourceStart, int sourceEnd,
+                                      const QModelIndex &, int destinationRow)
+{
+    if(!m_valid)
+    {
+        return;
+    }
+
+    auto count = sourceEnd - sourceStart + 1;
+    auto firstAffectedRow = std::min(sourceStart, destinationRow);
+    auto lastAffectedRow = std::max(sourceEnd, destinationRow - 1);
+
+    unpostRows(firstAffectedRow, lastAffectedRow);
+
+    auto movedRowTokens = m_rowTokens.mid(sourceStart, count);
+
+    m_rowTokens.remove(sourceStart, count);
+
+    auto insertRow = destinationRow > sourceStart ? destinationRow - count : destinationRow;
+
+    for(auto i = 0; i < count; i++)
+    {
+        m_rowTokens.insert(insertRow + i, movedRowTokens[i]);
+    }
+
+    postRows(firstAffectedRow, lastAffectedRow);
+}
+
+void MedicationIndex::invalidate()
+{
+    m_valid = false;
+}
+
+void MedicationIndex::rebuild()
+{
+    m_postings.clear();
+    m_rowTokens.clear();
+    m_rowTokens.resize(m_model->rowCount());
+
+    for(auto row = 0; row < m_rowTokens.size(); row++)
+    {
+        indexRow(row);
+    }
+
+    m_valid = true;
+}
+
+void MedicationIndex::indexRow(int row)
+{
+    QStringList rowTokens;
+
+    for(auto column : m_columns)
+    {
+        rowTokens += tokens(m_model->text(row, column));
+    }
+
+    rowTokens.removeDuplicates();
+
+    for(const auto& token : rowTokens)
+    {
+        m_postings[token].insert(row);
+    }
+
+    m_rowTokens[row] = rowTokens;
+}
+
+void MedicationIndex::unindexRow(int row)
+{
+    unpostRows(row, row);
+
+    m_rowTokens[row].clear();
+}
+
+// Adds the passed rows to the postings of their words.
+void MedicationIndex::postRows(int first, int last)
+{
+    for(auto row = first; row <= last; row++)
+    {
+        for(const auto& token : std::as_const(m_rowTokens[row]))
+        {
+            m_postings[token].insert(row);
+        }
+    }
+}
+
+// Removes the passed rows from the postings of their words, their words are kept.
+void MedicationIndex::unpostRows(int first, int last)
+{
+    for(auto row = first; row <= last; row++)
+    {
+        for(const auto& token : std::as_const(m_rowTokens[row]))
+        {
+            auto it = m_postings.find(token);
+
+            it.value().remove(row);
+
+            if(it.value().isEmpty())
+            {
+                m_postings.erase(it);
+            }
+        }
+    }
+}
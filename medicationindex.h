@@ -0,0 +1,53 @@
+#ifndef MEDICATIONINDEX_H
+#define MEDICATIONINDEX_H
+
+#include <QObject>
+#include <QMap>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include "patienttablemodel.h"
+
+// Inverted index over the words of text columns of a table model (e.g. the medication names
+// and doses), searched case and accent insensitively by word prefixes. Edited and inserted
+// rows are indexed at once, the rows behind inserted, removed and moved rows keep their words
+// and only change their row numbers in the postings. A reset of the model rebuilds the index
+// with the next search.
+class MedicationIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MedicationIndex(PatientTableModel *model, const QVector<int>& columns, QObject *parent = nullptr);
+
+    QVector<int> search(const QString& text);
+
+    static QStringList tokens(const QString& text);
+    static QString fold(const QString& text);
+
+private slots:
+    void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void handleRowsInserted(const QModelIndex &parent, int first, int last);
+    void handleRowsRemoved(const QModelIndex &parent, int first, int last);
+    void handleRowsMoved(const QModelIndex &sourceParent, int sourceStart, int sourceEnd,
+                         const QModelIndex &destinationParent, int destinationRow);
+    void invalidate();
+
+private:
+    QPointer<PatientTableModel> m_model;
+    QVector<int> m_columns;
+
+    // Rows containing each word, the words of each row.
+    QMap<QString, QSet<int>> m_postings;
+    QVector<QStringList> m_rowTokens;
+    bool m_valid;
+
+    void rebuild();
+    void indexRow(int row);
+    void unindexRow(int row);
+    void postRows(int first, int last);
+    void unpostRows(int first, int last);
+};
+
+#endif // MEDICATIONINDEX_H
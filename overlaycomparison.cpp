@@ -0,0 +1,251 @@
+#include "overlaycomparison.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "patienttablemodel.h"
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const static double secondsPerDay = 24.0 * 3600.0;
+
+OverlayComparison::OverlayComparison(QObject *parent)
+    : QObject(parent)
+    , m_comparePending(false)
+{
+    m_result.skippedCount = 0;
+
+    connect(&m_compareWatcher, &QFutureWatcher<result_t>::finished, this, &OverlayComparison::handleCompareResult);
+
+    // Comparisons run one after the other, the files of a comparison are read in parallel.
+    m_threadPool.setMaxThreadCount(1);
+}
+
+OverlayComparison::~OverlayComparison()
+{
+    m_threadPool.waitForDone();
+}
+
+// Compares the passed patients in the background, compared() is emitted when done.
+void OverlayComparison::compare(const QStringList& patientDataFileNames, const query_t& query)
+{
+    if(m_compareWatcher.isRunning())
+    {
+        m_comparePending = true;
+        m_pendingPatientDataFileNames = patientDataFileNames;
+        m_pendingQuery = query;
+
+        return;
+    }
+
+    m_compareWatcher.setFuture(QtConcurrent::run(&m_threadPool, runComparison, patientDataFileNames, query));
+}
+
+bool OverlayComparison::isComparing() const
+{
+    return m_compareWatcher.isRunning();
+}
+
+const OverlayComparison::result_t& OverlayComparison::result() const
+{
+    return m_result;
+}
+
+void OverlayComparison::handleCompareResult()
+{
+    if(m_comparePending)
+    {
+        m_comparePending = false;
+        compare(m_pendingPatientDataFileNames, m_pendingQuery);
+
+        return;
+    }
+
+    m_result = m_compareWatcher.result();
+
+    emit compared();
+}
+
+// Runs on the worker thread: resamples all patients in parallel and computes the statistics
+// of each day over the pool.
+OverlayComparison::result_t OverlayComparison::runComparison(const QStringList& patientDataFileNames, const query_t& query)
+{
+    result_t result;
+
+    auto resampleFunction = [query](const QString& patientDataFileName)
+    {
+        return resamplePatient(patientDataFileName, query);
+    };
+
+    const auto patientCurves = QtConcurrent::blockingMapped<QVector<patient_curve_t>>(patientDataFileNames, resampleFunction);
+    const auto dayCount = query.daysBefore + query.daysAfter + 1;
+
+    for(auto day = -query.daysBefore; day <= query.daysAfter; day++)
+    {
+        result.days.append(day);
+    }
+
+    result.skippedCount = 0;
+
+    for(const auto& patientCurve : patientCurves)
+    {
+        if(!patientCurve.valid)
+        {
+            result.skippedCount++;
+            continue;
+        }
+
+        result.names.append(patientCurve.name);
+        result.pool += patientCurve.values;
+    }
+
+    const auto patientCount = static_cast<int>(result.names.size());
+    QVector<double> dayValues;
+
+    dayValues.reserve(patientCount);
+
+    for(auto day = 0; day < dayCount; day++)
+    {
+        dayValues.clear();
+
+        for(auto patient = 0; patient < patientCount; patient++)
+        {
+            auto value = result.pool[patient * dayCount + day];
+
+            if(!std::isnan(value))
+            {
+                dayValues.append(value);
+            }
+        }
+
+        result.medians.append(percentile(dayValues, 0.5));
+        result.lowerQuartiles.append(percentile(dayValues, 0.25));
+        result.upperQuartiles.append(percentile(dayValues, 0.75));
+    }
+
+    return result;
+}
+
+// Runs on a worker thread: reads a patient data file and resamples the values of the queried
+// blood value to the days around the protocol start. Values between two samples are
+// interpolated linearly, there are no values before the first and after the last sample.
+OverlayComparison::patient_curve_t OverlayComparison::resamplePatient(const QString& patientDataFileName, const query_t& query)
+{
+    patient_curve_t patientCurve;
+    PatientDataFile::patient_data_t patientData;
+
+    patientCurve.valid = false;
+
+    if(!PatientDataFile::load(patientDataFileName, patientData))
+    {
+        return patientCurve;
+    }
+
+    // The protocol starts with the earliest matching chemo therapy / medication.
+    auto chemoAndMedsDateKeys = PatientTableModel::parseDates(patientData.chemoAndMeds, PatientDataSchema::chemoAndMedsDateColumn);
+    auto startKey = std::numeric_limits<qint64>::max();
+
+    for(auto i = 0; i < chemoAndMedsDateKeys.size(); i++)
+    {
+        if(chemoAndMedsDateKeys[i] != PatientTableModel::invalidDateKey &&
+           patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsNameColumn][i].contains(query.protocol, Qt::CaseInsensitive))
+        {
+            startKey = std::min(startKey, chemoAndMedsDateKeys[i]);
+        }
+    }
+
+    if(startKey == std::numeric_limits<qint64>::max())
+    {
+        return patientCurve;
+    }
+
+    // Samples as (day relative to the start, value), sorted by day.
+    auto bloodSamplesDateKeys = PatientTableModel::parseDates(patientData.bloodSamples, PatientDataSchema::bloodSamplesDateColumn);
+    const auto& columnTexts = patientData.bloodSamples[query.parameterColumn];
+    QVector<QPair<int, double>> samples;
+
+    for(auto i = 0; i < bloodSamplesDateKeys.size(); i++)
+    {
+        bool conversionSuccessful = false;
+        double value = columnTexts[i].toDouble(&conversionSuccessful);
+
+        if(bloodSamplesDateKeys[i] != PatientTableModel::invalidDateKey && conversionSuccessful)
+        {
+            samples.append(qMakePair(static_cast<int>(std::lround((bloodSamplesDateKeys[i] - startKey) / secondsPerDay)), value));
+        }
+    }
+
+    std::stable_sort(samples.begin(), samples.end(), [](const QPair<int, double>& a, const QPair<int, double>& b)
+    {
+        return a.first < b.first;
+    });
+
+    patientCurve.values.fill(std::numeric_limits<double>::quiet_NaN(), query.daysBefore + query.daysAfter + 1);
+
+    auto sample = 0;
+
+    for(auto day = -query.daysBefore; day <= query.daysAfter; day++)
+    {
+        // Last sample not after the day.
+        while(sample + 1 < samples.size() && samples[sample + 1].first <= day)
+        {
+            sample++;
+        }
+
+        if(samples.isEmpty() || samples[sample].first > day)
+        {
+            continue;
+        }
+
+        double value;
+
+        if(samples[sample].first == day || sample + 1 == samples.size())
+        {
+            // Samples of the same day are represented by the last one, there are no values
+            // after the last sample.
+            if(samples[sample].first != day)
+            {
+                continue;
+            }
+
+            value = samples[sample].second;
+        }
+        else
+        {
+            const auto& previous = samples[sample];
+            const auto& next = samples[sample + 1];
+
+            value = previous.second + (next.second - previous.second) * (day - previous.first) / (next.first - previous.first);
+        }
+
+        patientCurve.values[day + query.daysBefore] = value;
+    }
+
+    patientCurve.name = patientData.name.isEmpty() ? QFileInfo(patientDataFileName).completeBaseName() : patientData.name;
+    patientCurve.valid = true;
+
+    return patientCurve;
+}
+
+// Returns the passed percentile (0..1) of the values with linear interpolation, NaN if there
+// are no values. Reorders the values.
+double OverlayComparison::percentile(QVector<double>& values, double fraction)
+{
+    if(values.isEmpty())
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    auto position = fraction * (values.size() - 1);
+    auto lower = static_cast<int>(std::floor(position));
+    auto upper = std::min(lower + 1, static_cast<int>(values.size()) - 1);
+
+    std::nth_element(values.begin(), values.begin() + lower, values.end());
+    double lowerValue = values[lower];
+
+    std::nth_element(values.begin() + lower, values.begin() + upper, values.end());
+    double upperValue = values[upper];
+
+    return lowerValue + (upperValue - lowerValue) * (position - lower);
+}
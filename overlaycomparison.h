@@ -0,0 +1,89 @@
+#ifndef OVERLAYCOMPARISON_H
+#define OVERLAYCOMPARISON_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+// Comparison of a blood value across several patients, aligned to the start of a protocol
+// (the first chemo therapy / medication matching a name). The patient data files are read
+// and resampled in parallel to a common daily grid, so that all curves share the same days
+// and are stored in one pool, one row of values per patient. The median and the quartiles of
+// each day are computed over the pool.
+class OverlayComparison : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        // Blood value column (in the column order of the blood sample table).
+        int parameterColumn;
+
+        // Case insensitive part of the chemo therapy / medication name, empty for the first
+        // chemo therapy / medication of each patient.
+        QString protocol;
+
+        int daysBefore;
+        int daysAfter;
+    } query_t;
+
+    typedef struct
+    {
+        // Days relative to the protocol start (0 is the start day).
+        QVector<double> days;
+
+        QStringList names;
+
+        // Values of all patients, days.size() values per patient in the order of names. NaN
+        // where a patient has no value, i.e. before the first or after the last sample.
+        QVector<double> pool;
+
+        // Per day, NaN if no patient has a value.
+        QVector<double> medians;
+        QVector<double> lowerQuartiles;
+        QVector<double> upperQuartiles;
+
+        // Patients whose file cannot be read or who did not receive the protocol.
+        int skippedCount;
+    } result_t;
+
+    explicit OverlayComparison(QObject *parent = nullptr);
+    ~OverlayComparison();
+
+    void compare(const QStringList& patientDataFileNames, const query_t& query);
+    bool isComparing() const;
+    const result_t& result() const;
+
+signals:
+    void compared();
+
+private slots:
+    void handleCompareResult();
+
+private:
+    typedef struct
+    {
+        bool valid;
+        QString name;
+        QVector<double> values;
+    } patient_curve_t;
+
+    result_t m_result;
+    QThreadPool m_threadPool;
+    QFutureWatcher<result_t> m_compareWatcher;
+
+    // Comparison requested while another one is running, started when that has finished.
+    bool m_comparePending;
+    QStringList m_pendingPatientDataFileNames;
+    query_t m_pendingQuery;
+
+    static result_t runComparison(const QStringList& patientDataFileNames, const query_t& query);
+    static patient_curve_t resamplePatient(const QString& patientDataFileName, const query_t& query);
+    static double percentile(QVector<double>& values, double fraction);
+};
+
+#endif // OVERLAYCOMPARISON_H
@@ -0,0 +1,253 @@
+#include "overlaycomparisonwindow.h"
+#include "ui_overlaycomparisonwindow.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "relativedayaxisticker.h"
+#include "cycleanalysis.h"
+#include <QFileDialog>
+#include <cmath>
+
+const static double secondsPerDay = 24.0 * 3600.0;
+
+// Quantiles of the band of all patients of the directory.
+const static double cohortBandLowerFraction = 0.1;
+const static double cohortBandUpperFraction = 0.9;
+
+OverlayComparisonWindow::OverlayComparisonWindow(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::OverlayComparisonWindow),
+    m_parameterColumn(PatientDataSchema::labParameterColumns[0])
+{
+    ui->setupUi(this);
+
+    // All blood values can be compared, i.e. all columns except the date.
+    for(auto column : PatientDataSchema::labParameterColumns)
+    {
+        ui->comboBoxParameter->addItem(PatientDataFile::bloodSamplesColumns[column], column);
+    }
+
+    // Days are counted from the protocol start as in the visualization, the start is day 1.
+    QSharedPointer<RelativeDayAxisTicker> relativeDayTicker(new RelativeDayAxisTicker);
+    relativeDayTicker->setAnchorKey(0);
+
+    ui->customPlot->xAxis->setTicker(relativeDayTicker);
+    ui->customPlot->xAxis->setLabel("Day of Protocol");
+    ui->customPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+
+    // The curves are built before they are plotted.
+    connect(&m_overlayComparison, &OverlayComparison::compared, this, &OverlayComparisonWindow::updatePatientCurves);
+    connect(&m_overlayComparison, &OverlayComparison::compared, this, &OverlayComparisonWindow::plotComparison);
+    connect(&m_cohortBands, &CohortBands::built, this, &OverlayComparisonWindow::plotComparison);
+
+    showStatus();
+}
+
+OverlayComparisonWindow::~OverlayComparisonWindow()
+{
+    delete ui;
+}
+
+void OverlayComparisonWindow::setDirectory(const QString& directory)
+{
+    m_directory = directory;
+    m_cohortBands.setDirectory(directory);
+}
+
+void OverlayComparisonWindow::setPatientDataFileNames(const QStringList& patientDataFileNames)
+{
+    m_patientDataFileNames = patientDataFileNames;
+    m_patientDataFileNames.removeDuplicates();
+    m_compareStatus.clear();
+
+    showStatus();
+}
+
+// The cohort bands are brought up to date in the background whenever the window is shown.
+void OverlayComparisonWindow::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+
+    m_cohortBands.build();
+
+    showStatus();
+}
+
+void OverlayComparisonWindow::on_pushButtonAddPatients_clicked()
+{
+    auto patientDataFileNames = QFileDialog::getOpenFileNames(this,
+                                                              tr("Add Patients"),
+                                                              m_directory,
+                                                              tr("JSON (*.json)"));
+
+    setPatientDataFileNames(m_patientDataFileNames + patientDataFileNames);
+}
+
+void OverlayComparisonWindow::on_pushButtonClear_clicked()
+{
+    setPatientDataFileNames({});
+}
+
+void OverlayComparisonWindow::on_pushButtonCompare_clicked()
+{
+    OverlayComparison::query_t query;
+
+    query.parameterColumn = ui->comboBoxParameter->currentData().toInt();
+    query.protocol = ui->lineEditProtocol->text().trimmed();
+    query.daysBefore = ui->spinBoxDaysBefore->value();
+    query.daysAfter = ui->spinBoxDaysAfter->value();
+
+    m_parameterColumn = query.parameterColumn;
+    ui->customPlot->yAxis->setLabel(ui->comboBoxParameter->currentText());
+
+    m_compareTimer.start();
+    m_overlayComparison.compare(m_patientDataFileNames, query);
+
+    showStatus();
+}
+
+void OverlayComparisonWindow::on_checkBoxCohortBand_toggled(bool)
+{
+    plotComparison();
+}
+
+// Builds the curve of each patient from its row of the pool of the comparison. Days without a
+// value, i.e. before the first and after the last sample of a patient, are left out.
+void OverlayComparisonWindow::updatePatientCurves()
+{
+    const auto& result = m_overlayComparison.result();
+    const auto dayCount = static_cast<int>(result.days.size());
+
+    m_patientCurves.clear();
+    m_patientCurves.reserve(result.names.size());
+
+    for(auto patient = 0; patient < result.names.size(); patient++)
+    {
+        QVector<QCPGraphData> data;
+        data.reserve(dayCount);
+
+        for(auto day = 0; day < dayCount; day++)
+        {
+            auto value = result.pool[patient * dayCount + day];
+
+            if(!std::isnan(value))
+            {
+                data.append(QCPGraphData(result.days[day] * secondsPerDay, value));
+            }
+        }
+
+        QSharedPointer<QCPGraphDataContainer> curve(new QCPGraphDataContainer);
+        curve->set(data, true);
+
+        m_patientCurves.append(curve);
+    }
+}
+
+// Plots the curves of all patients thin and translucent behind the median and the band between
+// the quartiles. The graphs of the patients share the curves built by updatePatientCurves(), so
+// plotting again copies no values. The band of all patients of the directory is drawn behind
+// everything, aligned with the cycle day of its sketches (day 1 is the protocol start).
+void OverlayComparisonWindow::plotComparison()
+{
+    const auto& result = m_overlayComparison.result();
+    const auto dayCount = static_cast<int>(result.days.size());
+
+    ui->customPlot->clearGraphs();
+
+    if(ui->checkBoxCohortBand->isChecked() && m_cohortBands.patientCount() > 0)
+    {
+        QVector<double> cohortKeys;
+
+        for(auto cycleDay = 1; cycleDay <= CycleAnalysis::maximumCycleDays; cycleDay++)
+        {
+            cohortKeys.append((cycleDay - 1) * secondsPerDay);
+        }
+
+        auto cohortLowerGraph = ui->customPlot->addGraph();
+        cohortLowerGraph->setName("Cohort " + QString::number(qRound(cohortBandLowerFraction * 100.0)) + " %");
+        cohortLowerGraph->setPen(Qt::NoPen);
+        cohortLowerGraph->setData(cohortKeys, m_cohortBands.band(m_parameterColumn, cohortBandLowerFraction), true);
+
+        auto cohortUpperGraph = ui->customPlot->addGraph();
+        cohortUpperGraph->setName("Cohort " + QString::number(qRound(cohortBandUpperFraction * 100.0)) + " %");
+        cohortUpperGraph->setPen(Qt::NoPen);
+        cohortUpperGraph->setBrush(QBrush(QColor(0, 160, 0, 30)));
+        cohortUpperGraph->setChannelFillGraph(cohortLowerGraph);
+        cohortUpperGraph->setData(cohortKeys, m_cohortBands.band(m_parameterColumn, cohortBandUpperFraction), true);
+    }
+
+    QVector<double> keys;
+    keys.reserve(dayCount);
+
+    for(auto day : result.days)
+    {
+        keys.append(day * secondsPerDay);
+    }
+
+    QPen patientPen(QColor(128, 128, 128, 80));
+    patientPen.setWidthF(1.0);
+
+    for(auto patient = 0; patient < m_patientCurves.size(); patient++)
+    {
+        auto graph = ui->customPlot->addGraph();
+
+        graph->setName(result.names[patient]);
+        graph->setPen(patientPen);
+        graph->setAntialiased(false);
+        graph->setAdaptiveSampling(true);
+        graph->setData(m_patientCurves[patient]);
+    }
+
+    auto lowerQuartileGraph = ui->customPlot->addGraph();
+    lowerQuartileGraph->setName("Lower Quartile");
+    lowerQuartileGraph->setPen(QPen(QColor(0, 0, 255, 120)));
+    lowerQuartileGraph->setData(keys, result.lowerQuartiles, true);
+
+    auto upperQuartileGraph = ui->customPlot->addGraph();
+    upperQuartileGraph->setName("Upper Quartile");
+    upperQuartileGraph->setPen(QPen(QColor(0, 0, 255, 120)));
+    upperQuartileGraph->setBrush(QBrush(QColor(0, 0, 255, 40)));
+    upperQuartileGraph->setChannelFillGraph(lowerQuartileGraph);
+    upperQuartileGraph->setData(keys, result.upperQuartiles, true);
+
+    QPen medianPen(Qt::black);
+    medianPen.setWidthF(2.0);
+
+    auto medianGraph = ui->customPlot->addGraph();
+    medianGraph->setName("Median");
+    medianGraph->setPen(medianPen);
+    medianGraph->setData(keys, result.medians, true);
+
+    ui->customPlot->rescaleAxes();
+    ui->customPlot->replot();
+
+    if(sender() == &m_overlayComparison)
+    {
+        m_compareStatus = QString::number(result.names.size()) + " compared, " +
+                          QString::number(result.skippedCount) + " skipped (" +
+                          QString::number(m_compareTimer.elapsed()) + " ms)";
+    }
+
+    showStatus();
+}
+
+void OverlayComparisonWindow::showStatus()
+{
+    QString status = QString::number(m_patientDataFileNames.size()) + " patients";
+
+    if(m_overlayComparison.isComparing())
+    {
+        status += ", comparing...";
+    }
+    else if(!m_compareStatus.isEmpty())
+    {
+        status += ", " + m_compareStatus;
+    }
+
+    if(m_cohortBands.isBuilding())
+    {
+        status += " - updating cohort...";
+    }
+
+    ui->labelStatus->setText(status);
+    ui->pushButtonCompare->setEnabled(!m_patientDataFileNames.isEmpty());
+}
@@ -0,0 +1,60 @@
+#ifndef OVERLAYCOMPARISONWINDOW_H
+#define OVERLAYCOMPARISONWINDOW_H
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include "overlaycomparison.h"
+#include "cohortbands.h"
+#include "qcustomplot.h"
+
+namespace Ui {
+class OverlayComparisonWindow;
+}
+
+class OverlayComparisonWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit OverlayComparisonWindow(QWidget *parent = nullptr);
+    ~OverlayComparisonWindow();
+
+    void setDirectory(const QString& directory);
+    void setPatientDataFileNames(const QStringList& patientDataFileNames);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void on_pushButtonAddPatients_clicked();
+
+    void on_pushButtonClear_clicked();
+
+    void on_pushButtonCompare_clicked();
+
+    void on_checkBoxCohortBand_toggled(bool);
+
+    void updatePatientCurves();
+
+    void plotComparison();
+
+    void showStatus();
+
+private:
+    Ui::OverlayComparisonWindow *ui;
+    OverlayComparison m_overlayComparison;
+    CohortBands m_cohortBands;
+    QString m_directory;
+    QStringList m_patientDataFileNames;
+    QElapsedTimer m_compareTimer;
+    QString m_compareStatus;
+
+    // Blood value column of the last comparison.
+    int m_parameterColumn;
+
+    // Curves of the patients of the last comparison in the order of its names, built once from
+    // its pool and shared by the graphs of each plot.
+    QVector<QSharedPointer<QCPGraphDataContainer>> m_patientCurves;
+};
+
+#endif // OVERLAYCOMPARISONWINDOW_H
@@ -0,0 +1,453 @@
+#include "patientcatalog.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "patienttablemodel.h"
+#include "medicationindex.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+const static QString catalogFileName = ".leukiCatalog";
+const static quint32 catalogFileMagic = 0x4c4b4354;
+const static quint32 catalogFileVersion = 2;
+
+// Writes the passed data to the passed file atomically.
+static void writeCatalogFile(const QString& fileName, const QByteArray& data)
+{
+    QSaveFile file(fileName);
+
+    if(file.open(QIODevice::WriteOnly))
+    {
+        file.write(data);
+        file.commit();
+    }
+}
+
+static QDataStream& operator<<(QDataStream& stream, const PatientCatalog::medication_period_t& medicationPeriod)
+{
+    return stream << medicationPeriod.name << medicationPeriod.firstDay << medicationPeriod.lastDay;
+}
+
+static QDataStream& operator>>(QDataStream& stream, PatientCatalog::medication_period_t& medicationPeriod)
+{
+    return stream >> medicationPeriod.name >> medicationPeriod.firstDay >> medicationPeriod.lastDay;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const PatientCatalog::catalog_entry_t& entry)
+{
+    return stream << entry.fileName << entry.size << entry.lastModified << entry.patientId << entry.name
+                  << entry.dateOfBirth << static_cast<qint32>(entry.sampleCount) << entry.lastSampleDate
+                  << entry.latestValues << entry.medicationPeriods;
+}
+
+static QDataStream& operator>>(QDataStream& stream, PatientCatalog::catalog_entry_t& entry)
+{
+    qint32 sampleCount = 0;
+
+    stream >> entry.fileName >> entry.size >> entry.lastModified >> entry.patientId >> entry.name
+           >> entry.dateOfBirth >> sampleCount >> entry.lastSampleDate
+           >> entry.latestValues >> entry.medicationPeriods;
+
+    entry.sampleCount = sampleCount;
+
+    return stream;
+}
+
+PatientCatalog::PatientCatalog(QObject *parent)
+    : QObject(parent)
+    , m_refreshPending(false)
+{
+    connect(&m_refreshWatcher, &QFutureWatcher<refresh_result_t>::finished, this, &PatientCatalog::handleRefreshResult);
+
+    // A single thread keeps refreshes and writes of the catalog file in order.
+    m_threadPool.setMaxThreadCount(1);
+}
+
+PatientCatalog::~PatientCatalog()
+{
+    m_threadPool.waitForDone();
+}
+
+// Loads the catalog of the passed directory and refreshes it in the background.
+void PatientCatalog::setDirectory(const QString& directory)
+{
+    if(directory == m_directory)
+    {
+        return;
+    }
+
+    m_directory = directory;
+
+    load();
+    refresh();
+
+    emit updated();
+}
+
+QString PatientCatalog::directory() const
+{
+    return m_directory;
+}
+
+// Checks size and modification time of all patient data files of the directory in the
+// background, only new and changed files are read.
+void PatientCatalog::refresh()
+{
+    if(m_directory.isEmpty())
+    {
+        return;
+    }
+
+    if(m_refreshWatcher.isRunning())
+    {
+        m_refreshPending = true;
+        return;
+    }
+
+    m_refreshDirectory = m_directory;
+    m_refreshWatcher.setFuture(QtConcurrent::run(&m_threadPool, refreshEntries, m_directory, m_entries));
+}
+
+bool PatientCatalog::isRefreshing() const
+{
+    return m_refreshWatcher.isRunning();
+}
+
+int PatientCatalog::count() const
+{
+    return static_cast<int>(m_entries.size());
+}
+
+// Returns the entries with a word of the name or the patient ID starting with the passed
+// prefix (case insensitive), at most maximumCount. The search keys are sorted, so the
+// matching keys are found by binary search.
+QVector<PatientCatalog::catalog_entry_t> PatientCatalog::search(const QString& prefix, int maximumCount) const
+{
+    QString searchKey = prefix.trimmed().toCaseFolded();
+    QVector<catalog_entry_t> entries;
+    QSet<int> found;
+
+    auto it = std::lower_bound(m_searchKeys.constBegin(), m_searchKeys.constEnd(), searchKey,
+                               [](const QPair<QString, int>& key, const QString& value)
+    {
+        return key.first < value;
+    });
+
+    for(; it != m_searchKeys.constEnd() && entries.size() < maximumCount && it->first.startsWith(searchKey); it++)
+    {
+        if(!found.contains(it->second))
+        {
+            found.insert(it->second);
+            entries.append(m_entries[it->second]);
+        }
+    }
+
+    return entries;
+}
+
+// Returns the entries with a chemo therapy / medication containing a word starting with each
+// word of the passed text (case and accent insensitive), at most maximumCount.
+QVector<PatientCatalog::catalog_entry_t> PatientCatalog::searchMedication(const QString& text, int maximumCount) const
+{
+    QVector<catalog_entry_t> entries;
+    const auto searchTokens = MedicationIndex::tokens(text);
+
+    if(searchTokens.isEmpty())
+    {
+        return entries;
+    }
+
+    auto found = prefixEntryIndices(m_medicationKeys, searchTokens[0]);
+
+    for(auto i = 1; i < searchTokens.size(); i++)
+    {
+        found.intersect(prefixEntryIndices(m_medicationKeys, searchTokens[i]));
+    }
+
+    QVector<int> entryIndices(found.begin(), found.end());
+    std::sort(entryIndices.begin(), entryIndices.end());
+
+    for(auto i = 0; i < entryIndices.size() && i < maximumCount; i++)
+    {
+        entries.append(m_entries[entryIndices[i]]);
+    }
+
+    return entries;
+}
+
+// Returns the names of the chemo therapies and medications given at the passed date.
+QStringList PatientCatalog::activeMedications(const catalog_entry_t& entry, const QDate& date)
+{
+    QStringList medications;
+    auto day = date.toJulianDay();
+
+    for(const auto& medicationPeriod : entry.medicationPeriods)
+    {
+        if(medicationPeriod.firstDay <= day && day <= medicationPeriod.lastDay && !medications.contains(medicationPeriod.name))
+        {
+            medications.append(medicationPeriod.name);
+        }
+    }
+
+    return medications;
+}
+
+void PatientCatalog::handleRefreshResult()
+{
+    refresh_result_t result = m_refreshWatcher.result();
+
+    // Results of a previous directory are dropped.
+    if(m_refreshDirectory == m_directory && result.changed)
+    {
+        m_entries = result.entries;
+
+        buildSearchKeys();
+        save();
+
+        emit updated();
+    }
+
+    if(m_refreshPending)
+    {
+        m_refreshPending = false;
+        refresh();
+    }
+}
+
+// Loads the catalog file of the directory. A missing or unreadable catalog file results in
+// an empty catalog which is filled by the next refresh.
+void PatientCatalog::load()
+{
+    m_entries.clear();
+
+    QFile file(m_directory + "/" + catalogFileName);
+
+    if(!m_directory.isEmpty() && file.open(QIODevice::ReadOnly))
+    {
+        QDataStream stream(&file);
+        quint32 magic = 0;
+        quint32 version = 0;
+
+        stream >> magic >> version;
+
+        if(magic == catalogFileMagic && version == catalogFileVersion)
+        {
+            stream >> m_entries;
+
+            if(stream.status() != QDataStream::Ok)
+            {
+                m_entries.clear();
+            }
+        }
+    }
+
+    buildSearchKeys();
+}
+
+void PatientCatalog::save()
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+
+    stream << catalogFileMagic << catalogFileVersion << m_entries;
+
+    (void)QtConcurrent::run(&m_threadPool, writeCatalogFile, m_directory + "/" + catalogFileName, data);
+}
+
+void PatientCatalog::buildSearchKeys()
+{
+    m_searchKeys.clear();
+
+    for(auto i = 0; i < m_entries.size(); i++)
+    {
+        QString words = m_entries[i].name.isEmpty() ? QFileInfo(m_entries[i].fileName).completeBaseName() : m_entries[i].name;
+        const auto nameWords = words.toCaseFolded().split(' ', Qt::SkipEmptyParts);
+
+        for(const auto& word : nameWords)
+        {
+            m_searchKeys.append(qMakePair(word, i));
+        }
+
+        // The whole name is a key as well, so that "first last" prefixes are found.
+        if(nameWords.size() > 1)
+        {
+            m_searchKeys.append(qMakePair(nameWords.join(' '), i));
+        }
+
+        if(!m_entries[i].patientId.isEmpty())
+        {
+            m_searchKeys.append(qMakePair(m_entries[i].patientId.toCaseFolded(), i));
+        }
+    }
+
+    std::sort(m_searchKeys.begin(), m_searchKeys.end());
+
+    m_medicationKeys.clear();
+
+    for(auto i = 0; i < m_entries.size(); i++)
+    {
+        QSet<QString> medicationTokens;
+
+        for(const auto& medicationPeriod : std::as_const(m_entries[i].medicationPeriods))
+        {
+            for(const auto& token : MedicationIndex::tokens(medicationPeriod.name))
+            {
+                medicationTokens.insert(token);
+            }
+        }
+
+        for(const auto& token : std::as_const(medicationTokens))
+        {
+            m_medicationKeys.append(qMakePair(token, i));
+        }
+    }
+
+    std::sort(m_medicationKeys.begin(), m_medicationKeys.end());
+}
+
+// Returns the entry indices of all keys starting with the passed prefix.
+QSet<int> PatientCatalog::prefixEntryIndices(const QVector<QPair<QString, int>>& keys, const QString& prefix)
+{
+    QSet<int> entryIndices;
+
+    auto it = std::lower_bound(keys.constBegin(), keys.constEnd(), prefix,
+                               [](const QPair<QString, int>& key, const QString& value)
+    {
+        return key.first < value;
+    });
+
+    for(; it != keys.constEnd() && it->first.startsWith(prefix); it++)
+    {
+        entryIndices.insert(it->second);
+    }
+
+    return entryIndices;
+}
+
+// Runs on the worker thread: takes over the entries of unchanged files and reads new and
+// changed files in parallel. Entries of removed files are dropped.
+PatientCatalog::refresh_result_t PatientCatalog::refreshEntries(const QString& directory, QVector<catalog_entry_t> entries)
+{
+    QHash<QString, int> entryIndices;
+
+    for(auto i = 0; i < entries.size(); i++)
+    {
+        entryIndices[entries[i].fileName] = i;
+    }
+
+    const auto fileInfos = QDir(directory).entryInfoList({"*.json"}, QDir::Files, QDir::Name);
+
+    QVector<catalog_entry_t> refreshedEntries(fileInfos.size());
+    QVector<QPair<int, QFuture<catalog_entry_t>>> entryFutures;
+
+    for(auto i = 0; i < fileInfos.size(); i++)
+    {
+        auto size = fileInfos[i].size();
+        auto lastModified = fileInfos[i].lastModified().toMSecsSinceEpoch();
+        auto entryIndex = entryIndices.value(fileInfos[i].fileName(), -1);
+
+        if(entryIndex >= 0 && entries[entryIndex].size == size && entries[entryIndex].lastModified == lastModified)
+        {
+            refreshedEntries[i] = entries[entryIndex];
+        }
+        else
+        {
+            entryFutures.append(qMakePair(i, QtConcurrent::run(readEntry, directory, fileInfos[i].fileName(), size, lastModified)));
+        }
+    }
+
+    for(auto& entryFuture : entryFutures)
+    {
+        refreshedEntries[entryFuture.first] = entryFuture.second.result();
+    }
+
+    refresh_result_t result;
+
+    result.entries = refreshedEntries;
+    result.changed = !entryFutures.isEmpty() || refreshedEntries.size() != entries.size();
+
+    return result;
+}
+
+// Reads the catalog entry of the passed patient data file.
+PatientCatalog::catalog_entry_t PatientCatalog::readEntry(const QString& directory, const QString& fileName, qint64 size, qint64 lastModified)
+{
+    catalog_entry_t entry;
+
+    entry.fileName = fileName;
+    entry.size = size;
+    entry.lastModified = lastModified;
+    entry.sampleCount = 0;
+    entry.latestValues = QVector<QString>(PatientDataSchema::labParameterCount);
+
+    PatientDataFile::patient_data_t patientData;
+
+    if(!PatientDataFile::load(directory + "/" + fileName, patientData))
+    {
+        return entry;
+    }
+
+    entry.patientId = patientData.patientId;
+    entry.name = patientData.name;
+    entry.dateOfBirth = patientData.dateOfBirth;
+
+    const auto& bloodSampleDates = patientData.bloodSamples[PatientDataSchema::bloodSamplesDateColumn];
+    auto lastSampleDateKey = PatientTableModel::invalidDateKey;
+    QVector<qint64> latestValueDateKeys(entry.latestValues.size(), PatientTableModel::invalidDateKey);
+
+    entry.sampleCount = static_cast<int>(bloodSampleDates.size());
+
+    for(auto row = 0; row < bloodSampleDates.size(); row++)
+    {
+        auto dateKey = PatientTableModel::parseDate(bloodSampleDates[row]);
+
+        if(dateKey == PatientTableModel::invalidDateKey)
+        {
+            continue;
+        }
+
+        if(dateKey > lastSampleDateKey)
+        {
+            lastSampleDateKey = dateKey;
+            entry.lastSampleDate = bloodSampleDates[row];
+        }
+
+        for(auto i = 0; i < entry.latestValues.size(); i++)
+        {
+            const auto& value = patientData.bloodSamples[PatientDataSchema::labParameterColumns[i]][row];
+
+            if(!value.isEmpty() && dateKey >= latestValueDateKeys[i])
+            {
+                latestValueDateKeys[i] = dateKey;
+                entry.latestValues[i] = value;
+            }
+        }
+    }
+
+    const auto& medicationStartDates = patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsDateColumn];
+
+    for(auto row = 0; row < medicationStartDates.size(); row++)
+    {
+        QDate firstDay = QDate::fromString(medicationStartDates[row], "dd.MM.yyyy");
+
+        if(!firstDay.isValid())
+        {
+            continue;
+        }
+
+        medication_period_t medicationPeriod;
+
+        medicationPeriod.name = patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsNameColumn][row];
+        medicationPeriod.firstDay = firstDay.toJulianDay();
+        medicationPeriod.lastDay = medicationPeriod.firstDay + std::max(patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsDaysColumn][row].toInt(), 1) - 1;
+
+        entry.medicationPeriods.append(medicationPeriod);
+    }
+
+    return entry;
+}
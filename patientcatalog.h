@@ -0,0 +1,103 @@
+#ifndef PATIENTCATALOG_H
+#define PATIENTCATALOG_H
+
+#include <QObject>
+#include <QDate>
+#include <QFutureWatcher>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+// Catalog of the patient data files of a directory, persisted in the directory so that it is
+// available at once without reading the patient data files. Files are only read again if
+// their size or modification time have changed. Patients can be searched by name or patient
+// ID prefix and by the words of their chemo therapy / medication names.
+class PatientCatalog : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        QString name;
+        qint64 firstDay;
+        qint64 lastDay;
+    } medication_period_t;
+
+    typedef struct
+    {
+        QString fileName;
+        qint64 size;
+        qint64 lastModified;
+        QString patientId;
+        QString name;
+        QString dateOfBirth;
+        int sampleCount;
+        QString lastSampleDate;
+
+        // Latest non-empty value of each blood value column (in the column order of the
+        // blood sample table, without the date column).
+        QVector<QString> latestValues;
+
+        // Periods of all chemo therapies and medications (Julian days, last day included),
+        // so that the active ones can be told for any day without reading the file again.
+        QVector<medication_period_t> medicationPeriods;
+    } catalog_entry_t;
+
+    explicit PatientCatalog(QObject *parent = nullptr);
+    ~PatientCatalog();
+
+    void setDirectory(const QString& directory);
+    QString directory() const;
+    void refresh();
+    bool isRefreshing() const;
+
+    int count() const;
+    QVector<catalog_entry_t> search(const QString& prefix, int maximumCount) const;
+    QVector<catalog_entry_t> searchMedication(const QString& text, int maximumCount) const;
+
+    static QStringList activeMedications(const catalog_entry_t& entry, const QDate& date);
+
+signals:
+    // Emitted when the catalog has been changed by a refresh.
+    void updated();
+
+private slots:
+    void handleRefreshResult();
+
+private:
+    QString m_directory;
+    QVector<catalog_entry_t> m_entries;
+
+    // Case folded words of the names and patient IDs, sorted, each with its entry index.
+    QVector<QPair<QString, int>> m_searchKeys;
+
+    // Folded words of the chemo therapy / medication names (see MedicationIndex), sorted, each
+    // with its entry index.
+    QVector<QPair<QString, int>> m_medicationKeys;
+
+    typedef struct
+    {
+        QVector<catalog_entry_t> entries;
+        bool changed;
+    } refresh_result_t;
+
+    QThreadPool m_threadPool;
+    QFutureWatcher<refresh_result_t> m_refreshWatcher;
+    QString m_refreshDirectory;
+    bool m_refreshPending;
+
+    void load();
+    void save();
+    void buildSearchKeys();
+
+    static QSet<int> prefixEntryIndices(const QVector<QPair<QString, int>>& keys, const QString& prefix);
+
+    static refresh_result_t refreshEntries(const QString& directory, QVector<catalog_entry_t> entries);
+    static catalog_entry_t readEntry(const QString& directory, const QString& fileName, qint64 size, qint64 lastModified);
+};
+
+#endif // PATIENTCATALOG_H
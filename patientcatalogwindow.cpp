@@ -0,0 +1,145 @@
+#include "patientcatalogwindow.h"
+#include "ui_patientcatalogwindow.h"
+#include "patientdatafile.h"
+#include "labparameters.h"
+
+// Search results shown at most, more specific prefixes narrow them down.
+const static int maximumSearchResults = 200;
+
+// The latest value of each blood value of the registry is shown between the last sample and
+// the active medications.
+const static QVector<QString> tableWidgetPatientsColumns = []()
+{
+    QVector<QString> columns {"Name", "Patient ID", "Date of Birth", "Samples", "Last Sample"};
+
+    for(const auto& parameter : LabParameters::parameters())
+    {
+        columns.append(parameter.name);
+    }
+
+    columns.append("Active Medications");
+
+    return columns;
+}();
+
+PatientCatalogWindow::PatientCatalogWindow(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::PatientCatalogWindow)
+{
+    ui->setupUi(this);
+
+    ui->tableWidgetPatients->setColumnCount(static_cast<int>(tableWidgetPatientsColumns.size()));
+
+    for(auto i = 0; i < tableWidgetPatientsColumns.size(); i++)
+    {
+        ui->tableWidgetPatients->setHorizontalHeaderItem(i, new QTableWidgetItem(tableWidgetPatientsColumns[i]));
+    }
+
+    connect(&m_patientCatalog, &PatientCatalog::updated, this, &PatientCatalogWindow::showSearchResults);
+}
+
+PatientCatalogWindow::~PatientCatalogWindow()
+{
+    delete ui;
+}
+
+void PatientCatalogWindow::setDirectory(const QString& directory)
+{
+    m_patientCatalog.setDirectory(directory);
+}
+
+// The catalog is shown at once and brought up to date in the background.
+void PatientCatalogWindow::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+
+    m_patientCatalog.refresh();
+
+    showSearchResults();
+
+    ui->lineEditSearch->setFocus();
+    ui->lineEditSearch->selectAll();
+}
+
+void PatientCatalogWindow::on_lineEditSearch_textEdited(const QString &arg1)
+{
+    showSearchResults();
+}
+
+void PatientCatalogWindow::on_checkBoxSearchMedications_toggled(bool checked)
+{
+    ui->lineEditSearch->setPlaceholderText(checked ? "Chemo therapy / medication" : "Name or patient ID");
+
+    showSearchResults();
+}
+
+void PatientCatalogWindow::on_tableWidgetPatients_cellDoubleClicked(int row, int column)
+{
+    openSelectedPatient();
+    accept();
+}
+
+void PatientCatalogWindow::on_buttonBox_accepted()
+{
+    openSelectedPatient();
+}
+
+// Fills the table with the patients matching the search text.
+void PatientCatalogWindow::showSearchResults()
+{
+    auto entries = ui->checkBoxSearchMedications->isChecked() ?
+                   m_patientCatalog.searchMedication(ui->lineEditSearch->text(), maximumSearchResults) :
+                   m_patientCatalog.search(ui->lineEditSearch->text(), maximumSearchResults);
+    auto today = QDate::currentDate();
+
+    ui->tableWidgetPatients->setRowCount(0);
+    ui->tableWidgetPatients->setRowCount(static_cast<int>(entries.size()));
+
+    for(auto row = 0; row < entries.size(); row++)
+    {
+        const auto& entry = entries[row];
+        QVector<QString> texts {entry.name, entry.patientId, entry.dateOfBirth, QString::number(entry.sampleCount), entry.lastSampleDate};
+
+        texts += entry.latestValues;
+        texts.append(PatientCatalog::activeMedications(entry, today).join(", "));
+
+        for(auto column = 0; column < texts.size() && column < tableWidgetPatientsColumns.size(); column++)
+        {
+            auto item = new QTableWidgetItem(texts[column]);
+            item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+
+            ui->tableWidgetPatients->setItem(row, column, item);
+        }
+
+        ui->tableWidgetPatients->item(row, 0)->setData(Qt::UserRole, m_patientCatalog.directory() + "/" + entry.fileName);
+    }
+
+    if(entries.size())
+    {
+        ui->tableWidgetPatients->selectRow(0);
+    }
+
+    QString status = QString::number(m_patientCatalog.count()) + " patients in catalog";
+
+    if(entries.size() == maximumSearchResults)
+    {
+        status += ", first " + QString::number(maximumSearchResults) + " matches shown";
+    }
+
+    if(m_patientCatalog.isRefreshing())
+    {
+        status += ", updating...";
+    }
+
+    ui->labelStatus->setText(status);
+}
+
+void PatientCatalogWindow::openSelectedPatient()
+{
+    auto row = ui->tableWidgetPatients->currentRow();
+
+    if(row >= 0 && ui->tableWidgetPatients->item(row, 0))
+    {
+        emit patientDataFileSelected(ui->tableWidgetPatients->item(row, 0)->data(Qt::UserRole).toString());
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef PATIENTCATALOGWINDOW_H
+#define PATIENTCATALOGWINDOW_H
+
+#include <QDialog>
+#include "patientcatalog.h"
+
+namespace Ui {
+class PatientCatalogWindow;
+}
+
+class PatientCatalogWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit PatientCatalogWindow(QWidget *parent = nullptr);
+    ~PatientCatalogWindow();
+
+    void setDirectory(const QString& directory);
+
+signals:
+    // Emitted when the user opens a patient of the catalog.
+    void patientDataFileSelected(const QString& patientDataFileName);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void on_lineEditSearch_textEdited(const QString &arg1);
+
+    void on_checkBoxSearchMedications_toggled(bool checked);
+
+    void on_tableWidgetPatients_cellDoubleClicked(int row, int column);
+
+    void on_buttonBox_accepted();
+
+    void showSearchResults();
+
+private:
+    Ui::PatientCatalogWindow *ui;
+    PatientCatalog m_patientCatalog;
+
+    void openSelectedPatient();
+};
+
+#endif // PATIENTCATALOGWINDOW_H
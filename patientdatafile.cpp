@@ -0,0 +1,501 @@
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QUuid>
+#include <algorithm>
+
+// Journal entries address rows by this key besides the column keys.
+const static QString journalRowKey = "row";
+
+static_assert(PatientDataSchema::columnIndex(PatientDataSchema::bloodSamplesColumns, "row") < 0 &&
+              PatientDataSchema::columnIndex(PatientDataSchema::chemoAndMedsColumns, "row") < 0,
+              "The JSON key row is used by the journal.");
+
+// Returns the names of the passed columns as shown in the table headers, e.g.
+// "Leukocytes [Giga/l]".
+template<std::size_t N>
+static QVector<QString> columnNames(const std::array<PatientDataSchema::column_t, N>& columns)
+{
+    QVector<QString> names;
+
+    for(const auto& column : columns)
+    {
+        names.append(column.unit ? QString("%1 [%2]").arg(column.name, column.unit) : QString(column.name));
+    }
+
+    return names;
+}
+
+template<std::size_t N>
+static QVector<QString> jsonKeys(const std::array<PatientDataSchema::column_t, N>& columns)
+{
+    QVector<QString> keys;
+
+    for(const auto& column : columns)
+    {
+        keys.append(QString(column.jsonKey));
+    }
+
+    return keys;
+}
+
+// Converts a cell by the value type of its column.
+static QString cellFromJson(const QJsonValue& value, const PatientDataSchema::column_t& column)
+{
+    return column.valueType == PatientDataSchema::VALUE_NUMBER ? PatientDataFile::bloodSampleValueToText(value) : value.toString();
+}
+
+// Numbers are written as JSON numbers, cells of number columns which are no number as empty
+// string.
+static QJsonValue cellToJson(const QString& text, const PatientDataSchema::column_t& column)
+{
+    if(column.valueType == PatientDataSchema::VALUE_NUMBER)
+    {
+        bool conversionSuccessful = false;
+        double value = text.toDouble(&conversionSuccessful);
+
+        if(conversionSuccessful)
+        {
+            return value;
+        }
+
+        return "";
+    }
+
+    return text;
+}
+
+// Reads the rows of a table from their JSON objects into columnar storage.
+template<std::size_t N>
+static QVector<QVector<QString>> tableFromJson(const QJsonArray& rowsArray, const std::array<PatientDataSchema::column_t, N>& columns,
+                                               const QVector<QString>& keys)
+{
+    auto rowCount = rowsArray.size();
+    QVector<QVector<QString>> table(N, QVector<QString>(rowCount));
+
+    for(auto row = 0; row < rowCount; row++)
+    {
+        QJsonObject rowJsonObject = rowsArray[row].toObject();
+
+        for(std::size_t column = 0; column < N; column++)
+        {
+            table[column][row] = cellFromJson(rowJsonObject[keys[column]], columns[column]);
+        }
+    }
+
+    return table;
+}
+
+// Reads rows from their JSON objects, each row as a vector of cell texts in column order.
+template<std::size_t N>
+static QVector<QVector<QString>> rowsFromJson(const QJsonArray& rowsArray, const std::array<PatientDataSchema::column_t, N>& columns,
+                                              const QVector<QString>& keys)
+{
+    QVector<QVector<QString>> rows;
+    rows.reserve(rowsArray.size());
+
+    for(const auto& rowJsonValue : rowsArray)
+    {
+        QJsonObject rowJsonObject = rowJsonValue.toObject();
+        QVector<QString> row(N);
+
+        for(std::size_t column = 0; column < N; column++)
+        {
+            row[column] = cellFromJson(rowJsonObject[keys[column]], columns[column]);
+        }
+
+        rows.append(row);
+    }
+
+    return rows;
+}
+
+// Writes the rows of a table as JSON objects.
+template<std::size_t N>
+static QJsonArray tableToJson(const QVector<QVector<QString>>& table, const std::array<PatientDataSchema::column_t, N>& columns,
+                              const QVector<QString>& keys)
+{
+    QJsonArray rowsArray;
+    auto rowCount = table.size() < static_cast<int>(N) ? 0 : table[0].size();
+
+    for(auto row = 0; row < rowCount; row++)
+    {
+        QJsonObject rowJsonObject;
+
+        for(std::size_t column = 0; column < N; column++)
+        {
+            rowJsonObject[keys[column]] = cellToJson(table[column][row], columns[column]);
+        }
+
+        rowsArray.push_back(rowJsonObject);
+    }
+
+    return rowsArray;
+}
+
+// Writes the changes of a table as journal entry: the deleted rows as row indices, each edited
+// cell and each inserted row as object with the row index and the column keys.
+template<std::size_t N>
+static QJsonObject tableChangesToJson(const PatientDataFile::table_changes_t& changes, const std::array<PatientDataSchema::column_t, N>& columns,
+                                      const QVector<QString>& keys)
+{
+    QJsonArray deletedRowsArray;
+    QJsonArray changedCellsArray;
+    QJsonArray insertedRowsArray;
+
+    for(auto row : changes.deletedRows)
+    {
+        deletedRowsArray.append(row);
+    }
+
+    for(const auto& cellChange : changes.changedCells)
+    {
+        QJsonObject cellJsonObject;
+
+        cellJsonObject[journalRowKey] = cellChange.row;
+        cellJsonObject[keys[cellChange.column]] = cellToJson(cellChange.text, columns[cellChange.column]);
+
+        changedCellsArray.append(cellJsonObject);
+    }
+
+    for(const auto& insertedRow : changes.insertedRows)
+    {
+        QJsonObject rowJsonObject;
+
+        rowJsonObject[journalRowKey] = insertedRow.first;
+
+        for(std::size_t column = 0; column < N; column++)
+        {
+            rowJsonObject[keys[column]] = cellToJson(insertedRow.second.value(column), columns[column]);
+        }
+
+        insertedRowsArray.append(rowJsonObject);
+    }
+
+    QJsonObject changesJsonObject;
+
+    changesJsonObject["deletedRows"] = deletedRowsArray;
+    changesJsonObject["changedCells"] = changedCellsArray;
+    changesJsonObject["insertedRows"] = insertedRowsArray;
+
+    return changesJsonObject;
+}
+
+template<std::size_t N>
+static PatientDataFile::table_changes_t tableChangesFromJson(const QJsonObject& changesJsonObject, const std::array<PatientDataSchema::column_t, N>& columns,
+                                                             const QVector<QString>& keys)
+{
+    PatientDataFile::table_changes_t changes;
+
+    for(const auto& value : changesJsonObject["deletedRows"].toArray())
+    {
+        changes.deletedRows.append(value.toInt());
+    }
+
+    for(const auto& value : changesJsonObject["changedCells"].toArray())
+    {
+        QJsonObject cellJsonObject = value.toObject();
+
+        for(auto it = cellJsonObject.constBegin(); it != cellJsonObject.constEnd(); it++)
+        {
+            auto column = keys.indexOf(it.key());
+
+            if(column >= 0)
+            {
+                changes.changedCells.append({cellJsonObject[journalRowKey].toInt(), static_cast<int>(column), cellFromJson(it.value(), columns[column])});
+            }
+        }
+    }
+
+    for(const auto& value : changesJsonObject["insertedRows"].toArray())
+    {
+        QJsonObject rowJsonObject = value.toObject();
+        QVector<QString> texts(N);
+
+        for(std::size_t column = 0; column < N; column++)
+        {
+            texts[column] = cellFromJson(rowJsonObject[keys[column]], columns[column]);
+        }
+
+        changes.insertedRows.append(qMakePair(rowJsonObject[journalRowKey].toInt(), texts));
+    }
+
+    return changes;
+}
+
+static void generalInformationFromJson(const QJsonObject& patientDataJsonObject, PatientDataFile::patient_data_t& patientData)
+{
+    patientData.patientId = patientDataJsonObject["patientId"].toString();
+    patientData.name = patientDataJsonObject["name"].toString();
+    patientData.dateOfBirth = patientDataJsonObject["dateOfBirth"].toString();
+    patientData.size = patientDataJsonObject["size"].toString();
+    patientData.weight = patientDataJsonObject["weight"].toString();
+    patientData.bodySurface = patientDataJsonObject["bodySurface"].toString();
+    patientData.dateOfDiagnosis = patientDataJsonObject["dateOfDiagnosis"].toString();
+}
+
+static void generalInformationToJson(const PatientDataFile::patient_data_t& patientData, QJsonObject& patientDataJsonObject)
+{
+    // Files without a patient ID are kept free of the key.
+    if(!patientData.patientId.isEmpty())
+    {
+        patientDataJsonObject["patientId"] = patientData.patientId;
+    }
+
+    patientDataJsonObject["name"] = patientData.name;
+    patientDataJsonObject["dateOfBirth"] = patientData.dateOfBirth;
+    patientDataJsonObject["size"] = patientData.size;
+    patientDataJsonObject["weight"] = patientData.weight;
+    patientDataJsonObject["bodySurface"] = patientData.bodySurface;
+
+    // Files without a date of diagnosis are kept free of the key as well.
+    if(!patientData.dateOfDiagnosis.isEmpty())
+    {
+        patientDataJsonObject["dateOfDiagnosis"] = patientData.dateOfDiagnosis;
+    }
+}
+
+const QVector<QString> PatientDataFile::bloodSamplesColumns = columnNames(PatientDataSchema::bloodSamplesColumns);
+const QVector<QString> PatientDataFile::bloodSamplesJsonKeys = jsonKeys(PatientDataSchema::bloodSamplesColumns);
+const QVector<QString> PatientDataFile::chemoAndMedsColumns = columnNames(PatientDataSchema::chemoAndMedsColumns);
+const QVector<QString> PatientDataFile::chemoAndMedsJsonKeys = jsonKeys(PatientDataSchema::chemoAndMedsColumns);
+
+// Loads the passed patient data file and applies the entries of its journal. Returns false
+// if the file cannot be read.
+bool PatientDataFile::load(const QString& fileName, patient_data_t& patientData)
+{
+    QFile patientDataFile(fileName);
+
+    if(!patientDataFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QJsonDocument patientDataJsonDocument = QJsonDocument::fromJson(patientDataFile.readAll());
+    patientDataFile.close();
+
+    patientData = fromJson(patientDataJsonDocument.object());
+
+    QFile journalFile(journalFileName(fileName));
+
+    if(patientData.journalId.isEmpty() || !journalFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return true;
+    }
+
+    // One entry per line. Entries of another journal id have been compacted into the file
+    // already, an entry interrupted while being appended cannot be parsed and is skipped.
+    while(!journalFile.atEnd())
+    {
+        QJsonParseError parseError;
+        QJsonObject entryJsonObject = QJsonDocument::fromJson(journalFile.readLine(), &parseError).object();
+
+        if(parseError.error != QJsonParseError::NoError || entryJsonObject["journalId"].toString() != patientData.journalId)
+        {
+            continue;
+        }
+
+        generalInformationFromJson(entryJsonObject, patientData);
+
+        applyChanges(patientData.bloodSamples, tableChangesFromJson(entryJsonObject["bloodSamples"].toObject(),
+                                                                    PatientDataSchema::bloodSamplesColumns, bloodSamplesJsonKeys));
+        applyChanges(patientData.chemoAndMeds, tableChangesFromJson(entryJsonObject["chemoTherapyAndMedicamentation"].toObject(),
+                                                                    PatientDataSchema::chemoAndMedsColumns, chemoAndMedsJsonKeys));
+    }
+
+    return true;
+}
+
+// Writes the passed patient data file atomically, so that readers (e.g. on other workstations)
+// never see a partially written file. The file gets a new journal id, returned in journalId
+// if passed, so that the journal is compacted. Returns false if the file cannot be written.
+bool PatientDataFile::save(const QString& fileName, const patient_data_t& patientData, QString *journalId)
+{
+    auto newPatientData = patientData;
+
+    newPatientData.journalId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    QJsonDocument patientDataJsonDocument(toJson(newPatientData));
+
+    QSaveFile patientDataFile(fileName);
+
+    if(!patientDataFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    patientDataFile.write(patientDataJsonDocument.toJson());
+
+    if(!patientDataFile.commit())
+    {
+        return false;
+    }
+
+    QFile::remove(journalFileName(fileName));
+
+    if(journalId)
+    {
+        *journalId = newPatientData.journalId;
+    }
+
+    return true;
+}
+
+// Appends the changes since the last save to the journal of the passed patient data file, so
+// that only the changed rows are written. patientData holds the complete data and the journal
+// id of the file, the file is saved completely instead if it has no journal id yet or if the
+// journal would exceed half the size of the file. journalId receives the journal id of the
+// file afterwards. Returns false if the file cannot be written.
+bool PatientDataFile::saveChanges(const QString& fileName, const patient_data_t& patientData, const patient_data_changes_t& changes,
+                                  QString *journalId)
+{
+    QJsonObject entryJsonObject;
+
+    entryJsonObject["journalId"] = patientData.journalId;
+    generalInformationToJson(changes.generalInformation, entryJsonObject);
+    entryJsonObject["bloodSamples"] = tableChangesToJson(changes.bloodSamples, PatientDataSchema::bloodSamplesColumns, bloodSamplesJsonKeys);
+    entryJsonObject["chemoTherapyAndMedicamentation"] = tableChangesToJson(changes.chemoAndMeds, PatientDataSchema::chemoAndMedsColumns, chemoAndMedsJsonKeys);
+
+    auto entry = QJsonDocument(entryJsonObject).toJson(QJsonDocument::Compact) + '\n';
+
+    QFileInfo patientDataFileInfo(fileName);
+    QFileInfo journalFileInfo(journalFileName(fileName));
+
+    if(patientData.journalId.isEmpty() || !patientDataFileInfo.exists() ||
+       journalFileInfo.size() + entry.size() > patientDataFileInfo.size() / 2)
+    {
+        return save(fileName, patientData, journalId);
+    }
+
+    QFile journalFile(journalFileInfo.filePath());
+
+    if(!journalFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text) || journalFile.write(entry) != entry.size())
+    {
+        return false;
+    }
+
+    journalFile.close();
+
+    // Readers detect changed files by their modification time, e.g. the patient catalog.
+    QFile patientDataFile(fileName);
+
+    if(patientDataFile.open(QIODevice::ReadWrite))
+    {
+        patientDataFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    if(journalId)
+    {
+        *journalId = patientData.journalId;
+    }
+
+    return true;
+}
+
+QString PatientDataFile::journalFileName(const QString& fileName)
+{
+    return fileName + ".journal";
+}
+
+// Applies changes to the passed columnar table: edited cells first, addressed by the rows of
+// the last saved table like the deleted rows, which are removed next, then the inserted rows
+// at their resulting index. Changes which do not fit the table are skipped.
+void PatientDataFile::applyChanges(QVector<QVector<QString>>& table, const table_changes_t& changes)
+{
+    auto rowCount = table.isEmpty() ? 0 : table[0].size();
+
+    for(const auto& cellChange : changes.changedCells)
+    {
+        if(cellChange.row >= 0 && cellChange.row < rowCount && cellChange.column >= 0 && cellChange.column < table.size())
+        {
+            table[cellChange.column][cellChange.row] = cellChange.text;
+        }
+    }
+
+    auto deletedRows = changes.deletedRows;
+
+    std::sort(deletedRows.begin(), deletedRows.end());
+
+    for(auto i = deletedRows.size() - 1; i >= 0; i--)
+    {
+        if(deletedRows[i] >= 0 && deletedRows[i] < rowCount && (i == 0 || deletedRows[i - 1] != deletedRows[i]))
+        {
+            for(auto& column : table)
+            {
+                column.remove(deletedRows[i]);
+            }
+        }
+    }
+
+    for(const auto& insertedRow : changes.insertedRows)
+    {
+        auto row = table.isEmpty() ? 0 : std::clamp(insertedRow.first, 0, static_cast<int>(table[0].size()));
+
+        for(auto column = 0; column < table.size(); column++)
+        {
+            table[column].insert(row, insertedRow.second.value(column));
+        }
+    }
+}
+
+PatientDataFile::patient_data_t PatientDataFile::fromJson(const QJsonObject& patientDataJsonObject)
+{
+    patient_data_t patientData;
+
+    generalInformationFromJson(patientDataJsonObject, patientData);
+    patientData.journalId = patientDataJsonObject["journalId"].toString();
+
+    patientData.bloodSamples = tableFromJson(patientDataJsonObject["bloodSamples"].toArray(),
+                                             PatientDataSchema::bloodSamplesColumns, bloodSamplesJsonKeys);
+    patientData.chemoAndMeds = tableFromJson(patientDataJsonObject["chemoTherapyAndMedicamentation"].toArray(),
+                                             PatientDataSchema::chemoAndMedsColumns, chemoAndMedsJsonKeys);
+
+    return patientData;
+}
+
+// Reads blood sample rows given as JSON objects like in a patient data file, e.g. pushed by
+// local tools.
+QVector<QVector<QString>> PatientDataFile::bloodSampleRowsFromJson(const QJsonArray& rowsArray)
+{
+    return rowsFromJson(rowsArray, PatientDataSchema::bloodSamplesColumns, bloodSamplesJsonKeys);
+}
+
+QVector<QVector<QString>> PatientDataFile::chemoAndMedRowsFromJson(const QJsonArray& rowsArray)
+{
+    return rowsFromJson(rowsArray, PatientDataSchema::chemoAndMedsColumns, chemoAndMedsJsonKeys);
+}
+
+QJsonObject PatientDataFile::toJson(const patient_data_t& patientData)
+{
+    QJsonObject patientDataJsonObject;
+
+    generalInformationToJson(patientData, patientDataJsonObject);
+
+    if(!patientData.journalId.isEmpty())
+    {
+        patientDataJsonObject["journalId"] = patientData.journalId;
+    }
+
+    patientDataJsonObject["bloodSamples"] = tableToJson(patientData.bloodSamples, PatientDataSchema::bloodSamplesColumns, bloodSamplesJsonKeys);
+    patientDataJsonObject["chemoTherapyAndMedicamentation"] = tableToJson(patientData.chemoAndMeds, PatientDataSchema::chemoAndMedsColumns, chemoAndMedsJsonKeys);
+
+    return patientDataJsonObject;
+}
+
+// Converts a blood sample value of a patient data file to the text shown in the table.
+// We expect the values to be of type double. If not, user may have entered nothing so we
+// expect an empty string.
+QString PatientDataFile::bloodSampleValueToText(const QJsonValue& value)
+{
+    if(value.isDouble())
+    {
+        return QString::number(value.toDouble());
+    }
+
+    return value.toString();
+}
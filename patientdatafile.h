@@ -0,0 +1,88 @@
+#ifndef PATIENTDATAFILE_H
+#define PATIENTDATAFILE_H
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QJsonArray>
+#include <QJsonObject>
+
+// Reading and writing of patient data files, independent of the user interface so that
+// it can be used on worker threads as well. Besides saving a file completely, the changes
+// since the last save can be appended to a journal next to the file, so that saving a few
+// new samples does not write the whole history again. Loading applies the journal, a
+// complete save compacts it into the file.
+class PatientDataFile
+{
+public:
+    // Table contents are stored columnar (one vector of cell texts per column) in the
+    // column order of bloodSamplesColumns and chemoAndMedsColumns.
+    typedef struct
+    {
+        QString patientId;
+        QString name;
+        QString dateOfBirth;
+        QString size;
+        QString weight;
+        QString bodySurface;
+        QString dateOfDiagnosis;
+        QVector<QVector<QString>> bloodSamples;
+        QVector<QVector<QString>> chemoAndMeds;
+
+        // Identifies the journal entries belonging to the file, written anew by each complete
+        // save so that entries already compacted into the file are not applied again.
+        QString journalId;
+    } patient_data_t;
+
+    typedef struct
+    {
+        // Row in the last saved table.
+        int row;
+        int column;
+        QString text;
+    } cell_change_t;
+
+    // Changes of a table since the last save. Rows which have not been deleted or moved keep
+    // their order, so only deleted, edited and inserted rows are listed.
+    typedef struct
+    {
+        // Rows of the last saved table which have been deleted or moved, ascending.
+        QVector<int> deletedRows;
+
+        // Edited cells of the remaining rows.
+        QVector<cell_change_t> changedCells;
+
+        // Added or moved rows (each a vector of cell texts in column order) with their index in
+        // the resulting table, ascending.
+        QVector<QPair<int, QVector<QString>>> insertedRows;
+    } table_changes_t;
+
+    typedef struct
+    {
+        // Complete general information, the tables are left empty.
+        patient_data_t generalInformation;
+
+        table_changes_t bloodSamples;
+        table_changes_t chemoAndMeds;
+    } patient_data_changes_t;
+
+    static const QVector<QString> bloodSamplesColumns;
+    static const QVector<QString> bloodSamplesJsonKeys;
+    static const QVector<QString> chemoAndMedsColumns;
+    static const QVector<QString> chemoAndMedsJsonKeys;
+
+    static bool load(const QString& fileName, patient_data_t& patientData);
+    static bool save(const QString& fileName, const patient_data_t& patientData, QString *journalId = nullptr);
+    static bool saveChanges(const QString& fileName, const patient_data_t& patientData, const patient_data_changes_t& changes,
+                            QString *journalId = nullptr);
+    static QString journalFileName(const QString& fileName);
+    static void applyChanges(QVector<QVector<QString>>& table, const table_changes_t& changes);
+
+    static patient_data_t fromJson(const QJsonObject& patientDataJsonObject);
+    static QJsonObject toJson(const patient_data_t& patientData);
+    static QVector<QVector<QString>> bloodSampleRowsFromJson(const QJsonArray& rowsArray);
+    static QVector<QVector<QString>> chemoAndMedRowsFromJson(const QJsonArray& rowsArray);
+    static QString bloodSampleValueToText(const QJsonValue& value);
+};
+
+#endif // PATIENTDATAFILE_H
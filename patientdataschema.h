@@ -0,0 +1,161 @@
+#ifndef PATIENTDATASCHEMA_H
+#define PATIENTDATASCHEMA_H
+
+#include <QColor>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <string_view>
+
+// Compile-time schema of the patient data tables: name, JSON key and value type of each
+// column of the blood sample and the chemo therapy / medication table, the blood values
+// being taken from the lab parameters. Column indices are resolved from the JSON keys at
+// compile time, so that code working on columns uses constants instead of searching the
+// column names, and a column is added in a single place. Loading, saving and the plot
+// series are generated from the value types.
+namespace PatientDataSchema
+{
+    typedef enum
+    {
+        // Text in the format dd.MM.yyyy.
+        VALUE_DATE,
+
+        // Stored as JSON number, cells which are no number as empty string.
+        VALUE_NUMBER,
+
+        VALUE_TEXT
+    } value_type_t;
+
+    typedef struct
+    {
+        const char *name;
+
+        // Unit appended to the name in brackets, nullptr if there is none.
+        const char *unit;
+
+        const char *jsonKey;
+        value_type_t valueType;
+    } column_t;
+
+    // Value axis of the visualization a lab parameter is plotted on.
+    typedef enum
+    {
+        AXIS_BLOOD_COUNT,
+        AXIS_CHEMISTRY
+    } axis_t;
+
+    typedef struct
+    {
+        // Also the name of the visualization setting.
+        const char *name;
+        const char *unit;
+        const char *jsonKey;
+        QRgb color;
+
+        // Reference range, NaN where there is no limit.
+        double referenceLow;
+        double referenceHigh;
+
+        axis_t axis;
+    } lab_parameter_t;
+
+    constexpr double noLimit = std::numeric_limits<double>::quiet_NaN();
+
+    // Blood values of the blood sample table, in column order after the date.
+    constexpr lab_parameter_t labParameters[]
+    {
+        {"Leukocytes", "Giga/l", "leukocytes", qRgb(0, 0, 255), 4.0, 10.0, AXIS_BLOOD_COUNT},
+        {"Erythrocytes", "Tera/l", "erythrocytes", qRgb(255, 0, 0), 4.0, 5.9, AXIS_BLOOD_COUNT},
+        {"Hemoglobin", "g/dl", "hemoglobin", qRgb(255, 0, 255), 12.0, 17.5, AXIS_BLOOD_COUNT},
+        {"Thrombocytes", "Giga/l", "thrombocytes", qRgb(128, 128, 0), 150.0, 400.0, AXIS_BLOOD_COUNT},
+        {"Neutrophils", "Giga/l", "neutrophils", qRgb(0, 128, 0), 1.8, 7.7, AXIS_BLOOD_COUNT},
+        {"Blasts", "%", "blasts", qRgb(0, 128, 128), noLimit, 0.0, AXIS_BLOOD_COUNT},
+        {"CRP", "mg/l", "crp", qRgb(128, 0, 128), noLimit, 5.0, AXIS_CHEMISTRY},
+        {"LDH", "U/l", "ldh", qRgb(255, 128, 0), noLimit, 250.0, AXIS_CHEMISTRY}
+    };
+
+    constexpr std::size_t labParameterCount = std::size(labParameters);
+
+    constexpr std::array<column_t, 1 + labParameterCount> bloodSamplesColumns = []()
+    {
+        std::array<column_t, 1 + labParameterCount> columns {};
+
+        columns[0] = {"Date", nullptr, "date", VALUE_DATE};
+
+        for(std::size_t i = 0; i < labParameterCount; i++)
+        {
+            columns[i + 1] = {labParameters[i].name, labParameters[i].unit, labParameters[i].jsonKey, VALUE_NUMBER};
+        }
+
+        return columns;
+    }();
+
+    // Days, name and dose are free text as entered.
+    constexpr std::array<column_t, 4> chemoAndMedsColumns
+    {{
+        {"Date (Start)", nullptr, "date", VALUE_DATE},
+        {"Days", nullptr, "days", VALUE_TEXT},
+        {"Name", nullptr, "name", VALUE_TEXT},
+        {"Dose per Day", nullptr, "dose", VALUE_TEXT}
+    }};
+
+    // Returns the index of the column with the passed JSON key, -1 if there is none.
+    template<std::size_t N>
+    constexpr int columnIndex(const std::array<column_t, N>& columns, std::string_view jsonKey)
+    {
+        for(std::size_t i = 0; i < N; i++)
+        {
+            if(std::string_view(columns[i].jsonKey) == jsonKey)
+            {
+                return static_cast<int>(i);
+            }
+        }
+
+        return -1;
+    }
+
+    constexpr int bloodSamplesDateColumn = columnIndex(bloodSamplesColumns, "date");
+
+    // Blood sample table column of each lab parameter, in the order of labParameters.
+    constexpr std::array<int, labParameterCount> labParameterColumns = []()
+    {
+        std::array<int, labParameterCount> columns {};
+
+        for(std::size_t i = 0; i < labParameterCount; i++)
+        {
+            columns[i] = columnIndex(bloodSamplesColumns, labParameters[i].jsonKey);
+        }
+
+        return columns;
+    }();
+
+    // Returns the index in labParameters of the lab parameter of the passed blood sample table
+    // column, -1 for the date column.
+    constexpr int labParameterIndex(int column)
+    {
+        for(std::size_t i = 0; i < labParameterCount; i++)
+        {
+            if(labParameterColumns[i] == column)
+            {
+                return static_cast<int>(i);
+            }
+        }
+
+        return -1;
+    }
+
+    constexpr int leukocytesColumn = columnIndex(bloodSamplesColumns, "leukocytes");
+    constexpr int thrombocytesColumn = columnIndex(bloodSamplesColumns, "thrombocytes");
+
+    constexpr int chemoAndMedsDateColumn = columnIndex(chemoAndMedsColumns, "date");
+    constexpr int chemoAndMedsDaysColumn = columnIndex(chemoAndMedsColumns, "days");
+    constexpr int chemoAndMedsNameColumn = columnIndex(chemoAndMedsColumns, "name");
+    constexpr int chemoAndMedsDoseColumn = columnIndex(chemoAndMedsColumns, "dose");
+
+    static_assert(bloodSamplesDateColumn == 0, "The date must be the first blood sample column.");
+    static_assert(leukocytesColumn > 0 && thrombocytesColumn > 0, "Missing blood value column.");
+    static_assert(chemoAndMedsDateColumn >= 0 && chemoAndMedsDaysColumn >= 0 &&
+                  chemoAndMedsNameColumn >= 0 && chemoAndMedsDoseColumn >= 0, "Missing chemo therapy / medication column.");
+}
+
+#endif // PATIENTDATASCHEMA_H
@@ -0,0 +1,208 @@
+#include "patientfilemonitor.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSysInfo>
+
+const static int pollIntervalMilliseconds = 10 * 1000;
+
+// Lock files are updated after this time while their file is open, a lock file not updated
+// for the stale time is left over.
+const static int lockFileUpdateSeconds = 60;
+const static int lockFileStaleSeconds = 5 * 60;
+
+static QString userName()
+{
+    return qEnvironmentVariable("USERNAME", qEnvironmentVariable("USER"));
+}
+
+PatientFileMonitor::PatientFileMonitor(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_fileSystemWatcher, &QFileSystemWatcher::fileChanged, this, &PatientFileMonitor::update);
+
+    m_pollTimer.setInterval(pollIntervalMilliseconds);
+    connect(&m_pollTimer, &QTimer::timeout, this, &PatientFileMonitor::update);
+    m_pollTimer.start();
+}
+
+PatientFileMonitor::~PatientFileMonitor()
+{
+    for(auto& monitoredFile : m_monitoredFiles)
+    {
+        releaseFile(monitoredFile);
+    }
+}
+
+void PatientFileMonitor::addPatientSession(PatientSession *patientSession)
+{
+    m_monitoredFiles.insert(patientSession, {QString(), false});
+}
+
+void PatientFileMonitor::removePatientSession(PatientSession *patientSession)
+{
+    if(m_monitoredFiles.contains(patientSession))
+    {
+        releaseFile(m_monitoredFiles[patientSession]);
+        m_monitoredFiles.remove(patientSession);
+    }
+}
+
+QString PatientFileMonitor::lockFileName(const QString& patientDataFileName)
+{
+    return patientDataFileName + ".lock";
+}
+
+// Follows the files of the sessions (e.g. after Save As), keeps the lock files up to date and
+// lets the sessions merge the changes of their files.
+void PatientFileMonitor::update()
+{
+    // The sessions are looked up each time, a warning about concurrent editing may let the
+    // user close a session meanwhile.
+    const auto patientSessions = m_monitoredFiles.keys();
+
+    for(auto patientSession : patientSessions)
+    {
+        if(!m_monitoredFiles.contains(patientSession))
+        {
+            continue;
+        }
+
+        auto& monitoredFile = m_monitoredFiles[patientSession];
+
+        if(monitoredFile.fileName != patientSession->fileName())
+        {
+            releaseFile(monitoredFile);
+
+            monitoredFile.fileName = patientSession->fileName();
+
+            if(!monitoredFile.fileName.isEmpty())
+            {
+                monitorFile(patientSession, monitoredFile);
+            }
+
+            continue;
+        }
+
+        if(monitoredFile.fileName.isEmpty())
+        {
+            continue;
+        }
+
+        // Files replaced by an atomic save are not watched anymore.
+        if(!m_fileSystemWatcher.files().contains(monitoredFile.fileName))
+        {
+            m_fileSystemWatcher.addPath(monitoredFile.fileName);
+        }
+
+        QFileInfo lockFileInfo(lockFileName(monitoredFile.fileName));
+
+        if(monitoredFile.locked && lockFileInfo.lastModified().secsTo(QDateTime::currentDateTime()) >= lockFileUpdateSeconds)
+        {
+            writeLockFile(lockFileInfo.filePath());
+        }
+
+        if(patientSession->isFileChangedOnDisk())
+        {
+            patientSession->reloadFileChanges();
+        }
+    }
+}
+
+// Starts watching the file of the passed session and takes its lock file, unless it is held
+// by someone else. The passed file must not be used after the warning has been emitted.
+void PatientFileMonitor::monitorFile(PatientSession *patientSession, monitored_file_t& monitoredFile)
+{
+    m_fileSystemWatcher.addPath(monitoredFile.fileName);
+
+    QString fileName = lockFileName(monitoredFile.fileName);
+    QFileInfo lockFileInfo(fileName);
+
+    if(lockFileInfo.exists() && !isOwnLockFile(fileName) &&
+       lockFileInfo.lastModified().secsTo(QDateTime::currentDateTime()) < lockFileStaleSeconds)
+    {
+        QFile lockFile(fileName);
+        QJsonObject lockJsonObject;
+
+        if(lockFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            lockJsonObject = QJsonDocument::fromJson(lockFile.readAll()).object();
+        }
+
+        monitoredFile.locked = false;
+
+        emit concurrentEditingDetected(patientSession, lockJsonObject["user"].toString(), lockJsonObject["host"].toString(),
+                                       QDateTime::fromString(lockJsonObject["since"].toString(), Qt::ISODate));
+
+        return;
+    }
+
+    monitoredFile.locked = writeLockFile(fileName);
+}
+
+void PatientFileMonitor::releaseFile(monitored_file_t& monitoredFile)
+{
+    if(monitoredFile.fileName.isEmpty())
+    {
+        return;
+    }
+
+    m_fileSystemWatcher.removePath(monitoredFile.fileName);
+
+    // The lock file may have been taken over meanwhile.
+    if(monitoredFile.locked && isOwnLockFile(lockFileName(monitoredFile.fileName)))
+    {
+        QFile::remove(lockFileName(monitoredFile.fileName));
+    }
+
+    monitoredFile.fileName.clear();
+    monitoredFile.locked = false;
+}
+
+bool PatientFileMonitor::isOwnLockFile(const QString& lockFileName)
+{
+    QFile lockFile(lockFileName);
+
+    if(!lockFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QJsonObject lockJsonObject = QJsonDocument::fromJson(lockFile.readAll()).object();
+
+    return lockJsonObject["host"].toString() == QSysInfo::machineHostName() &&
+           lockJsonObject["pid"].toInteger() == QCoreApplication::applicationPid();
+}
+
+// Writes the lock file naming this program, the time the file has been opened is kept.
+bool PatientFileMonitor::writeLockFile(const QString& lockFileName)
+{
+    QString since = QDateTime::currentDateTime().toString(Qt::ISODate);
+    QFile previousLockFile(lockFileName);
+
+    if(isOwnLockFile(lockFileName) && previousLockFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        since = QJsonDocument::fromJson(previousLockFile.readAll()).object()["since"].toString();
+    }
+
+    QJsonObject lockJsonObject;
+
+    lockJsonObject["user"] = userName();
+    lockJsonObject["host"] = QSysInfo::machineHostName();
+    lockJsonObject["pid"] = QCoreApplication::applicationPid();
+    lockJsonObject["since"] = since;
+
+    QSaveFile lockFile(lockFileName);
+
+    if(!lockFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    lockFile.write(QJsonDocument(lockJsonObject).toJson(QJsonDocument::Compact));
+
+    return lockFile.commit();
+}
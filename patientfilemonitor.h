@@ -0,0 +1,59 @@
+#ifndef PATIENTFILEMONITOR_H
+#define PATIENTFILEMONITOR_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QTimer>
+#include "patientsession.h"
+
+// Watches the patient data files of the open sessions for changes made by someone else (e.g.
+// on another workstation), which the sessions merge then. Notifications of files on network
+// drives are not reliable, so the files are polled as well. Each opened file gets an advisory
+// lock file next to it naming who has opened it, so that opening a file opened elsewhere
+// warns about concurrent editing. Lock files are kept up to date while the file is open, a
+// lock file not updated for a while is left over by a program which has not been closed
+// properly and is taken over.
+class PatientFileMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PatientFileMonitor(QObject *parent = nullptr);
+    ~PatientFileMonitor();
+
+    void addPatientSession(PatientSession *patientSession);
+    void removePatientSession(PatientSession *patientSession);
+
+    static QString lockFileName(const QString& patientDataFileName);
+
+public slots:
+    void update();
+
+signals:
+    // Emitted when the file of a session is opened by someone else as well.
+    void concurrentEditingDetected(PatientSession *patientSession, const QString& userName, const QString& hostName,
+                                   const QDateTime& since);
+
+private:
+    typedef struct
+    {
+        QString fileName;
+
+        // Whether the lock file of the file is the one of this program.
+        bool locked;
+    } monitored_file_t;
+
+    QHash<PatientSession*, monitored_file_t> m_monitoredFiles;
+    QFileSystemWatcher m_fileSystemWatcher;
+    QTimer m_pollTimer;
+
+    void monitorFile(PatientSession *patientSession, monitored_file_t& monitoredFile);
+    void releaseFile(monitored_file_t& monitoredFile);
+
+    static bool isOwnLockFile(const QString& lockFileName);
+    static bool writeLockFile(const QString& lockFileName);
+};
+
+#endif // PATIENTFILEMONITOR_H
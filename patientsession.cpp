@@ -0,0 +1,720 @@
+#include "patientsession.h"
+#include "labparameters.h"
+#include "patientdataschema.h"
+#include "patientundocommands.h"
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <limits>
+
+static_assert(PatientDataSchema::bloodSamplesColumns.size() <= PatientTableModel::maxColumnCount &&
+              PatientDataSchema::chemoAndMedsColumns.size() <= PatientTableModel::maxColumnCount,
+              "The table models track changed cells in a bit per column.");
+
+// Fields of the general information, merged one by one with changes of the file.
+const static QVector<QString PatientSession::general_information_t::*> generalInformationFields
+{
+    &PatientSession::general_information_t::patientId,
+    &PatientSession::general_information_t::name,
+    &PatientSession::general_information_t::dateOfBirth,
+    &PatientSession::general_information_t::size,
+    &PatientSession::general_information_t::weight,
+    &PatientSession::general_information_t::bodySurface,
+    &PatientSession::general_information_t::dateOfDiagnosis
+};
+
+// Memory the undo history of a session may use until the settings are applied.
+const static qsizetype defaultUndoMemoryBudget = 16 * 1024 * 1024;
+
+PatientSession::PatientSession(QObject *parent)
+    : QObject(parent)
+    , m_fileSize(0)
+    , m_recovering(false)
+    , m_undoStack(new QUndoStack(this))
+    , m_undoFloorIndex(0)
+    , m_undoMemoryBudget(defaultUndoMemoryBudget)
+    , m_bloodSamplesModel(new PatientTableModel(PatientDataFile::bloodSamplesColumns, PatientDataSchema::bloodSamplesDateColumn, m_undoStack, this))
+    , m_chemoAndMedsModel(new PatientTableModel(PatientDataFile::chemoAndMedsColumns, PatientDataSchema::chemoAndMedsDateColumn, m_undoStack, this))
+    , m_medicationIndex(new MedicationIndex(m_chemoAndMedsModel,
+                                            {PatientDataSchema::chemoAndMedsNameColumn,
+                                             PatientDataSchema::chemoAndMedsDoseColumn},
+                                            this))
+    , m_cycleAnalysis(new CycleAnalysis(m_bloodSamplesModel, m_chemoAndMedsModel, this))
+    , m_derivedSeries(new DerivedSeries(m_bloodSamplesModel, this))
+    , m_doseAccounting(new DoseAccounting(m_chemoAndMedsModel, this))
+    , m_changedSinceLastSave(false)
+    , m_plotDataValid(false)
+{
+    // Tables are scrolled to the bottom (i.e. the latest entries) when shown first.
+    m_viewState.visualizationRangeValid = false;
+    m_viewState.bloodSamplesScrollPosition = -1;
+    m_viewState.chemoAndMedsScrollPosition = -1;
+
+    // Blood values outside of the reference range of their parameter are marked.
+    QVector<QPair<double, double>> referenceRanges {qMakePair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN())};
+
+    for(const auto& parameter : LabParameters::parameters())
+    {
+        referenceRanges.append(qMakePair(parameter.referenceLow, parameter.referenceHigh));
+    }
+
+    m_bloodSamplesModel->setReferenceRanges(referenceRanges);
+
+    // Any change of the tables requires the visualization data to be prepared again.
+    for(auto model : {m_bloodSamplesModel, m_chemoAndMedsModel})
+    {
+        connect(model, &QAbstractItemModel::dataChanged, this, &PatientSession::invalidatePlotData);
+        connect(model, &QAbstractItemModel::rowsInserted, this, &PatientSession::invalidatePlotData);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &PatientSession::invalidatePlotData);
+        connect(model, &QAbstractItemModel::rowsMoved, this, &PatientSession::invalidatePlotData);
+        connect(model, &QAbstractItemModel::modelReset, this, &PatientSession::invalidatePlotData);
+    }
+
+    connect(&m_loadWatcher, &QFutureWatcher<load_result_t>::finished, this, &PatientSession::handleLoadResult);
+    connect(&m_reloadWatcher, &QFutureWatcher<load_result_t>::finished, this, &PatientSession::handleReloadResult);
+
+    // The session has unsaved changes as long as the undo history is not at the saved state.
+    connect(m_undoStack, &QUndoStack::cleanChanged, this, &PatientSession::handleUndoCleanChanged);
+    connect(m_undoStack, &QUndoStack::indexChanged, this, &PatientSession::enforceUndoMemoryBudget);
+    connect(m_undoStack, &QUndoStack::indexChanged, this, &PatientSession::edited);
+}
+
+QString PatientSession::fileName() const
+{
+    return m_fileName;
+}
+
+void PatientSession::setFileName(const QString& fileName)
+{
+    m_fileName = fileName;
+}
+
+// Returns the text shown on the patient's tab.
+QString PatientSession::title() const
+{
+    QString title = m_generalInformation.name;
+
+    if(title.isEmpty())
+    {
+        title = m_fileName.isEmpty() ? "New Patient" : QFileInfo(m_fileName).completeBaseName();
+    }
+
+    if(isLoading())
+    {
+        title += " (loading...)";
+    }
+
+    if(m_changedSinceLastSave)
+    {
+        title += " *";
+    }
+
+    return title;
+}
+
+// Returns whether the session neither shows a file nor contains any changes, so that it can
+// be reused to show a file.
+bool PatientSession::isEmpty() const
+{
+    return m_fileName.isEmpty() && !m_changedSinceLastSave && !isLoading();
+}
+
+const PatientSession::general_information_t& PatientSession::generalInformation() const
+{
+    return m_generalInformation;
+}
+
+// General information as of the last save, e.g. to show the changes since.
+const PatientSession::general_information_t& PatientSession::savedGeneralInformation() const
+{
+    return m_savedGeneralInformation;
+}
+
+void PatientSession::setGeneralInformation(const general_information_t& generalInformation)
+{
+    m_generalInformation = generalInformation;
+
+    m_doseAccounting->setBodySurface(DoseAccounting::parseBodySurface(m_generalInformation.bodySurface));
+}
+
+// Edits a general information field (e.g. &general_information_t::name) undoably.
+void PatientSession::setGeneralInformationField(QString general_information_t::*field, const QString& text)
+{
+    if(m_generalInformation.*field != text)
+    {
+        m_undoStack->push(new SetGeneralInformationCommand(this, field, text));
+    }
+}
+
+void PatientSession::writeGeneralInformationField(QString general_information_t::*field, const QString& text)
+{
+    m_generalInformation.*field = text;
+
+    m_doseAccounting->setBodySurface(DoseAccounting::parseBodySurface(m_generalInformation.bodySurface));
+
+    emit generalInformationChanged();
+}
+
+PatientTableModel* PatientSession::bloodSamplesModel() const
+{
+    return m_bloodSamplesModel;
+}
+
+PatientTableModel* PatientSession::chemoAndMedsModel() const
+{
+    return m_chemoAndMedsModel;
+}
+
+// Index over the names and doses of the chemo therapies and medications.
+MedicationIndex* PatientSession::medicationIndex() const
+{
+    return m_medicationIndex;
+}
+
+// Nadir and recovery of the blood values per chemo therapy cycle.
+CycleAnalysis* PatientSession::cycleAnalysis() const
+{
+    return m_cycleAnalysis;
+}
+
+// Moving averages, smoothed values and slopes of the blood values.
+DerivedSeries* PatientSession::derivedSeries() const
+{
+    return m_derivedSeries;
+}
+
+// Cumulative doses per drug of the chemo therapies and medications.
+DoseAccounting* PatientSession::doseAccounting() const
+{
+    return m_doseAccounting;
+}
+
+// Collects the patient data of the session, e.g. to save it.
+PatientDataFile::patient_data_t PatientSession::patientData() const
+{
+    PatientDataFile::patient_data_t patientData;
+
+    patientData.patientId = m_generalInformation.patientId;
+    patientData.name = m_generalInformation.name;
+    patientData.dateOfBirth = m_generalInformation.dateOfBirth;
+    patientData.size = m_generalInformation.size;
+    patientData.weight = m_generalInformation.weight;
+    patientData.bodySurface = m_generalInformation.bodySurface;
+    patientData.dateOfDiagnosis = m_generalInformation.dateOfDiagnosis;
+    patientData.bloodSamples = m_bloodSamplesModel->columns();
+    patientData.chemoAndMeds = m_chemoAndMedsModel->columns();
+
+    return patientData;
+}
+
+// Collects the changes of the session since the last save, e.g. to append them to the journal
+// of the patient data file.
+PatientDataFile::patient_data_changes_t PatientSession::changesSinceLastSave() const
+{
+    PatientDataFile::patient_data_changes_t changes;
+
+    changes.generalInformation = patientData();
+    changes.generalInformation.bloodSamples.clear();
+    changes.generalInformation.chemoAndMeds.clear();
+    changes.bloodSamples = m_bloodSamplesModel->tableChanges();
+    changes.chemoAndMeds = m_chemoAndMedsModel->tableChanges();
+
+    return changes;
+}
+
+// Loads the passed patient data file in the background, the visualization data is prepared
+// in the background as well. loaded() is emitted when done.
+void PatientSession::load(const QString& fileName)
+{
+    m_fileName = fileName;
+
+    m_loadWatcher.setFuture(QtConcurrent::run(loadPatientData, fileName));
+}
+
+// Loads the unsaved changes of the passed patient data file (empty for a new patient) from the
+// passed recovery file written by Autosave. The session is unsaved afterwards and saved
+// completely, its file may have been changed since the recovery file has been written.
+void PatientSession::recover(const QString& recoveryFileName, const QString& patientDataFileName)
+{
+    m_fileName = patientDataFileName;
+    m_recovering = true;
+
+    m_loadWatcher.setFuture(QtConcurrent::run(loadPatientData, recoveryFileName));
+}
+
+bool PatientSession::isLoading() const
+{
+    return m_loadWatcher.isRunning();
+}
+
+// Saves the session to the passed patient data file. Saving to the file the session has been
+// loaded from or saved to before appends the changed rows only, see
+// PatientDataFile::saveChanges(). Changes of that file made by someone else are merged first,
+// which clears the undo history, see mergeFileChanges(). Returns false if the file cannot be
+// written.
+bool PatientSession::save(const QString& fileName)
+{
+    QString journalId;
+    bool successful = false;
+
+    // Changes of the file made by someone else which have not been merged yet are not
+    // overwritten.
+    if(fileName == m_fileName && isFileChangedOnDisk())
+    {
+        auto loadResult = readPatientData(fileName);
+
+        if(loadResult.successful)
+        {
+            mergeFileChanges(loadResult);
+        }
+    }
+
+    if(fileName == m_fileName && !m_journalId.isEmpty() && QFileInfo(fileName).lastModified() == m_fileLastModified)
+    {
+        auto patientData = this->patientData();
+
+        patientData.journalId = m_journalId;
+
+        successful = PatientDataFile::saveChanges(fileName, patientData, changesSinceLastSave(), &journalId);
+    }
+    else
+    {
+        successful = PatientDataFile::save(fileName, patientData(), &journalId);
+    }
+
+    if(successful)
+    {
+        markSaved(fileName, journalId);
+    }
+
+    return successful;
+}
+
+// Returns whether the file of the session has been written by someone else since it has been
+// loaded, saved or merged by the session.
+bool PatientSession::isFileChangedOnDisk() const
+{
+    if(m_fileName.isEmpty() || m_fileLastModified.isNull() || isLoading())
+    {
+        return false;
+    }
+
+    QFileInfo fileInfo(m_fileName);
+
+    return fileInfo.exists() && (fileInfo.lastModified() != m_fileLastModified || fileInfo.size() != m_fileSize);
+}
+
+// Reads the file of the session in the background and merges its changes made by someone
+// else, see mergeFileChanges(). fileChangesMerged() is emitted when done.
+void PatientSession::reloadFileChanges()
+{
+    if(m_fileName.isEmpty() || isLoading() || m_reloadWatcher.isRunning())
+    {
+        return;
+    }
+
+    m_reloadWatcher.setFuture(QtConcurrent::run(readPatientData, m_fileName));
+}
+
+void PatientSession::handleReloadResult()
+{
+    load_result_t loadResult = m_reloadWatcher.result();
+
+    // Files being written cannot be read, they are read again on the next change. The session
+    // may have been saved or shown another file meanwhile.
+    if(!loadResult.successful || loadResult.fileName != m_fileName || !isFileChangedOnDisk())
+    {
+        return;
+    }
+
+    mergeFileChanges(loadResult);
+}
+
+// Merges the patient data read from the file after it has been changed by someone else and
+// takes it as saved state. The tables are merged row by row, see
+// PatientTableModel::mergeSavedColumns(), general information fields changed in the file are
+// taken over unless they have been edited here as well. Local changes are kept, the undo
+// history does not apply to the merged tables anymore and is cleared.
+void PatientSession::mergeFileChanges(const load_result_t& loadResult)
+{
+    auto fileGeneralInformation = generalInformationOf(loadResult.patientData);
+    auto generalInformation = m_generalInformation;
+    bool generalInformationChanged = false;
+    int conflictCount = 0;
+
+    for(auto field : generalInformationFields)
+    {
+        if(fileGeneralInformation.*field == m_savedGeneralInformation.*field || fileGeneralInformation.*field == generalInformation.*field)
+        {
+            continue;
+        }
+
+        if(generalInformation.*field == m_savedGeneralInformation.*field)
+        {
+            generalInformation.*field = fileGeneralInformation.*field;
+            generalInformationChanged = true;
+        }
+        else
+        {
+            conflictCount++;
+        }
+    }
+
+    setGeneralInformation(generalInformation);
+    m_savedGeneralInformation = fileGeneralInformation;
+
+    int bloodSamplesConflictCount = 0;
+    int chemoAndMedsConflictCount = 0;
+    int changedRowCount = m_bloodSamplesModel->mergeSavedColumns(loadResult.patientData.bloodSamples, &bloodSamplesConflictCount) +
+                          m_chemoAndMedsModel->mergeSavedColumns(loadResult.patientData.chemoAndMeds, &chemoAndMedsConflictCount);
+
+    conflictCount += bloodSamplesConflictCount + chemoAndMedsConflictCount;
+
+    m_journalId = loadResult.patientData.journalId;
+    m_fileLastModified = loadResult.lastModified;
+    m_fileSize = loadResult.size;
+
+    m_undoStack->clear();
+
+    if(hasChangesSinceLastSave())
+    {
+        m_undoStack->resetClean();
+    }
+
+    // The edits made before cannot be undone anymore.
+    emit fileChangesMerged(changedRowCount, conflictCount, generalInformationChanged);
+}
+
+bool PatientSession::hasChangesSinceLastSave() const
+{
+    for(auto field : generalInformationFields)
+    {
+        if(m_generalInformation.*field != m_savedGeneralInformation.*field)
+        {
+            return true;
+        }
+    }
+
+    for(auto model : {m_bloodSamplesModel, m_chemoAndMedsModel})
+    {
+        auto changes = model->tableChanges();
+
+        if(!changes.deletedRows.isEmpty() || !changes.changedCells.isEmpty() || !changes.insertedRows.isEmpty())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Takes the current state as saved state of the passed file.
+void PatientSession::markSaved(const QString& fileName, const QString& journalId)
+{
+    m_fileName = fileName;
+    m_journalId = journalId;
+    m_fileLastModified = QFileInfo(fileName).lastModified();
+    m_fileSize = QFileInfo(fileName).size();
+    m_savedGeneralInformation = m_generalInformation;
+
+    m_bloodSamplesModel->markSaved();
+    m_chemoAndMedsModel->markSaved();
+
+    setChangedSinceLastSave(false);
+}
+
+bool PatientSession::changedSinceLastSave() const
+{
+    return m_changedSinceLastSave;
+}
+
+// Marks the session as saved (or changed). Saving marks the current state of the undo
+// history, undoing or redoing back to it marks the session as saved again.
+void PatientSession::setChangedSinceLastSave(bool changedSinceLastSave)
+{
+    if(changedSinceLastSave != m_changedSinceLastSave)
+    {
+        m_changedSinceLastSave = changedSinceLastSave;
+
+        emit changedSinceLastSaveChanged(m_changedSinceLastSave);
+    }
+
+    if(!changedSinceLastSave)
+    {
+        m_undoStack->setClean();
+    }
+}
+
+void PatientSession::handleUndoCleanChanged(bool clean)
+{
+    setChangedSinceLastSave(!clean);
+}
+
+QUndoStack* PatientSession::undoStack() const
+{
+    return m_undoStack;
+}
+
+// Returns whether there is a command to undo which has not been released.
+bool PatientSession::canUndo() const
+{
+    return m_undoStack->canUndo() && m_undoStack->index() > m_undoFloorIndex;
+}
+
+void PatientSession::undo()
+{
+    if(canUndo())
+    {
+        m_undoStack->undo();
+    }
+}
+
+void PatientSession::redo()
+{
+    m_undoStack->redo();
+}
+
+// Sets the memory the commands of the undo history may use. QUndoStack can only limit the
+// number of commands, so the oldest commands exceeding the budget are released instead: they
+// free their deltas and the history cannot be undone beyond them.
+void PatientSession::setUndoMemoryBudget(qsizetype undoMemoryBudget)
+{
+    m_undoMemoryBudget = undoMemoryBudget;
+
+    enforceUndoMemoryBudget();
+}
+
+void PatientSession::enforceUndoMemoryBudget()
+{
+    // A cleared stack starts over.
+    m_undoFloorIndex = std::min(m_undoFloorIndex, m_undoStack->index());
+
+    qsizetype byteSize = 0;
+
+    for(auto i = m_undoStack->count() - 1; i >= m_undoFloorIndex; i--)
+    {
+        byteSize += PatientUndoCommand::commandByteSize(m_undoStack->command(i));
+
+        // Commands to redo are kept, they are newer than the commands to undo.
+        if(byteSize > m_undoMemoryBudget && i < m_undoStack->index())
+        {
+            // The stack only hands out const commands, the commands themselves are not const.
+            for(auto j = m_undoFloorIndex; j <= i; j++)
+            {
+                PatientUndoCommand::releaseCommand(const_cast<QUndoCommand*>(m_undoStack->command(j)));
+            }
+
+            m_undoFloorIndex = i + 1;
+
+            break;
+        }
+    }
+}
+
+// Returns the visualization data, prepared again only if the tables have been changed.
+const PatientSession::plot_data_t& PatientSession::plotData()
+{
+    if(!m_plotDataValid)
+    {
+        m_plotData = preparePlotData(m_bloodSamplesModel->columns(), m_chemoAndMedsModel->columns());
+        m_plotDataValid = true;
+    }
+
+    return m_plotData;
+}
+
+const PatientSession::view_state_t& PatientSession::viewState() const
+{
+    return m_viewState;
+}
+
+void PatientSession::setViewState(const view_state_t& viewState)
+{
+    m_viewState = viewState;
+}
+
+// Prepares the visualization data of the passed tables (in the column order of the patient
+// data files). Does not use any widget, so it can run on worker threads.
+PatientSession::plot_data_t PatientSession::preparePlotData(const QVector<QVector<QString>>& bloodSamples,
+                                                            const QVector<QVector<QString>>& chemoAndMeds)
+{
+    plot_data_t plotData;
+
+    auto bloodSamplesDateKeys = PatientTableModel::parseDates(bloodSamples, PatientDataSchema::bloodSamplesDateColumn);
+    auto bloodSamplesCount = static_cast<int>(bloodSamplesDateKeys.size());
+
+    plotData.bloodSampleCount = bloodSamplesCount;
+    plotData.hasValidDate = false;
+    plotData.firstDateKey = 0;
+    plotData.lastDateKey = 0;
+
+    // The first and last row with a valid date give the date axis range.
+    for(auto bloodSampleIndex = 0; bloodSampleIndex < bloodSamplesCount; bloodSampleIndex++)
+    {
+        if(bloodSamplesDateKeys[bloodSampleIndex] != PatientTableModel::invalidDateKey)
+        {
+            if(!plotData.hasValidDate)
+            {
+                plotData.firstDateKey = bloodSamplesDateKeys[bloodSampleIndex];
+                plotData.hasValidDate = true;
+            }
+
+            plotData.lastDateKey = bloodSamplesDateKeys[bloodSampleIndex];
+        }
+    }
+
+    // One series per lab parameter of the schema, one graph each.
+    for(auto column : PatientDataSchema::labParameterColumns)
+    {
+        QVector<QCPGraphData> graphData;
+        double graphMaximum = 0.0;
+
+        graphData.reserve(bloodSamplesCount);
+
+        const auto& columnTexts = bloodSamples[column];
+
+        for(auto bloodSampleIndex = 0; bloodSampleIndex < bloodSamplesCount; bloodSampleIndex++)
+        {
+            // Ignore cells of rows with an invalid date and cells which are no number.
+            if(bloodSamplesDateKeys[bloodSampleIndex] == PatientTableModel::invalidDateKey)
+            {
+                continue;
+            }
+
+            bool conversionSuccessful = false;
+            QCPGraphData graphPoint;
+
+            graphPoint.key = bloodSamplesDateKeys[bloodSampleIndex];
+            graphPoint.value = columnTexts[bloodSampleIndex].toDouble(&conversionSuccessful);
+
+            if(!conversionSuccessful)
+            {
+                continue;
+            }
+
+            graphData.append(graphPoint);
+
+            if(graphPoint.value > graphMaximum)
+            {
+                graphMaximum = graphPoint.value;
+            }
+        }
+
+        plotData.graphs.append(graphData);
+        plotData.graphMaximums.append(graphMaximum);
+    }
+
+    auto chemoAndMedsDateKeys = PatientTableModel::parseDates(chemoAndMeds, PatientDataSchema::chemoAndMedsDateColumn);
+
+    for(auto i = 0; i < chemoAndMedsDateKeys.size(); i++)
+    {
+        // Rows without a valid date cannot be placed on the x-axis.
+        if(chemoAndMedsDateKeys[i] == PatientTableModel::invalidDateKey)
+        {
+            continue;
+        }
+
+        medication_label_t medicationLabel;
+
+        medicationLabel.dateKey = chemoAndMedsDateKeys[i];
+        medicationLabel.days = 1;
+        medicationLabel.text = chemoAndMeds[PatientDataSchema::chemoAndMedsNameColumn][i] + "\n" + chemoAndMeds[PatientDataSchema::chemoAndMedsDoseColumn][i];
+
+        bool conversionSuccessful = false;
+        int days = chemoAndMeds[PatientDataSchema::chemoAndMedsDaysColumn][i].toInt(&conversionSuccessful);
+
+        if(conversionSuccessful)
+        {
+            medicationLabel.days = days;
+        }
+
+        plotData.medicationLabels.append(medicationLabel);
+    }
+
+    return plotData;
+}
+
+void PatientSession::invalidatePlotData()
+{
+    m_plotDataValid = false;
+}
+
+// Takes over a patient data file loaded in the background.
+void PatientSession::handleLoadResult()
+{
+    load_result_t loadResult = m_loadWatcher.result();
+
+    if(loadResult.successful)
+    {
+        setGeneralInformation(generalInformationOf(loadResult.patientData));
+
+        // The table columns are handed over at once so that the views are reset only once.
+        m_bloodSamplesModel->setColumns(loadResult.patientData.bloodSamples);
+        m_chemoAndMedsModel->setColumns(loadResult.patientData.chemoAndMeds);
+
+        m_plotData = loadResult.plotData;
+        m_plotDataValid = true;
+        m_viewState.visualizationRangeValid = false;
+        m_viewState.bloodSamplesScrollPosition = -1;
+        m_viewState.chemoAndMedsScrollPosition = -1;
+
+        // The history of the previous contents does not apply to the loaded file.
+        m_undoStack->clear();
+
+        markSaved(m_fileName, loadResult.patientData.journalId);
+
+        // Undoing back to the recovered state does not make the session saved.
+        if(m_recovering)
+        {
+            m_journalId.clear();
+            m_fileLastModified = QDateTime();
+            m_undoStack->resetClean();
+        }
+    }
+
+    m_recovering = false;
+
+    emit loaded(loadResult.successful);
+}
+
+PatientSession::general_information_t PatientSession::generalInformationOf(const PatientDataFile::patient_data_t& patientData)
+{
+    general_information_t generalInformation;
+
+    generalInformation.patientId = patientData.patientId;
+    generalInformation.name = patientData.name;
+    generalInformation.dateOfBirth = patientData.dateOfBirth;
+    generalInformation.size = patientData.size;
+    generalInformation.weight = patientData.weight;
+    generalInformation.bodySurface = patientData.bodySurface;
+    generalInformation.dateOfDiagnosis = patientData.dateOfDiagnosis;
+
+    return generalInformation;
+}
+
+// Runs on a worker thread: reads the patient data file.
+PatientSession::load_result_t PatientSession::readPatientData(const QString& fileName)
+{
+    load_result_t loadResult;
+    QFileInfo fileInfo(fileName);
+
+    loadResult.fileName = fileName;
+    loadResult.lastModified = fileInfo.lastModified();
+    loadResult.size = fileInfo.size();
+    loadResult.successful = PatientDataFile::load(fileName, loadResult.patientData);
+
+    return loadResult;
+}
+
+// Runs on a worker thread: reads the patient data file and prepares its visualization data.
+PatientSession::load_result_t PatientSession::loadPatientData(const QString& fileName)
+{
+    load_result_t loadResult = readPatientData(fileName);
+
+    if(loadResult.successful)
+    {
+        loadResult.plotData = preparePlotData(loadResult.patientData.bloodSamples, loadResult.patientData.chemoAndMeds);
+    }
+
+    return loadResult;
+}
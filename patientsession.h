@@ -0,0 +1,203 @@
+#ifndef PATIENTSESSION_H
+#define PATIENTSESSION_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QString>
+#include <QUndoStack>
+#include <QVector>
+#include "qcustomplot.h"
+#include "patientdatafile.h"
+#include "patienttablemodel.h"
+#include "medicationindex.h"
+#include "cycleanalysis.h"
+#include "derivedseries.h"
+#include "doseaccounting.h"
+
+// A patient opened in the main window: the general information, the table models and the
+// prepared visualization data. The widgets are shared by all sessions, the main window shows
+// the active session only, so inactive sessions hold data but no widget state. Each session
+// has its own undo history of the table and general information edits. Changes of the file
+// made by someone else are merged into the session row by row.
+class PatientSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct
+    {
+        QString patientId;
+        QString name;
+        QString dateOfBirth;
+        QString size;
+        QString weight;
+        QString bodySurface;
+        QString dateOfDiagnosis;
+    } general_information_t;
+
+    // Chemo therapy / medication label of the visualization.
+    typedef struct
+    {
+        qint64 dateKey;
+        int days;
+        QString text;
+    } medication_label_t;
+
+    // Visualization data prepared from the tables, independent of the plot widget.
+    typedef struct
+    {
+        int bloodSampleCount;
+        bool hasValidDate;
+        qint64 firstDateKey;
+        qint64 lastDateKey;
+
+        // Graph data and maximum value per lab parameter, in the order of LabParameters::parameters().
+        QVector<QVector<QCPGraphData>> graphs;
+        QVector<double> graphMaximums;
+
+        QVector<medication_label_t> medicationLabels;
+    } plot_data_t;
+
+    // View state of the shared widgets, restored when the session is activated again.
+    typedef struct
+    {
+        bool visualizationRangeValid;
+        QCPRange visualizationRange;
+        int bloodSamplesScrollPosition;
+        int chemoAndMedsScrollPosition;
+    } view_state_t;
+
+    explicit PatientSession(QObject *parent = nullptr);
+
+    QString fileName() const;
+    void setFileName(const QString& fileName);
+    QString title() const;
+    bool isEmpty() const;
+
+    const general_information_t& generalInformation() const;
+    const general_information_t& savedGeneralInformation() const;
+    void setGeneralInformation(const general_information_t& generalInformation);
+    void setGeneralInformationField(QString general_information_t::*field, const QString& text);
+
+    PatientTableModel* bloodSamplesModel() const;
+    PatientTableModel* chemoAndMedsModel() const;
+    MedicationIndex* medicationIndex() const;
+    CycleAnalysis* cycleAnalysis() const;
+    DerivedSeries* derivedSeries() const;
+    DoseAccounting* doseAccounting() const;
+
+    PatientDataFile::patient_data_t patientData() const;
+    PatientDataFile::patient_data_changes_t changesSinceLastSave() const;
+    void load(const QString& fileName);
+    void recover(const QString& recoveryFileName, const QString& patientDataFileName);
+    bool isLoading() const;
+    bool save(const QString& fileName);
+    bool isFileChangedOnDisk() const;
+    void reloadFileChanges();
+
+    bool changedSinceLastSave() const;
+    void setChangedSinceLastSave(bool changedSinceLastSave);
+
+    QUndoStack* undoStack() const;
+    bool canUndo() const;
+    void undo();
+    void redo();
+    void setUndoMemoryBudget(qsizetype undoMemoryBudget);
+
+    const plot_data_t& plotData();
+
+    const view_state_t& viewState() const;
+    void setViewState(const view_state_t& viewState);
+
+    static plot_data_t preparePlotData(const QVector<QVector<QString>>& bloodSamples,
+                                       const QVector<QVector<QString>>& chemoAndMeds);
+
+signals:
+    // Emitted when loading a patient data file started by load() has finished.
+    void loaded(bool successful);
+
+    void changedSinceLastSaveChanged(bool changedSinceLastSave);
+
+    // Emitted when a general information field has been edited, undone or redone.
+    void generalInformationChanged();
+
+    // Emitted after each edit, undo or redo of the patient data.
+    void edited();
+
+    // Emitted when changes of the file made by someone else have been merged, see
+    // reloadFileChanges() and save(). The undo history has been cleared then.
+    void fileChangesMerged(int changedRowCount, int conflictCount, bool generalInformationChanged);
+
+private slots:
+    void invalidatePlotData();
+    void handleLoadResult();
+    void handleReloadResult();
+    void handleUndoCleanChanged(bool clean);
+    void enforceUndoMemoryBudget();
+
+private:
+    typedef struct
+    {
+        bool successful;
+        QString fileName;
+
+        // Of the file before it has been read.
+        QDateTime lastModified;
+        qint64 size;
+
+        PatientDataFile::patient_data_t patientData;
+        plot_data_t plotData;
+    } load_result_t;
+
+    friend class SetGeneralInformationCommand;
+
+    QString m_fileName;
+    general_information_t m_generalInformation;
+    general_information_t m_savedGeneralInformation;
+
+    // Journal id, modification time and size of the file as of the last load, save or merge.
+    // Changes are only appended to the journal if the file has not been written by someone
+    // else since. The modification time is null if the file is not known, e.g. after a
+    // recovery.
+    QString m_journalId;
+    QDateTime m_fileLastModified;
+    qint64 m_fileSize;
+
+    // Set while a recovery file is loaded, whose contents are unsaved changes.
+    bool m_recovering;
+
+    // Created before the models, which execute their modifications on it.
+    QUndoStack *m_undoStack;
+
+    // The commands below this index have been released to stay within the memory budget and
+    // cannot be undone anymore.
+    int m_undoFloorIndex;
+    qsizetype m_undoMemoryBudget;
+
+    PatientTableModel *m_bloodSamplesModel;
+    PatientTableModel *m_chemoAndMedsModel;
+    MedicationIndex *m_medicationIndex;
+    CycleAnalysis *m_cycleAnalysis;
+    DerivedSeries *m_derivedSeries;
+    DoseAccounting *m_doseAccounting;
+    bool m_changedSinceLastSave;
+
+    plot_data_t m_plotData;
+    bool m_plotDataValid;
+    view_state_t m_viewState;
+
+    QFutureWatcher<load_result_t> m_loadWatcher;
+    QFutureWatcher<load_result_t> m_reloadWatcher;
+
+    void writeGeneralInformationField(QString general_information_t::*field, const QString& text);
+    void markSaved(const QString& fileName, const QString& journalId);
+    void mergeFileChanges(const load_result_t& loadResult);
+    bool hasChangesSinceLastSave() const;
+
+    static general_information_t generalInformationOf(const PatientDataFile::patient_data_t& patientData);
+    static load_result_t readPatientData(const QString& fileName);
+    static load_result_t loadPatientData(const QString& fileName);
+};
+
+#endif // PATIENTSESSION_H
@@ -0,0 +1,990 @@
+#include "patienttablemodel.h"
+#include "patientundocommands.h"
+#include <QBrush>
+#include <QDateTime>
+#include <QHash>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const qint64 PatientTableModel::invalidDateKey = std::numeric_limits<qint64>::min();
+
+// Returns the texts of a row of the passed columnar table as single key, so that rows can be
+// compared by a hash lookup.
+static QString rowKey(const QVector<QVector<QString>>& columns, int row)
+{
+    QString key;
+
+    for(const auto& column : columns)
+    {
+        key += column[row];
+        key += QChar(0x1f);
+    }
+
+    return key;
+}
+
+PatientTableModel::PatientTableModel(const QVector<QString>& columnNames, int dateColumn, QUndoStack *undoStack, QObject *parent)
+    : QAbstractTableModel(parent)
+    , m_columnNames(columnNames)
+    , m_dateColumn(dateColumn)
+    , m_undoStack(undoStack)
+    , m_columns(columnNames.size())
+    , m_referenceRanges(columnNames.size(), qMakePair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()))
+    , m_invalidDateCount(0)
+    , m_savedColumns(columnNames.size())
+    , m_saveGeneration(0)
+{
+    Q_ASSERT(columnNames.size() <= maxColumnCount);
+}
+
+int PatientTableModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+    {
+        return 0;
+    }
+
+    return static_cast<int>(m_dateKeys.size());
+}
+
+int PatientTableModel::columnCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+    {
+        return 0;
+    }
+
+    return static_cast<int>(m_columns.size());
+}
+
+QVariant PatientTableModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid())
+    {
+        return QVariant();
+    }
+
+    if(role == Qt::DisplayRole || role == Qt::EditRole)
+    {
+        return m_columns[index.column()][index.row()];
+    }
+
+    if(index.column() == m_dateColumn && isDateInvalid(index.row()))
+    {
+        if(role == InvalidCellRole)
+        {
+            return true;
+        }
+
+        if(role == Qt::ToolTipRole)
+        {
+            return QString("Invalid date entry! Format must be dd.MM.yyyy .");
+        }
+    }
+
+    // Values below the reference range are shown in blue, values above in red.
+    if(role == Qt::ForegroundRole)
+    {
+        const auto& referenceRange = m_referenceRanges[index.column()];
+
+        if(std::isnan(referenceRange.first) && std::isnan(referenceRange.second))
+        {
+            return QVariant();
+        }
+
+        bool conversionSuccessful = false;
+        double value = m_columns[index.column()][index.row()].toDouble(&conversionSuccessful);
+
+        if(conversionSuccessful && value < referenceRange.first)
+        {
+            return QBrush(Qt::blue);
+        }
+
+        if(conversionSuccessful && value > referenceRange.second)
+        {
+            return QBrush(Qt::red);
+        }
+    }
+
+    return QVariant();
+}
+
+bool PatientTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if(!index.isValid() || role != Qt::EditRole)
+    {
+        return false;
+    }
+
+    QString text = value.toString();
+
+    // Like QTableWidgetItem, do not report a change if the text has not been changed.
+    if(m_columns[index.column()][index.row()] == text)
+    {
+        return true;
+    }
+
+    m_undoStack->push(new SetCellCommand(this, index.row(), index.column(), text));
+
+    return true;
+}
+
+QVariant PatientTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < m_columnNames.size())
+    {
+        return m_columnNames[section];
+    }
+
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags PatientTableModel::flags(const QModelIndex &index) const
+{
+    if(!index.isValid())
+    {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEditable | Qt::ItemIsEnabled;
+}
+
+bool PatientTableModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    if(parent.isValid() || row < 0 || row > rowCount() || count <= 0)
+    {
+        return false;
+    }
+
+    m_undoStack->push(new InsertRowsCommand(this, row, count));
+
+    return true;
+}
+
+bool PatientTableModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if(parent.isValid() || row < 0 || count <= 0 || row + count > rowCount())
+    {
+        return false;
+    }
+
+    m_undoStack->push(new RemoveRowsCommand(this, row, count));
+
+    return true;
+}
+
+const QString& PatientTableModel::text(int row, int column) const
+{
+    return m_columns[column][row];
+}
+
+const QVector<QString>& PatientTableModel::columnTexts(int column) const
+{
+    return m_columns[column];
+}
+
+const QVector<QVector<QString>>& PatientTableModel::columns() const
+{
+    return m_columns;
+}
+
+// Replaces the complete table contents, e.g. when loading a patient data file. Columns
+// with less rows than the longest column are padded with empty cells. The contents are
+// considered saved.
+void PatientTableModel::setColumns(const QVector<QVector<QString>>& columns)
+{
+    beginResetModel();
+
+    m_columns = columns;
+    m_columns.resize(m_columnNames.size());
+
+    qsizetype rows = 0;
+
+    for(const auto& column : m_columns)
+    {
+        rows = std::max(rows, static_cast<qsizetype>(column.size()));
+    }
+
+    for(auto& column : m_columns)
+    {
+        column.resize(rows);
+    }
+
+    m_dateKeys.resize(rows);
+
+    int invalidDateCount = 0;
+
+    for(auto row = 0; row < rows; row++)
+    {
+        m_dateKeys[row] = parseDate(m_columns[m_dateColumn][row]);
+        invalidDateCount += isDateInvalid(row);
+    }
+
+    markSaved();
+
+    endResetModel();
+
+    updateInvalidDateCount(invalidDateCount);
+}
+
+// Takes the current contents as saved state: all rows are unchanged afterwards.
+void PatientTableModel::markSaved()
+{
+    m_savedColumns = m_columns;
+    m_rowStates.resize(m_dateKeys.size());
+
+    for(auto row = 0; row < m_rowStates.size(); row++)
+    {
+        m_rowStates[row] = {row, 0};
+    }
+
+    m_saveGeneration++;
+}
+
+int PatientTableModel::saveGeneration() const
+{
+    return m_saveGeneration;
+}
+
+const PatientTableModel::row_state_t& PatientTableModel::rowState(int row) const
+{
+    return m_rowStates[row];
+}
+
+const QString& PatientTableModel::savedText(int savedRow, int column) const
+{
+    return m_savedColumns[column][savedRow];
+}
+
+// Returns the rows of the last saved table which are not in the table anymore, ascending.
+QVector<int> PatientTableModel::deletedSavedRows() const
+{
+    auto savedRowCount = m_savedColumns.isEmpty() ? 0 : static_cast<int>(m_savedColumns[0].size());
+    QVector<bool> kept(savedRowCount, false);
+    QVector<int> deletedRows;
+
+    for(const auto& rowState : m_rowStates)
+    {
+        if(rowState.savedRow >= 0)
+        {
+            kept[rowState.savedRow] = true;
+        }
+    }
+
+    for(auto savedRow = 0; savedRow < savedRowCount; savedRow++)
+    {
+        if(!kept[savedRow])
+        {
+            deletedRows.append(savedRow);
+        }
+    }
+
+    return deletedRows;
+}
+
+// Returns the changes since the last save as written to the journal of the patient data file.
+// The longest sequence of saved rows still in saved order is kept, their dirty cells are
+// listed as edited. All other saved rows (deleted or moved, e.g. by editing the date) are
+// listed as deleted and the rows not kept as inserted.
+PatientDataFile::table_changes_t PatientTableModel::tableChanges() const
+{
+    PatientDataFile::table_changes_t changes;
+
+    // Longest increasing subsequence of the saved rows in O(n log n): tails[k] is the row
+    // ending the best sequence of length k + 1 found so far, previous links the sequence.
+    QVector<int> tails;
+    QVector<int> previous(m_rowStates.size(), -1);
+
+    for(auto row = 0; row < m_rowStates.size(); row++)
+    {
+        auto savedRow = m_rowStates[row].savedRow;
+
+        if(savedRow < 0)
+        {
+            continue;
+        }
+
+        auto position = std::lower_bound(tails.begin(), tails.end(), savedRow, [this](int tailRow, int value)
+        {
+            return m_rowStates[tailRow].savedRow < value;
+        }) - tails.begin();
+
+        if(position > 0)
+        {
+            previous[row] = tails[position - 1];
+        }
+
+        if(position == tails.size())
+        {
+            tails.append(row);
+        }
+        else
+        {
+            tails[position] = row;
+        }
+    }
+
+    QVector<bool> kept(m_rowStates.size(), false);
+
+    for(auto row = tails.isEmpty() ? -1 : tails.last(); row >= 0; row = previous[row])
+    {
+        kept[row] = true;
+    }
+
+    auto savedRowCount = m_savedColumns.isEmpty() ? 0 : static_cast<int>(m_savedColumns[0].size());
+    QVector<bool> savedRowKept(savedRowCount, false);
+
+    for(auto row = 0; row < m_rowStates.size(); row++)
+    {
+        const auto& rowState = m_rowStates[row];
+
+        if(kept[row])
+        {
+            savedRowKept[rowState.savedRow] = true;
+
+            for(auto column = 0; column < m_columns.size(); column++)
+            {
+                if(rowState.dirtyColumns & (1u << column))
+                {
+                    changes.changedCells.append({rowState.savedRow, column, m_columns[column][row]});
+                }
+            }
+        }
+        else
+        {
+            QVector<QString> texts(m_columns.size());
+
+            for(auto column = 0; column < m_columns.size(); column++)
+            {
+                texts[column] = m_columns[column][row];
+            }
+
+            changes.insertedRows.append(qMakePair(row, texts));
+        }
+    }
+
+    for(auto savedRow = 0; savedRow < savedRowCount; savedRow++)
+    {
+        if(!savedRowKept[savedRow])
+        {
+            changes.deletedRows.append(savedRow);
+        }
+    }
+
+    return changes;
+}
+
+// Sets the reference range (low, high) of each column, NaN where there is no limit.
+void PatientTableModel::setReferenceRanges(const QVector<QPair<double, double>>& referenceRanges)
+{
+    if(referenceRanges.size() != m_columns.size())
+    {
+        return;
+    }
+
+    m_referenceRanges = referenceRanges;
+
+    if(rowCount())
+    {
+        emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1), {Qt::ForegroundRole});
+    }
+}
+
+int PatientTableModel::dateColumn() const
+{
+    return m_dateColumn;
+}
+
+// Returns the date of the passed row in seconds since epoch or invalidDateKey.
+qint64 PatientTableModel::dateKey(int row) const
+{
+    return m_dateKeys[row];
+}
+
+bool PatientTableModel::isDateValid(int row) const
+{
+    return m_dateKeys[row] != invalidDateKey;
+}
+
+// Returns true if the passed row contains a date entry which is not valid. Rows without a
+// date entry (e.g. rows just added and not yet filled) are not considered invalid.
+bool PatientTableModel::isDateInvalid(int row) const
+{
+    return m_dateKeys[row] == invalidDateKey && !m_columns[m_dateColumn][row].isEmpty();
+}
+
+int PatientTableModel::invalidDateCount() const
+{
+    return m_invalidDateCount;
+}
+
+void PatientTableModel::updateInvalidDateCount(int invalidDateCount)
+{
+    if(invalidDateCount != m_invalidDateCount)
+    {
+        m_invalidDateCount = invalidDateCount;
+
+        emit invalidDateCountChanged(m_invalidDateCount);
+    }
+}
+
+// Moves the passed row so that it ends up at the passed destination row index.
+void PatientTableModel::moveRowTo(int row, int destinationRow)
+{
+    if(row == destinationRow)
+    {
+        return;
+    }
+
+    // beginMoveRows() expects the destination in terms of the row indices before moving.
+    auto destinationChild = destinationRow > row ? destinationRow + 1 : destinationRow;
+
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), destinationChild);
+
+    for(auto& column : m_columns)
+    {
+        column.move(row, destinationRow);
+    }
+
+    m_dateKeys.move(row, destinationRow);
+    m_rowStates.move(row, destinationRow);
+
+    endMoveRows();
+}
+
+// Returns the row index the passed row must be moved to so that all rows with a valid date
+// are sorted date ascending. Rows with an equal date keep their order, so the passed row is
+// placed after them. Rows with an invalid date are not moved.
+int PatientTableModel::sortedDestinationRow(int row) const
+{
+    auto key = m_dateKeys[row];
+
+    if(key == invalidDateKey)
+    {
+        return row;
+    }
+
+    // Position counts the rows without the passed row.
+    int position = 0;
+    int destinationRow = -1;
+
+    for(auto i = 0; i < m_dateKeys.size(); i++)
+    {
+        if(i == row)
+        {
+            continue;
+        }
+
+        if(m_dateKeys[i] != invalidDateKey)
+        {
+            if(m_dateKeys[i] > key)
+            {
+                destinationRow = position;
+                break;
+            }
+
+            destinationRow = position + 1;
+        }
+
+        position++;
+    }
+
+    if(destinationRow < 0)
+    {
+        return row;
+    }
+
+    return destinationRow;
+}
+
+// Inserts the passed rows (each a vector of cell texts in column order) so that all rows
+// with a valid date stay sorted date ascending, see mergeRowsSorted(). Views are reset only
+// once. Returns the resulting row index of the first inserted row in date order.
+int PatientTableModel::insertRowsSorted(const QVector<QVector<QString>>& rows)
+{
+    if(rows.isEmpty())
+    {
+        return -1;
+    }
+
+    // The command stays on the stack, merged rows are never merged with other commands.
+    auto command = new InsertRowsSortedCommand(this, rows);
+
+    m_undoStack->push(command);
+
+    return command->firstInsertedRow();
+}
+
+// Merges the passed rows (each a vector of cell texts in column order) into the passed
+// columnar table whose rows with a valid date are sorted date ascending. dateKeys holds the
+// parsed date column of the table and is updated as well. The new rows are validated and
+// sorted first (O(m log m)) and then merged with the already sorted rows in a single pass
+// (O(n + m)). New rows with an invalid date are appended at the end. Works without a model,
+// so that patient data files can be merged on worker threads. If passed, invalidDateCount
+// is increased by the number of new rows with an invalid, non-empty date. If passed,
+// insertedRows receives the resulting row indices of all inserted rows, ascending.
+// Returns the resulting row index of the first inserted row in date order.
+int PatientTableModel::mergeRowsSorted(QVector<QVector<QString>>& columns, QVector<qint64>& dateKeys, int dateColumn,
+                                       const QVector<QVector<QString>>& rows, int *invalidDateCount,
+                                       QVector<int> *insertedRows)
+{
+    if(rows.isEmpty())
+    {
+        return -1;
+    }
+
+    auto newRowCount = static_cast<int>(rows.size());
+    QVector<qint64> newDateKeys(newRowCount);
+    QVector<int> newRowOrder(newRowCount);
+
+    for(auto i = 0; i < newRowCount; i++)
+    {
+        const auto& dateString = rows[i].value(dateColumn);
+
+        newDateKeys[i] = parseDate(dateString);
+        newRowOrder[i] = i;
+
+        if(invalidDateCount && newDateKeys[i] == invalidDateKey && !dateString.isEmpty())
+        {
+            (*invalidDateCount)++;
+        }
+    }
+
+    std::stable_sort(newRowOrder.begin(), newRowOrder.end(), [&newDateKeys](int a, int b)
+    {
+        auto aValid = newDateKeys[a] != invalidDateKey;
+        auto bValid = newDateKeys[b] != invalidDateKey;
+
+        if(aValid != bValid)
+        {
+            return aValid;
+        }
+
+        return newDateKeys[a] < newDateKeys[b];
+    });
+
+    auto existingRowCount = static_cast<int>(dateKeys.size());
+    auto columnCount = static_cast<int>(columns.size());
+
+    QVector<QVector<QString>> mergedColumns(columnCount);
+    QVector<qint64> mergedDateKeys;
+
+    for(auto& column : mergedColumns)
+    {
+        column.reserve(existingRowCount + newRowCount);
+    }
+
+    mergedDateKeys.reserve(existingRowCount + newRowCount);
+
+    int firstInsertedRow = -1;
+    int nextNewRow = 0;
+
+    auto appendNewRow = [&](int newRow)
+    {
+        if(firstInsertedRow < 0)
+        {
+            firstInsertedRow = static_cast<int>(mergedDateKeys.size());
+        }
+
+        if(insertedRows)
+        {
+            insertedRows->append(static_cast<int>(mergedDateKeys.size()));
+        }
+
+        for(auto column = 0; column < columnCount; column++)
+        {
+            mergedColumns[column].append(rows[newRow].value(column));
+        }
+
+        mergedDateKeys.append(newDateKeys[newRow]);
+    };
+
+    for(auto row = 0; row < existingRowCount; row++)
+    {
+        // Existing rows with an invalid date keep their position relative to their neighbours.
+        if(dateKeys[row] != invalidDateKey)
+        {
+            while(nextNewRow < newRowCount &&
+                  newDateKeys[newRowOrder[nextNewRow]] != invalidDateKey &&
+                  newDateKeys[newRowOrder[nextNewRow]] < dateKeys[row])
+            {
+                appendNewRow(newRowOrder[nextNewRow++]);
+            }
+        }
+
+        for(auto column = 0; column < columnCount; column++)
+        {
+            mergedColumns[column].append(columns[column][row]);
+        }
+
+        mergedDateKeys.append(dateKeys[row]);
+    }
+
+    while(nextNewRow < newRowCount)
+    {
+        appendNewRow(newRowOrder[nextNewRow++]);
+    }
+
+    columns = mergedColumns;
+    dateKeys = mergedDateKeys;
+
+    return firstInsertedRow;
+}
+
+// Merges the passed table, read from the saved file after it has been changed by someone else
+// (e.g. on another workstation), and takes it as saved state. Rows are compared by their
+// texts with the last saved table: saved rows which are not in the file anymore are removed
+// unless they have been edited here, rows new in the file are inserted in date order unless
+// the same row has been added here. Only these rows are touched, so local changes are kept
+// and the views are not reset. Returns the number of removed and inserted rows. If passed,
+// conflictCount receives the number of rows edited here which have been changed or deleted
+// in the file as well, these are kept as added rows.
+int PatientTableModel::mergeSavedColumns(const QVector<QVector<QString>>& columns, int *conflictCount)
+{
+    QVector<QVector<QString>> savedColumns = columns;
+    qsizetype savedRowCount = 0;
+
+    savedColumns.resize(m_columnNames.size());
+
+    for(const auto& column : savedColumns)
+    {
+        savedRowCount = std::max(savedRowCount, static_cast<qsizetype>(column.size()));
+    }
+
+    for(auto& column : savedColumns)
+    {
+        column.resize(savedRowCount);
+    }
+
+    // Match the rows of the last saved table with the rows of the file, equal rows in order.
+    QHash<QString, QVector<int>> savedRowsOfKey;
+
+    for(auto savedRow = 0; savedRow < savedRowCount; savedRow++)
+    {
+        savedRowsOfKey[rowKey(savedColumns, savedRow)].append(savedRow);
+    }
+
+    auto previousSavedRowCount = m_savedColumns.isEmpty() ? 0 : static_cast<int>(m_savedColumns[0].size());
+    QVector<int> savedRowMatches(previousSavedRowCount, -1);
+    QVector<bool> savedRowMatched(savedRowCount, false);
+
+    for(auto previousSavedRow = 0; previousSavedRow < previousSavedRowCount; previousSavedRow++)
+    {
+        auto it = savedRowsOfKey.find(rowKey(m_savedColumns, previousSavedRow));
+
+        if(it != savedRowsOfKey.end() && !it->isEmpty())
+        {
+            savedRowMatches[previousSavedRow] = it->takeFirst();
+            savedRowMatched[savedRowMatches[previousSavedRow]] = true;
+        }
+    }
+
+    int changedRowCount = 0;
+    int conflicts = 0;
+
+    for(auto row = rowCount() - 1; row >= 0; row--)
+    {
+        auto& rowState = m_rowStates[row];
+
+        if(rowState.savedRow < 0 || savedRowMatches[rowState.savedRow] >= 0)
+        {
+            continue;
+        }
+
+        if(rowState.dirtyColumns)
+        {
+            rowState = {-1, 0};
+            conflicts++;
+        }
+        else
+        {
+            takeRows(row, 1);
+            changedRowCount++;
+        }
+    }
+
+    // Rows added here which are in the file as well are saved now.
+    QHash<QString, QVector<int>> addedRowsOfKey;
+
+    for(auto row = 0; row < m_rowStates.size(); row++)
+    {
+        auto& rowState = m_rowStates[row];
+
+        if(rowState.savedRow >= 0)
+        {
+            rowState.savedRow = savedRowMatches[rowState.savedRow];
+        }
+        else
+        {
+            addedRowsOfKey[rowKey(m_columns, row)].append(row);
+        }
+    }
+
+    for(auto savedRow = 0; savedRow < savedRowCount; savedRow++)
+    {
+        auto it = savedRowMatched[savedRow] ? addedRowsOfKey.end() : addedRowsOfKey.find(rowKey(savedColumns, savedRow));
+
+        if(it != addedRowsOfKey.end() && !it->isEmpty())
+        {
+            m_rowStates[it->takeFirst()] = {savedRow, 0};
+            savedRowMatched[savedRow] = true;
+        }
+    }
+
+    m_savedColumns = savedColumns;
+    m_saveGeneration++;
+
+    for(auto savedRow = 0; savedRow < savedRowCount; savedRow++)
+    {
+        if(savedRowMatched[savedRow])
+        {
+            continue;
+        }
+
+        QVector<QString> texts(m_columns.size());
+
+        for(auto column = 0; column < m_columns.size(); column++)
+        {
+            texts[column] = m_savedColumns[column][savedRow];
+        }
+
+        insertRowTexts(sortedInsertionRow(parseDate(texts[m_dateColumn])), {texts}, {{savedRow, 0}});
+        changedRowCount++;
+    }
+
+    if(conflictCount)
+    {
+        *conflictCount = conflicts;
+    }
+
+    return changedRowCount;
+}
+
+// Returns the row index a new row with the passed date is merged at, like mergeRowsSorted():
+// before the first row with a later valid date, rows with an invalid date at the end.
+int PatientTableModel::sortedInsertionRow(qint64 dateKey) const
+{
+    if(dateKey != invalidDateKey)
+    {
+        for(auto row = 0; row < m_dateKeys.size(); row++)
+        {
+            if(m_dateKeys[row] != invalidDateKey && m_dateKeys[row] > dateKey)
+            {
+                return row;
+            }
+        }
+    }
+
+    return static_cast<int>(m_dateKeys.size());
+}
+
+// Sets the text of a cell and keeps the parsed date column and the dirty bit of the cell in
+// sync. An edit back to the saved text clears the bit again.
+void PatientTableModel::writeText(int row, int column, const QString& text)
+{
+    auto invalidDateCount = m_invalidDateCount;
+    auto& rowState = m_rowStates[row];
+
+    if(rowState.savedRow >= 0)
+    {
+        if(m_savedColumns[column][rowState.savedRow] == text)
+        {
+            rowState.dirtyColumns &= ~(1u << column);
+        }
+        else
+        {
+            rowState.dirtyColumns |= 1u << column;
+        }
+    }
+
+    if(column == m_dateColumn)
+    {
+        invalidDateCount -= isDateInvalid(row);
+        m_columns[column][row] = text;
+        m_dateKeys[row] = parseDate(text);
+        invalidDateCount += isDateInvalid(row);
+    }
+    else
+    {
+        m_columns[column][row] = text;
+    }
+
+    emit dataChanged(index(row, column), index(row, column), {Qt::DisplayRole, Qt::EditRole, InvalidCellRole, Qt::ToolTipRole, Qt::ForegroundRole});
+    updateInvalidDateCount(invalidDateCount);
+}
+
+// Inserts the passed rows (each a vector of cell texts in column order, empty for an empty
+// row) at the passed row index. If passed, the rows get their states back as taken out by
+// takeRows() of the same save generation, otherwise they are added rows.
+void PatientTableModel::insertRowTexts(int row, const QVector<QVector<QString>>& rows, const QVector<row_state_t>& rowStates)
+{
+    auto count = static_cast<int>(rows.size());
+    auto invalidDateCount = m_invalidDateCount;
+
+    beginInsertRows(QModelIndex(), row, row + count - 1);
+
+    for(auto column = 0; column < m_columns.size(); column++)
+    {
+        m_columns[column].insert(row, count, QString());
+
+        for(auto i = 0; i < count; i++)
+        {
+            m_columns[column][row + i] = rows[i].value(column);
+        }
+    }
+
+    m_dateKeys.insert(row, count, invalidDateKey);
+    m_rowStates.insert(row, count, {-1, 0});
+
+    if(rowStates.size() == count)
+    {
+        std::copy(rowStates.begin(), rowStates.end(), m_rowStates.begin() + row);
+    }
+
+    for(auto i = row; i < row + count; i++)
+    {
+        m_dateKeys[i] = parseDate(m_columns[m_dateColumn][i]);
+        invalidDateCount += isDateInvalid(i);
+    }
+
+    endInsertRows();
+
+    updateInvalidDateCount(invalidDateCount);
+}
+
+// Removes the passed rows and returns their texts (each row a vector of cell texts in column
+// order). If passed, rowStates receives the states of the rows.
+QVector<QVector<QString>> PatientTableModel::takeRows(int row, int count, QVector<row_state_t> *rowStates)
+{
+    QVector<QVector<QString>> rows(count, QVector<QString>(m_columns.size()));
+    auto invalidDateCount = m_invalidDateCount;
+
+    for(auto i = 0; i < count; i++)
+    {
+        invalidDateCount -= isDateInvalid(row + i);
+
+        for(auto column = 0; column < m_columns.size(); column++)
+        {
+            rows[i][column] = m_columns[column][row + i];
+        }
+    }
+
+    beginRemoveRows(QModelIndex(), row, row + count - 1);
+
+    for(auto& column : m_columns)
+    {
+        column.remove(row, count);
+    }
+
+    if(rowStates)
+    {
+        *rowStates = m_rowStates.mid(row, count);
+    }
+
+    m_dateKeys.remove(row, count);
+    m_rowStates.remove(row, count);
+
+    endRemoveRows();
+
+    updateInvalidDateCount(invalidDateCount);
+
+    return rows;
+}
+
+// Merges the passed rows into the date sorted table, see mergeRowsSorted(). Views are reset
+// only once. Returns the resulting row indices of the merged rows, ascending.
+QVector<int> PatientTableModel::mergeRows(const QVector<QVector<QString>>& rows)
+{
+    QVector<QVector<QString>> columns = m_columns;
+    QVector<qint64> dateKeys = m_dateKeys;
+    auto invalidDateCount = m_invalidDateCount;
+    QVector<int> insertedRows;
+
+    mergeRowsSorted(columns, dateKeys, m_dateColumn, rows, &invalidDateCount, &insertedRows);
+
+    // The existing rows keep their order, so their states are taken over in order around the
+    // merged rows.
+    QVector<row_state_t> rowStates(dateKeys.size(), {-1, 0});
+    auto nextRowState = m_rowStates.cbegin();
+    auto nextInsertedRow = insertedRows.cbegin();
+
+    for(auto row = 0; row < rowStates.size(); row++)
+    {
+        if(nextInsertedRow != insertedRows.cend() && *nextInsertedRow == row)
+        {
+            nextInsertedRow++;
+        }
+        else
+        {
+            rowStates[row] = *nextRowState++;
+        }
+    }
+
+    beginResetModel();
+
+    m_columns = columns;
+    m_dateKeys = dateKeys;
+    m_rowStates = rowStates;
+
+    endResetModel();
+
+    updateInvalidDateCount(invalidDateCount);
+
+    return insertedRows;
+}
+
+// Parses the date column of the passed columnar table, e.g. to prepare mergeRowsSorted().
+QVector<qint64> PatientTableModel::parseDates(const QVector<QVector<QString>>& columns, int dateColumn)
+{
+    if(dateColumn >= columns.size())
+    {
+        return QVector<qint64>();
+    }
+
+    const auto& dateTexts = columns[dateColumn];
+    QVector<qint64> dateKeys(dateTexts.size());
+
+    for(auto row = 0; row < dateTexts.size(); row++)
+    {
+        dateKeys[row] = parseDate(dateTexts[row]);
+    }
+
+    return dateKeys;
+}
+
+// Converts a date string of format dd.MM.yyyy to seconds since epoch (local midnight).
+// Returns invalidDateKey if the string is not a valid date of this format.
+qint64 PatientTableModel::parseDate(const QString& dateString)
+{
+    if(dateString.size() != 10 || dateString[2] != '.' || dateString[5] != '.')
+    {
+        return invalidDateKey;
+    }
+
+    const static int digitPositions[] = {0, 1, 3, 4, 6, 7, 8, 9};
+    int digits[8];
+
+    for(auto i = 0; i < 8; i++)
+    {
+        auto digit = dateString[digitPositions[i]].unicode() - '0';
+
+        if(digit < 0 || digit > 9)
+        {
+            return invalidDateKey;
+        }
+
+        digits[i] = digit;
+    }
+
+    QDate date(digits[4] * 1000 + digits[5] * 100 + digits[6] * 10 + digits[7],
+               digits[2] * 10 + digits[3],
+               digits[0] * 10 + digits[1]);
+
+    if(!date.isValid())
+    {
+        return invalidDateKey;
+    }
+
+    return date.startOfDay().toSecsSinceEpoch();
+}
@@ -0,0 +1,129 @@
+#ifndef PATIENTTABLEMODEL_H
+#define PATIENTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QPair>
+#include <QUndoStack>
+#include <QVector>
+#include <QString>
+#include "patientdatafile.h"
+
+// Table model keeping the cell texts in columnar storage (one vector per column). Views
+// render straight from these vectors, so no item object is allocated per cell. Modifications
+// (edits, added, deleted and merged rows) are executed as commands of the passed undo stack,
+// see patientundocommands.h. The model tracks per row which saved row it stems from and
+// which of its cells differ from the saved texts, so that saving writes the changed rows only.
+class PatientTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    // Change state of a row since the last save.
+    typedef struct
+    {
+        // Row of the last saved table the row stems from, -1 for rows added since.
+        int savedRow;
+
+        // Bit per column whose text differs from the saved text, unused for added rows.
+        quint32 dirtyColumns;
+    } row_state_t;
+
+    static const int maxColumnCount = 32;
+
+    // Data role telling whether a cell contains an invalid entry, used by the item delegate
+    // to decorate the cell.
+    static const int InvalidCellRole = Qt::UserRole + 1;
+
+    PatientTableModel(const QVector<QString>& columnNames, int dateColumn, QUndoStack *undoStack, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+
+    const QString& text(int row, int column) const;
+    const QVector<QString>& columnTexts(int column) const;
+    const QVector<QVector<QString>>& columns() const;
+    void setColumns(const QVector<QVector<QString>>& columns);
+
+    void setReferenceRanges(const QVector<QPair<double, double>>& referenceRanges);
+
+    int dateColumn() const;
+    qint64 dateKey(int row) const;
+    bool isDateValid(int row) const;
+    bool isDateInvalid(int row) const;
+    int invalidDateCount() const;
+
+    void moveRowTo(int row, int destinationRow);
+    int sortedDestinationRow(int row) const;
+    int insertRowsSorted(const QVector<QVector<QString>>& rows);
+
+    void markSaved();
+    int saveGeneration() const;
+    const row_state_t& rowState(int row) const;
+    const QString& savedText(int savedRow, int column) const;
+    QVector<int> deletedSavedRows() const;
+    PatientDataFile::table_changes_t tableChanges() const;
+    int mergeSavedColumns(const QVector<QVector<QString>>& columns, int *conflictCount = nullptr);
+
+    static const qint64 invalidDateKey;
+    static qint64 parseDate(const QString& dateString);
+    static QVector<qint64> parseDates(const QVector<QVector<QString>>& columns, int dateColumn);
+    static int mergeRowsSorted(QVector<QVector<QString>>& columns, QVector<qint64>& dateKeys, int dateColumn,
+                               const QVector<QVector<QString>>& rows, int *invalidDateCount = nullptr,
+                               QVector<int> *insertedRows = nullptr);
+
+signals:
+    // Emitted for cell changes made through the view (i.e. by the user) and when these are
+    // undone or redone, with the row of the cell after an edited date has been sorted in. Not
+    // emitted for changes made by the application via setColumns(), moveRowTo() or
+    // insertRowsSorted().
+    void cellChanged(int row, int column);
+
+    // Emitted once per modification (a single edit as well as a bulk operation) that changes
+    // the number of rows with an invalid date entry.
+    void invalidDateCountChanged(int count);
+
+private:
+    friend class SetCellCommand;
+    friend class InsertRowsCommand;
+    friend class RemoveRowsCommand;
+    friend class InsertRowsSortedCommand;
+
+    QVector<QString> m_columnNames;
+    int m_dateColumn;
+    QUndoStack *m_undoStack;
+    QVector<QVector<QString>> m_columns;
+
+    // Reference range (low, high) per column, NaN where there is no limit. Values outside are
+    // coloured.
+    QVector<QPair<double, double>> m_referenceRanges;
+
+    // Parsed date column (seconds since epoch), kept in sync with the date texts so that
+    // sorting and plotting do not have to parse dates again.
+    QVector<qint64> m_dateKeys;
+    int m_invalidDateCount;
+
+    // Table as of the last save (shared with the caller of setColumns() until modified) and
+    // the change state of each row, kept in sync with the rows like the date keys. The save
+    // generation is counted up by each save, so that row states taken out by a command are
+    // only restored into the table they belong to.
+    QVector<QVector<QString>> m_savedColumns;
+    QVector<row_state_t> m_rowStates;
+    int m_saveGeneration;
+
+    void updateInvalidDateCount(int invalidDateCount);
+    int sortedInsertionRow(qint64 dateKey) const;
+
+    // Modifications executed by the undo commands.
+    void writeText(int row, int column, const QString& text);
+    void insertRowTexts(int row, const QVector<QVector<QString>>& rows, const QVector<row_state_t>& rowStates = QVector<row_state_t>());
+    QVector<QVector<QString>> takeRows(int row, int count, QVector<row_state_t> *rowStates = nullptr);
+    QVector<int> mergeRows(const QVector<QVector<QString>>& rows);
+};
+
+#endif // PATIENTTABLEMODEL_H
@@ -0,0 +1,317 @@
+#include "patientundocommands.h"
+#include <algorithm>
+
+PatientUndoCommand::PatientUndoCommand(const QString& text)
+    : QUndoCommand(text)
+    , m_released(false)
+{
+}
+
+bool PatientUndoCommand::isReleased() const
+{
+    return m_released;
+}
+
+qsizetype PatientUndoCommand::commandByteSize(const QUndoCommand *command)
+{
+    auto patientUndoCommand = dynamic_cast<const PatientUndoCommand*>(command);
+    qsizetype byteSize = patientUndoCommand ? patientUndoCommand->byteSize() : static_cast<qsizetype>(sizeof(QUndoCommand));
+
+    for(auto i = 0; i < command->childCount(); i++)
+    {
+        byteSize += commandByteSize(command->child(i));
+    }
+
+    return byteSize;
+}
+
+void PatientUndoCommand::releaseCommand(QUndoCommand *command)
+{
+    auto patientUndoCommand = dynamic_cast<PatientUndoCommand*>(command);
+
+    if(patientUndoCommand)
+    {
+        patientUndoCommand->release();
+    }
+
+    for(auto i = 0; i < command->childCount(); i++)
+    {
+        releaseCommand(const_cast<QUndoCommand*>(command->child(i)));
+    }
+}
+
+qsizetype PatientUndoCommand::textByteSize(const QString& text)
+{
+    return static_cast<qsizetype>(sizeof(QString)) + text.capacity() * static_cast<qsizetype>(sizeof(QChar));
+}
+
+qsizetype PatientUndoCommand::rowsByteSize(const QVector<QVector<QString>>& rows)
+{
+    qsizetype byteSize = static_cast<qsizetype>(sizeof(QVector<QVector<QString>>));
+
+    for(const auto& row : rows)
+    {
+        byteSize += static_cast<qsizetype>(sizeof(QVector<QString>));
+
+        for(const auto& text : row)
+        {
+            byteSize += textByteSize(text);
+        }
+    }
+
+    return byteSize;
+}
+
+SetCellCommand::SetCellCommand(PatientTableModel *model, int row, int column, const QString& text)
+    : PatientUndoCommand("Edit Cell")
+    , m_model(model)
+    , m_row(row)
+    , m_column(column)
+    , m_oldText(model->text(row, column))
+    , m_newText(text)
+    , m_destinationRow(row)
+{
+}
+
+void SetCellCommand::undo()
+{
+    m_model->moveRowTo(m_destinationRow, m_row);
+    m_model->writeText(m_row, m_column, m_oldText);
+
+    emit m_model->cellChanged(m_row, m_column);
+}
+
+// Determines the row of the edited cell each time, the result only depends on the rows which
+// are not edited, so it is the same as long as the command is undone and redone in order.
+void SetCellCommand::redo()
+{
+    m_model->writeText(m_row, m_column, m_newText);
+
+    m_destinationRow = (m_column == m_model->dateColumn()) ? m_model->sortedDestinationRow(m_row) : m_row;
+    m_model->moveRowTo(m_row, m_destinationRow);
+
+    emit m_model->cellChanged(m_destinationRow, m_column);
+}
+
+int SetCellCommand::id() const
+{
+    return COMMAND_SET_CELL;
+}
+
+// Merges the edit of the cell just edited by this command.
+bool SetCellCommand::mergeWith(const QUndoCommand *other)
+{
+    auto otherCommand = static_cast<const SetCellCommand*>(other);
+
+    if(m_released || otherCommand->m_model != m_model || otherCommand->m_column != m_column ||
+       otherCommand->m_row != m_destinationRow)
+    {
+        return false;
+    }
+
+    m_newText = otherCommand->m_newText;
+    m_destinationRow = otherCommand->m_destinationRow;
+
+    // An edit back to the original text at the original row does not need to be undone.
+    setObsolete(m_newText == m_oldText && m_destinationRow == m_row);
+
+    return true;
+}
+
+qsizetype SetCellCommand::byteSize() const
+{
+    return static_cast<qsizetype>(sizeof(SetCellCommand)) + textByteSize(m_oldText) + textByteSize(m_newText);
+}
+
+void SetCellCommand::release()
+{
+    m_oldText = QString();
+    m_newText = QString();
+    m_released = true;
+}
+
+InsertRowsCommand::InsertRowsCommand(PatientTableModel *model, int row, int count)
+    : PatientUndoCommand("Add Rows")
+    , m_model(model)
+    , m_row(row)
+    , m_count(count)
+{
+}
+
+// Rows are empty when added, edits of the added rows are undone before.
+void InsertRowsCommand::undo()
+{
+    m_model->takeRows(m_row, m_count);
+}
+
+void InsertRowsCommand::redo()
+{
+    m_model->insertRowTexts(m_row, QVector<QVector<QString>>(m_count));
+}
+
+qsizetype InsertRowsCommand::byteSize() const
+{
+    return static_cast<qsizetype>(sizeof(InsertRowsCommand));
+}
+
+void InsertRowsCommand::release()
+{
+    m_released = true;
+}
+
+RemoveRowsCommand::RemoveRowsCommand(PatientTableModel *model, int row, int count)
+    : PatientUndoCommand("Delete Rows")
+    , m_model(model)
+    , m_row(row)
+    , m_count(count)
+    , m_saveGeneration(0)
+{
+}
+
+// The rows get their change state back unless the table has been saved in between, then
+// they are added rows compared to the saved table.
+void RemoveRowsCommand::undo()
+{
+    m_model->insertRowTexts(m_row, m_rows, m_saveGeneration == m_model->saveGeneration() ?
+                                           m_rowStates : QVector<PatientTableModel::row_state_t>());
+    m_rows.clear();
+    m_rowStates.clear();
+}
+
+void RemoveRowsCommand::redo()
+{
+    m_rows = m_model->takeRows(m_row, m_count, &m_rowStates);
+    m_saveGeneration = m_model->saveGeneration();
+}
+
+qsizetype RemoveRowsCommand::byteSize() const
+{
+    return static_cast<qsizetype>(sizeof(RemoveRowsCommand)) + rowsByteSize(m_rows) +
+           m_rowStates.capacity() * static_cast<qsizetype>(sizeof(PatientTableModel::row_state_t));
+}
+
+void RemoveRowsCommand::release()
+{
+    m_rows.clear();
+    m_rows.squeeze();
+    m_rowStates.clear();
+    m_rowStates.squeeze();
+    m_released = true;
+}
+
+InsertRowsSortedCommand::InsertRowsSortedCommand(PatientTableModel *model, const QVector<QVector<QString>>& rows)
+    : PatientUndoCommand("Insert Rows")
+    , m_model(model)
+    , m_rows(rows)
+    , m_firstInsertedRow(-1)
+{
+}
+
+// Takes the merged rows out of the table again, each contiguous range at once starting at the
+// bottom so that the indices of the remaining ranges stay valid. The rows are kept in table
+// order, merging them again gives the same table as merging them first.
+void InsertRowsSortedCommand::undo()
+{
+    m_rows.resize(m_insertedRows.size());
+
+    auto last = m_insertedRows.size() - 1;
+
+    while(last >= 0)
+    {
+        auto first = last;
+
+        while(first > 0 && m_insertedRows[first - 1] == m_insertedRows[first] - 1)
+        {
+            first--;
+        }
+
+        auto rows = m_model->takeRows(m_insertedRows[first], static_cast<int>(last - first + 1));
+
+        std::copy(rows.begin(), rows.end(), m_rows.begin() + first);
+
+        last = first - 1;
+    }
+}
+
+void InsertRowsSortedCommand::redo()
+{
+    m_insertedRows = m_model->mergeRows(m_rows);
+    m_firstInsertedRow = m_insertedRows.isEmpty() ? -1 : m_insertedRows.first();
+
+    m_rows.clear();
+}
+
+qsizetype InsertRowsSortedCommand::byteSize() const
+{
+    return static_cast<qsizetype>(sizeof(InsertRowsSortedCommand)) + rowsByteSize(m_rows) +
+           m_insertedRows.capacity() * static_cast<qsizetype>(sizeof(int));
+}
+
+void InsertRowsSortedCommand::release()
+{
+    m_rows.clear();
+    m_rows.squeeze();
+    m_insertedRows.clear();
+    m_insertedRows.squeeze();
+    m_released = true;
+}
+
+// Returns the resulting row index of the first merged row in date order.
+int InsertRowsSortedCommand::firstInsertedRow() const
+{
+    return m_firstInsertedRow;
+}
+
+SetGeneralInformationCommand::SetGeneralInformationCommand(PatientSession *patientSession,
+                                                           QString PatientSession::general_information_t::*field,
+                                                           const QString& text)
+    : PatientUndoCommand("Edit General Information")
+    , m_patientSession(patientSession)
+    , m_field(field)
+    , m_oldText(patientSession->generalInformation().*field)
+    , m_newText(text)
+{
+}
+
+void SetGeneralInformationCommand::undo()
+{
+    m_patientSession->writeGeneralInformationField(m_field, m_oldText);
+}
+
+void SetGeneralInformationCommand::redo()
+{
+    m_patientSession->writeGeneralInformationField(m_field, m_newText);
+}
+
+int SetGeneralInformationCommand::id() const
+{
+    return COMMAND_SET_GENERAL_INFORMATION;
+}
+
+bool SetGeneralInformationCommand::mergeWith(const QUndoCommand *other)
+{
+    auto otherCommand = static_cast<const SetGeneralInformationCommand*>(other);
+
+    if(m_released || otherCommand->m_patientSession != m_patientSession || otherCommand->m_field != m_field)
+    {
+        return false;
+    }
+
+    m_newText = otherCommand->m_newText;
+
+    setObsolete(m_newText == m_oldText);
+
+    return true;
+}
+
+qsizetype SetGeneralInformationCommand::byteSize() const
+{
+    return static_cast<qsizetype>(sizeof(SetGeneralInformationCommand)) + textByteSize(m_oldText) + textByteSize(m_newText);
+}
+
+void SetGeneralInformationCommand::release()
+{
+    m_oldText = QString();
+    m_newText = QString();
+    m_released = true;
+}
@@ -0,0 +1,156 @@
+#ifndef PATIENTUNDOCOMMANDS_H
+#define PATIENTUNDOCOMMANDS_H
+
+#include <QUndoCommand>
+#include <QString>
+#include <QVector>
+#include "patienttablemodel.h"
+#include "patientsession.h"
+
+// Undo commands of the patient session. Instead of table snapshots, each command stores the
+// delta of one modification (cell position and old / new text, the index and texts of
+// inserted or deleted rows). Texts are only kept while they are not contained in the table,
+// e.g. the texts of deleted rows until the deletion is undone.
+class PatientUndoCommand : public QUndoCommand
+{
+public:
+    // Ids of the commands which merge consecutive edits, see QUndoCommand::id().
+    typedef enum
+    {
+        COMMAND_SET_CELL = 1,
+        COMMAND_SET_GENERAL_INFORMATION
+    } command_id_t;
+
+    explicit PatientUndoCommand(const QString& text);
+
+    // Approximate number of bytes held by the command.
+    virtual qsizetype byteSize() const = 0;
+
+    // Frees the delta of a command which will not be undone anymore, see
+    // PatientSession::setUndoMemoryBudget().
+    virtual void release() = 0;
+    bool isReleased() const;
+
+    // Like byteSize() and release(), for commands grouped by a macro as well.
+    static qsizetype commandByteSize(const QUndoCommand *command);
+    static void releaseCommand(QUndoCommand *command);
+
+protected:
+    bool m_released;
+
+    static qsizetype textByteSize(const QString& text);
+    static qsizetype rowsByteSize(const QVector<QVector<QString>>& rows);
+};
+
+// Edit of a table cell. An edited date moves its row so that the table stays sorted date
+// ascending, the move is part of the command. Consecutive edits of the same cell are merged.
+class SetCellCommand : public PatientUndoCommand
+{
+public:
+    SetCellCommand(PatientTableModel *model, int row, int column, const QString& text);
+
+    void undo() override;
+    void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand *other) override;
+    qsizetype byteSize() const override;
+    void release() override;
+
+private:
+    PatientTableModel *m_model;
+    int m_row;
+    int m_column;
+    QString m_oldText;
+    QString m_newText;
+
+    // Row of the cell after the edit.
+    int m_destinationRow;
+};
+
+// Empty rows added at a position.
+class InsertRowsCommand : public PatientUndoCommand
+{
+public:
+    InsertRowsCommand(PatientTableModel *model, int row, int count);
+
+    void undo() override;
+    void redo() override;
+    qsizetype byteSize() const override;
+    void release() override;
+
+private:
+    PatientTableModel *m_model;
+    int m_row;
+    int m_count;
+};
+
+// Deletion of contiguous rows.
+class RemoveRowsCommand : public PatientUndoCommand
+{
+public:
+    RemoveRowsCommand(PatientTableModel *model, int row, int count);
+
+    void undo() override;
+    void redo() override;
+    qsizetype byteSize() const override;
+    void release() override;
+
+private:
+    PatientTableModel *m_model;
+    int m_row;
+    int m_count;
+
+    // Texts and change states of the deleted rows while the deletion is done.
+    QVector<QVector<QString>> m_rows;
+    QVector<PatientTableModel::row_state_t> m_rowStates;
+    int m_saveGeneration;
+};
+
+// Rows merged into the date sorted table, e.g. pasted rows or lab results.
+class InsertRowsSortedCommand : public PatientUndoCommand
+{
+public:
+    InsertRowsSortedCommand(PatientTableModel *model, const QVector<QVector<QString>>& rows);
+
+    void undo() override;
+    void redo() override;
+    qsizetype byteSize() const override;
+    void release() override;
+
+    int firstInsertedRow() const;
+
+private:
+    PatientTableModel *m_model;
+
+    // Texts of the rows while they are not merged.
+    QVector<QVector<QString>> m_rows;
+
+    // Resulting row indices of the merged rows, ascending.
+    QVector<int> m_insertedRows;
+    int m_firstInsertedRow;
+};
+
+// Edit of a general information field. Consecutive edits of the same field (i.e. typing) are
+// merged.
+class SetGeneralInformationCommand : public PatientUndoCommand
+{
+public:
+    SetGeneralInformationCommand(PatientSession *patientSession,
+                                 QString PatientSession::general_information_t::*field,
+                                 const QString& text);
+
+    void undo() override;
+    void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand *other) override;
+    qsizetype byteSize() const override;
+    void release() override;
+
+private:
+    PatientSession *m_patientSession;
+    QString PatientSession::general_information_t::*m_field;
+    QString m_oldText;
+    QString m_newText;
+};
+
+#endif // PATIENTUNDOCOMMANDS_H
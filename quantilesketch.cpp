@@ -0,0 +1,209 @@
+#include "quantilesketch.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+// Added values and merged centroids are collected until there are this many times the
+// compression of them.
+const static int unmergedFactor = 4;
+
+const static double pi = 3.14159265358979323846;
+
+QuantileSketch::QuantileSketch(double compression)
+    : m_compression(compression)
+    , m_minimum(std::numeric_limits<double>::infinity())
+    , m_maximum(-std::numeric_limits<double>::infinity())
+    , m_unmergedCount(0)
+{
+}
+
+void QuantileSketch::add(double value, double weight)
+{
+    if(std::isnan(value) || weight <= 0.0)
+    {
+        return;
+    }
+
+    m_minimum = std::min(m_minimum, value);
+    m_maximum = std::max(m_maximum, value);
+
+    m_means.append(value);
+    m_weights.append(weight);
+    m_unmergedCount++;
+
+    if(m_unmergedCount >= unmergedFactor * m_compression)
+    {
+        compress();
+    }
+}
+
+// Adds the values of the other sketch, the result is the same as if they had been added.
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    if(other.isEmpty())
+    {
+        return;
+    }
+
+    m_minimum = std::min(m_minimum, other.m_minimum);
+    m_maximum = std::max(m_maximum, other.m_maximum);
+
+    m_means += other.m_means;
+    m_weights += other.m_weights;
+    m_unmergedCount += static_cast<int>(other.m_means.size());
+
+    if(m_unmergedCount >= unmergedFactor * m_compression)
+    {
+        compress();
+    }
+}
+
+// Sorts the centroids and merges neighbours as long as the merged centroid does not span more
+// than one unit of the scale function k, which is steep at the tails.
+void QuantileSketch::compress()
+{
+    if(m_unmergedCount == 0)
+    {
+        return;
+    }
+
+    QVector<int> order(m_means.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return m_means[a] < m_means[b];
+    });
+
+    const auto totalWeight = count();
+    QVector<double> means;
+    QVector<double> weights;
+    double weightSoFar = 0.0;
+    double mean = m_means[order[0]];
+    double weight = m_weights[order[0]];
+    double weightLimit = totalWeight * fractionOfK(k(0.0) + 1.0);
+
+    for(auto i = 1; i < order.size(); i++)
+    {
+        const auto nextMean = m_means[order[i]];
+        const auto nextWeight = m_weights[order[i]];
+
+        if(weightSoFar + weight + nextWeight <= weightLimit)
+        {
+            weight += nextWeight;
+            mean += (nextMean - mean) * nextWeight / weight;
+        }
+        else
+        {
+            weightSoFar += weight;
+            means.append(mean);
+            weights.append(weight);
+
+            weightLimit = totalWeight * fractionOfK(k(weightSoFar / totalWeight) + 1.0);
+            mean = nextMean;
+            weight = nextWeight;
+        }
+    }
+
+    means.append(mean);
+    weights.append(weight);
+
+    m_means = means;
+    m_weights = weights;
+    m_unmergedCount = 0;
+}
+
+bool QuantileSketch::isEmpty() const
+{
+    return m_means.isEmpty();
+}
+
+double QuantileSketch::count() const
+{
+    return std::accumulate(m_weights.constBegin(), m_weights.constEnd(), 0.0);
+}
+
+// Returns the value below which the passed fraction (0..1) of the values lies, NaN if the
+// sketch is empty. Interpolates linearly between the centers of neighbouring centroids and
+// towards minimum and maximum at the ends.
+double QuantileSketch::quantile(double fraction) const
+{
+    if(isEmpty())
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    if(m_unmergedCount > 0)
+    {
+        QuantileSketch compressedSketch(*this);
+        compressedSketch.compress();
+
+        return compressedSketch.quantile(fraction);
+    }
+
+    if(m_means.size() == 1)
+    {
+        return m_means[0];
+    }
+
+    const auto target = std::clamp(fraction, 0.0, 1.0) * count();
+    double weightSoFar = 0.0;
+    double previousCenter = 0.0;
+    double previousMean = m_minimum;
+
+    for(auto i = 0; i < m_means.size(); i++)
+    {
+        const auto center = weightSoFar + m_weights[i] / 2.0;
+
+        if(target < center)
+        {
+            return previousMean + (m_means[i] - previousMean) * (target - previousCenter) / (center - previousCenter);
+        }
+
+        weightSoFar += m_weights[i];
+        previousCenter = center;
+        previousMean = m_means[i];
+    }
+
+    if(weightSoFar <= previousCenter)
+    {
+        return m_maximum;
+    }
+
+    return previousMean + (m_maximum - previousMean) * (target - previousCenter) / (weightSoFar - previousCenter);
+}
+
+// Scale function k1 of the t-digest, mapping the fraction 0..1 to -compression/4..compression/4.
+double QuantileSketch::k(double fraction) const
+{
+    return m_compression / (2.0 * pi) * std::asin(2.0 * fraction - 1.0);
+}
+
+double QuantileSketch::fractionOfK(double k) const
+{
+    if(k >= m_compression / 4.0)
+    {
+        return 1.0;
+    }
+
+    return (std::sin(k * 2.0 * pi / m_compression) + 1.0) / 2.0;
+}
+
+QDataStream& operator<<(QDataStream& stream, const QuantileSketch& sketch)
+{
+    QuantileSketch compressedSketch(sketch);
+    compressedSketch.compress();
+
+    return stream << compressedSketch.m_compression << compressedSketch.m_minimum << compressedSketch.m_maximum
+                  << compressedSketch.m_means << compressedSketch.m_weights;
+}
+
+QDataStream& operator>>(QDataStream& stream, QuantileSketch& sketch)
+{
+    stream >> sketch.m_compression >> sketch.m_minimum >> sketch.m_maximum >> sketch.m_means >> sketch.m_weights;
+
+    sketch.m_unmergedCount = 0;
+
+    return stream;
+}
@@ -0,0 +1,42 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <QDataStream>
+#include <QVector>
+
+// Mergeable streaming quantile sketch (merging t-digest). Values are kept as centroids (mean
+// and weight), centroids near the median may grow large while those near the tails stay
+// small, so that extreme quantiles remain accurate with a bounded number of centroids.
+// Sketches of different sets of values can be merged into the sketch of their union, so that
+// sketches can be built in parallel and combined afterwards.
+class QuantileSketch
+{
+public:
+    explicit QuantileSketch(double compression = 100.0);
+
+    void add(double value, double weight = 1.0);
+    void merge(const QuantileSketch& other);
+    void compress();
+
+    bool isEmpty() const;
+    double count() const;
+    double quantile(double fraction) const;
+
+    friend QDataStream& operator<<(QDataStream& stream, const QuantileSketch& sketch);
+    friend QDataStream& operator>>(QDataStream& stream, QuantileSketch& sketch);
+
+private:
+    double m_compression;
+    double m_minimum;
+    double m_maximum;
+
+    // Centroids, sorted by mean except for the ones added since the last compression.
+    QVector<double> m_means;
+    QVector<double> m_weights;
+    int m_unmergedCount;
+
+    double k(double fraction) const;
+    double fractionOfK(double k) const;
+};
+
+#endif // QUANTILESKETCH_H
@@ -0,0 +1,58 @@
+#include "relativedayaxisticker.h"
+
+const static double secondsPerDay = 24.0 * 3600.0;
+
+// Tick steps in days, whole weeks from one week on.
+const static QVector<double> tickStepDays {1, 2, 7, 14, 28, 56, 84, 182, 364};
+
+RelativeDayAxisTicker::RelativeDayAxisTicker()
+    : m_anchorKey(0)
+{
+}
+
+qint64 RelativeDayAxisTicker::anchorKey() const
+{
+    return m_anchorKey;
+}
+
+// Sets the anchor date (seconds since epoch of its midnight). Ticks are placed at whole days
+// from the anchor on.
+void RelativeDayAxisTicker::setAnchorKey(qint64 anchorKey)
+{
+    m_anchorKey = anchorKey;
+
+    setTickOrigin(static_cast<double>(anchorKey));
+}
+
+double RelativeDayAxisTicker::getTickStep(const QCPRange &range)
+{
+    double exactStepDays = range.size() / (static_cast<double>(mTickCount) + 1e-10) / secondsPerDay;
+
+    return pickClosest(exactStepDays, tickStepDays) * secondsPerDay;
+}
+
+// Sub ticks mark the days of steps up to a week and the weeks of longer steps.
+int RelativeDayAxisTicker::getSubTickCount(double tickStep)
+{
+    auto days = qRound(tickStep / secondsPerDay);
+
+    if(days <= 7)
+    {
+        return days - 1;
+    }
+
+    if(days % 7 == 0 && days <= 56)
+    {
+        return days / 7 - 1;
+    }
+
+    return 3;
+}
+
+QString RelativeDayAxisTicker::getTickLabel(double tick, const QLocale &locale, QChar formatChar, int precision)
+{
+    // Rounding keeps the day if a daylight saving time change lies between anchor and tick.
+    auto days = qRound((tick - static_cast<double>(m_anchorKey)) / secondsPerDay);
+
+    return "Day " + QString::number(days >= 0 ? days + 1 : days);
+}
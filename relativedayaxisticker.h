@@ -0,0 +1,27 @@
+#ifndef RELATIVEDAYAXISTICKER_H
+#define RELATIVEDAYAXISTICKER_H
+
+#include "qcustomplot.h"
+
+// Date axis ticker labeling the days relative to an anchor date ("Day 1" is the anchor day,
+// the day before it is "Day -1"), e.g. to compare chemo therapy cycles. The keys of the plotted
+// data stay seconds since epoch, so changing the anchor only changes the labels and the tick
+// origin, not the data.
+class RelativeDayAxisTicker : public QCPAxisTicker
+{
+public:
+    RelativeDayAxisTicker();
+
+    qint64 anchorKey() const;
+    void setAnchorKey(qint64 anchorKey);
+
+protected:
+    double getTickStep(const QCPRange &range) override;
+    int getSubTickCount(double tickStep) override;
+    QString getTickLabel(double tick, const QLocale &locale, QChar formatChar, int precision) override;
+
+private:
+    qint64 m_anchorKey;
+};
+
+#endif // RELATIVEDAYAXISTICKER_H
@@ -0,0 +1,329 @@
+#include "settingsstore.h"
+#include "labparameters.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+#include <type_traits>
+#include <variant>
+
+const static QString settingsFileName = "leukiSettings.json";
+const static QString settingsFileVersion = "v1.0";
+const static QString visualizationShowKeyPrefix = "visualizationShow";
+
+// Visualizations besides the blood values by default shown or not. The blood values are taken
+// from LabParameters and shown by default.
+const static QVector<QPair<QString, bool>> visualizationShowDefaults =
+{
+    {"MedicamentationAndChemoTherapy", true},
+    {"NadirAndRecovery", true},
+    {"MovingAverage", false},
+    {"Smoothed", false},
+    {"Slope", false},
+    {"CumulativeDose", true}
+};
+
+// Field of the settings stored under a key of the settings file.
+typedef std::variant<bool SettingsWindow::settings_t::*, int SettingsWindow::settings_t::*,
+                     double SettingsWindow::settings_t::*, QString SettingsWindow::settings_t::*> settings_field_t;
+
+// Keys of the settings in the settings file. Loading, saving and comparing the settings go
+// through this table, so a new setting only needs its default value and an entry here.
+const static QVector<QPair<QString, settings_field_t>> settingsFields =
+{
+    {"autoLoadPatientDataFileOnStartup", &SettingsWindow::settings_t::autoLoadPatientDataFileOnStartup},
+    {"labInboxDirectory", &SettingsWindow::settings_t::labInboxDirectory},
+    {"patientDataDirectory", &SettingsWindow::settings_t::patientDataDirectory},
+    {"leukocytesRecoveryThreshold", &SettingsWindow::settings_t::leukocytesRecoveryThreshold},
+    {"thrombocytesRecoveryThreshold", &SettingsWindow::settings_t::thrombocytesRecoveryThreshold},
+    {"movingAverageDays", &SettingsWindow::settings_t::movingAverageDays},
+    {"smoothingFactor", &SettingsWindow::settings_t::smoothingFactor},
+    {"undoMemoryBudgetMegabytes", &SettingsWindow::settings_t::undoMemoryBudgetMegabytes},
+    {"autosaveIntervalSeconds", &SettingsWindow::settings_t::autosaveIntervalSeconds}
+};
+
+// Delay between the last change and writing the settings file, so that bursts of changes
+// (e.g. toggling several checkboxes) result in a single write.
+const static int saveDelayMilliseconds = 1000;
+
+// Writes the passed data to the passed file atomically (written to a temporary file which
+// replaces the settings file only after it has been written completely).
+static void writeSettingsFile(const QString& fileName, const QByteArray& data)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile file(fileName);
+
+    if(file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        file.write(data);
+        file.commit();
+    }
+}
+
+static const settings_field_t* settingsFieldOf(const QString& key)
+{
+    for(const auto& settingsField : settingsFields)
+    {
+        if(settingsField.first == key)
+        {
+            return &settingsField.second;
+        }
+    }
+
+    return nullptr;
+}
+
+// Reads a setting from the settings file, a value of another type than the setting is ignored.
+static void settingFromJson(const QJsonValue& value, const settings_field_t& field, SettingsWindow::settings_t& settings)
+{
+    std::visit([&](auto member)
+    {
+        using value_t = std::decay_t<decltype(settings.*member)>;
+
+        if constexpr(std::is_same_v<value_t, bool>)
+        {
+            if(value.isBool())
+            {
+                settings.*member = value.toBool();
+            }
+        }
+        else if constexpr(std::is_same_v<value_t, int>)
+        {
+            if(value.isDouble())
+            {
+                settings.*member = value.toInt();
+            }
+        }
+        else if constexpr(std::is_same_v<value_t, double>)
+        {
+            if(value.isDouble())
+            {
+                settings.*member = value.toDouble();
+            }
+        }
+        else
+        {
+            if(value.isString())
+            {
+                settings.*member = value.toString();
+            }
+        }
+    }, field);
+}
+
+static QJsonValue settingToJson(const settings_field_t& field, const SettingsWindow::settings_t& settings)
+{
+    return std::visit([&](auto member) { return QJsonValue(settings.*member); }, field);
+}
+
+static bool settingsEqual(const SettingsWindow::settings_t& settings, const SettingsWindow::settings_t& otherSettings)
+{
+    for(const auto& settingsField : settingsFields)
+    {
+        if(!std::visit([&](auto member) { return settings.*member == otherSettings.*member; }, settingsField.second))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+SettingsStore::SettingsStore(QObject *parent)
+    : QObject(parent)
+    , m_activeTabIndex(0)
+    , m_settings(SettingsWindow::defaultSettings)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(saveDelayMilliseconds);
+    connect(&m_saveTimer, &QTimer::timeout, this, &SettingsStore::save);
+
+    // A single thread keeps the writes in order.
+    m_writeThreadPool.setMaxThreadCount(1);
+}
+
+SettingsStore::~SettingsStore()
+{
+    flush();
+}
+
+QString SettingsStore::fileName() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/" + settingsFileName;
+}
+
+// Loads the settings file once. If it does not exist yet, a settings file of a previous
+// version in the working directory is taken over, otherwise the default settings are used.
+void SettingsStore::load()
+{
+    QFile settingsFile(fileName());
+    QByteArray settingsData;
+
+    if(!settingsFile.exists())
+    {
+        settingsFile.setFileName(QDir::currentPath() + "/" + settingsFileName);
+    }
+
+    if(settingsFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        settingsData = settingsFile.readAll();
+        settingsFile.close();
+    }
+
+    QJsonObject settingsJsonObject = QJsonDocument::fromJson(settingsData).object();
+
+    m_settings = SettingsWindow::defaultSettings;
+    m_otherValues = QJsonObject();
+    m_visualizationShow.clear();
+
+    for(const auto& parameter : LabParameters::parameters())
+    {
+        m_visualizationShow[parameter.name] = true;
+    }
+
+    for(const auto& visualizationShowDefault : visualizationShowDefaults)
+    {
+        m_visualizationShow[visualizationShowDefault.first] = visualizationShowDefault.second;
+    }
+
+    for(auto it = settingsJsonObject.constBegin(); it != settingsJsonObject.constEnd(); it++)
+    {
+        if(it.key() == "previousPatientDataFileName" && it.value().isString())
+        {
+            m_previousPatientDataFileName = it.value().toString();
+        }
+        else if(it.key() == "activeTabIndex" && it.value().isDouble())
+        {
+            m_activeTabIndex = it.value().toInt();
+        }
+        else if(settingsFieldOf(it.key()))
+        {
+            settingFromJson(it.value(), *settingsFieldOf(it.key()), m_settings);
+        }
+        else if(it.key().startsWith(visualizationShowKeyPrefix) && it.value().isBool())
+        {
+            m_visualizationShow[it.key().mid(visualizationShowKeyPrefix.size())] = it.value().toBool();
+        }
+        else
+        {
+            m_otherValues[it.key()] = it.value();
+        }
+    }
+
+    // Make sure the settings file exists from now on.
+    if(!QFile::exists(fileName()))
+    {
+        scheduleSave();
+    }
+}
+
+// Writes pending changes immediately and waits until all writes have been finished.
+void SettingsStore::flush()
+{
+    if(m_saveTimer.isActive())
+    {
+        m_saveTimer.stop();
+        save();
+    }
+
+    m_writeThreadPool.waitForDone();
+}
+
+QString SettingsStore::previousPatientDataFileName() const
+{
+    return m_previousPatientDataFileName;
+}
+
+void SettingsStore::setPreviousPatientDataFileName(const QString& previousPatientDataFileName)
+{
+    if(previousPatientDataFileName != m_previousPatientDataFileName)
+    {
+        m_previousPatientDataFileName = previousPatientDataFileName;
+        scheduleSave();
+
+        emit previousPatientDataFileNameChanged(m_previousPatientDataFileName);
+    }
+}
+
+int SettingsStore::activeTabIndex() const
+{
+    return m_activeTabIndex;
+}
+
+void SettingsStore::setActiveTabIndex(int activeTabIndex)
+{
+    if(activeTabIndex != m_activeTabIndex)
+    {
+        m_activeTabIndex = activeTabIndex;
+        scheduleSave();
+
+        emit activeTabIndexChanged(m_activeTabIndex);
+    }
+}
+
+SettingsWindow::settings_t SettingsStore::settings() const
+{
+    return m_settings;
+}
+
+void SettingsStore::setSettings(const SettingsWindow::settings_t& settings)
+{
+    if(!settingsEqual(settings, m_settings))
+    {
+        m_settings = settings;
+        scheduleSave();
+
+        emit settingsChanged(m_settings);
+    }
+}
+
+// Returns whether the visualization of the passed name (e.g. "Leukocytes") is shown.
+bool SettingsStore::visualizationShow(const QString& name) const
+{
+    return m_visualizationShow.value(name, true);
+}
+
+void SettingsStore::setVisualizationShow(const QString& name, bool show)
+{
+    if(!m_visualizationShow.contains(name) || m_visualizationShow[name] != show)
+    {
+        m_visualizationShow[name] = show;
+        scheduleSave();
+
+        emit visualizationShowChanged(name, show);
+    }
+}
+
+void SettingsStore::scheduleSave()
+{
+    // Restarting the timer debounces bursts of changes.
+    m_saveTimer.start();
+}
+
+// Serializes the settings and hands the data over to the write thread.
+void SettingsStore::save()
+{
+    QJsonObject settingsJsonObject = m_otherValues;
+
+    settingsJsonObject["fileVersion"] = settingsFileVersion;
+    settingsJsonObject["previousPatientDataFileName"] = m_previousPatientDataFileName;
+    settingsJsonObject["activeTabIndex"] = static_cast<double>(m_activeTabIndex);
+
+    for(const auto& settingsField : settingsFields)
+    {
+        settingsJsonObject[settingsField.first] = settingToJson(settingsField.second, m_settings);
+    }
+
+    for(auto it = m_visualizationShow.constBegin(); it != m_visualizationShow.constEnd(); it++)
+    {
+        settingsJsonObject[visualizationShowKeyPrefix + it.key()] = it.value();
+    }
+
+    (void)QtConcurrent::run(&m_writeThreadPool, writeSettingsFile, fileName(), QJsonDocument(settingsJsonObject).toJson());
+}
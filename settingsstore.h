@@ -0,0 +1,63 @@
+#ifndef SETTINGSSTORE_H
+#define SETTINGSSTORE_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <QTimer>
+#include "settingswindow.h"
+
+// Typed in-memory store of the application settings. The settings file is parsed once on
+// load(), changes are signalled and persisted by a debounced, atomic write running on a
+// background thread. Settings missing in the file have their default values, a missing file
+// is written from the defaults.
+class SettingsStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SettingsStore(QObject *parent = nullptr);
+    ~SettingsStore();
+
+    void load();
+    void flush();
+    QString fileName() const;
+
+    QString previousPatientDataFileName() const;
+    void setPreviousPatientDataFileName(const QString& previousPatientDataFileName);
+
+    int activeTabIndex() const;
+    void setActiveTabIndex(int activeTabIndex);
+
+    SettingsWindow::settings_t settings() const;
+    void setSettings(const SettingsWindow::settings_t& settings);
+
+    bool visualizationShow(const QString& name) const;
+    void setVisualizationShow(const QString& name, bool show);
+
+signals:
+    void previousPatientDataFileNameChanged(const QString& previousPatientDataFileName);
+    void activeTabIndexChanged(int activeTabIndex);
+    void settingsChanged(const SettingsWindow::settings_t& settings);
+    void visualizationShowChanged(const QString& name, bool show);
+
+private slots:
+    void save();
+
+private:
+    QString m_previousPatientDataFileName;
+    int m_activeTabIndex;
+    SettingsWindow::settings_t m_settings;
+    QHash<QString, bool> m_visualizationShow;
+
+    // Values of keys unknown to this version, written back unchanged.
+    QJsonObject m_otherValues;
+
+    QTimer m_saveTimer;
+    QThreadPool m_writeThreadPool;
+
+    void scheduleSave();
+};
+
+#endif // SETTINGSSTORE_H
@@ -1,13 +1,32 @@
 #include "settingswindow.h"
 #include "ui_settingswindow.h"
+#include <QFileDialog>
+
+static SettingsWindow::settings_t createDefaultSettings()
+{
+    SettingsWindow::settings_t settings;
+
+    settings.autoLoadPatientDataFileOnStartup = false;
+    settings.leukocytesRecoveryThreshold = 3.0;
+    settings.thrombocytesRecoveryThreshold = 100.0;
+    settings.movingAverageDays = 7;
+    settings.smoothingFactor = 0.3;
+    settings.undoMemoryBudgetMegabytes = 16;
+    settings.autosaveIntervalSeconds = 60;
+
+    return settings;
+}
+
+const SettingsWindow::settings_t SettingsWindow::defaultSettings = createDefaultSettings();
 
 SettingsWindow::SettingsWindow(QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::SettingsWindow)
+    ui(new Ui::SettingsWindow),
+    m_settings(defaultSettings)
 {
     ui->setupUi(this);
 
-    m_settings.autoLoadPatientDataFileOnStartup = false;
+    showSettings(m_settings);
 }
 
 SettingsWindow::~SettingsWindow()
@@ -19,14 +38,7 @@ void SettingsWindow::setSettings(settings_t& settings)
 {
     m_settings = settings;
 
-    if(settings.autoLoadPatientDataFileOnStartup)
-    {
-        ui->checkBoxAutoLoadPatientDataFileOnStartup->setCheckState(Qt::CheckState::Checked);
-    }
-    else
-    {
-        ui->checkBoxAutoLoadPatientDataFileOnStartup->setCheckState(Qt::CheckState::Unchecked);
-    }
+    showSettings(m_settings);
 }
 
 SettingsWindow::settings_t& SettingsWindow::getSettings()
@@ -34,11 +46,9 @@ SettingsWindow::settings_t& SettingsWindow::getSettings()
     return m_settings;
 }
 
-void SettingsWindow::on_buttonBox_rejected()
+void SettingsWindow::showSettings(const settings_t& settings)
 {
-    // Restore previous settings.
-
-    if(m_settings.autoLoadPatientDataFileOnStartup)
+    if(settings.autoLoadPatientDataFileOnStartup)
     {
         ui->checkBoxAutoLoadPatientDataFileOnStartup->setCheckState(Qt::CheckState::Checked);
     }
@@ -46,6 +56,22 @@ void SettingsWindow::on_buttonBox_rejected()
     {
         ui->checkBoxAutoLoadPatientDataFileOnStartup->setCheckState(Qt::CheckState::Unchecked);
     }
+
+    ui->lineEditLabInboxDirectory->setText(settings.labInboxDirectory);
+    ui->lineEditPatientDataDirectory->setText(settings.patientDataDirectory);
+    ui->doubleSpinBoxLeukocytesRecoveryThreshold->setValue(settings.leukocytesRecoveryThreshold);
+    ui->doubleSpinBoxThrombocytesRecoveryThreshold->setValue(settings.thrombocytesRecoveryThreshold);
+    ui->spinBoxMovingAverageDays->setValue(settings.movingAverageDays);
+    ui->doubleSpinBoxSmoothingFactor->setValue(settings.smoothingFactor);
+    ui->spinBoxUndoMemoryBudgetMegabytes->setValue(settings.undoMemoryBudgetMegabytes);
+    ui->spinBoxAutosaveIntervalSeconds->setValue(settings.autosaveIntervalSeconds);
+}
+
+void SettingsWindow::on_buttonBox_rejected()
+{
+    // Restore previous settings.
+
+    showSettings(m_settings);
 }
 
 void SettingsWindow::on_buttonBox_accepted()
@@ -53,5 +79,34 @@ void SettingsWindow::on_buttonBox_accepted()
     // Store settings.
 
     m_settings.autoLoadPatientDataFileOnStartup = ui->checkBoxAutoLoadPatientDataFileOnStartup->isChecked();
+    m_settings.labInboxDirectory = ui->lineEditLabInboxDirectory->text();
+    m_settings.patientDataDirectory = ui->lineEditPatientDataDirectory->text();
+    m_settings.leukocytesRecoveryThreshold = ui->doubleSpinBoxLeukocytesRecoveryThreshold->value();
+    m_settings.thrombocytesRecoveryThreshold = ui->doubleSpinBoxThrombocytesRecoveryThreshold->value();
+    m_settings.movingAverageDays = ui->spinBoxMovingAverageDays->value();
+    m_settings.smoothingFactor = ui->doubleSpinBoxSmoothingFactor->value();
+    m_settings.undoMemoryBudgetMegabytes = ui->spinBoxUndoMemoryBudgetMegabytes->value();
+    m_settings.autosaveIntervalSeconds = ui->spinBoxAutosaveIntervalSeconds->value();
+
+    emit settingsAccepted(m_settings);
+}
+
+void SettingsWindow::on_pushButtonBrowseLabInboxDirectory_clicked()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, "Select Lab Result Inbox Directory", ui->lineEditLabInboxDirectory->text());
+
+    if(!directory.isEmpty())
+    {
+        ui->lineEditLabInboxDirectory->setText(directory);
+    }
 }
 
+void SettingsWindow::on_pushButtonBrowsePatientDataDirectory_clicked()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, "Select Patient Data Directory", ui->lineEditPatientDataDirectory->text());
+
+    if(!directory.isEmpty())
+    {
+        ui->lineEditPatientDataDirectory->setText(directory);
+    }
+}
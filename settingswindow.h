@@ -18,19 +18,51 @@ public:
     typedef struct
     {
         bool autoLoadPatientDataFileOnStartup;
+        QString labInboxDirectory;
+        QString patientDataDirectory;
+
+        // Values a blood count has to reach again after the nadir of a chemo therapy cycle
+        // to count as recovered.
+        double leukocytesRecoveryThreshold;
+        double thrombocytesRecoveryThreshold;
+
+        // Derived series of the visualization: moving average window and weight of the
+        // latest sample when smoothing exponentially.
+        int movingAverageDays;
+        double smoothingFactor;
+
+        // Memory the undo history of each open patient may use.
+        int undoMemoryBudgetMegabytes;
+
+        // Longest time unsaved changes are kept in memory only before they are written to a
+        // recovery file, also while typing continuously.
+        int autosaveIntervalSeconds;
     } settings_t;
 
+    // Default settings, used by the settings store and this dialog alike.
+    static const settings_t defaultSettings;
+
     void setSettings(settings_t& settings);
     settings_t& getSettings();
 
+signals:
+    // Emitted when the user accepts the dialog.
+    void settingsAccepted(const SettingsWindow::settings_t& settings);
+
 private slots:
     void on_buttonBox_rejected();
 
     void on_buttonBox_accepted();
 
+    void on_pushButtonBrowseLabInboxDirectory_clicked();
+
+    void on_pushButtonBrowsePatientDataDirectory_clicked();
+
 private:
     Ui::SettingsWindow *ui;
     settings_t m_settings;
+
+    void showSettings(const settings_t& settings);
 };
 
 #endif // SETTINGSWINDOW_H
@@ -0,0 +1,154 @@
+#include "tablecolumnsizer.h"
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QStyle>
+#include <QFontMetrics>
+#include <algorithm>
+
+TableColumnSizer::TableColumnSizer(QTableView *tableView, int sampleRows)
+    : QObject(tableView)
+    , m_tableView(tableView)
+    , m_sampleRows(sampleRows)
+{
+    m_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+
+    setModel(m_tableView->model());
+}
+
+// Starts tracking the passed model, must be called whenever the view's model is replaced.
+void TableColumnSizer::setModel(QAbstractItemModel *model)
+{
+    if(m_model)
+    {
+        disconnect(m_model, nullptr, this, nullptr);
+    }
+
+    m_model = model;
+
+    if(m_model)
+    {
+        connect(m_model, &QAbstractItemModel::modelReset, this, &TableColumnSizer::recompute);
+        connect(m_model, &QAbstractItemModel::dataChanged, this, &TableColumnSizer::handleDataChanged);
+        connect(m_model, &QAbstractItemModel::rowsInserted, this, &TableColumnSizer::handleRowsInserted);
+    }
+
+    recompute();
+}
+
+// Recomputes all column widths from the header and a sample of the rows.
+void TableColumnSizer::recompute()
+{
+    if(!m_model)
+    {
+        return;
+    }
+
+    auto columnCount = m_model->columnCount();
+
+    m_columnWidths.resize(columnCount);
+
+    for(auto column = 0; column < columnCount; column++)
+    {
+        m_columnWidths[column] = headerWidth(column);
+    }
+
+    measureRows(0, m_model->rowCount() - 1);
+
+    for(auto column = 0; column < columnCount; column++)
+    {
+        applyColumnWidth(column, m_columnWidths[column]);
+    }
+}
+
+void TableColumnSizer::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(!topLeft.isValid() || !bottomRight.isValid())
+    {
+        return;
+    }
+
+    measureRows(topLeft.row(), bottomRight.row());
+}
+
+void TableColumnSizer::handleRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+    {
+        return;
+    }
+
+    measureRows(first, last);
+}
+
+// Measures a sample of at most m_sampleRows rows of the passed row range (including its
+// first and last row) and widens each column whose cached width is exceeded.
+void TableColumnSizer::measureRows(int first, int last)
+{
+    auto rowCount = last - first + 1;
+
+    if(rowCount <= 0)
+    {
+        return;
+    }
+
+    auto columnCount = static_cast<int>(m_columnWidths.size());
+    auto samples = std::min(rowCount, m_sampleRows);
+    QVector<bool> columnWidened(columnCount, false);
+
+    for(auto sample = 0; sample < samples; sample++)
+    {
+        auto row = first;
+
+        if(samples > 1)
+        {
+            row = first + static_cast<int>(static_cast<qint64>(sample) * (rowCount - 1) / (samples - 1));
+        }
+
+        for(auto column = 0; column < columnCount; column++)
+        {
+            auto width = cellWidth(row, column);
+
+            if(width > m_columnWidths[column])
+            {
+                m_columnWidths[column] = width;
+                columnWidened[column] = true;
+            }
+        }
+    }
+
+    for(auto column = 0; column < columnCount; column++)
+    {
+        if(columnWidened[column])
+        {
+            applyColumnWidth(column, m_columnWidths[column]);
+        }
+    }
+}
+
+int TableColumnSizer::cellWidth(int row, int column) const
+{
+    auto text = m_model->data(m_model->index(row, column)).toString();
+
+    if(text.isEmpty())
+    {
+        return 0;
+    }
+
+    // Same text margin as used by the default item delegate.
+    auto textMargin = m_tableView->style()->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, m_tableView) + 1;
+
+    return m_tableView->fontMetrics().horizontalAdvance(text) + 2 * textMargin + 1;
+}
+
+int TableColumnSizer::headerWidth(int column) const
+{
+    auto header = m_tableView->horizontalHeader();
+    auto text = m_model->headerData(column, Qt::Horizontal).toString();
+    auto headerMargin = header->style()->pixelMetric(QStyle::PM_HeaderMargin, nullptr, header);
+
+    return header->fontMetrics().horizontalAdvance(text) + 2 * headerMargin + 1;
+}
+
+void TableColumnSizer::applyColumnWidth(int column, int width)
+{
+    m_tableView->horizontalHeader()->resizeSection(column, width);
+}
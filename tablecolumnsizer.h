@@ -0,0 +1,38 @@
+#ifndef TABLECOLUMNSIZER_H
+#define TABLECOLUMNSIZER_H
+
+#include <QObject>
+#include <QVector>
+#include <QPointer>
+#include <QtWidgets/QTableView>
+
+// Sizes the columns of a table view from the header and a bounded sample of rows. The
+// widths are cached and a column is only widened when a changed or inserted cell is
+// wider than its cached width, so the cost does not grow with the number of rows.
+class TableColumnSizer : public QObject
+{
+    Q_OBJECT
+
+public:
+    TableColumnSizer(QTableView *tableView, int sampleRows);
+
+    void setModel(QAbstractItemModel *model);
+    void recompute();
+
+private slots:
+    void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void handleRowsInserted(const QModelIndex &parent, int first, int last);
+
+private:
+    QTableView *m_tableView;
+    QPointer<QAbstractItemModel> m_model;
+    int m_sampleRows;
+    QVector<int> m_columnWidths;
+
+    int cellWidth(int row, int column) const;
+    int headerWidth(int column) const;
+    void measureRows(int first, int last);
+    void applyColumnWidth(int column, int width);
+};
+
+#endif // TABLECOLUMNSIZER_H
@@ -0,0 +1,165 @@
+#include "autosave.h"
+#include "patientdataschema.h"
+#include "patientsession.h"
+#include <QtTest>
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+// Recovery files of unsaved changes and their recovery, see Autosave and
+// PatientSession::recover().
+class TestAutosave : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void changedSessionIsWritten();
+    void recoveryFilesSkipOpenSessions();
+    void recoverRestoresUnsavedChanges();
+    void savingRemovesRecoveryFile();
+    void closingRemovesRecoveryFile();
+
+private:
+    QTemporaryDir m_directory;
+};
+
+const static int leukocytesColumn = PatientDataSchema::labParameterColumns[0];
+
+// Edits a blood value of a session with a single blood sample, written at once by the
+// passed autosave.
+static void editPatientSession(Autosave& autosave, PatientSession& patientSession)
+{
+    QVector<QVector<QString>> bloodSamples(PatientDataFile::bloodSamplesColumns.size(), QVector<QString>(1));
+
+    bloodSamples[PatientDataSchema::bloodSamplesDateColumn][0] = "01.01.2024";
+    bloodSamples[leukocytesColumn][0] = "1";
+
+    autosave.setInterval(0);
+    autosave.addPatientSession(&patientSession);
+
+    patientSession.setGeneralInformationField(&PatientSession::general_information_t::name, "Doe, Jane");
+    patientSession.bloodSamplesModel()->setColumns(bloodSamples);
+    patientSession.bloodSamplesModel()->setData(patientSession.bloodSamplesModel()->index(0, leukocytesColumn), "2.5");
+}
+
+static QStringList recoveryFileNames()
+{
+    QDir directory(Autosave::recoveryDirectory());
+    QStringList fileNames;
+
+    for(const auto& fileName : directory.entryList({"*.json"}, QDir::Files))
+    {
+        fileNames.append(directory.absoluteFilePath(fileName));
+    }
+
+    return fileNames;
+}
+
+// Recovery files are written to the test location, not to the one of the user.
+void TestAutosave::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(m_directory.isValid());
+}
+
+void TestAutosave::init()
+{
+    QDir(Autosave::recoveryDirectory()).removeRecursively();
+}
+
+void TestAutosave::changedSessionIsWritten()
+{
+    Autosave autosave;
+    PatientSession patientSession;
+
+    editPatientSession(autosave, patientSession);
+
+    QTRY_COMPARE(recoveryFileNames().size(), 1);
+}
+
+// A recovery file is locked while its session is open, it is offered for recovery once the
+// program holding it is gone.
+void TestAutosave::recoveryFilesSkipOpenSessions()
+{
+    PatientSession patientSession;
+    patientSession.setFileName(m_directory.path() + "/patient.json");
+
+    {
+        Autosave autosave;
+
+        editPatientSession(autosave, patientSession);
+
+        QTRY_COMPARE(recoveryFileNames().size(), 1);
+        QVERIFY(Autosave().recoveryFiles().isEmpty());
+    }
+
+    auto recoveryFiles = Autosave().recoveryFiles();
+
+    QCOMPARE(recoveryFiles.size(), 1);
+    QCOMPARE(recoveryFiles[0].patientDataFileName, m_directory.path() + "/patient.json");
+    QCOMPARE(recoveryFiles[0].patientName, QString("Doe, Jane"));
+}
+
+void TestAutosave::recoverRestoresUnsavedChanges()
+{
+    auto patientDataFileName = m_directory.path() + "/patient.json";
+
+    {
+        Autosave autosave;
+        PatientSession patientSession;
+
+        patientSession.setFileName(patientDataFileName);
+        editPatientSession(autosave, patientSession);
+
+        QTRY_COMPARE(recoveryFileNames().size(), 1);
+    }
+
+    PatientSession recoveredPatientSession;
+    QSignalSpy loadedSpy(&recoveredPatientSession, &PatientSession::loaded);
+
+    recoveredPatientSession.recover(recoveryFileNames()[0], patientDataFileName);
+
+    QVERIFY(loadedSpy.wait());
+    QVERIFY(loadedSpy.first().first().toBool());
+    QCOMPARE(recoveredPatientSession.fileName(), patientDataFileName);
+    QCOMPARE(recoveredPatientSession.generalInformation().name, QString("Doe, Jane"));
+    QCOMPARE(recoveredPatientSession.bloodSamplesModel()->text(0, leukocytesColumn), QString("2.5"));
+
+    // The recovered changes are unsaved and have to be saved completely.
+    QVERIFY(recoveredPatientSession.changedSinceLastSave());
+}
+
+void TestAutosave::savingRemovesRecoveryFile()
+{
+    Autosave autosave;
+    PatientSession patientSession;
+
+    editPatientSession(autosave, patientSession);
+
+    QTRY_COMPARE(recoveryFileNames().size(), 1);
+
+    QVERIFY(patientSession.save(m_directory.path() + "/saved.json"));
+
+    QTRY_VERIFY(recoveryFileNames().isEmpty());
+}
+
+void TestAutosave::closingRemovesRecoveryFile()
+{
+    Autosave autosave;
+    PatientSession patientSession;
+
+    editPatientSession(autosave, patientSession);
+
+    QTRY_COMPARE(recoveryFileNames().size(), 1);
+
+    autosave.removePatientSession(&patientSession);
+
+    QTRY_VERIFY(recoveryFileNames().isEmpty());
+}
+
+QTEST_MAIN(TestAutosave)
+
+#include "tst_autosave.moc"
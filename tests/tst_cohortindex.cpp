@@ -0,0 +1,201 @@
+#include "cohortindex.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QTemporaryDir>
+
+// Queries across the patient data files of a directory, see CohortIndex: the predicate over
+// the columns of all patients, the periods of consecutive matching samples and the filter by
+// medication.
+class TestCohortIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void counts();
+    void query_data();
+    void query();
+    void matchDetails();
+    void medicationMatch();
+    void dateColumnMatchesNothing();
+
+private:
+    QTemporaryDir m_directory;
+    CohortIndex m_cohortIndex;
+
+    void writePatient(const QString& patientId, const QString& name, const QVector<QPair<QString, QString>>& leukocytes,
+                      const QVector<QPair<QString, QString>>& medications);
+};
+
+const static int dateColumn = PatientDataSchema::bloodSamplesDateColumn;
+const static int leukocytesColumn = PatientDataSchema::leukocytesColumn;
+const static int thrombocytesColumn = PatientDataSchema::thrombocytesColumn;
+
+static CohortIndex::query_t leukocytesQuery(CohortIndex::comparison_t comparison, double threshold, int minimumDays,
+                                            const QString& medication = QString())
+{
+    CohortIndex::query_t query;
+
+    query.parameterColumn = leukocytesColumn;
+    query.comparison = comparison;
+    query.threshold = threshold;
+    query.minimumDays = minimumDays;
+    query.medication = medication;
+
+    return query;
+}
+
+// Returns "patient ID:days" of each match, sorted.
+static QStringList matchTexts(const QVector<CohortIndex::match_t>& matches)
+{
+    QStringList texts;
+
+    for(const auto& match : matches)
+    {
+        texts.append(match.patientId + ":" + QString::number(match.days));
+    }
+
+    texts.sort();
+
+    return texts;
+}
+
+// Writes a patient data file with the passed (date, leukocytes) samples and (start date, name)
+// medications. Samples without leukocytes get thrombocytes.
+void TestCohortIndex::writePatient(const QString& patientId, const QString& name, const QVector<QPair<QString, QString>>& leukocytes,
+                                   const QVector<QPair<QString, QString>>& medications)
+{
+    PatientDataFile::patient_data_t patientData;
+
+    patientData.patientId = patientId;
+    patientData.name = name;
+    patientData.bloodSamples.resize(PatientDataFile::bloodSamplesColumns.size());
+    patientData.chemoAndMeds.resize(PatientDataFile::chemoAndMedsColumns.size());
+
+    for(const auto& sample : leukocytes)
+    {
+        for(auto& column : patientData.bloodSamples)
+        {
+            column.append(QString());
+        }
+
+        patientData.bloodSamples[dateColumn].last() = sample.first;
+        patientData.bloodSamples[leukocytesColumn].last() = sample.second;
+
+        if(sample.second.isEmpty())
+        {
+            patientData.bloodSamples[thrombocytesColumn].last() = "150";
+        }
+    }
+
+    for(const auto& medication : medications)
+    {
+        for(auto& column : patientData.chemoAndMeds)
+        {
+            column.append(QString());
+        }
+
+        patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsDateColumn].last() = medication.first;
+        patientData.chemoAndMeds[PatientDataSchema::chemoAndMedsNameColumn].last() = medication.second;
+    }
+
+    QVERIFY(PatientDataFile::save(m_directory.filePath(patientId + ".json"), patientData));
+}
+
+void TestCohortIndex::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+
+    writePatient("111", "Alpha", {{"01.01.2024", "5"}, {"03.01.2024", "0.8"}, {"05.01.2024", ""}, {"08.01.2024", "0.5"}, {"10.01.2024", "3"}},
+                 {{"02.01.2024", "Cytarabin"}, {"15.01.2024", "Doxorubicin"}});
+    writePatient("222", "Beta", {{"01.02.2024", "0.9"}, {"02.02.2024", "0.7"}, {"03.02.2024", "2"}, {"10.02.2024", "0.5"}, {"20.02.2024", "0.4"}},
+                 {{"05.02.2024", "Doxorubicin liposomal"}});
+    writePatient("333", "Gamma", {{"01.03.2024", "6"}, {"15.03.2024", "12"}}, {});
+
+    QSignalSpy builtSpy(&m_cohortIndex, &CohortIndex::built);
+
+    m_cohortIndex.setDirectory(m_directory.path());
+    m_cohortIndex.build();
+
+    QVERIFY(builtSpy.wait());
+}
+
+void TestCohortIndex::counts()
+{
+    QCOMPARE(m_cohortIndex.patientCount(), 3);
+    QCOMPARE(m_cohortIndex.sampleCount(), 12);
+}
+
+void TestCohortIndex::query_data()
+{
+    QTest::addColumn<int>("comparison");
+    QTest::addColumn<double>("threshold");
+    QTest::addColumn<int>("minimumDays");
+    QTest::addColumn<QString>("medication");
+    QTest::addColumn<QStringList>("expectedMatches");
+
+    // Samples without leukocytes neither extend nor interrupt a period, the first long
+    // enough period of a patient matches.
+    QTest::newRow("below") << int(CohortIndex::COMPARISON_BELOW) << 1.0 << 1 << QString() << QStringList({"111:6", "222:2"});
+    QTest::newRow("below for a week") << int(CohortIndex::COMPARISON_BELOW) << 1.0 << 7 << QString() << QStringList({"222:11"});
+    QTest::newRow("below for too long") << int(CohortIndex::COMPARISON_BELOW) << 1.0 << 12 << QString() << QStringList();
+    QTest::newRow("above") << int(CohortIndex::COMPARISON_ABOVE) << 10.0 << 1 << QString() << QStringList({"333:1"});
+    QTest::newRow("threshold excluded") << int(CohortIndex::COMPARISON_ABOVE) << 12.0 << 1 << QString() << QStringList();
+
+    // Only samples from the start of the first matching medication on are considered.
+    QTest::newRow("medication") << int(CohortIndex::COMPARISON_BELOW) << 1.0 << 1 << "doxo" << QStringList({"222:11"});
+    QTest::newRow("medication case insensitive") << int(CohortIndex::COMPARISON_BELOW) << 1.0 << 1 << "CYTARABIN" << QStringList({"111:6"});
+    QTest::newRow("unknown medication") << int(CohortIndex::COMPARISON_BELOW) << 1.0 << 1 << "vincristin" << QStringList();
+}
+
+void TestCohortIndex::query()
+{
+    QFETCH(int, comparison);
+    QFETCH(double, threshold);
+    QFETCH(int, minimumDays);
+    QFETCH(QString, medication);
+    QFETCH(QStringList, expectedMatches);
+
+    auto matches = m_cohortIndex.query(leukocytesQuery(static_cast<CohortIndex::comparison_t>(comparison), threshold, minimumDays, medication));
+
+    QCOMPARE(matchTexts(matches), expectedMatches);
+}
+
+void TestCohortIndex::matchDetails()
+{
+    auto matches = m_cohortIndex.query(leukocytesQuery(CohortIndex::COMPARISON_BELOW, 1.0, 7));
+
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].fileName, QString("222.json"));
+    QCOMPARE(matches[0].name, QString("Beta"));
+    QCOMPARE(matches[0].firstDate, QDate(2024, 2, 10));
+    QCOMPARE(matches[0].lastDate, QDate(2024, 2, 20));
+    QCOMPARE(matches[0].extremeValue, double(0.4f));
+    QVERIFY(matches[0].medication.isEmpty());
+}
+
+void TestCohortIndex::medicationMatch()
+{
+    auto matches = m_cohortIndex.query(leukocytesQuery(CohortIndex::COMPARISON_BELOW, 1.0, 1, "cytarabin"));
+
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].medication, QString("Cytarabin"));
+    QCOMPARE(matches[0].medicationStart, QDate(2024, 1, 2));
+    QCOMPARE(matches[0].firstDate, QDate(2024, 1, 3));
+    QCOMPARE(matches[0].lastDate, QDate(2024, 1, 8));
+    QCOMPARE(matches[0].extremeValue, 0.5);
+}
+
+void TestCohortIndex::dateColumnMatchesNothing()
+{
+    auto query = leukocytesQuery(CohortIndex::COMPARISON_ABOVE, 0.0, 1);
+
+    query.parameterColumn = dateColumn;
+
+    QVERIFY(m_cohortIndex.query(query).isEmpty());
+}
+
+QTEST_MAIN(TestCohortIndex)
+
+#include "tst_cohortindex.moc"
@@ -0,0 +1,212 @@
+#include "cycleanalysis.h"
+#include "patienttablemodel.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QUndoStack>
+
+// Nadir and recovery per chemo therapy cycle and the cycle boundaries, also after the tables
+// have been edited, see CycleAnalysis.
+class TestCycleAnalysis : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void nadirAndRecovery();
+    void recoveryFollowsNadir();
+    void cycleBoundaries();
+    void editedSampleUpdatesItsCycle();
+    void addedStartDateSplitsCycle();
+
+private:
+    QUndoStack *m_undoStack;
+    PatientTableModel *m_bloodSamplesModel;
+    PatientTableModel *m_chemoAndMedsModel;
+    CycleAnalysis *m_cycleAnalysis;
+};
+
+const static int leukocytesColumn = PatientDataSchema::leukocytesColumn;
+
+// Leukocytes recover at 3, thrombocytes at 100.
+const static QVector<double> recoveryThresholds{3.0, 100.0};
+
+// Blood samples of the passed (date, leukocytes) rows.
+static QVector<QVector<QString>> bloodSamples(const QVector<QPair<QString, QString>>& rows)
+{
+    QVector<QVector<QString>> columns(PatientDataFile::bloodSamplesColumns.size(), QVector<QString>(rows.size()));
+
+    for(auto row = 0; row < rows.size(); row++)
+    {
+        columns[PatientDataSchema::bloodSamplesDateColumn][row] = rows[row].first;
+        columns[leukocytesColumn][row] = rows[row].second;
+    }
+
+    return columns;
+}
+
+// Chemo therapy / medication rows of the passed (date, name) rows.
+static QVector<QVector<QString>> chemoAndMeds(const QVector<QPair<QString, QString>>& rows)
+{
+    QVector<QVector<QString>> columns(PatientDataFile::chemoAndMedsColumns.size(), QVector<QString>(rows.size()));
+
+    for(auto row = 0; row < rows.size(); row++)
+    {
+        columns[PatientDataSchema::chemoAndMedsDateColumn][row] = rows[row].first;
+        columns[PatientDataSchema::chemoAndMedsNameColumn][row] = rows[row].second;
+    }
+
+    return columns;
+}
+
+static qint64 dateKey(const QString& date)
+{
+    return PatientTableModel::parseDate(date);
+}
+
+void TestCycleAnalysis::init()
+{
+    m_undoStack = new QUndoStack(this);
+    m_bloodSamplesModel = new PatientTableModel(PatientDataFile::bloodSamplesColumns, PatientDataSchema::bloodSamplesDateColumn, m_undoStack, this);
+    m_chemoAndMedsModel = new PatientTableModel(PatientDataFile::chemoAndMedsColumns, PatientDataSchema::chemoAndMedsDateColumn, m_undoStack, this);
+    m_cycleAnalysis = new CycleAnalysis(m_bloodSamplesModel, m_chemoAndMedsModel, this);
+
+    m_cycleAnalysis->setRecoveryThresholds(recoveryThresholds);
+}
+
+void TestCycleAnalysis::cleanup()
+{
+    delete m_cycleAnalysis;
+    delete m_chemoAndMedsModel;
+    delete m_bloodSamplesModel;
+    delete m_undoStack;
+}
+
+void TestCycleAnalysis::nadirAndRecovery()
+{
+    m_chemoAndMedsModel->setColumns(chemoAndMeds({{"01.01.2024", "Cisplatin"}}));
+    m_bloodSamplesModel->setColumns(bloodSamples({{"01.01.2024", "5"}, {"08.01.2024", "1"}, {"15.01.2024", "2"}, {"22.01.2024", "4"}, {"29.01.2024", "6"}}));
+
+    const auto& cycles = m_cycleAnalysis->cycles();
+
+    QCOMPARE(cycles.size(), 1);
+
+    const auto& leukocytes = cycles[0].parameters[0];
+
+    QVERIFY(leukocytes.hasNadir);
+    QCOMPARE(leukocytes.nadir, 1.0);
+    QCOMPARE(leukocytes.nadirDateKey, dateKey("08.01.2024"));
+    QCOMPARE(leukocytes.nadirDay, 8);
+    QVERIFY(leukocytes.recovered);
+    QCOMPARE(leukocytes.recoveryValue, 4.0);
+    QCOMPARE(leukocytes.recoveryDateKey, dateKey("22.01.2024"));
+    QCOMPARE(leukocytes.recoveryDay, 22);
+
+    // No thrombocytes have been sampled.
+    QVERIFY(!cycles[0].parameters[1].hasNadir);
+}
+
+// A value reaching the threshold before a lower nadir is no recovery, nor is a nadir which has
+// never been below the threshold.
+void TestCycleAnalysis::recoveryFollowsNadir()
+{
+    m_chemoAndMedsModel->setColumns(chemoAndMeds({{"01.01.2024", "Cisplatin"}, {"01.03.2024", "Cisplatin"}}));
+    m_bloodSamplesModel->setColumns(bloodSamples({{"05.01.2024", "2"}, {"08.01.2024", "3.5"}, {"12.01.2024", "0.5"},
+                                                  {"02.03.2024", "4"}, {"09.03.2024", "5"}}));
+
+    const auto& cycles = m_cycleAnalysis->cycles();
+
+    QCOMPARE(cycles.size(), 2);
+    QCOMPARE(cycles[0].parameters[0].nadir, 0.5);
+    QCOMPARE(cycles[0].parameters[0].nadirDay, 12);
+    QVERIFY(!cycles[0].parameters[0].recovered);
+    QCOMPARE(cycles[1].parameters[0].nadir, 4.0);
+    QVERIFY(!cycles[1].parameters[0].recovered);
+}
+
+// Rows starting at the same date form one cycle, which lasts until the next start date or
+// maximumCycleDays.
+void TestCycleAnalysis::cycleBoundaries()
+{
+    m_chemoAndMedsModel->setColumns(chemoAndMeds({{"01.01.2024", "Cisplatin"}, {"01.01.2024", "Etoposid"}, {"01.01.2024", "Cisplatin"},
+                                                  {"15.01.2024", "Carboplatin"}, {"xx.01.2024", "Vincristin"},
+                                                  {"01.06.2024", "Etoposid"}}));
+
+    const auto& cycles = m_cycleAnalysis->cycles();
+
+    QCOMPARE(cycles.size(), 3);
+    QCOMPARE(cycles[0].startDateKey, dateKey("01.01.2024"));
+    QCOMPARE(cycles[0].endDateKey, dateKey("15.01.2024"));
+    QCOMPARE(cycles[0].medications, QString("Cisplatin, Etoposid"));
+    QCOMPARE(cycles[1].startDateKey, dateKey("15.01.2024"));
+    QCOMPARE(cycles[1].endDateKey, dateKey("26.02.2024"));
+    QCOMPARE(cycles[1].medications, QString("Carboplatin"));
+    QCOMPARE(cycles[2].startDateKey, dateKey("01.06.2024"));
+    QCOMPARE(cycles[2].endDateKey, dateKey("13.07.2024"));
+}
+
+// Edited and added samples are assigned to their cycle, samples outside of any cycle are
+// ignored.
+void TestCycleAnalysis::editedSampleUpdatesItsCycle()
+{
+    m_chemoAndMedsModel->setColumns(chemoAndMeds({{"01.01.2024", "Cisplatin"}, {"01.03.2024", "Cisplatin"}}));
+    m_bloodSamplesModel->setColumns(bloodSamples({{"08.01.2024", "2"}, {"15.01.2024", "4"}, {"08.03.2024", "1"}}));
+
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadir, 2.0);
+
+    m_bloodSamplesModel->setData(m_bloodSamplesModel->index(1, leukocytesColumn), "1.5");
+
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadir, 1.5);
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadirDay, 15);
+    QCOMPARE(m_cycleAnalysis->cycles()[1].parameters[0].nadir, 1.0);
+
+    auto row = QVector<QString>(PatientDataFile::bloodSamplesColumns.size());
+
+    row[PatientDataSchema::bloodSamplesDateColumn] = "10.03.2024";
+    row[leukocytesColumn] = "0.5";
+
+    m_bloodSamplesModel->insertRowsSorted({row});
+
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadir, 1.5);
+    QCOMPARE(m_cycleAnalysis->cycles()[1].parameters[0].nadir, 0.5);
+    QCOMPARE(m_cycleAnalysis->cycles()[1].parameters[0].nadirDay, 10);
+
+    // Moving the sample into the first cycle takes it out of the second one.
+    m_bloodSamplesModel->setData(m_bloodSamplesModel->index(3, PatientDataSchema::bloodSamplesDateColumn), "10.01.2024");
+
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadir, 0.5);
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadirDay, 10);
+    QCOMPARE(m_cycleAnalysis->cycles()[1].parameters[0].nadir, 1.0);
+
+    m_bloodSamplesModel->removeRows(0, m_bloodSamplesModel->rowCount());
+
+    QVERIFY(!m_cycleAnalysis->cycles()[0].parameters[0].hasNadir);
+    QVERIFY(!m_cycleAnalysis->cycles()[1].parameters[0].hasNadir);
+}
+
+void TestCycleAnalysis::addedStartDateSplitsCycle()
+{
+    m_chemoAndMedsModel->setColumns(chemoAndMeds({{"01.01.2024", "Cisplatin"}}));
+    m_bloodSamplesModel->setColumns(bloodSamples({{"05.01.2024", "2"}, {"20.01.2024", "1"}}));
+
+    QCOMPARE(m_cycleAnalysis->cycles()[0].parameters[0].nadir, 1.0);
+
+    auto row = QVector<QString>(PatientDataFile::chemoAndMedsColumns.size());
+
+    row[PatientDataSchema::chemoAndMedsDateColumn] = "15.01.2024";
+    row[PatientDataSchema::chemoAndMedsNameColumn] = "Carboplatin";
+
+    m_chemoAndMedsModel->insertRowsSorted({row});
+
+    const auto& cycles = m_cycleAnalysis->cycles();
+
+    QCOMPARE(cycles.size(), 2);
+    QCOMPARE(cycles[0].endDateKey, dateKey("15.01.2024"));
+    QCOMPARE(cycles[0].parameters[0].nadir, 2.0);
+    QCOMPARE(cycles[1].parameters[0].nadir, 1.0);
+    QCOMPARE(cycles[1].parameters[0].nadirDay, 6);
+}
+
+QTEST_MAIN(TestCycleAnalysis)
+
+#include "tst_cycleanalysis.moc"
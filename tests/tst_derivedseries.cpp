@@ -0,0 +1,151 @@
+#include "derivedseries.h"
+#include "patienttablemodel.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QUndoStack>
+#include <cmath>
+
+// Moving average, smoothed values and slope of a blood value column, see DerivedSeries. An
+// edited cell continues the pass from the edited sample, which must give the same series as
+// computing the column again.
+class TestDerivedSeries : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void derivedValues();
+    void editedCellEqualsRecompute_data();
+    void editedCellEqualsRecompute();
+};
+
+const static int dateColumn = PatientDataSchema::bloodSamplesDateColumn;
+const static int leukocytesColumn = PatientDataSchema::leukocytesColumn;
+
+// Blood samples of the passed (date, leukocytes) rows.
+static QVector<QVector<QString>> bloodSamples(const QVector<QPair<QString, QString>>& rows)
+{
+    QVector<QVector<QString>> columns(PatientDataFile::bloodSamplesColumns.size(), QVector<QString>(rows.size()));
+
+    for(auto row = 0; row < rows.size(); row++)
+    {
+        columns[dateColumn][row] = rows[row].first;
+        columns[leukocytesColumn][row] = rows[row].second;
+    }
+
+    return columns;
+}
+
+static qint64 dateKey(const QString& date)
+{
+    return PatientTableModel::parseDate(date);
+}
+
+// Compares the passed series point by point, NaN (no slope) equals NaN.
+static void compareSeries(const QVector<QCPGraphData>& actual, const QVector<QCPGraphData>& expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+
+    for(auto i = 0; i < actual.size(); i++)
+    {
+        QCOMPARE(actual[i].key, expected[i].key);
+
+        if(std::isnan(expected[i].value))
+        {
+            QVERIFY(std::isnan(actual[i].value));
+        }
+        else
+        {
+            QCOMPARE(actual[i].value, expected[i].value);
+        }
+    }
+}
+
+void TestDerivedSeries::derivedValues()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+    DerivedSeries derivedSeries(&model);
+
+    derivedSeries.setParameters(3, 0.5);
+    model.setColumns(bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "2"}, {"02.01.2024", "x"}, {"03.01.2024", "3"},
+                                   {"03.01.2024", "5"}, {"10.01.2024", "4"}}));
+
+    const auto& movingAverage = derivedSeries.series(leukocytesColumn, DerivedSeries::DERIVED_MOVING_AVERAGE);
+    const auto& smoothed = derivedSeries.series(leukocytesColumn, DerivedSeries::DERIVED_SMOOTHED);
+    const auto& slope = derivedSeries.series(leukocytesColumn, DerivedSeries::DERIVED_SLOPE);
+
+    // The text is no sample.
+    QCOMPARE(movingAverage.size(), 5);
+    QCOMPARE(movingAverage[0].key, double(dateKey("01.01.2024")));
+    QCOMPARE(movingAverage[4].key, double(dateKey("10.01.2024")));
+
+    QCOMPARE(movingAverage[0].value, 1.0);
+    QCOMPARE(movingAverage[1].value, 1.5);
+    QCOMPARE(movingAverage[2].value, 2.0);
+    QCOMPARE(movingAverage[3].value, 2.75);
+    QCOMPARE(movingAverage[4].value, 4.0);
+
+    QCOMPARE(smoothed[0].value, 1.0);
+    QCOMPARE(smoothed[1].value, 1.5);
+    QCOMPARE(smoothed[2].value, 2.25);
+    QCOMPARE(smoothed[3].value, 3.625);
+    QCOMPARE(smoothed[4].value, 3.8125);
+
+    // Samples of the same day have no slope.
+    QVERIFY(std::isnan(slope[0].value));
+    QCOMPARE(slope[1].value, 1.0);
+    QCOMPARE(slope[2].value, 1.0);
+    QVERIFY(std::isnan(slope[3].value));
+    QCOMPARE(slope[4].value, -1.0 / 7.0);
+}
+
+void TestDerivedSeries::editedCellEqualsRecompute_data()
+{
+    QTest::addColumn<int>("row");
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("first sample") << 0 << "9";
+    QTest::newRow("middle sample") << 5 << "0.5";
+    QTest::newRow("last sample") << 11 << "7";
+    QTest::newRow("sample removed") << 4 << "";
+    QTest::newRow("sample inserted") << 7 << "3.5";
+    QTest::newRow("first sample removed") << 0 << "-";
+}
+
+void TestDerivedSeries::editedCellEqualsRecompute()
+{
+    QFETCH(int, row);
+    QFETCH(QString, text);
+
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+    DerivedSeries derivedSeries(&model);
+
+    model.setColumns(bloodSamples({{"01.01.2024", "4"}, {"02.01.2024", "3"}, {"04.01.2024", "2.5"}, {"05.01.2024", "2"},
+                                   {"05.01.2024", "1.5"}, {"08.01.2024", "1"}, {"09.01.2024", "1.2"}, {"11.01.2024", ""},
+                                   {"12.01.2024", "2"}, {"15.01.2024", "3"}, {"20.01.2024", "4"}, {"21.01.2024", "5"}}));
+
+    for(auto derived = 0; derived < DerivedSeries::DERIVED_COUNT; derived++)
+    {
+        derivedSeries.series(leukocytesColumn, static_cast<DerivedSeries::derived_t>(derived));
+    }
+
+    model.setData(model.index(row, leukocytesColumn), text);
+
+    DerivedSeries recomputedSeries(&model);
+
+    for(auto derived = 0; derived < DerivedSeries::DERIVED_COUNT; derived++)
+    {
+        compareSeries(derivedSeries.series(leukocytesColumn, static_cast<DerivedSeries::derived_t>(derived)),
+                      recomputedSeries.series(leukocytesColumn, static_cast<DerivedSeries::derived_t>(derived)));
+
+        if(QTest::currentTestFailed())
+        {
+            return;
+        }
+    }
+}
+
+QTEST_MAIN(TestDerivedSeries)
+
+#include "tst_derivedseries.moc"
@@ -0,0 +1,228 @@
+#include "doseaccounting.h"
+#include "patienttablemodel.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QUndoStack>
+#include <cmath>
+
+// Parsing of free text doses and the cumulative doses per drug kept up to date row by row,
+// see DoseAccounting.
+class TestDoseAccounting : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parseDose_data();
+    void parseDose();
+    void rowsAreAddedAndSubtracted();
+    void bodySurfaceConvertsTotals();
+    void lifetimePercentages();
+};
+
+const static int dateColumn = PatientDataSchema::chemoAndMedsDateColumn;
+
+static QVector<QString> row(const QString& date, const QString& days, const QString& name, const QString& dose)
+{
+    QVector<QString> texts(PatientDataFile::chemoAndMedsColumns.size());
+
+    texts[dateColumn] = date;
+    texts[PatientDataSchema::chemoAndMedsDaysColumn] = days;
+    texts[PatientDataSchema::chemoAndMedsNameColumn] = name;
+    texts[PatientDataSchema::chemoAndMedsDoseColumn] = dose;
+
+    return texts;
+}
+
+// Chemo therapy / medication table of the passed rows.
+static QVector<QVector<QString>> chemoAndMeds(const QVector<QVector<QString>>& rows)
+{
+    QVector<QVector<QString>> columns(PatientDataFile::chemoAndMedsColumns.size(), QVector<QString>(rows.size()));
+
+    for(auto row = 0; row < rows.size(); row++)
+    {
+        for(auto column = 0; column < columns.size(); column++)
+        {
+            columns[column][row] = rows[row][column];
+        }
+    }
+
+    return columns;
+}
+
+// Returns the total of the passed drug, an invalid total (empty name) if there is none.
+static DoseAccounting::drug_total_t total(const DoseAccounting& doseAccounting, const QString& name)
+{
+    for(const auto& drugTotal : doseAccounting.totals())
+    {
+        if(drugTotal.name.compare(name, Qt::CaseInsensitive) == 0)
+        {
+            return drugTotal;
+        }
+    }
+
+    return DoseAccounting::drug_total_t();
+}
+
+void TestDoseAccounting::parseDose_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<double>("amount");
+    QTest::addColumn<QString>("unit");
+    QTest::addColumn<bool>("perBodySurface");
+
+    QTest::newRow("mg per m²") << "60 mg/m²" << true << 60.0 << "mg" << true;
+    QTest::newRow("g with comma") << "1,5 g" << true << 1500.0 << "mg" << false;
+    QTest::newRow("pro qm") << "75mg pro qm" << true << 75.0 << "mg" << true;
+    QTest::newRow("µg") << "500 µg" << true << 0.5 << "mg" << false;
+    QTest::newRow("mcg per m2") << "100 MCG/m2" << true << 0.1 << "mg" << true;
+    QTest::newRow("other unit") << "2 Tbl" << true << 2.0 << "Tbl" << false;
+    QTest::newRow("no unit") << "3" << true << 3.0 << "" << false;
+    QTest::newRow("trailing text") << "40 mg p.o. morgens" << true << 40.0 << "mg" << false;
+    QTest::newRow("empty") << "" << false << 0.0 << "" << false;
+    QTest::newRow("unit first") << "mg 60" << false << 0.0 << "" << false;
+    QTest::newRow("text") << "nach Bedarf" << false << 0.0 << "" << false;
+}
+
+void TestDoseAccounting::parseDose()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, valid);
+    QFETCH(double, amount);
+    QFETCH(QString, unit);
+    QFETCH(bool, perBodySurface);
+
+    auto dose = DoseAccounting::parseDose(text);
+
+    QCOMPARE(dose.valid, valid);
+
+    if(!valid)
+    {
+        return;
+    }
+
+    QCOMPARE(dose.amount, amount);
+    QCOMPARE(dose.unit, unit);
+    QCOMPARE(dose.perBodySurface, perBodySurface);
+}
+
+// Each row contributes its dose times its days, rows of the same drug are summed whatever the
+// case of their names.
+void TestDoseAccounting::rowsAreAddedAndSubtracted()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::chemoAndMedsColumns, dateColumn, &undoStack);
+    DoseAccounting doseAccounting(&model);
+
+    model.setColumns(chemoAndMeds({row("01.01.2024", "3", "Etoposid", "100 mg"),
+                                   row("01.01.2024", "", "Cisplatin", "50 mg"),
+                                   row("22.01.2024", "3", "etoposid", "0,1 g"),
+                                   row("22.01.2024", "1", "Cisplatin", "nach Bedarf")}));
+
+    QCOMPARE(doseAccounting.totals().size(), 2);
+    QCOMPARE(total(doseAccounting, "Etoposid").total, 600.0);
+    QCOMPARE(total(doseAccounting, "Cisplatin").total, 50.0);
+
+    // A row added through the table is empty until its cells are edited.
+    model.insertRows(4, 1);
+
+    const auto insertedRow = row("12.02.2024", "2", "Etoposid", "100 mg");
+
+    for(auto column = 0; column < insertedRow.size(); column++)
+    {
+        model.setData(model.index(4, column), insertedRow[column]);
+    }
+
+    QCOMPARE(total(doseAccounting, "Etoposid").total, 800.0);
+
+    model.setData(model.index(3, PatientDataSchema::chemoAndMedsDoseColumn), "60 mg");
+
+    QCOMPARE(total(doseAccounting, "Cisplatin").total, 110.0);
+
+    model.setData(model.index(0, PatientDataSchema::chemoAndMedsDaysColumn), "1");
+
+    QCOMPARE(total(doseAccounting, "Etoposid").total, 600.0);
+
+    // Moving a row by its date does not change any total.
+    model.setData(model.index(0, dateColumn), "15.02.2024");
+
+    QCOMPARE(model.text(4, PatientDataSchema::chemoAndMedsNameColumn), QString("Etoposid"));
+    QCOMPARE(total(doseAccounting, "Etoposid").total, 600.0);
+
+    model.removeRows(4, 1);
+
+    QCOMPARE(total(doseAccounting, "Etoposid").total, 500.0);
+
+    model.removeRows(0, 1);
+    model.removeRows(1, 1);
+
+    QCOMPARE(doseAccounting.totals().size(), 1);
+    QVERIFY(total(doseAccounting, "Cisplatin").name.isEmpty());
+
+    undoStack.undo();
+
+    QCOMPARE(total(doseAccounting, "Cisplatin").total, 60.0);
+}
+
+// Doses per m² and absolute doses are converted into each other by the body surface area.
+void TestDoseAccounting::bodySurfaceConvertsTotals()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::chemoAndMedsColumns, dateColumn, &undoStack);
+    DoseAccounting doseAccounting(&model);
+
+    model.setColumns(chemoAndMeds({row("01.01.2024", "3", "Doxorubicin", "60 mg/m²"),
+                                   row("01.02.2024", "1", "Doxorubicin", "120 mg"),
+                                   row("01.02.2024", "1", "Vincristin", "1,5 mg/m²")}));
+
+    auto doxorubicin = total(doseAccounting, "Doxorubicin");
+
+    QVERIFY(std::isnan(doxorubicin.total));
+    QVERIFY(std::isnan(doxorubicin.totalPerBodySurface));
+    QCOMPARE(doxorubicin.lifetimeLimit, 450.0);
+
+    doseAccounting.setBodySurface(2.0);
+    doxorubicin = total(doseAccounting, "Doxorubicin");
+
+    QCOMPARE(doxorubicin.total, 480.0);
+    QCOMPARE(doxorubicin.totalPerBodySurface, 240.0);
+
+    auto vincristin = total(doseAccounting, "Vincristin");
+
+    QCOMPARE(vincristin.total, 3.0);
+    QCOMPARE(vincristin.totalPerBodySurface, 1.5);
+    QCOMPARE(vincristin.lifetimeLimit, 0.0);
+}
+
+// One point per day of treatment, absolute doses count once the body surface area is known.
+void TestDoseAccounting::lifetimePercentages()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::chemoAndMedsColumns, dateColumn, &undoStack);
+    DoseAccounting doseAccounting(&model);
+
+    model.setColumns(chemoAndMeds({row("01.01.2024", "3", "Doxorubicin", "60 mg/m²"),
+                                   row("01.02.2024", "1", "Doxorubicin", "120 mg"),
+                                   row("01.02.2024", "1", "Cisplatin", "50 mg/m²")}));
+
+    auto curves = doseAccounting.lifetimeCurves();
+
+    QCOMPARE(curves.size(), 1);
+    QCOMPARE(curves[0].name, QString("Doxorubicin"));
+    QCOMPARE(curves[0].percentages.size(), 3);
+    QCOMPARE(curves[0].percentages[0].key, double(PatientTableModel::parseDate("01.01.2024")));
+    QCOMPARE(curves[0].percentages[1].key, double(PatientTableModel::parseDate("01.01.2024") + 24 * 3600));
+    QCOMPARE(curves[0].percentages[0].value, 100.0 * 60.0 / 450.0);
+    QCOMPARE(curves[0].percentages[2].value, 40.0);
+
+    doseAccounting.setBodySurface(2.0);
+    curves = doseAccounting.lifetimeCurves();
+
+    QCOMPARE(curves[0].percentages.size(), 4);
+    QCOMPARE(curves[0].percentages[3].key, double(PatientTableModel::parseDate("01.02.2024")));
+    QCOMPARE(curves[0].percentages[3].value, 100.0 * 240.0 / 450.0);
+}
+
+QTEST_MAIN(TestDoseAccounting)
+
+#include "tst_doseaccounting.moc"
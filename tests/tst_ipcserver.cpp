@@ -0,0 +1,193 @@
+#include "ipcprotocol.h"
+#include "ipcserver.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QLocalSocket>
+
+// Protocol of the local socket, see ipcprotocol.h: requests answered by the server, requests
+// handed over in batches and the rows pushed.
+class TestIpcServer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void pingIsAnswered();
+    void invalidRequestsAreRefused_data();
+    void invalidRequestsAreRefused();
+    void requestsAreBatched();
+    void incompleteLineWaitsForRest();
+    void secondServerDoesNotListen();
+    void bloodSampleRowsFromJson();
+
+private:
+    IpcServer *m_server;
+    QLocalSocket *m_socket;
+    QVector<QVector<IpcServer::request_t>> m_batches;
+
+    void write(const QByteArray& data);
+    QJsonObject readResponse();
+};
+
+const static int responseTimeoutMilliseconds = 5000;
+
+// The socket is named after the user, a name of its own keeps the test off a running
+// instance.
+void TestIpcServer::initTestCase()
+{
+    qputenv("USERNAME", "leukitest" + QByteArray::number(QCoreApplication::applicationPid()));
+}
+
+void TestIpcServer::init()
+{
+    m_server = new IpcServer(this);
+    m_batches.clear();
+
+    connect(m_server, &IpcServer::batchReceived, this, [this](const QVector<IpcServer::request_t>& requests)
+    {
+        m_batches.append(requests);
+    });
+
+    QVERIFY(m_server->listen());
+
+    m_socket = new QLocalSocket(this);
+    m_socket->connectToServer(IpcProtocol::serverName());
+
+    QVERIFY(m_socket->waitForConnected(responseTimeoutMilliseconds));
+}
+
+void TestIpcServer::cleanup()
+{
+    delete m_socket;
+    delete m_server;
+}
+
+void TestIpcServer::write(const QByteArray& data)
+{
+    m_socket->write(data);
+    m_socket->flush();
+}
+
+// Waits for the next response line while the server keeps running, an empty object on timeout.
+QJsonObject TestIpcServer::readResponse()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while(!m_socket->canReadLine() && timer.elapsed() < responseTimeoutMilliseconds)
+    {
+        QTest::qWait(10);
+    }
+
+    return QJsonDocument::fromJson(m_socket->readLine()).object();
+}
+
+void TestIpcServer::pingIsAnswered()
+{
+    write("{\"id\": 1, \"command\": \"ping\"}\n");
+
+    auto response = readResponse();
+
+    QCOMPARE(response["id"].toInt(), 1);
+    QCOMPARE(response["ok"].toBool(), true);
+    QVERIFY(m_batches.isEmpty());
+}
+
+void TestIpcServer::invalidRequestsAreRefused_data()
+{
+    QTest::addColumn<QByteArray>("request");
+
+    QTest::newRow("no JSON") << QByteArray("ping\n");
+    QTest::newRow("unknown command") << QByteArray("{\"id\": 1, \"command\": \"deletePatient\"}\n");
+    QTest::newRow("rows missing") << QByteArray("{\"id\": 1, \"command\": \"addBloodSamples\"}\n");
+    QTest::newRow("row no object") << QByteArray("{\"id\": 1, \"command\": \"addBloodSamples\", \"rows\": [1]}\n");
+}
+
+void TestIpcServer::invalidRequestsAreRefused()
+{
+    QFETCH(QByteArray, request);
+
+    write(request);
+
+    auto response = readResponse();
+
+    QCOMPARE(response["ok"].toBool(true), false);
+    QVERIFY(!response["error"].toString().isEmpty());
+
+    QTest::qWait(100);
+
+    QVERIFY(m_batches.isEmpty());
+}
+
+// Requests arriving together are handed over as one batch in their order, the responses
+// get the ids of their requests.
+void TestIpcServer::requestsAreBatched()
+{
+    write("{\"id\": 1, \"command\": \"addBloodSamples\", \"patientId\": \"123\", \"rows\": [{\"date\": \"01.01.2024\"}]}\n"
+          "{\"id\": 2, \"command\": \"listPatients\"}\n"
+          "{\"id\": 3, \"command\": \"addChemoAndMeds\", \"rows\": []}\n");
+
+    QTRY_COMPARE(m_batches.size(), 1);
+
+    const auto& requests = m_batches[0];
+
+    QCOMPARE(requests.size(), 3);
+    QCOMPARE(requests[0].command, IpcProtocol::commandAddBloodSamples);
+    QCOMPARE(requests[0].patientId, QString("123"));
+    QCOMPARE(requests[0].rows.size(), 1);
+    QCOMPARE(requests[1].command, IpcProtocol::commandListPatients);
+    QCOMPARE(requests[2].command, IpcProtocol::commandAddChemoAndMeds);
+
+    QJsonObject response;
+    response["addedRows"] = 1;
+
+    m_server->respond(requests[0], response);
+
+    response = readResponse();
+
+    QCOMPARE(response["id"].toInt(), 1);
+    QCOMPARE(response["ok"].toBool(), true);
+    QCOMPARE(response["addedRows"].toInt(), 1);
+}
+
+void TestIpcServer::incompleteLineWaitsForRest()
+{
+    write("{\"id\": 1, \"comm");
+
+    QTest::qWait(100);
+
+    QVERIFY(!m_socket->canReadLine());
+
+    write("and\": \"ping\"}\n");
+
+    QCOMPARE(readResponse()["id"].toInt(), 1);
+}
+
+void TestIpcServer::secondServerDoesNotListen()
+{
+    IpcServer server;
+
+    QVERIFY(!server.listen());
+}
+
+// Rows are read by the keys of a patient data file, numbers like in a patient data file.
+void TestIpcServer::bloodSampleRowsFromJson()
+{
+    auto rowsArray = QJsonDocument::fromJson("[{\"date\": \"01.01.2024\", \"leukocytes\": 2.5, \"crp\": \"\"}]").array();
+    auto rows = PatientDataFile::bloodSampleRowsFromJson(rowsArray);
+
+    QCOMPARE(rows.size(), 1);
+    QCOMPARE(rows[0].size(), PatientDataFile::bloodSamplesColumns.size());
+    QCOMPARE(rows[0][PatientDataSchema::bloodSamplesDateColumn], QString("01.01.2024"));
+    QCOMPARE(rows[0][PatientDataSchema::labParameterColumns[0]], QString("2.5"));
+}
+
+QTEST_MAIN(TestIpcServer)
+
+#include "tst_ipcserver.moc"
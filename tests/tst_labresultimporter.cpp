@@ -0,0 +1,208 @@
+#include "labresultimporter.h"
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+// Bulk import of lab exports into the patient data files of a directory, see
+// LabResultImporter: rows grouped by patient, malformed rows, the dry run and the split of
+// large exports into chunks.
+class TestLabResultImporter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void rowsAreMergedIntoPatientFiles();
+    void malformedRowsAreCounted();
+    void dryRunWritesNothing();
+    void chunksEndAtLineEnds();
+
+private:
+    QTemporaryDir *m_directory;
+    QString m_patientDataDirectory;
+    QString m_exportFileName;
+    QString m_patientDataFileName;
+
+    void writeExport(const QByteArray& data);
+};
+
+const static int dateColumn = PatientDataSchema::bloodSamplesDateColumn;
+const static int leukocytesColumn = PatientDataSchema::leukocytesColumn;
+
+// Larger than a chunk of LabResultImporter.
+const static int largeExportRowCount = 250000;
+
+static QByteArray exportHeader()
+{
+    return "patientId;date;" + PatientDataFile::bloodSamplesJsonKeys[leukocytesColumn].toUtf8() + "\n";
+}
+
+// Patient 123 with a blood sample on 01.01.2024.
+static PatientDataFile::patient_data_t existingPatientData()
+{
+    PatientDataFile::patient_data_t patientData;
+
+    patientData.patientId = "123";
+    patientData.bloodSamples.resize(PatientDataFile::bloodSamplesColumns.size());
+    patientData.chemoAndMeds.resize(PatientDataFile::chemoAndMedsColumns.size());
+
+    for(auto& column : patientData.bloodSamples)
+    {
+        column.append(QString());
+    }
+
+    patientData.bloodSamples[dateColumn][0] = "01.01.2024";
+    patientData.bloodSamples[leukocytesColumn][0] = "2.5";
+
+    return patientData;
+}
+
+void TestLabResultImporter::init()
+{
+    m_directory = new QTemporaryDir();
+
+    QVERIFY(m_directory->isValid());
+    QVERIFY(QDir(m_directory->path()).mkdir("patients"));
+
+    m_patientDataDirectory = m_directory->filePath("patients");
+    m_exportFileName = m_directory->filePath("export.csv");
+    m_patientDataFileName = m_patientDataDirectory + "/existing.json";
+
+    QVERIFY(PatientDataFile::save(m_patientDataFileName, existingPatientData()));
+}
+
+void TestLabResultImporter::cleanup()
+{
+    delete m_directory;
+}
+
+void TestLabResultImporter::writeExport(const QByteArray& data)
+{
+    QFile exportFile(m_exportFileName);
+
+    QVERIFY(exportFile.open(QIODevice::WriteOnly));
+    QCOMPARE(exportFile.write(data), qint64(data.size()));
+}
+
+// Rows of a known patient are merged into the sorted samples of the patient's file, rows
+// already contained are skipped, unknown patients get a new file.
+void TestLabResultImporter::rowsAreMergedIntoPatientFiles()
+{
+    writeExport(exportHeader() +
+                "123;2024-01-01;2,5\n"
+                "123;2024-01-03;3,5\n"
+                "456;2024-01-02;1\n"
+                "123;2024-01-02;3\n");
+
+    auto report = LabResultImporter::import(m_exportFileName, m_patientDataDirectory, false);
+
+    QVERIFY2(report.successful, qPrintable(report.error));
+    QCOMPARE(report.rowCount, qint64(4));
+    QCOMPARE(report.patientCount, 2);
+    QCOMPARE(report.duplicateRowCount, qint64(1));
+    QCOMPARE(report.newPatientDataFileCount, 1);
+    QCOMPARE(report.updatedPatientDataFileCount, 1);
+    QCOMPARE(report.failedPatientDataFileCount, 0);
+
+    PatientDataFile::patient_data_t patientData;
+
+    QVERIFY(PatientDataFile::load(m_patientDataFileName, patientData));
+    QCOMPARE(patientData.bloodSamples[dateColumn], QVector<QString>({"01.01.2024", "02.01.2024", "03.01.2024"}));
+    QCOMPARE(patientData.bloodSamples[leukocytesColumn], QVector<QString>({"2.5", "3", "3.5"}));
+
+    QVERIFY(PatientDataFile::load(m_patientDataDirectory + "/456.json", patientData));
+    QCOMPARE(patientData.patientId, QString("456"));
+    QCOMPARE(patientData.bloodSamples[dateColumn], QVector<QString>({"02.01.2024"}));
+}
+
+// Malformed rows are skipped, rows with invalid dates or values are imported as written. The
+// messages give the line numbers of the export.
+void TestLabResultImporter::malformedRowsAreCounted()
+{
+    writeExport("\n" + exportHeader() +
+                "123;2024-01-02;3\n"
+                "123;2024-01-03\n"
+                "\n"
+                ";2024-01-04;4\n"
+                "123;2024-13-05;5\n"
+                "123;2024-01-06;n.a.\n");
+
+    auto report = LabResultImporter::import(m_exportFileName, m_patientDataDirectory, true);
+
+    QVERIFY2(report.successful, qPrintable(report.error));
+    QCOMPARE(report.rowCount, qint64(3));
+    QCOMPARE(report.malformedRowCount, qint64(2));
+    QCOMPARE(report.invalidDateCount, qint64(1));
+    QCOMPARE(report.invalidValueCount, qint64(1));
+    QCOMPARE(report.messages.size(), 4);
+    QVERIFY(report.messages[0].startsWith("Line 4: "));
+    QVERIFY(report.messages[1].startsWith("Line 6: "));
+    QVERIFY(report.messages[2].startsWith("Line 7: "));
+    QVERIFY(report.messages[3].startsWith("Line 8: "));
+}
+
+// The dry run reports the same as the import without writing any file.
+void TestLabResultImporter::dryRunWritesNothing()
+{
+    writeExport(exportHeader() +
+                "123;2024-01-02;3\n"
+                "456;2024-01-02;1\n");
+
+    QFile patientDataFile(m_patientDataFileName);
+
+    QVERIFY(patientDataFile.open(QIODevice::ReadOnly));
+
+    auto patientDataFileContent = patientDataFile.readAll();
+    auto patientDataFileNames = QDir(m_patientDataDirectory).entryList(QDir::Files);
+
+    patientDataFile.close();
+
+    auto report = LabResultImporter::import(m_exportFileName, m_patientDataDirectory, true);
+
+    QVERIFY2(report.successful, qPrintable(report.error));
+    QCOMPARE(report.newPatientDataFileCount, 1);
+    QCOMPARE(report.updatedPatientDataFileCount, 1);
+    QCOMPARE(QDir(m_patientDataDirectory).entryList(QDir::Files), patientDataFileNames);
+
+    QVERIFY(patientDataFile.open(QIODevice::ReadOnly));
+    QCOMPARE(patientDataFile.readAll(), patientDataFileContent);
+}
+
+// An export larger than a chunk is split at line ends only: no row is broken up and the line
+// numbers continue over the chunks.
+void TestLabResultImporter::chunksEndAtLineEnds()
+{
+    QByteArray data = exportHeader();
+    const QDate firstDay(2024, 1, 1);
+
+    for(auto i = 0; i < largeExportRowCount; i++)
+    {
+        data += "P" + QByteArray::number(i % 100) + ";" + firstDay.addDays(i % 1000).toString("yyyy-MM-dd").toUtf8() + ";" +
+                QByteArray::number(i % 50) + ",5\n";
+    }
+
+    data += "P1;2024-01-01\n";
+
+    QVERIFY(data.size() > 4 * 1024 * 1024);
+
+    writeExport(data);
+
+    auto report = LabResultImporter::import(m_exportFileName, m_patientDataDirectory, true);
+
+    QVERIFY2(report.successful, qPrintable(report.error));
+    QCOMPARE(report.rowCount, qint64(largeExportRowCount));
+    QCOMPARE(report.patientCount, 100);
+    QCOMPARE(report.malformedRowCount, qint64(1));
+    QCOMPARE(report.invalidDateCount, qint64(0));
+    QCOMPARE(report.invalidValueCount, qint64(0));
+    QCOMPARE(report.messages, QStringList("Line " + QString::number(largeExportRowCount + 2) + ": Too few fields."));
+}
+
+QTEST_MAIN(TestLabResultImporter)
+
+#include "tst_labresultimporter.moc"
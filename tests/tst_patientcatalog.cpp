@@ -0,0 +1,202 @@
+#include "patientcatalog.h"
+#include "patientdatafile.h"
+#include <QtTest>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+// Catalog of the patient data files of a directory, see PatientCatalog: the prefix search over
+// the sorted search keys and the refresh reading only files whose size or modification time
+// have changed.
+class TestPatientCatalog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void searchByPrefix_data();
+    void searchByPrefix();
+    void searchIsLimited();
+    void catalogFileIsLoadedAtOnce();
+    void changedSizeIsRead();
+    void changedModificationTimeIsRead();
+    void unchangedFileIsNotRead();
+
+private:
+    QTemporaryDir *m_directory;
+    PatientCatalog *m_catalog;
+
+    void writePatient(const QString& baseName, const QString& patientId, const QString& name);
+};
+
+// Sets the modification time of the passed file.
+static bool setLastModified(const QString& fileName, const QDateTime& lastModified)
+{
+    QFile file(fileName);
+
+    return file.open(QIODevice::ReadWrite) && file.setFileTime(lastModified, QFileDevice::FileModificationTime);
+}
+
+// Waits until the running refresh of the passed catalog has been taken over.
+static void waitForRefresh(PatientCatalog& catalog)
+{
+    QTRY_VERIFY(!catalog.isRefreshing());
+
+    QCoreApplication::processEvents();
+}
+
+static QStringList patientIds(const QVector<PatientCatalog::catalog_entry_t>& entries)
+{
+    QStringList patientIds;
+
+    for(const auto& entry : entries)
+    {
+        patientIds.append(entry.patientId);
+    }
+
+    patientIds.sort();
+
+    return patientIds;
+}
+
+void TestPatientCatalog::init()
+{
+    m_directory = new QTemporaryDir();
+
+    QVERIFY(m_directory->isValid());
+
+    writePatient("doe", "123", "Doe, Jane");
+    writePatient("gray", "456", "Dorian Gray");
+    writePatient("smith", "1234", "Smith, John");
+    writePatient("unnamed", "", "");
+
+    m_catalog = new PatientCatalog();
+    m_catalog->setDirectory(m_directory->path());
+
+    waitForRefresh(*m_catalog);
+
+    QCOMPARE(m_catalog->count(), 4);
+}
+
+void TestPatientCatalog::cleanup()
+{
+    delete m_catalog;
+    delete m_directory;
+}
+
+void TestPatientCatalog::writePatient(const QString& baseName, const QString& patientId, const QString& name)
+{
+    PatientDataFile::patient_data_t patientData;
+
+    patientData.patientId = patientId;
+    patientData.name = name;
+    patientData.bloodSamples.resize(PatientDataFile::bloodSamplesColumns.size());
+    patientData.chemoAndMeds.resize(PatientDataFile::chemoAndMedsColumns.size());
+
+    QVERIFY(PatientDataFile::save(m_directory->filePath(baseName + ".json"), patientData));
+}
+
+void TestPatientCatalog::searchByPrefix_data()
+{
+    QTest::addColumn<QString>("prefix");
+    QTest::addColumn<QStringList>("expectedPatientIds");
+
+    QTest::newRow("word of two names") << "do" << QStringList({"123", "456"});
+    QTest::newRow("second word") << "jane" << QStringList({"123"});
+    QTest::newRow("case insensitive") << "SMI" << QStringList({"1234"});
+    QTest::newRow("whole name") << " dorian g" << QStringList({"456"});
+    QTest::newRow("patient ID prefix") << "123" << QStringList({"123", "1234"});
+    QTest::newRow("whole patient ID") << "1234" << QStringList({"1234"});
+    QTest::newRow("file name without name") << "unnam" << QStringList({""});
+    QTest::newRow("behind all keys") << "zz" << QStringList();
+    QTest::newRow("no match") << "dx" << QStringList();
+}
+
+void TestPatientCatalog::searchByPrefix()
+{
+    QFETCH(QString, prefix);
+    QFETCH(QStringList, expectedPatientIds);
+
+    QCOMPARE(patientIds(m_catalog->search(prefix, 10)), expectedPatientIds);
+}
+
+void TestPatientCatalog::searchIsLimited()
+{
+    QCOMPARE(m_catalog->search("", 10).size(), 4);
+    QCOMPARE(m_catalog->search("", 2).size(), 2);
+    QCOMPARE(m_catalog->search("do", 1).size(), 1);
+}
+
+// The catalog file written after the refresh is loaded without reading the patient data files.
+void TestPatientCatalog::catalogFileIsLoadedAtOnce()
+{
+    delete m_catalog;
+
+    m_catalog = new PatientCatalog();
+    m_catalog->setDirectory(m_directory->path());
+
+    QCOMPARE(m_catalog->count(), 4);
+    QCOMPARE(patientIds(m_catalog->search("jane", 10)), QStringList({"123"}));
+
+    waitForRefresh(*m_catalog);
+}
+
+void TestPatientCatalog::changedSizeIsRead()
+{
+    QSignalSpy updatedSpy(m_catalog, &PatientCatalog::updated);
+
+    writePatient("smith", "1234", "Smith, Johanna");
+    QFile::remove(m_directory->filePath("unnamed.json"));
+
+    m_catalog->refresh();
+    waitForRefresh(*m_catalog);
+
+    QCOMPARE(updatedSpy.count(), 1);
+    QCOMPARE(m_catalog->count(), 3);
+    QCOMPARE(patientIds(m_catalog->search("johanna", 10)), QStringList({"1234"}));
+    QVERIFY(m_catalog->search("unnam", 10).isEmpty());
+}
+
+// A file changed without changing its size is found by its modification time.
+void TestPatientCatalog::changedModificationTimeIsRead()
+{
+    auto fileName = m_directory->filePath("doe.json");
+    auto fileInfo = QFileInfo(fileName);
+    auto size = fileInfo.size();
+    auto lastModified = fileInfo.lastModified();
+
+    writePatient("doe", "123", "Doe, Joan");
+
+    QCOMPARE(QFileInfo(fileName).size(), size);
+    QVERIFY(setLastModified(fileName, lastModified.addSecs(3600)));
+
+    m_catalog->refresh();
+    waitForRefresh(*m_catalog);
+
+    QCOMPARE(patientIds(m_catalog->search("joan", 10)), QStringList({"123"}));
+    QVERIFY(m_catalog->search("jane", 10).isEmpty());
+}
+
+// Files with the size and the modification time of the catalog entry are taken as unchanged.
+void TestPatientCatalog::unchangedFileIsNotRead()
+{
+    QSignalSpy updatedSpy(m_catalog, &PatientCatalog::updated);
+    auto fileName = m_directory->filePath("doe.json");
+    auto lastModified = QFileInfo(fileName).lastModified();
+
+    writePatient("doe", "123", "Doe, Joan");
+
+    QVERIFY(setLastModified(fileName, lastModified));
+
+    m_catalog->refresh();
+    waitForRefresh(*m_catalog);
+
+    QCOMPARE(updatedSpy.count(), 0);
+    QCOMPARE(patientIds(m_catalog->search("jane", 10)), QStringList({"123"}));
+}
+
+QTEST_MAIN(TestPatientCatalog)
+
+#include "tst_patientcatalog.moc"
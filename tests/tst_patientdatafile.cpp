@@ -0,0 +1,234 @@
+#include "patientdatafile.h"
+#include "patientdataschema.h"
+#include "patienttablemodel.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QUndoStack>
+
+// Complete and incremental saving of patient data files, see PatientDataFile::save(),
+// saveChanges() and the change tracking of PatientTableModel.
+class TestPatientDataFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void saveAndLoad();
+    void applyChanges();
+    void tableChangesReproduceTable();
+    void saveChangesAppendsJournal();
+    void saveCompactsJournal();
+    void interruptedJournalEntryIsSkipped();
+
+private:
+    QTemporaryDir m_directory;
+    QString m_fileName;
+};
+
+const static int dateColumn = PatientDataSchema::bloodSamplesDateColumn;
+const static int leukocytesColumn = PatientDataSchema::labParameterColumns[0];
+const static int rowCount = 50;
+
+// Patient with a blood sample per day, the leukocytes are counted up from 0.5. Values are
+// numbers as written by QString::number(), so that they are read back unchanged.
+static PatientDataFile::patient_data_t patientData()
+{
+    PatientDataFile::patient_data_t patientData;
+    const QDate firstDay(2024, 1, 1);
+
+    patientData.patientId = "123";
+    patientData.name = "Doe, Jane";
+    patientData.bloodSamples.resize(PatientDataFile::bloodSamplesColumns.size());
+    patientData.chemoAndMeds.resize(PatientDataFile::chemoAndMedsColumns.size());
+
+    for(auto row = 0; row < rowCount; row++)
+    {
+        for(auto& column : patientData.bloodSamples)
+        {
+            column.append(QString());
+        }
+
+        patientData.bloodSamples[dateColumn][row] = firstDay.addDays(row).toString("dd.MM.yyyy");
+        patientData.bloodSamples[leukocytesColumn][row] = QString::number(row + 0.5);
+    }
+
+    return patientData;
+}
+
+static QVector<QString> row(const QString& date, const QString& leukocytes)
+{
+    QVector<QString> texts(PatientDataFile::bloodSamplesColumns.size());
+
+    texts[dateColumn] = date;
+    texts[leukocytesColumn] = leukocytes;
+
+    return texts;
+}
+
+// Edits a cell, moves the first row by editing its date, deletes a row (saved row 11, the
+// rows before have moved up) and merges a new one.
+static void editTable(PatientTableModel& model)
+{
+    model.setData(model.index(3, leukocytesColumn), "7");
+    model.setData(model.index(0, dateColumn), "15.01.2024");
+    model.removeRows(10, 1);
+    model.insertRowsSorted({row("05.01.2024", "9")});
+}
+
+void TestPatientDataFile::init()
+{
+    QVERIFY(m_directory.isValid());
+
+    m_fileName = m_directory.path() + "/" + QTest::currentTestFunction() + ".json";
+}
+
+void TestPatientDataFile::saveAndLoad()
+{
+    QString journalId;
+
+    QVERIFY(PatientDataFile::save(m_fileName, patientData(), &journalId));
+    QVERIFY(!journalId.isEmpty());
+
+    PatientDataFile::patient_data_t loadedPatientData;
+
+    QVERIFY(PatientDataFile::load(m_fileName, loadedPatientData));
+    QCOMPARE(loadedPatientData.patientId, QString("123"));
+    QCOMPARE(loadedPatientData.name, QString("Doe, Jane"));
+    QCOMPARE(loadedPatientData.journalId, journalId);
+    QCOMPARE(loadedPatientData.bloodSamples, patientData().bloodSamples);
+}
+
+// Edited cells address the saved rows, deleted rows are removed before the rows are inserted.
+void TestPatientDataFile::applyChanges()
+{
+    QVector<QVector<QString>> table {{"a", "b", "c", "d"}, {"1", "2", "3", "4"}};
+    PatientDataFile::table_changes_t changes;
+
+    changes.changedCells.append({2, 1, "30"});
+    changes.deletedRows = {1, 3};
+    changes.insertedRows.append(qMakePair(1, QVector<QString>({"x", "9"})));
+
+    PatientDataFile::applyChanges(table, changes);
+
+    QCOMPARE(table, QVector<QVector<QString>>({{"a", "x", "c"}, {"1", "9", "30"}}));
+}
+
+void TestPatientDataFile::tableChangesReproduceTable()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+    auto savedTable = patientData().bloodSamples;
+
+    model.setColumns(savedTable);
+    editTable(model);
+
+    auto changes = model.tableChanges();
+
+    QCOMPARE(changes.changedCells.size(), 1);
+    QCOMPARE(changes.deletedRows, QVector<int>({0, 11}));
+    QCOMPARE(changes.insertedRows.size(), 2);
+
+    PatientDataFile::applyChanges(savedTable, changes);
+
+    QCOMPARE(savedTable, model.columns());
+}
+
+void TestPatientDataFile::saveChangesAppendsJournal()
+{
+    QString journalId;
+
+    QVERIFY(PatientDataFile::save(m_fileName, patientData(), &journalId));
+
+    auto fileSize = QFileInfo(m_fileName).size();
+
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+
+    model.setColumns(patientData().bloodSamples);
+    editTable(model);
+
+    auto editedPatientData = patientData();
+    editedPatientData.bloodSamples = model.columns();
+    editedPatientData.journalId = journalId;
+
+    PatientDataFile::patient_data_changes_t changes;
+    changes.generalInformation = editedPatientData;
+    changes.generalInformation.bloodSamples.clear();
+    changes.generalInformation.chemoAndMeds.clear();
+    changes.bloodSamples = model.tableChanges();
+
+    QString savedJournalId;
+
+    QVERIFY(PatientDataFile::saveChanges(m_fileName, editedPatientData, changes, &savedJournalId));
+    QCOMPARE(savedJournalId, journalId);
+    QCOMPARE(QFileInfo(m_fileName).size(), fileSize);
+    QVERIFY(QFile::exists(PatientDataFile::journalFileName(m_fileName)));
+
+    PatientDataFile::patient_data_t loadedPatientData;
+
+    QVERIFY(PatientDataFile::load(m_fileName, loadedPatientData));
+    QCOMPARE(loadedPatientData.name, QString("Doe, Jane"));
+    QCOMPARE(loadedPatientData.bloodSamples, model.columns());
+}
+
+// A complete save gets a new journal id, so that the entries of the old journal are not
+// applied again even if the journal is left over.
+void TestPatientDataFile::saveCompactsJournal()
+{
+    QString journalId;
+
+    QVERIFY(PatientDataFile::save(m_fileName, patientData(), &journalId));
+
+    auto editedPatientData = patientData();
+    editedPatientData.journalId = journalId;
+    editedPatientData.bloodSamples[leukocytesColumn][0] = "7";
+
+    PatientDataFile::patient_data_changes_t changes;
+    changes.generalInformation = editedPatientData;
+    changes.generalInformation.bloodSamples.clear();
+    changes.generalInformation.chemoAndMeds.clear();
+    changes.bloodSamples.changedCells.append({0, leukocytesColumn, "7"});
+
+    QVERIFY(PatientDataFile::saveChanges(m_fileName, editedPatientData, changes));
+
+    QFile journalFile(PatientDataFile::journalFileName(m_fileName));
+    QVERIFY(journalFile.open(QIODevice::ReadOnly));
+    auto journal = journalFile.readAll();
+    journalFile.close();
+
+    QString compactedJournalId;
+
+    QVERIFY(PatientDataFile::save(m_fileName, patientData(), &compactedJournalId));
+    QVERIFY(compactedJournalId != journalId);
+    QVERIFY(!QFile::exists(PatientDataFile::journalFileName(m_fileName)));
+
+    QVERIFY(journalFile.open(QIODevice::WriteOnly));
+    journalFile.write(journal);
+    journalFile.close();
+
+    PatientDataFile::patient_data_t loadedPatientData;
+
+    QVERIFY(PatientDataFile::load(m_fileName, loadedPatientData));
+    QCOMPARE(loadedPatientData.bloodSamples, patientData().bloodSamples);
+}
+
+void TestPatientDataFile::interruptedJournalEntryIsSkipped()
+{
+    QString journalId;
+
+    QVERIFY(PatientDataFile::save(m_fileName, patientData(), &journalId));
+
+    QFile journalFile(PatientDataFile::journalFileName(m_fileName));
+    QVERIFY(journalFile.open(QIODevice::WriteOnly));
+    journalFile.write("{\"journalId\": \"" + journalId.toUtf8() + "\", \"bloodSamples\": {\"deleted");
+    journalFile.close();
+
+    PatientDataFile::patient_data_t loadedPatientData;
+
+    QVERIFY(PatientDataFile::load(m_fileName, loadedPatientData));
+    QCOMPARE(loadedPatientData.bloodSamples, patientData().bloodSamples);
+}
+
+QTEST_MAIN(TestPatientDataFile)
+
+#include "tst_patientdatafile.moc"
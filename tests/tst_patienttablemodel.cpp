@@ -0,0 +1,147 @@
+#include "patienttablemodel.h"
+#include "patientdataschema.h"
+#include <QtTest>
+#include <QUndoStack>
+
+// Row by row merge of the changes of a patient data file made by someone else, see
+// PatientTableModel::mergeSavedColumns().
+class TestPatientTableModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rowAddedInFileIsInserted();
+    void rowDeletedInFileIsRemoved();
+    void localChangesAreKept();
+    void rowEditedOnBothSidesIsConflict();
+    void rowAddedOnBothSidesIsSaved();
+};
+
+const static int dateColumn = PatientDataSchema::bloodSamplesDateColumn;
+const static int leukocytesColumn = PatientDataSchema::labParameterColumns[0];
+
+// Blood samples of the passed (date, leukocytes) rows.
+static QVector<QVector<QString>> bloodSamples(const QVector<QPair<QString, QString>>& rows)
+{
+    QVector<QVector<QString>> columns(PatientDataFile::bloodSamplesColumns.size(), QVector<QString>(rows.size()));
+
+    for(auto row = 0; row < rows.size(); row++)
+    {
+        columns[dateColumn][row] = rows[row].first;
+        columns[leukocytesColumn][row] = rows[row].second;
+    }
+
+    return columns;
+}
+
+static QVector<QString> row(const QString& date, const QString& leukocytes)
+{
+    QVector<QString> texts(PatientDataFile::bloodSamplesColumns.size());
+
+    texts[dateColumn] = date;
+    texts[leukocytesColumn] = leukocytes;
+
+    return texts;
+}
+
+static bool hasChanges(const PatientTableModel& model)
+{
+    auto changes = model.tableChanges();
+
+    return !changes.deletedRows.isEmpty() || !changes.changedCells.isEmpty() || !changes.insertedRows.isEmpty();
+}
+
+void TestPatientTableModel::rowAddedInFileIsInserted()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+    QSignalSpy resetSpy(&model, SIGNAL(modelReset()));
+
+    model.setColumns(bloodSamples({{"01.01.2024", "1"}, {"03.01.2024", "3"}}));
+    resetSpy.clear();
+
+    auto fileColumns = bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "2"}, {"03.01.2024", "3"}});
+    int conflictCount = -1;
+
+    QCOMPARE(model.mergeSavedColumns(fileColumns, &conflictCount), 1);
+    QCOMPARE(conflictCount, 0);
+    QCOMPARE(model.columns(), fileColumns);
+    QVERIFY(!hasChanges(model));
+    QCOMPARE(resetSpy.count(), 0);
+}
+
+void TestPatientTableModel::rowDeletedInFileIsRemoved()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+
+    model.setColumns(bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "2"}, {"03.01.2024", "3"}}));
+
+    auto fileColumns = bloodSamples({{"01.01.2024", "1"}, {"03.01.2024", "3"}});
+
+    QCOMPARE(model.mergeSavedColumns(fileColumns), 1);
+    QCOMPARE(model.columns(), fileColumns);
+    QVERIFY(!hasChanges(model));
+}
+
+// Rows edited or added here stay unsaved changes around the merged rows.
+void TestPatientTableModel::localChangesAreKept()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+
+    model.setColumns(bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "2"}}));
+    model.setData(model.index(0, leukocytesColumn), "7");
+    model.insertRowsSorted({row("04.01.2024", "4")});
+
+    int conflictCount = -1;
+
+    QCOMPARE(model.mergeSavedColumns(bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "2"}, {"03.01.2024", "3"}}), &conflictCount), 1);
+    QCOMPARE(conflictCount, 0);
+    QCOMPARE(model.columns(), bloodSamples({{"01.01.2024", "7"}, {"02.01.2024", "2"}, {"03.01.2024", "3"}, {"04.01.2024", "4"}}));
+
+    auto changes = model.tableChanges();
+
+    QVERIFY(changes.deletedRows.isEmpty());
+    QCOMPARE(changes.changedCells.size(), 1);
+    QCOMPARE(changes.changedCells[0].row, 0);
+    QCOMPARE(changes.insertedRows.size(), 1);
+    QCOMPARE(changes.insertedRows[0].first, 3);
+}
+
+// A row edited here and in the file is kept as added row next to the row of the file.
+void TestPatientTableModel::rowEditedOnBothSidesIsConflict()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+
+    model.setColumns(bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "2"}}));
+    model.setData(model.index(1, leukocytesColumn), "7");
+
+    int conflictCount = -1;
+
+    QCOMPARE(model.mergeSavedColumns(bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "8"}}), &conflictCount), 1);
+    QCOMPARE(conflictCount, 1);
+    QCOMPARE(model.columns(), bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "7"}, {"02.01.2024", "8"}}));
+    QCOMPARE(model.rowState(1).savedRow, -1);
+    QCOMPARE(model.rowState(2).savedRow, 1);
+}
+
+void TestPatientTableModel::rowAddedOnBothSidesIsSaved()
+{
+    QUndoStack undoStack;
+    PatientTableModel model(PatientDataFile::bloodSamplesColumns, dateColumn, &undoStack);
+
+    model.setColumns(bloodSamples({{"01.01.2024", "1"}}));
+    model.insertRowsSorted({row("02.01.2024", "5")});
+
+    auto fileColumns = bloodSamples({{"01.01.2024", "1"}, {"02.01.2024", "5"}});
+
+    QCOMPARE(model.mergeSavedColumns(fileColumns), 0);
+    QCOMPARE(model.columns(), fileColumns);
+    QVERIFY(!hasChanges(model));
+}
+
+QTEST_MAIN(TestPatientTableModel)
+
+#include "tst_patienttablemodel.moc"
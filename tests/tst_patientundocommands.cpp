@@ -0,0 +1,212 @@
+#include "patientsession.h"
+#include "patientdataschema.h"
+#include "patientundocommands.h"
+#include <QtTest>
+
+// Undo commands of the table edits and the memory budget of the undo history, see
+// patientundocommands.h and PatientSession::setUndoMemoryBudget().
+class TestPatientUndoCommands : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void setCellUndoRedo();
+    void setCellMergesConsecutiveEdits();
+    void editedDateMovesRow();
+    void removeRowsUndoRestoresRows();
+    void insertRowsSortedUndo();
+    void memoryBudgetReleasesOldestCommands();
+    void memoryBudgetKeepsCommandsToRedo();
+};
+
+const static int dateColumn = PatientDataSchema::bloodSamplesDateColumn;
+const static int leukocytesColumn = PatientDataSchema::labParameterColumns[0];
+
+// Blood samples with the passed dates, the leukocytes are counted up from 1.0.
+static QVector<QVector<QString>> bloodSamples(const QVector<QString>& dates)
+{
+    QVector<QVector<QString>> columns(PatientDataFile::bloodSamplesColumns.size(), QVector<QString>(dates.size()));
+
+    for(auto row = 0; row < dates.size(); row++)
+    {
+        columns[dateColumn][row] = dates[row];
+        columns[leukocytesColumn][row] = QString::number(row + 1.0, 'f', 1);
+    }
+
+    return columns;
+}
+
+static QVector<QString> leukocytes(const PatientTableModel *model)
+{
+    return model->columnTexts(leukocytesColumn);
+}
+
+static int undoableCommandCount(PatientSession& patientSession)
+{
+    auto count = 0;
+
+    while(patientSession.canUndo())
+    {
+        patientSession.undo();
+        count++;
+    }
+
+    return count;
+}
+
+void TestPatientUndoCommands::setCellUndoRedo()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+
+    model->setColumns(bloodSamples({"01.01.2024", "02.01.2024"}));
+    model->setData(model->index(1, leukocytesColumn), "5.0");
+
+    QCOMPARE(model->text(1, leukocytesColumn), QString("5.0"));
+    QVERIFY(patientSession.changedSinceLastSave());
+
+    patientSession.undo();
+
+    QCOMPARE(model->text(1, leukocytesColumn), QString("2.0"));
+    QVERIFY(!patientSession.changedSinceLastSave());
+
+    patientSession.redo();
+
+    QCOMPARE(model->text(1, leukocytesColumn), QString("5.0"));
+    QVERIFY(patientSession.changedSinceLastSave());
+}
+
+void TestPatientUndoCommands::setCellMergesConsecutiveEdits()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+
+    model->setColumns(bloodSamples({"01.01.2024"}));
+    model->setData(model->index(0, leukocytesColumn), "5");
+    model->setData(model->index(0, leukocytesColumn), "5.5");
+
+    QCOMPARE(patientSession.undoStack()->count(), 1);
+
+    patientSession.undo();
+
+    QCOMPARE(model->text(0, leukocytesColumn), QString("1.0"));
+}
+
+void TestPatientUndoCommands::editedDateMovesRow()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+
+    model->setColumns(bloodSamples({"01.01.2024", "02.01.2024", "03.01.2024"}));
+    model->setData(model->index(0, dateColumn), "04.01.2024");
+
+    QCOMPARE(model->columnTexts(dateColumn), QVector<QString>({"02.01.2024", "03.01.2024", "04.01.2024"}));
+    QCOMPARE(leukocytes(model), QVector<QString>({"2.0", "3.0", "1.0"}));
+
+    patientSession.undo();
+
+    QCOMPARE(model->columnTexts(dateColumn), QVector<QString>({"01.01.2024", "02.01.2024", "03.01.2024"}));
+    QCOMPARE(leukocytes(model), QVector<QString>({"1.0", "2.0", "3.0"}));
+}
+
+void TestPatientUndoCommands::removeRowsUndoRestoresRows()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+
+    model->setColumns(bloodSamples({"01.01.2024", "02.01.2024", "03.01.2024"}));
+    model->removeRows(0, 2);
+
+    QCOMPARE(leukocytes(model), QVector<QString>({"3.0"}));
+
+    patientSession.undo();
+
+    QCOMPARE(leukocytes(model), QVector<QString>({"1.0", "2.0", "3.0"}));
+    QVERIFY(!patientSession.changedSinceLastSave());
+    QCOMPARE(model->rowState(0).savedRow, 0);
+    QCOMPARE(model->rowState(1).savedRow, 1);
+}
+
+void TestPatientUndoCommands::insertRowsSortedUndo()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+
+    model->setColumns(bloodSamples({"01.01.2024", "03.01.2024"}));
+
+    QVector<QString> row(PatientDataFile::bloodSamplesColumns.size());
+    row[dateColumn] = "02.01.2024";
+    row[leukocytesColumn] = "9.0";
+
+    QCOMPARE(model->insertRowsSorted({row}), 1);
+    QCOMPARE(leukocytes(model), QVector<QString>({"1.0", "9.0", "2.0"}));
+
+    patientSession.undo();
+
+    QCOMPARE(leukocytes(model), QVector<QString>({"1.0", "2.0"}));
+
+    patientSession.redo();
+
+    QCOMPARE(leukocytes(model), QVector<QString>({"1.0", "9.0", "2.0"}));
+}
+
+// Edits of different cells are not merged, each takes the same memory.
+void TestPatientUndoCommands::memoryBudgetReleasesOldestCommands()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+    const auto rowCount = 10;
+
+    model->setColumns(bloodSamples(QVector<QString>(rowCount, "01.01.2024")));
+    model->setData(model->index(0, leukocytesColumn), "5.0");
+
+    auto commandByteSize = PatientUndoCommand::commandByteSize(patientSession.undoStack()->command(0));
+
+    patientSession.setUndoMemoryBudget(commandByteSize * 7 / 2);
+
+    for(auto row = 1; row < rowCount; row++)
+    {
+        model->setData(model->index(row, leukocytesColumn), "5.0");
+    }
+
+    auto oldestCommand = dynamic_cast<const PatientUndoCommand*>(patientSession.undoStack()->command(0));
+    auto newestCommand = dynamic_cast<const PatientUndoCommand*>(patientSession.undoStack()->command(rowCount - 1));
+
+    QVERIFY(oldestCommand->isReleased());
+    QVERIFY(!newestCommand->isReleased());
+    QCOMPARE(undoableCommandCount(patientSession), 3);
+    QCOMPARE(model->text(rowCount - 1, leukocytesColumn), QString("10.0"));
+    QCOMPARE(model->text(rowCount - 4, leukocytesColumn), QString("5.0"));
+}
+
+void TestPatientUndoCommands::memoryBudgetKeepsCommandsToRedo()
+{
+    PatientSession patientSession;
+    auto model = patientSession.bloodSamplesModel();
+    const auto rowCount = 4;
+
+    model->setColumns(bloodSamples(QVector<QString>(rowCount, "01.01.2024")));
+
+    for(auto row = 0; row < rowCount; row++)
+    {
+        model->setData(model->index(row, leukocytesColumn), "5.0");
+    }
+
+    patientSession.undo();
+    patientSession.undo();
+
+    auto commandByteSize = PatientUndoCommand::commandByteSize(patientSession.undoStack()->command(0));
+
+    patientSession.setUndoMemoryBudget(commandByteSize * 5 / 2);
+
+    QVERIFY(!patientSession.canUndo());
+
+    patientSession.redo();
+    patientSession.redo();
+
+    QCOMPARE(leukocytes(model), QVector<QString>({"5.0", "5.0", "5.0", "5.0"}));
+}
+
+QTEST_MAIN(TestPatientUndoCommands)
+
+#include "tst_patientundocommands.moc"
@@ -0,0 +1,161 @@
+#include "quantilesketch.h"
+#include <QtTest>
+#include <QByteArray>
+#include <cmath>
+#include <limits>
+
+// Accuracy of the quantiles of the merging t-digest, merging sketches and writing them to a
+// data stream, see QuantileSketch.
+class TestQuantileSketch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyAndSingleValue();
+    void accuracy_data();
+    void accuracy();
+    void mergeEqualsAdding();
+    void dataStreamRoundTrip();
+};
+
+const static int valueCount = 10000;
+
+// Returns the values 0..valueCount - 1 in a scrambled order (7919 is prime to valueCount).
+static double value(int i)
+{
+    return (i * 7919) % valueCount;
+}
+
+void TestQuantileSketch::emptyAndSingleValue()
+{
+    QuantileSketch sketch;
+
+    QVERIFY(sketch.isEmpty());
+    QVERIFY(std::isnan(sketch.quantile(0.5)));
+
+    sketch.add(std::numeric_limits<double>::quiet_NaN());
+    sketch.add(1.0, 0.0);
+    sketch.merge(QuantileSketch());
+
+    QVERIFY(sketch.isEmpty());
+
+    sketch.add(42.0, 2.0);
+
+    QCOMPARE(sketch.count(), 2.0);
+    QCOMPARE(sketch.quantile(0.0), 42.0);
+    QCOMPARE(sketch.quantile(0.5), 42.0);
+    QCOMPARE(sketch.quantile(1.0), 42.0);
+}
+
+void TestQuantileSketch::accuracy_data()
+{
+    QTest::addColumn<double>("fraction");
+
+    QTest::newRow("minimum") << 0.0;
+    QTest::newRow("1 %") << 0.01;
+    QTest::newRow("10 %") << 0.1;
+    QTest::newRow("median") << 0.5;
+    QTest::newRow("90 %") << 0.9;
+    QTest::newRow("99 %") << 0.99;
+    QTest::newRow("maximum") << 1.0;
+}
+
+// Quantiles are off by less than half a percent of the values, the extremes are exact.
+void TestQuantileSketch::accuracy()
+{
+    QFETCH(double, fraction);
+
+    QuantileSketch sketch;
+
+    for(auto i = 0; i < valueCount; i++)
+    {
+        sketch.add(value(i));
+    }
+
+    QCOMPARE(sketch.count(), double(valueCount));
+
+    auto expected = fraction * (valueCount - 1);
+    auto quantile = sketch.quantile(fraction);
+
+    if(fraction == 0.0 || fraction == 1.0)
+    {
+        QCOMPARE(quantile, expected);
+    }
+    else
+    {
+        QVERIFY2(std::abs(quantile - expected) < 0.005 * valueCount, qPrintable(QString::number(quantile)));
+    }
+}
+
+// Sketches of two halves of the values merged give the quantiles of all values.
+void TestQuantileSketch::mergeEqualsAdding()
+{
+    QuantileSketch sketch;
+    QuantileSketch lowerSketch;
+    QuantileSketch upperSketch;
+
+    for(auto i = 0; i < valueCount; i++)
+    {
+        sketch.add(value(i));
+        (value(i) < valueCount / 2 ? lowerSketch : upperSketch).add(value(i));
+    }
+
+    lowerSketch.merge(upperSketch);
+
+    QCOMPARE(lowerSketch.count(), sketch.count());
+    QCOMPARE(lowerSketch.quantile(0.0), 0.0);
+    QCOMPARE(lowerSketch.quantile(1.0), double(valueCount - 1));
+
+    for(auto fraction : {0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99})
+    {
+        QVERIFY2(std::abs(lowerSketch.quantile(fraction) - sketch.quantile(fraction)) < 0.005 * valueCount,
+                 qPrintable(QString::number(fraction)));
+    }
+}
+
+// A sketch read back from a data stream gives the same quantiles and keeps merging.
+void TestQuantileSketch::dataStreamRoundTrip()
+{
+    QuantileSketch sketch(50.0);
+
+    for(auto i = 0; i < valueCount / 2; i++)
+    {
+        sketch.add(value(i));
+    }
+
+    QByteArray data;
+
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << sketch;
+    }
+
+    QuantileSketch readSketch;
+    QDataStream stream(data);
+
+    stream >> readSketch;
+
+    QCOMPARE(stream.status(), QDataStream::Ok);
+    QCOMPARE(readSketch.count(), sketch.count());
+
+    for(auto fraction : {0.0, 0.01, 0.5, 0.99, 1.0})
+    {
+        QCOMPARE(readSketch.quantile(fraction), sketch.quantile(fraction));
+    }
+
+    QuantileSketch otherSketch(50.0);
+
+    for(auto i = valueCount / 2; i < valueCount; i++)
+    {
+        otherSketch.add(value(i));
+    }
+
+    readSketch.merge(otherSketch);
+
+    QCOMPARE(readSketch.count(), double(valueCount));
+    QVERIFY(std::abs(readSketch.quantile(0.5) - (valueCount - 1) / 2.0) < 0.005 * valueCount);
+}
+
+QTEST_MAIN(TestQuantileSketch)
+
+#include "tst_quantilesketch.moc"
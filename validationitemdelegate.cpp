@@ -0,0 +1,40 @@
+#include "validationitemdelegate.h"
+#include "patienttablemodel.h"
+#include <QPainter>
+#include <QPolygon>
+
+const static int invalidCellMarkerSizePixels = 7;
+
+ValidationItemDelegate::ValidationItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void ValidationItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyledItemDelegate::paint(painter, option, index);
+
+    if(!index.data(PatientTableModel::InvalidCellRole).toBool())
+    {
+        return;
+    }
+
+    painter->save();
+
+    // Frame around the cell.
+    painter->setPen(QPen(Qt::red, 1));
+    painter->setBrush(Qt::NoBrush);
+    painter->drawRect(option.rect.adjusted(0, 0, -1, -1));
+
+    // Marker in the top right corner of the cell.
+    QPolygon marker;
+    marker << option.rect.topRight()
+           << option.rect.topRight() - QPoint(invalidCellMarkerSizePixels, 0)
+           << option.rect.topRight() + QPoint(0, invalidCellMarkerSizePixels);
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(Qt::red);
+    painter->drawPolygon(marker);
+
+    painter->restore();
+}
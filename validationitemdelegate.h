@@ -0,0 +1,18 @@
+#ifndef VALIDATIONITEMDELEGATE_H
+#define VALIDATIONITEMDELEGATE_H
+
+#include <QtWidgets/QStyledItemDelegate>
+
+// Item delegate decorating cells the model reports as invalid (PatientTableModel::InvalidCellRole)
+// with a red frame and corner marker instead of interrupting the user with a dialog.
+class ValidationItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit ValidationItemDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // VALIDATIONITEMDELEGATE_H